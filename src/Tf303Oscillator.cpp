@@ -3,12 +3,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 
 #include "plugin.hpp"
 #include "components.hpp"
+#include "expander.hpp"
 #include "tfdsp/control.hpp"
+#include "tfdsp/handoff.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 
 struct Tf303Oscillator : Module
@@ -51,14 +56,25 @@ struct Tf303Oscillator : Module
 
 	using OscillatorX2 = tfdsp::Tb303Oscillator<tfdsp::X2Resampler_Order7>;
 	using OscillatorX4 = tfdsp::Tb303Oscillator<tfdsp::X4Resampler_Order7>;
-	std::array<std::unique_ptr<OscillatorX2>, PORT_MAX_CHANNELS> oscillatorsX2;
-	std::array<std::unique_ptr<OscillatorX4>, PORT_MAX_CHANNELS> oscillatorsX4;
+	// Created by the widget for the channels in use and the selected path only.
+	tfdsp::OversamplingPaths<OscillatorX2, OscillatorX4, PORT_MAX_CHANNELS>
+		oscillators{ 1 };
 	std::array<dsp::SchmittTrigger, PORT_MAX_CHANNELS> slideTriggers{};
 	std::array<tfdsp::FractionalSchmittTrigger,
 		PORT_MAX_CHANNELS> syncTriggers{};
 	// 4x is the quality default; 2x remains available for dense polyphonic use.
 	int oversampling = 1;
-	int activeOversampling = 1;
+	// Index of a tfdsp::QualityTier; the models run its solver settings.
+	int quality = 1;
+	int configuredQuality = 1;
+	std::atomic<int> usedChannels{ 1 };
+	float sampleRate = 48000.0f;
+	// Opt-in: hand the undecimated mix to a 303 Voice Core directly to the
+	// right, which then ignores its unpatched IN.
+	bool expanderBus = false;
+	std::uint64_t busSequence{};
+	// Whether the previous frame ran the host-rate decimators.
+	bool decimated = true;
 
 	Tf303Oscillator()
 	{
@@ -95,56 +111,88 @@ struct Tf303Oscillator : Module
 		configOutput(CV_OUTPUT, "Post-slide pitch CV");
 		configOutput(AUDIO_OUTPUT, "Audio");
 
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			oscillatorsX2[channel] = std::make_unique<OscillatorX2>(
-				tfdsp::CreateX2Resampler_Chebychev7);
-			oscillatorsX4[channel] = std::make_unique<OscillatorX4>(
-				tfdsp::CreateX4Resampler_Cheby7);
-		}
+		// Without a widget to prepare models later, allocate every channel now.
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS : 1);
 		SetSampleRate(APP->engine->getSampleRate());
 	}
 
-	void SetSampleRate(float sampleRate)
+	/** Creates the models process() needs and frees those it stopped using.
+	 * Called from the widget's step(), never from process(). */
+	void PrepareModels(int channels)
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			oscillatorsX2[channel]->SetSampleRate(sampleRate);
-			oscillatorsX4[channel]->SetSampleRate(sampleRate);
-		}
+		oscillators.Prepare(oversampling,
+			[channels](int channel) { return channel < channels; },
+			[]() { return std::make_unique<OscillatorX2>(
+				tfdsp::CreateX2Resampler_Chebychev7); },
+			[]() { return std::make_unique<OscillatorX4>(
+				tfdsp::CreateX4Resampler_Cheby7); });
+	}
+
+	void SetSampleRate(float nextSampleRate)
+	{
+		sampleRate = nextSampleRate;
+		oscillators.Invalidate();
 	}
 
 	void ResetDsp()
 	{
+		oscillators.Invalidate();
 		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
 		{
-			oscillatorsX2[channel]->Reset();
-			oscillatorsX4[channel]->Reset();
 			slideTriggers[channel].reset();
 			syncTriggers[channel].Reset();
 		}
 	}
 
+	/** The expander message of a 303 Voice Core directly to the right, if the
+	 * bus is enabled and there is one. */
+	OversampledAudioBus* VoiceCoreBus()
+	{
+		Module* voiceCore = rightExpander.module;
+		if (!expanderBus || !voiceCore || voiceCore->model != modelTf303VoiceCore)
+			return nullptr;
+		return static_cast<OversampledAudioBus*>(
+			voiceCore->leftExpander.producerMessage);
+	}
+
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
+
 	void process(const ProcessArgs& args) override
 	{
+		TF_PROFILE_MODULE(profile);
 		oversampling = std::clamp(oversampling, 0, 1);
-		if (activeOversampling != oversampling)
-		{
-			activeOversampling = oversampling;
-			for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-			{
-				if (activeOversampling == 0)
-					oscillatorsX2[channel]->Reset();
-				else
-					oscillatorsX4[channel]->Reset();
-			}
-		}
 		const int channels = std::clamp(std::max({
 			inputs[VOCT_INPUT].getChannels(), inputs[SLIDE_INPUT].getChannels(),
 			inputs[TIME_INPUT].getChannels(), inputs[FM_INPUT].getChannels(),
 			inputs[SYNC_INPUT].getChannels(),
 			inputs[SHAPE_INPUT].getChannels(),
 			inputs[WAVE_INPUT].getChannels(), 1}), 1, PORT_MAX_CHANNELS);
+		usedChannels.store(channels, std::memory_order_relaxed);
+		const tfdsp::NewtonSolverSettings shaperSolver = tfdsp::QualitySettingsFor(
+			tfdsp::QualityTierAt(quality)).squareShaper;
+		// A new tier only changes the solver, so the oscillators keep playing;
+		// models configured later pick it up in `configure`.
+		if (quality != configuredQuality)
+		{
+			configuredQuality = quality;
+			oscillators.ForEachPublished([&shaperSolver](auto& oscillator)
+			{
+				oscillator.SetSolverSettings(shaperSolver);
+			});
+		}
+		// The switch waits until the widget has created the new path, which
+		// then starts from reset.
+		oscillators.BeginProcess(oversampling,
+			[channels](int channel) { return channel < channels; });
+		const int activeOversampling = oscillators.Active();
+		const auto configure = [this, &shaperSolver](auto& oscillator)
+		{
+			oscillator.SetSampleRate(sampleRate);
+			oscillator.SetSolverSettings(shaperSolver);
+			oscillator.Reset();
+		};
 		outputs[CV_OUTPUT].setChannels(channels);
 		outputs[AUDIO_OUTPUT].setChannels(channels);
 
@@ -159,6 +207,27 @@ struct Tf303Oscillator : Module
 		const double shapeAmount = params[SHAPE_AMOUNT].getValue();
 		const double waveAmount = params[WAVE_AMOUNT].getValue();
 		const bool linearFm = params[FM_MODE].getValue() > 0.5f;
+		// With a voice core to the right, hand it the undecimated mix; only
+		// decimate it here as well if AUDIO OUT is patched.
+		OversampledAudioBus* bus = VoiceCoreBus();
+		const bool audioPatched = outputs[AUDIO_OUTPUT].isConnected();
+		// Decimators skipped while only the bus was fed hold stale history;
+		// clear them before their output is heard again.
+		const bool decimating = !bus || audioPatched;
+		if (decimating && !decimated)
+		{
+			oscillators.ForEachPublished([](auto& oscillator)
+			{
+				oscillator.ResetDecimators();
+			});
+		}
+		decimated = decimating;
+		if (bus)
+		{
+			bus->factor = activeOversampling == 0 ? 2 : 4;
+			bus->channels = channels;
+			bus->sequence = ++busSequence;
+		}
 
 		for (int channel = 0; channel < channels; ++channel)
 		{
@@ -182,25 +251,47 @@ struct Tf303Oscillator : Module
 				finiteInput(SYNC_INPUT));
 			const double syncCrossing = syncEvent.triggered ?
 				syncEvent.position : -1.0;
-			float renderedPitch;
-			float renderedAudio;
-			if (activeOversampling == 0)
+			// A channel whose oscillator is still being created stays silent.
+			float renderedPitch = 0.0f;
+			float renderedAudio = 0.0f;
+			const auto render = [&](auto& oscillator, auto* busFrame)
 			{
-				const auto rendered = oscillatorsX2[channel]->Step(
+				if (!busFrame)
+				{
+					const auto rendered = oscillator.Step(
+						finiteInput(VOCT_INPUT), slide,
+						slideTime, tuningOffset, fmAmount * finiteInput(FM_INPUT),
+						linearFm, shape, wave, syncCrossing);
+					renderedPitch = rendered.pitch;
+					renderedAudio = rendered.mixed;
+					return;
+				}
+				const auto rendered = oscillator.StepOversampled(
 					finiteInput(VOCT_INPUT), slide,
 					slideTime, tuningOffset, fmAmount * finiteInput(FM_INPUT),
 					linearFm, shape, wave, syncCrossing);
+				*busFrame = rendered.mixed;
 				renderedPitch = rendered.pitch;
-				renderedAudio = rendered.mixed;
+				if (audioPatched)
+					renderedAudio = oscillator.DecimateMixed(rendered.mixed);
+			};
+			if (activeOversampling == 0)
+			{
+				auto* busFrame = bus ? &bus->framesX2[channel] : nullptr;
+				if (OscillatorX2* oscillator =
+					oscillators.x2.Acquire(channel, configure))
+					render(*oscillator, busFrame);
+				else if (busFrame)
+					busFrame->setZero();
 			}
 			else
 			{
-				const auto rendered = oscillatorsX4[channel]->Step(
-					finiteInput(VOCT_INPUT), slide,
-					slideTime, tuningOffset, fmAmount * finiteInput(FM_INPUT),
-					linearFm, shape, wave, syncCrossing);
-				renderedPitch = rendered.pitch;
-				renderedAudio = rendered.mixed;
+				auto* busFrame = bus ? &bus->framesX4[channel] : nullptr;
+				if (OscillatorX4* oscillator =
+					oscillators.x4.Acquire(channel, configure))
+					render(*oscillator, busFrame);
+				else if (busFrame)
+					busFrame->setZero();
 			}
 			outputs[CV_OUTPUT].setVoltage(static_cast<float>(
 				tfdsp::RackOutputAdapter::ProcessPostDecimation(renderedPitch)),
@@ -208,12 +299,16 @@ struct Tf303Oscillator : Module
 			outputs[AUDIO_OUTPUT].setVoltage(
 				std::isfinite(renderedAudio) ? renderedAudio : 0.0f, channel);
 		}
+		if (bus)
+			rightExpander.module->leftExpander.requestMessageFlip();
 	}
 
 	json_t* dataToJson() override
 	{
 		json_t* root = json_object();
 		json_object_set_new(root, "oversampling", json_integer(oversampling));
+		json_object_set_new(root, "quality", json_integer(quality));
+		json_object_set_new(root, "expanderBus", json_boolean(expanderBus));
 		return root;
 	}
 
@@ -222,13 +317,21 @@ struct Tf303Oscillator : Module
 		if (json_t* value = json_object_get(root, "oversampling"))
 			oversampling = std::clamp(
 				static_cast<int>(json_integer_value(value)), 0, 1);
+		if (json_t* value = json_object_get(root, "quality"))
+			quality = static_cast<int>(tfdsp::QualityTierAt(
+				static_cast<int>(json_integer_value(value))));
+		if (json_t* value = json_object_get(root, "expanderBus"))
+			expanderBus = json_is_true(value);
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS :
+			usedChannels.load(std::memory_order_relaxed));
 	}
 
 	void onReset(const ResetEvent& event) override
 	{
 		Module::onReset(event);
 		oversampling = 1;
-		activeOversampling = 1;
+		quality = 1;
+		expanderBus = false;
 		ResetDsp();
 	}
 
@@ -302,14 +405,29 @@ struct Tf303OscillatorWidget : ModuleWidget
 			Tf303Oscillator::AUDIO_OUTPUT));
 	}
 
+	void step() override
+	{
+		if (Tf303Oscillator* oscillator = dynamic_cast<Tf303Oscillator*>(module))
+			oscillator->PrepareModels(
+				oscillator->usedChannels.load(std::memory_order_relaxed));
+		ModuleWidget::step();
+	}
+
 	void appendContextMenu(Menu* menu) override
 	{
 		Tf303Oscillator* module = dynamic_cast<Tf303Oscillator*>(this->module);
 		if (!module)
 			return;
 		menu->addChild(new MenuSeparator);
+		appendQualityMenu(menu, &module->quality, &module->oversampling);
 		menu->addChild(createIndexPtrSubmenuItem("Oversampling",
 			{"2x (lower CPU)", "4x (default)"}, &module->oversampling));
+		menu->addChild(createBoolPtrMenuItem(
+			"Send oversampled mix to 303 Voice Core on the right", "",
+			&module->expanderBus));
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "Tf303Oscillator");
+#endif
 	}
 };
 
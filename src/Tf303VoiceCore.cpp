@@ -3,12 +3,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 
 #include "plugin.hpp"
 #include "components.hpp"
+#include "expander.hpp"
 #include "tfdsp/filters.hpp"
+#include "tfdsp/handoff.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 
 struct Tf303VoiceCore : Module
@@ -58,18 +63,47 @@ struct Tf303VoiceCore : Module
 
 	using FilterX2 = tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7>;
 	using FilterX4 = tfdsp::DiodeLadderFilter<tfdsp::X4Resampler_Order7>;
-	std::array<std::unique_ptr<FilterX2>, PORT_MAX_CHANNELS> filtersX2;
-	std::array<std::unique_ptr<FilterX4>, PORT_MAX_CHANNELS> filtersX4;
-	std::array<tfdsp::FirstOrderHighPassZdf<float>, PORT_MAX_CHANNELS> fmHighPass{};
-	std::array<tfdsp::Tb303Articulation, PORT_MAX_CHANNELS> articulations{};
-	std::array<tfdsp::Tb303Vca, PORT_MAX_CHANNELS> vcasX2{};
-	std::array<tfdsp::Tb303Vca, PORT_MAX_CHANNELS> vcasX4{};
+	using BusConverter = tfdsp::X2X4FrameConverter<tfdsp::X2Resampler_Order7>;
+	// The filter embeds its resamplers, so each voice is one contiguous
+	// allocation, in the order process() steps through it.
+	// The converter takes expander frames from an oscillator running the
+	// other oversampling factor.
+	struct alignas(tfdsp::CacheLineSize) VoiceX2
+	{
+		FilterX2 filter{ tfdsp::MakeX2Resampler_Chebychev7() };
+		tfdsp::Tb303Vca vca{};
+		BusConverter busConverter{ tfdsp::MakeX2Resampler_Chebychev7() };
+	};
+	struct alignas(tfdsp::CacheLineSize) VoiceX4
+	{
+		FilterX4 filter{ tfdsp::MakeX4Resampler_Cheby7() };
+		tfdsp::Tb303Vca vca{};
+		BusConverter busConverter{ tfdsp::MakeX2Resampler_Chebychev7() };
+	};
+	// Host-rate state of one channel. It outlives oversampling path switches,
+	// so it stays outside the voices.
+	struct alignas(tfdsp::CacheLineSize) ChannelState
+	{
+		tfdsp::Tb303Articulation articulation;
+		tfdsp::FirstOrderHighPassZdf<float> fmHighPass;
+	};
+	// Filter and VCA per channel and oversampling path, created by the widget
+	// for the channels in use and the selected path only.
+	tfdsp::OversamplingPaths<VoiceX2, VoiceX4, PORT_MAX_CHANNELS> voices{ 1 };
+	std::array<ChannelState, PORT_MAX_CHANNELS> channelStates{};
+	std::atomic<int> usedChannels{ 1 };
+	// Left expander buffers, written by an adjacent 303 Oscillator.
+	std::array<OversampledAudioBus, 2> busMessages{};
+	std::uint64_t lastBusSequence{};
 
 	// 0 = 2x, 1 = 4x. Four-times is the quality-first default; 2x roughly
 	// doubles throughput and remains useful for large polyphonic patches.
 	int oversampling = 1;
-	int activeOversampling = 1;
+	// Index of a tfdsp::QualityTier; the models run its solver settings.
+	int quality = 1;
+	int configuredQuality = 1;
 	int articulationMode = 0;
+	float sampleRate = 48000.0f;
 	float normalizedFmHighPass{};
 
 	Tf303VoiceCore()
@@ -133,73 +167,110 @@ struct Tf303VoiceCore : Module
 		configOutput(VCA_OUTPUT, "VCA audio");
 		configBypass(AUDIO_INPUT, LP_OUTPUT);
 		configBypass(AUDIO_INPUT, VCA_OUTPUT);
+		leftExpander.producerMessage = &busMessages[0];
+		leftExpander.consumerMessage = &busMessages[1];
 
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			filtersX2[channel] = std::make_unique<FilterX2>(
-				tfdsp::CreateX2Resampler_Chebychev7);
-			filtersX4[channel] = std::make_unique<FilterX4>(
-				tfdsp::CreateX4Resampler_Cheby7);
-		}
+		// Without a widget to prepare models later, allocate every channel now.
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS : 1);
 		SetSampleRate(APP->engine->getSampleRate());
 	}
 
-	void SetSampleRate(float sampleRate)
+	/** Creates the models process() needs and frees those it stopped using.
+	 * Called from the widget's step(), never from process(). */
+	void PrepareModels(int channels)
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
+		voices.Prepare(oversampling,
+			[channels](int channel) { return channel < channels; },
+			[]() { return std::make_unique<VoiceX2>(); },
+			[]() { return std::make_unique<VoiceX4>(); });
+	}
+
+	void SetSampleRate(float nextSampleRate)
+	{
+		sampleRate = nextSampleRate;
+		for (auto& state : channelStates)
 		{
-			filtersX2[channel]->SetSampleRate(sampleRate);
-			filtersX4[channel]->SetSampleRate(sampleRate);
-			fmHighPass[channel].Reset();
-			articulations[channel].SetSampleRate(sampleRate);
-			vcasX2[channel].SetSampleRate(2.0 * sampleRate);
-			vcasX4[channel].SetSampleRate(4.0 * sampleRate);
+			state.fmHighPass.Reset();
+			state.articulation.SetSampleRate(sampleRate);
 		}
 		normalizedFmHighPass = 5.0f / (0.5f * sampleRate);
+		voices.Invalidate();
 	}
 
 	void ResetDsp()
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
+		for (auto& state : channelStates)
 		{
-			filtersX2[channel]->Reset();
-			filtersX4[channel]->Reset();
-			fmHighPass[channel].Reset();
-			articulations[channel].Reset();
-			vcasX2[channel].Reset();
-			vcasX4[channel].Reset();
+			state.fmHighPass.Reset();
+			state.articulation.Reset();
 		}
+		voices.Invalidate();
 	}
 
-	void ResetActiveFilter()
+	/** This sample's oscillator frames when a 303 Oscillator sits directly to
+	 * the left and IN is unpatched, otherwise nullptr. */
+	const OversampledAudioBus* OscillatorBus()
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			if (activeOversampling == 0)
-			{
-				filtersX2[channel]->Reset();
-				vcasX2[channel].Reset();
-			}
-			else
-			{
-				filtersX4[channel]->Reset();
-				vcasX4[channel].Reset();
-			}
-		}
+		Module* oscillator = leftExpander.module;
+		if (!oscillator || oscillator->model != modelTf303Oscillator ||
+			inputs[AUDIO_INPUT].isConnected())
+			return nullptr;
+		const auto* bus = static_cast<const OversampledAudioBus*>(
+			leftExpander.consumerMessage);
+		if (bus->sequence == lastBusSequence)
+			return nullptr;
+		lastBusSequence = bus->sequence;
+		return bus;
 	}
 
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
+
 	void process(const ProcessArgs& args) override
 	{
+		TF_PROFILE_MODULE(profile);
 		oversampling = std::clamp(oversampling, 0, 1);
-		if (activeOversampling != oversampling)
+		const OversampledAudioBus* bus = OscillatorBus();
+		const int channels = bus ? std::clamp(bus->channels, 1, PORT_MAX_CHANNELS) :
+			std::max(inputs[AUDIO_INPUT].getChannels(), 1);
+		usedChannels.store(channels, std::memory_order_relaxed);
+		const tfdsp::NewtonSolverSettings ladderSolver = tfdsp::QualitySettingsFor(
+			tfdsp::QualityTierAt(quality)).ladderFilter;
+		// A new tier only changes the ladder solve, so the voices keep playing;
+		// models configured later pick it up in `configure`.
+		if (quality != configuredQuality)
 		{
-			activeOversampling = oversampling;
-			// Changing quality invalidates the selected resamplers and the VCA's
-			// rate-dependent C38 coupling state. Articulation remains continuous.
-			ResetActiveFilter();
+			configuredQuality = quality;
+			voices.ForEachPublished([&ladderSolver](auto& voice)
+			{
+				voice.filter.SetSolverSettings(ladderSolver);
+			});
 		}
-
-		const int channels = std::max(inputs[AUDIO_INPUT].getChannels(), 1);
+		// The switch waits until the widget has created the new path. Its
+		// resamplers and the VCA's rate-dependent C38 coupling state start from
+		// reset; articulation remains continuous.
+		voices.BeginProcess(oversampling,
+			[channels](int channel) { return channel < channels; });
+		const int activeOversampling = voices.Active();
+		const auto configureX2 = [this, &ladderSolver](VoiceX2& voice)
+		{
+			voice.filter.SetSampleRate(sampleRate);
+			voice.filter.SetSolverSettings(ladderSolver);
+			voice.filter.Reset();
+			voice.vca.SetSampleRate(2.0 * sampleRate);
+			voice.vca.Reset();
+			voice.busConverter.Reset();
+		};
+		const auto configureX4 = [this, &ladderSolver](VoiceX4& voice)
+		{
+			voice.filter.SetSampleRate(sampleRate);
+			voice.filter.SetSolverSettings(ladderSolver);
+			voice.filter.Reset();
+			voice.vca.SetSampleRate(4.0 * sampleRate);
+			voice.vca.Reset();
+			voice.busConverter.Reset();
+		};
 		outputs[LP_OUTPUT].setChannels(channels);
 		outputs[VCA_OUTPUT].setChannels(channels);
 		const float cutoffKnob = params[CUTOFF].getValue();
@@ -228,10 +299,11 @@ struct Tf303VoiceCore : Module
 
 		for (int channel = 0; channel < channels; ++channel)
 		{
-			articulations[channel].SetMode(articulationMode == 0 ?
+			ChannelState& state = channelStates[channel];
+			state.articulation.SetMode(articulationMode == 0 ?
 				tfdsp::Tb303Articulation::Mode::Stock :
 				tfdsp::Tb303Articulation::Mode::DevilFish);
-			articulations[channel].SetAccentSweepMode(
+			state.articulation.SetAccentSweepMode(
 				static_cast<tfdsp::Tb303AccentSweep::Mode>(
 					std::clamp(accentSweepMode, 0, 3)));
 			const float audio = inputs[AUDIO_INPUT].getPolyVoltage(channel);
@@ -245,7 +317,7 @@ struct Tf303VoiceCore : Module
 			const float finiteAudio = std::isfinite(audio) ? audio : 0.0f;
 			const double resonance = resonanceKnob + resonanceAmount *
 				(std::isfinite(resonanceCv) ? resonanceCv / 10.0f : 0.0f);
-			const auto envelope = articulations[channel].Step(gate, accent,
+			const auto envelope = state.articulation.Step(gate, accent,
 				resonance, normalDecay, accentDecay, vcaDecay);
 			// The Q9/R64/R65 bias makes Env Mod scale the envelope around an
 			// approximately 31.37% pivot instead of simply adding a positive
@@ -261,7 +333,7 @@ struct Tf303VoiceCore : Module
 				(std::isfinite(voct) ? voct : 0.0f) + cvAmount *
 				(std::isfinite(cv) ? cv : 0.0f) + envelopePitch;
 			const double log2CutoffHz = log2C4 + pitch;
-			const float acFm = fmHighPass[channel](
+			const float acFm = state.fmHighPass(
 				std::isfinite(fm) ? fm : 0.0f, normalizedFmHighPass);
 			// Linear-Hz modulation. At full amount a nominal +/-5 V Rack
 			// signal sweeps +/-1 kHz, keeping the negative half-cycle useful
@@ -276,38 +348,54 @@ struct Tf303VoiceCore : Module
 
 			float output = 0.0f;
 			float vcaOutput = 0.0f;
-			if (activeOversampling == 0)
+			// A channel whose models are still being created stays silent.
+			const auto render = [&](auto& voice, const auto* busFrame)
 			{
-				const auto rendered =
-					filtersX2[channel]->StepWithPostProcessorLogCutoffModulated(
-					finiteAudio, log2CutoffHz, linearFmHz, resonance,
-					highResonance, driveGain, bass, baseVcaControl,
-					[&](double audioValue, double control)
-					{
-						return vcasX2[channel].Step(audioValue, control,
-							vcaAccentControl);
-					});
+				const auto vca = [&](double audioValue, double control)
+				{
+					return voice.vca.Step(audioValue, control, vcaAccentControl);
+				};
+				const auto rendered = busFrame ?
+					voice.filter.StepWithPostProcessorOversampledInput(*busFrame,
+						log2CutoffHz, linearFmHz, resonance, highResonance,
+						driveGain, bass, baseVcaControl, vca) :
+					voice.filter.StepWithPostProcessorLogCutoffModulated(
+						finiteAudio, log2CutoffHz, linearFmHz, resonance,
+						highResonance, driveGain, bass, baseVcaControl, vca);
 				output = rendered.lowPass;
 				vcaOutput = rendered.postProcessed;
-			}
-			else
+			};
+			// Frames from an oscillator at the other factor pass through the
+			// voice's half-band converter instead of the host rate.
+			if (activeOversampling == 0)
 			{
-				const auto rendered =
-					filtersX4[channel]->StepWithPostProcessorLogCutoffModulated(
-					finiteAudio, log2CutoffHz, linearFmHz, resonance,
-					highResonance, driveGain, bass, baseVcaControl,
-					[&](double audioValue, double control)
+				if (VoiceX2* voice = voices.x2.Acquire(channel, configureX2))
+				{
+					Eigen::Array<double, 2, 1> converted;
+					if (bus && bus->factor == 4)
 					{
-						return vcasX4[channel].Step(audioValue, control,
-							vcaAccentControl);
-					});
-				output = rendered.lowPass;
-				vcaOutput = rendered.postProcessed;
+						TF_PROFILE_SCOPE(Resampling);
+						converted = voice->busConverter.Downsample(bus->framesX4[channel]);
+					}
+					render(*voice, !bus ? nullptr :
+						bus->factor == 2 ? &bus->framesX2[channel] : &converted);
+				}
+			}
+			else if (VoiceX4* voice = voices.x4.Acquire(channel, configureX4))
+			{
+				Eigen::Array<double, 4, 1> converted;
+				if (bus && bus->factor == 2)
+				{
+					TF_PROFILE_SCOPE(Resampling);
+					converted = voice->busConverter.Upsample(bus->framesX2[channel]);
+				}
+				render(*voice, !bus ? nullptr :
+					bus->factor == 4 ? &bus->framesX4[channel] : &converted);
 			}
-			outputs[LP_OUTPUT].setVoltage(
-				std::isfinite(output) ? output : 0.0f, channel);
-			outputs[VCA_OUTPUT].setVoltage(std::isfinite(vcaOutput) ?
-				vcaOutput : 0.0f, channel);
+			output = std::isfinite(output) ? output : 0.0f;
+			vcaOutput = std::isfinite(vcaOutput) ? vcaOutput : 0.0f;
+			outputs[LP_OUTPUT].setVoltage(output, channel);
+			outputs[VCA_OUTPUT].setVoltage(vcaOutput, channel);
 		}
 	}
 
@@ -315,6 +403,7 @@ struct Tf303VoiceCore : Module
 	{
 		json_t* root = json_object();
 		json_object_set_new(root, "oversampling", json_integer(oversampling));
+		json_object_set_new(root, "quality", json_integer(quality));
 		json_object_set_new(root, "articulationMode", json_integer(articulationMode));
 		return root;
 	}
@@ -323,6 +412,9 @@ struct Tf303VoiceCore : Module
 	{
 		if (json_t* value = json_object_get(root, "oversampling"))
 			oversampling = std::clamp(static_cast<int>(json_integer_value(value)), 0, 1);
+		if (json_t* value = json_object_get(root, "quality"))
+			quality = static_cast<int>(tfdsp::QualityTierAt(
+				static_cast<int>(json_integer_value(value))));
 		if (json_t* value = json_object_get(root, "articulationMode"))
 			articulationMode = std::clamp(
 				static_cast<int>(json_integer_value(value)), 0, 1);
@@ -331,13 +423,15 @@ struct Tf303VoiceCore : Module
 		if (json_t* value = json_object_get(root, "accentSweepMode"))
 			params[ACCENT_SWEEP_MODE].setValue(static_cast<float>(std::clamp(
 				static_cast<int>(json_integer_value(value)), 0, 3)));
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS :
+			usedChannels.load(std::memory_order_relaxed));
 	}
 
 	void onReset(const ResetEvent& event) override
 	{
 		Module::onReset(event);
 		oversampling = 1;
-		activeOversampling = 1;
+		quality = 1;
 		articulationMode = 0;
 		ResetDsp();
 	}
@@ -427,16 +521,28 @@ struct Tf303VoiceCoreWidget : ModuleWidget
 			Tf303VoiceCore::VCA_OUTPUT));
 	}
 
+	void step() override
+	{
+		if (Tf303VoiceCore* voiceCore = dynamic_cast<Tf303VoiceCore*>(module))
+			voiceCore->PrepareModels(
+				voiceCore->usedChannels.load(std::memory_order_relaxed));
+		ModuleWidget::step();
+	}
+
 	void appendContextMenu(Menu* menu) override
 	{
 		Tf303VoiceCore* module = dynamic_cast<Tf303VoiceCore*>(this->module);
 		if (!module)
 			return;
 		menu->addChild(new MenuSeparator);
+		appendQualityMenu(menu, &module->quality, &module->oversampling);
 		menu->addChild(createIndexPtrSubmenuItem("Oversampling",
 			{"2x", "4x"}, &module->oversampling));
 		menu->addChild(createIndexPtrSubmenuItem("Articulation",
 			{"TB-303", "Devil Fish"}, &module->articulationMode));
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "Tf303VoiceCore");
+#endif
 	}
 };
 
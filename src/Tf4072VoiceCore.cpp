@@ -4,11 +4,14 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <memory>
 
 #include "plugin.hpp"
 #include "components.hpp"
+#include "tfdsp/handoff.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 
 struct Tf4072VoiceCore : Module
@@ -84,19 +87,41 @@ struct Tf4072VoiceCore : Module
 	using VcaX4 = tfdsp::Arp4019Vca<tfdsp::X4Resampler_Order7>;
 	static constexpr double LinearFilterModulationHzPerVolt = 200.0;
 
-	std::array<std::unique_ptr<FilterX2>, PORT_MAX_CHANNELS> filtersX2;
-	std::array<std::unique_ptr<FilterX4>, PORT_MAX_CHANNELS> filtersX4;
-	std::array<std::unique_ptr<VcaX2>, PORT_MAX_CHANNELS> vcasX2;
-	std::array<std::unique_ptr<VcaX4>, PORT_MAX_CHANNELS> vcasX4;
-	std::array<tfdsp::ArpEnvelope, PORT_MAX_CHANNELS> filterEnvelopes{};
-	std::array<tfdsp::ArpEnvelope, PORT_MAX_CHANNELS> ampEnvelopes{};
+	// The models embed their resamplers, so each voice is one contiguous
+	// allocation, in the order process() steps through it.
+	struct alignas(tfdsp::CacheLineSize) VoiceX2
+	{
+		FilterX2 filter{ tfdsp::MakeX2Resampler_Chebychev7() };
+		VcaX2 vca{ tfdsp::MakeX2Resampler_Chebychev7() };
+	};
+	struct alignas(tfdsp::CacheLineSize) VoiceX4
+	{
+		FilterX4 filter{ tfdsp::MakeX4Resampler_Cheby7() };
+		VcaX4 vca{ tfdsp::MakeX4Resampler_Cheby7() };
+	};
+	// Host-rate state of one channel. It outlives oversampling path switches,
+	// so it stays outside the voices.
+	struct alignas(tfdsp::CacheLineSize) ChannelState
+	{
+		tfdsp::ArpEnvelope filterEnvelope;
+		tfdsp::ArpEnvelope ampEnvelope;
+	};
+
+	// Filter and VCA per channel and oversampling path, created by the widget
+	// for the channels in use and the selected path only.
+	tfdsp::OversamplingPaths<VoiceX2, VoiceX4, PORT_MAX_CHANNELS> voices{ 1 };
+	std::array<ChannelState, PORT_MAX_CHANNELS> channelStates{};
 	std::array<float, 4> filterStagePeaks{};
 	std::array<float, 4> ampStagePeaks{};
 	dsp::ClockDivider lightDivider;
 
 	int oversampling = 1;
-	int activeOversampling = 1;
+	// Index of a tfdsp::QualityTier; the filters run its solver settings.
+	int quality = 1;
+	int configuredQuality = 1;
 	int activeChannels = 0;
+	std::atomic<int> usedChannels{ 1 };
+	float sampleRate = 48000.0f;
 
 	Tf4072VoiceCore()
 	{
@@ -173,20 +198,21 @@ struct Tf4072VoiceCore : Module
 		configLight(AMP_DECAY_LIGHT, "Amplifier envelope decay");
 		configLight(AMP_SUSTAIN_LIGHT, "Amplifier envelope sustain");
 		configLight(AMP_RELEASE_LIGHT, "Amplifier envelope release");
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			filtersX2[channel] = std::make_unique<FilterX2>(
-				tfdsp::CreateX2Resampler_Chebychev7);
-			filtersX4[channel] = std::make_unique<FilterX4>(
-				tfdsp::CreateX4Resampler_Cheby7);
-			vcasX2[channel] = std::make_unique<VcaX2>(
-				tfdsp::CreateX2Resampler_Chebychev7);
-			vcasX4[channel] = std::make_unique<VcaX4>(
-				tfdsp::CreateX4Resampler_Cheby7);
-		}
+		// Without a widget to prepare models later, allocate every channel now.
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS : 1);
 		SetSampleRate(APP->engine->getSampleRate());
 	}
 
+	/** Creates the models process() needs and frees those it stopped using.
+	 * Called from the widget's step(), never from process(). */
+	void PrepareModels(int channels)
+	{
+		voices.Prepare(oversampling,
+			[channels](int channel) { return channel < channels; },
+			[]() { return std::make_unique<VoiceX2>(); },
+			[]() { return std::make_unique<VoiceX4>(); });
+	}
+
 	void ConfigureEnvelope(int attack, int decay, int sustain, int release,
 		const std::string& name, float defaultAttack, float defaultDecay,
 		float defaultSustain, float defaultRelease)
@@ -206,17 +232,15 @@ struct Tf4072VoiceCore : Module
 			1000.0f);
 	}
 
-	void SetSampleRate(float sampleRate)
+	void SetSampleRate(float nextSampleRate)
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
+		sampleRate = nextSampleRate;
+		for (auto& state : channelStates)
 		{
-			filtersX2[channel]->SetSampleRate(sampleRate);
-			filtersX4[channel]->SetSampleRate(sampleRate);
-			vcasX2[channel]->SetSampleRate(sampleRate);
-			vcasX4[channel]->SetSampleRate(sampleRate);
-			filterEnvelopes[channel].SetSampleRate(sampleRate);
-			ampEnvelopes[channel].SetSampleRate(sampleRate);
+			state.filterEnvelope.SetSampleRate(sampleRate);
+			state.ampEnvelope.SetSampleRate(sampleRate);
 		}
+		voices.Invalidate();
 	}
 
 	void ResetDsp()
@@ -233,12 +257,9 @@ struct Tf4072VoiceCore : Module
 
 	void ResetChannel(int channel)
 	{
-		filtersX2[channel]->Reset();
-		filtersX4[channel]->Reset();
-		vcasX2[channel]->Reset();
-		vcasX4[channel]->Reset();
-		filterEnvelopes[channel].Reset();
-		ampEnvelopes[channel].Reset();
+		voices.Invalidate(channel);
+		channelStates[channel].filterEnvelope.Reset();
+		channelStates[channel].ampEnvelope.Reset();
 	}
 
 	static int ActiveLightStage(const tfdsp::ArpEnvelope& envelope)
@@ -301,35 +322,43 @@ struct Tf4072VoiceCore : Module
 		ampStagePeaks.fill(0.0f);
 	}
 
-	void ResetActivePath()
-	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			if (activeOversampling == 0)
-			{
-				filtersX2[channel]->Reset();
-				vcasX2[channel]->Reset();
-			}
-			else
-			{
-				filtersX4[channel]->Reset();
-				vcasX4[channel]->Reset();
-			}
-		}
-	}
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
 
 	void process(const ProcessArgs& args) override
 	{
+		TF_PROFILE_MODULE(profile);
 		oversampling = std::clamp(oversampling, 0, 1);
-		if (oversampling != activeOversampling)
-		{
-			activeOversampling = oversampling;
-			ResetActivePath();
-		}
-
 		int channels = 1;
 		for (int input = 0; input < NUM_INPUTS; ++input)
 			channels = std::max(channels, inputs[input].getChannels());
+		usedChannels.store(channels, std::memory_order_relaxed);
+		const tfdsp::NewtonSolverSettings ladderSolver = tfdsp::QualitySettingsFor(
+			tfdsp::QualityTierAt(quality)).ladderFilter;
+		// A new tier only changes the ladder solve, so the voices keep playing;
+		// models configured later pick it up in `configure`.
+		if (quality != configuredQuality)
+		{
+			configuredQuality = quality;
+			voices.ForEachPublished([&ladderSolver](auto& voice)
+			{
+				voice.filter.SetSolverSettings(ladderSolver);
+			});
+		}
+		// The switch waits until the widget has created the new path, which
+		// then starts from reset.
+		voices.BeginProcess(oversampling,
+			[channels](int channel) { return channel < channels; });
+		const int activeOversampling = voices.Active();
+		const auto configure = [this, &ladderSolver](auto& voice)
+		{
+			voice.filter.SetSampleRate(sampleRate);
+			voice.filter.SetSolverSettings(ladderSolver);
+			voice.filter.Reset();
+			voice.vca.SetSampleRate(sampleRate);
+			voice.vca.Reset();
+		};
 		for (int channel = channels; channel < activeChannels; ++channel)
 			ResetChannel(channel);
 		activeChannels = channels;
@@ -380,20 +409,21 @@ struct Tf4072VoiceCore : Module
 
 		for (int channel = 0; channel < channels; ++channel)
 		{
+			ChannelState& state = channelStates[channel];
 			const double gate = inputs[GATE_INPUT].getPolyVoltage(channel);
 			const double trigger = inputs[TRIGGER_INPUT].getPolyVoltage(channel);
-			filterEnvelopes[channel].SetMode(
+			state.filterEnvelope.SetMode(
 				EnvelopeMode(params[FILTER_ENV_MODE].getValue()));
-			ampEnvelopes[channel].SetMode(
+			state.ampEnvelope.SetMode(
 				EnvelopeMode(params[AMP_ENV_MODE].getValue()));
-			const double filterEnvelope = 10.0 * filterEnvelopes[channel].Step(
+			const double filterEnvelope = 10.0 * state.filterEnvelope.Step(
 				gate, trigger, filterAttack, filterDecay, filterSustain,
 				filterRelease, envelopeCurve, autoGateTrigger);
-			const double ampEnvelope = 10.0 * ampEnvelopes[channel].Step(gate,
+			const double ampEnvelope = 10.0 * state.ampEnvelope.Step(gate,
 				trigger, ampAttack, ampDecay, ampSustain, ampRelease,
 				envelopeCurve, autoGateTrigger);
-			CaptureEnvelopeLight(filterEnvelopes[channel], filterStagePeaks);
-			CaptureEnvelopeLight(ampEnvelopes[channel], ampStagePeaks);
+			CaptureEnvelopeLight(state.filterEnvelope, filterStagePeaks);
+			CaptureEnvelopeLight(state.ampEnvelope, ampStagePeaks);
 			outputs[FILTER_ENV_OUTPUT].setVoltage(filterEnvelope, channel);
 			outputs[AMP_ENV_OUTPUT].setVoltage(ampEnvelope, channel);
 
@@ -425,55 +455,40 @@ struct Tf4072VoiceCore : Module
 
 			float lowPass = 0.0f;
 			float vcaOutput = 0.0f;
-			if (activeOversampling == 0)
+			// A channel whose models are still being created stays silent.
+			const auto render = [&](auto& voice)
 			{
 				if (vcaOverride)
 				{
-					lowPass = filtersX2[channel]->StepModulatedLogCutoff(audio,
+					lowPass = voice.filter.StepModulatedLogCutoff(audio,
 						log2CutoffHz, linearFilterModulationHz, resonance, driveGain);
-					vcaOutput = vcasX2[channel]->Step(
+					vcaOutput = voice.vca.Step(
 						inputs[VCA_AUDIO_INPUT].getPolyVoltage(channel), 0.0,
 						linearControl, exponentialControl, initialGain);
 				}
 				else
 				{
 					const auto rendered =
-						filtersX2[channel]->StepWithPostProcessorModulatedLogCutoff(
+						voice.filter.StepWithPostProcessorModulatedLogCutoff(
 						audio, log2CutoffHz, linearFilterModulationHz, resonance, driveGain,
 						linearControl, exponentialControl,
 						[&](double filtered, double linearCv, double exponentialCv)
 						{
-							return vcasX2[channel]->ProcessOversampled(filtered,
+							return voice.vca.ProcessOversampled(filtered,
 								linearCv, exponentialCv, initialGain);
 						});
 					lowPass = rendered.lowPass;
 					vcaOutput = rendered.postProcessed;
 				}
+			};
+			if (activeOversampling == 0)
+			{
+				if (VoiceX2* voice = voices.x2.Acquire(channel, configure))
+					render(*voice);
 			}
-			else
+			else if (VoiceX4* voice = voices.x4.Acquire(channel, configure))
 			{
-				if (vcaOverride)
-				{
-					lowPass = filtersX4[channel]->StepModulatedLogCutoff(audio,
-						log2CutoffHz, linearFilterModulationHz, resonance, driveGain);
-					vcaOutput = vcasX4[channel]->Step(
-						inputs[VCA_AUDIO_INPUT].getPolyVoltage(channel), 0.0,
-						linearControl, exponentialControl, initialGain);
-				}
-				else
-				{
-					const auto rendered =
-						filtersX4[channel]->StepWithPostProcessorModulatedLogCutoff(
-						audio, log2CutoffHz, linearFilterModulationHz, resonance, driveGain,
-						linearControl, exponentialControl,
-						[&](double filtered, double linearCv, double exponentialCv)
-						{
-							return vcasX4[channel]->ProcessOversampled(filtered,
-								linearCv, exponentialCv, initialGain);
-						});
-					lowPass = rendered.lowPass;
-					vcaOutput = rendered.postProcessed;
-				}
+				render(*voice);
 			}
 			outputs[LP_OUTPUT].setVoltage(lowPass, channel);
 			outputs[VCA_OUTPUT].setVoltage(vcaOutput, channel);
@@ -505,6 +520,7 @@ struct Tf4072VoiceCore : Module
 	{
 		json_t* root = json_object();
 		json_object_set_new(root, "oversampling", json_integer(oversampling));
+		json_object_set_new(root, "quality", json_integer(quality));
 		return root;
 	}
 
@@ -513,13 +529,18 @@ struct Tf4072VoiceCore : Module
 		if (json_t* value = json_object_get(root, "oversampling"))
 			oversampling = std::clamp(
 				static_cast<int>(json_integer_value(value)), 0, 1);
+		if (json_t* value = json_object_get(root, "quality"))
+			quality = static_cast<int>(tfdsp::QualityTierAt(
+				static_cast<int>(json_integer_value(value))));
+		PrepareModels(settings::headless ? PORT_MAX_CHANNELS :
+			usedChannels.load(std::memory_order_relaxed));
 	}
 
 	void onReset(const ResetEvent& event) override
 	{
 		Module::onReset(event);
 		oversampling = 1;
-		activeOversampling = 1;
+		quality = 1;
 		ResetDsp();
 	}
 
@@ -630,14 +651,26 @@ addParam(createParam<CKSS>(Vec(329, 241), module,
 			Tf4072VoiceCore::AMP_ENV_OUTPUT));
 	}
 
+	void step() override
+	{
+		if (Tf4072VoiceCore* voiceCore = dynamic_cast<Tf4072VoiceCore*>(module))
+			voiceCore->PrepareModels(
+				voiceCore->usedChannels.load(std::memory_order_relaxed));
+		ModuleWidget::step();
+	}
+
 	void appendContextMenu(Menu* menu) override
 	{
 		Tf4072VoiceCore* module = dynamic_cast<Tf4072VoiceCore*>(this->module);
 		if (!module)
 			return;
 		menu->addChild(new MenuSeparator);
+		appendQualityMenu(menu, &module->quality, &module->oversampling);
 		menu->addChild(createIndexPtrSubmenuItem("Oversampling",
 			{"2x (lower CPU)", "4x (default)"}, &module->oversampling));
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "Tf4072VoiceCore");
+#endif
 	}
 };
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <cmath>
 #include "plugin.hpp"
@@ -31,24 +32,23 @@ struct TfSlop : Module
 		NUM_LIGHTS
 	};
 
-	std::random_device _seed{};
-	std::minstd_rand _rng;
 	// 0.01 V/oct is a peak pitch deviation of 12 cents.
 	static constexpr float _maxHum{12.0f / 1200.0f};
 	static constexpr float _humFreq{60.0f};
+	// One supply hums into every channel.
 	tfdsp::RecursiveSineOscillator _humOscillator{};
 
-	// Temperature drift is modeled as an exact sampled OU process.
+	// Temperature drift is modeled as an exact sampled OU process per channel.
 	static constexpr double _tau{60.0}; //Time constant ( average decay time) in seconds
 	static constexpr double _sigmaCents{0.2 / 12};
 	static constexpr double _sigmaHz{2};
-	tfdsp::InterpolatedOrnsteinUhlenbeck _ou{};
+	tfdsp::OrnsteinUhlenbeckBank<PORT_MAX_CHANNELS, false> _drift{};
 	float _prevDetuneMode{};
 	float _sampleRate{44100.0f};
 
 	//----------------------------------------------------------------
 
-	TfSlop() : _rng(_seed())
+	TfSlop()
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(TfSlop::HUM_LEVEL, 0.0f, 1.0f, 0.25f, "60 Hz hum depth", " cents peak", 0.0f, 12.0f);
@@ -79,7 +79,7 @@ void TfSlop::init(float sampleRate)
 	_sampleRate = sampleRate;
 	_humOscillator.SetFrequency(_humFreq, sampleRate);
 	const double sigma = params[DETUNE_MODE].getValue() < 0 ? _sigmaHz : _sigmaCents;
-	_ou.Configure(sampleRate, _tau, sigma);
+	_drift.Configure(sampleRate, _tau, sigma);
 	_prevDetuneMode = params[DETUNE_MODE].getValue();
 }
 
@@ -87,25 +87,33 @@ void TfSlop::process(const ProcessArgs &args)
 {
 	if (_prevDetuneMode != params[DETUNE_MODE].getValue())
 	{
-		_ou.Reset();
+		_drift.Reset();
 		const double sigma = params[DETUNE_MODE].getValue() < 0 ? _sigmaHz : _sigmaCents;
-		_ou.Configure(args.sampleRate, _tau, sigma);
+		_drift.Configure(args.sampleRate, _tau, sigma);
 		_prevDetuneMode = params[DETUNE_MODE].getValue();
 	}
-	const float input = inputs[VOCT_INPUT].getVoltage();
-	float voct = (std::isfinite(input) ? input : 0.0f) * params[TRACK_SCALING].getValue();
+	const int channels = std::clamp(inputs[VOCT_INPUT].getChannels(), 1, PORT_MAX_CHANNELS);
+	const float trackScaling = params[TRACK_SCALING].getValue();
+	const float driftLevel = params[DRIFT_LEVEL].getValue();
+	const bool linearMode = params[DETUNE_MODE].getValue() < 0;
 
 	float hum = _maxHum * params[HUM_LEVEL].getValue() * _humOscillator.Step();
-	float drift = params[DRIFT_LEVEL].getValue() * _ou.Step(_rng);
+	_drift.Advance();
 
-	voct = voct + hum;
-
-	if (params[DETUNE_MODE].getValue() < 0) //Hz i.e linear detune mode
-		outputs[VOCT_OUTPUT].setVoltage(static_cast<float>(tfdsp::detune::linear(voct, drift)));
-	else //Cents i.e proportional detune mode
+	outputs[VOCT_OUTPUT].setChannels(channels);
+	for (int channel = 0; channel < channels; ++channel)
 	{
-		const double output = voct + drift;
-		outputs[VOCT_OUTPUT].setVoltage(std::isfinite(output) ? static_cast<float>(output) : 0.0f);
+		const float input = inputs[VOCT_INPUT].getVoltage(channel);
+		const float voct = (std::isfinite(input) ? input : 0.0f) * trackScaling + hum;
+		const float drift = driftLevel * _drift.Value(channel);
+
+		if (linearMode) //Hz i.e linear detune mode
+			outputs[VOCT_OUTPUT].setVoltage(static_cast<float>(tfdsp::detune::linear(voct, drift)), channel);
+		else //Cents i.e proportional detune mode
+		{
+			const double output = voct + drift;
+			outputs[VOCT_OUTPUT].setVoltage(std::isfinite(output) ? static_cast<float>(output) : 0.0f, channel);
+		}
 	}
 }
 void TfSlop::onSampleRateChange(const SampleRateChangeEvent& event)
@@ -116,7 +124,7 @@ void TfSlop::onReset(const ResetEvent& event)
 {
 	Module::onReset(event);
 	_humOscillator.Reset();
-	_ou.Reset();
+	_drift.Reset();
 	init(_sampleRate);
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <array>
 #include <cmath>
@@ -41,24 +42,23 @@ struct TfSlop4 : Module
 		NUM_LIGHTS
 	};
 
-	std::random_device _seed{};
-	std::minstd_rand _rng;
 	// 0.01 V/oct is a peak pitch deviation of 12 cents, common to all outputs.
 	static constexpr float _maxHum{12.0f / 1200.0f};
 	static constexpr float _humFreq{60.0f};
 	tfdsp::RecursiveSineOscillator _humOscillator{};
 
-	// Temperature drift is modeled as an exact sampled OU process.
+	// Temperature drift is modeled as exact sampled OU processes: one common to
+	// every path and channel, and one for each channel of each path.
 	static constexpr double _tau{60.0}; //Time constant ( average decay time) in seconds
 	static constexpr double _sigmaCents{0.1 / 12};
 	static constexpr double _sigmaHz{1.5};
-	tfdsp::InterpolatedOrnsteinUhlenbeck _ouCommon{};
-	std::array<tfdsp::InterpolatedOrnsteinUhlenbeck, 4> _ouIndividual{};
+	tfdsp::OrnsteinUhlenbeckBank<1, false> _ouCommon{};
+	tfdsp::OrnsteinUhlenbeckBank<4 * PORT_MAX_CHANNELS, false> _ouIndividual{};
 	float _sampleRate{44100.0f};
 
 	//----------------------------------------------------------------
 
-	TfSlop4() : _rng(_seed())
+	TfSlop4()
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(TfSlop4::HUM_LEVEL, 0.0f, 1.0f, 0.10f, "Common 60 Hz hum depth", " cents peak", 0.0f, 12.0f);
@@ -94,32 +94,34 @@ void TfSlop4::init(float sampleRate)
 	_sampleRate = sampleRate;
 	_humOscillator.SetFrequency(_humFreq, sampleRate);
 	_ouCommon.Configure(sampleRate, _tau, _sigmaCents);
-	for (auto& process : _ouIndividual)
-		process.Configure(sampleRate, _tau, _sigmaHz);
+	_ouIndividual.Configure(sampleRate, _tau, _sigmaHz);
 }
 
 void TfSlop4::process(const ProcessArgs &args)
 {
-	std::array<float, 4> voct;
-	for (int i = 0; i < 4; ++i)
-	{
-		//NOTE! : the parameters that are replicated for each input are put at the beginning to make life easier in loops
-		//careful not to add parameters before these in the enum !
-		const float input = inputs[i].getVoltage();
-		voct[i] = (std::isfinite(input) ? input : 0.0f) * params[i].getValue();
-	}
-
 	float hum = _maxHum * params[HUM_LEVEL].getValue() * _humOscillator.Step();
 
 	//The common drift operates in cents
-	float driftCommon = params[COMMON_DRIFT_LEVEL].getValue() * _ouCommon.Step(_rng);
+	_ouCommon.Advance();
+	float driftCommon = params[COMMON_DRIFT_LEVEL].getValue() * _ouCommon.Value(0);
 
+	_ouIndividual.Advance();
+	const float individualLevel = params[INDIVIDUAL_DRIFT_LEVEL].getValue();
 	for (int i = 0; i < 4; ++i)
 	{
-		//The individual drifts operate in hz for linear detuning
-		double v = voct[i] + hum + driftCommon;
-		double drift = params[INDIVIDUAL_DRIFT_LEVEL].getValue() * _ouIndividual[i].Step(_rng);
-		outputs[i].setVoltage(tfdsp::detune::linear(v, drift));
+		//NOTE! : the parameters that are replicated for each input are put at the beginning to make life easier in loops
+		//careful not to add parameters before these in the enum !
+		const int channels = std::clamp(inputs[i].getChannels(), 1, PORT_MAX_CHANNELS);
+		const float trackScaling = params[i].getValue();
+		outputs[i].setChannels(channels);
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			const float input = inputs[i].getVoltage(channel);
+			//The individual drifts operate in hz for linear detuning
+			double v = (std::isfinite(input) ? input : 0.0f) * trackScaling + hum + driftCommon;
+			double drift = individualLevel * _ouIndividual.Value(i * PORT_MAX_CHANNELS + channel);
+			outputs[i].setVoltage(tfdsp::detune::linear(v, drift), channel);
+		}
 	}
 }
 void TfSlop4::onSampleRateChange(const SampleRateChangeEvent& event)
@@ -131,8 +133,7 @@ void TfSlop4::onReset(const ResetEvent& event)
 	Module::onReset(event);
 	_humOscillator.Reset();
 	_ouCommon.Reset();
-	for (auto& process : _ouIndividual)
-		process.Reset();
+	_ouIndividual.Reset();
 	init(_sampleRate);
 }
 
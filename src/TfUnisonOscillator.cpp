@@ -1,7 +1,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
-#include <random>
+#include <cstdint>
 
 #include "plugin.hpp"
 #include "components.hpp"
@@ -135,16 +135,15 @@ struct TfUnisonOscillator : Module
 
 	std::array<std::array<tfdsp::StackedOscillatorVoice,
 		tfdsp::MaximumStackedOscillatorVoices>, PORT_MAX_CHANNELS> voices{};
-	std::array<tfdsp::BandlimitedFixedPulseOscillator,
+	std::array<tfdsp::BandlimitedFixedPulseOscillator<tfdsp::FixedPhase>,
 		PORT_MAX_CHANNELS> centerSubs{};
-	std::array<std::array<tfdsp::SmoothOrnsteinUhlenbeck,
-		tfdsp::MaximumStackedOscillatorVoices>, PORT_MAX_CHANNELS>
-		individualDriftProcesses{};
-	tfdsp::SmoothOrnsteinUhlenbeck commonDriftProcess{};
+	// Process 0 is the common drift, followed by one individual drift per
+	// channel and voice, all advanced together at the control rate.
+	static constexpr int CommonDriftProcess = 0;
+	tfdsp::OrnsteinUhlenbeckBank<1 +
+		tfdsp::MaximumStackedOscillatorVoices * PORT_MAX_CHANNELS> driftProcesses;
 	tfdsp::RecursiveSineOscillator humOscillator{};
 	tfdsp::RecursiveSineOscillator pwmOscillator{};
-	std::random_device randomSeed{};
-	std::minstd_rand randomGenerator;
 
 	std::array<double, tfdsp::MaximumStackedOscillatorVoices> voiceGains{};
 	std::array<double, tfdsp::MaximumStackedOscillatorVoices> pitchPositions{};
@@ -153,6 +152,17 @@ struct TfUnisonOscillator : Module
 	std::array<double, tfdsp::MaximumStackedOscillatorVoices> targetPitchPositions{};
 	std::array<double, tfdsp::MaximumStackedOscillatorVoices> targetPanPositions{};
 	std::array<double, tfdsp::MaximumStackedOscillatorVoices> targetTrackingPositions{};
+	// Each voice's frequency relative to its channel's centre frequency from
+	// spread, refreshed only when the spread or the voice layout moves.
+	struct VoiceRatios
+	{
+		double spreadCents{};
+		std::uint32_t layoutVersion{};
+		bool valid{};
+		std::array<float, tfdsp::MaximumStackedOscillatorVoices> values{};
+	};
+	std::array<VoiceRatios, PORT_MAX_CHANNELS> voiceRatios{};
+	std::uint32_t layoutVersion{};
 	int layoutVoiceCount{7};
 	double waveformMix{};
 	double subModeMix{};
@@ -160,8 +170,11 @@ struct TfUnisonOscillator : Module
 	double driftTimeSeconds{};
 	double configuredPwmRateHz{};
 	double transitionCoefficient{1.0};
+	// Layout transitions land on their targets once this close, a detune far
+	// below audibility, rather than approaching them until underflow.
+	static constexpr double TransitionSnap = 1.0e-6;
 
-	TfUnisonOscillator() : randomGenerator(randomSeed())
+	TfUnisonOscillator()
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(OCTAVE, -3.0f, 3.0f, 0.0f, "Octave", " oct");
@@ -232,20 +245,40 @@ struct TfUnisonOscillator : Module
 			pitchPositions = targetPitchPositions;
 			panPositions = targetPanPositions;
 			trackingPositions = targetTrackingPositions;
+			++layoutVersion;
 			for (int voice = 0; voice < tfdsp::MaximumStackedOscillatorVoices;
 				++voice)
 				voiceGains[voice] = voice < layoutVoiceCount ? 1.0 : 0.0;
 		}
 	}
 
+	static int IndividualDriftProcess(int channel, int voice)
+	{
+		return 1 + channel * tfdsp::MaximumStackedOscillatorVoices + voice;
+	}
+
+	const std::array<float, tfdsp::MaximumStackedOscillatorVoices>&
+	UpdateVoiceRatios(int channel, double spreadCents)
+	{
+		VoiceRatios& ratios = voiceRatios[channel];
+		if (ratios.valid && ratios.spreadCents == spreadCents &&
+			ratios.layoutVersion == layoutVersion)
+			return ratios.values;
+		std::array<float, tfdsp::MaximumStackedOscillatorVoices> exponents;
+		for (int voice = 0; voice < tfdsp::MaximumStackedOscillatorVoices; ++voice)
+			exponents[voice] = static_cast<float>(
+				spreadCents * pitchPositions[voice] / 1200.0);
+		tfdsp::Exp2Taylor5(exponents, ratios.values);
+		ratios.spreadCents = spreadCents;
+		ratios.layoutVersion = layoutVersion;
+		ratios.valid = true;
+		return ratios.values;
+	}
+
 	void ConfigureDrift(double timeSeconds)
 	{
 		driftTimeSeconds = timeSeconds;
-		commonDriftProcess.ConfigureStationary(sampleRate, timeSeconds, 1.0,
-			100.0);
-		for (auto& channel : individualDriftProcesses)
-			for (auto& process : channel)
-				process.ConfigureStationary(sampleRate, timeSeconds, 1.0, 100.0);
+		driftProcesses.ConfigureStationary(sampleRate, timeSeconds, 1.0, 100.0);
 	}
 
 	void SetSampleRate(double nextSampleRate)
@@ -269,10 +302,7 @@ struct TfUnisonOscillator : Module
 					voice * GoldenConjugate + channel * ChannelOffset, 1.0));
 		for (auto& oscillator : centerSubs)
 			oscillator.Reset();
-		commonDriftProcess.Reset();
-		for (auto& channel : individualDriftProcesses)
-			for (auto& process : channel)
-				process.Reset();
+		driftProcesses.Reset();
 		humOscillator.Reset();
 		pwmOscillator.Reset();
 		SetLayout(static_cast<int>(std::round(params[VOICES].getValue())), true);
@@ -280,23 +310,36 @@ struct TfUnisonOscillator : Module
 		subModeMix = params[SUB_MODE].getValue();
 	}
 
+	double Transition(double value, double target) const
+	{
+		const double next = value + transitionCoefficient * (target - value);
+		return std::abs(target - next) < TransitionSnap ? target : next;
+	}
+
 	void UpdateTransitions(int requestedVoices)
 	{
 		if (requestedVoices != layoutVoiceCount)
 			SetLayout(requestedVoices);
+		bool pitchLayoutMoved = false;
 		for (int voice = 0; voice < tfdsp::MaximumStackedOscillatorVoices;
 			++voice)
 		{
 			const double gainTarget = voice < layoutVoiceCount ? 1.0 : 0.0;
-			voiceGains[voice] += transitionCoefficient *
-				(gainTarget - voiceGains[voice]);
-			pitchPositions[voice] += transitionCoefficient *
-				(targetPitchPositions[voice] - pitchPositions[voice]);
-			panPositions[voice] += transitionCoefficient *
-				(targetPanPositions[voice] - panPositions[voice]);
-			trackingPositions[voice] += transitionCoefficient *
-				(targetTrackingPositions[voice] - trackingPositions[voice]);
+			voiceGains[voice] = Transition(voiceGains[voice], gainTarget);
+			const double pitchPosition = pitchPositions[voice];
+			pitchPositions[voice] = Transition(pitchPositions[voice],
+				targetPitchPositions[voice]);
+			panPositions[voice] = Transition(panPositions[voice],
+				targetPanPositions[voice]);
+			trackingPositions[voice] = Transition(trackingPositions[voice],
+				targetTrackingPositions[voice]);
+			pitchLayoutMoved = pitchLayoutMoved ||
+				pitchPositions[voice] != pitchPosition;
 		}
+		// The positions snap to their targets, after which cached voice ratios
+		// stay valid.
+		if (pitchLayoutMoved)
+			++layoutVersion;
 		waveformMix = params[WAVEFORM].getValue() > 0.5f ? 1.0 : 0.0;
 		subModeMix = params[SUB_MODE].getValue() > 0.5f ? 1.0 : 0.0;
 	}
@@ -336,9 +379,10 @@ struct TfUnisonOscillator : Module
 		const bool renderCenterSub = needSub && subModeMix == 0.0;
 		const bool renderStackSub = needSub && subModeMix == 1.0;
 
+		driftProcesses.Advance();
 		const double commonDriftCents = MaximumCommonDriftCents *
 			params[COMMON_DRIFT].getValue() *
-			commonDriftProcess.Step(randomGenerator);
+			driftProcesses.Value(CommonDriftProcess);
 		const double humCents = MaximumHumCents * params[HUM].getValue() *
 			humOscillator.Step();
 		const double commonPitchCents = commonDriftCents + humCents;
@@ -384,6 +428,13 @@ struct TfUnisonOscillator : Module
 			const double spreadControl = std::clamp(params[SPREAD].getValue() +
 				spreadCvAmount * finiteInput(SPREAD_INPUT) / 5.0, 0.0, 1.0);
 			const double spreadCents = tfdsp::UnisonSpreadCents(spreadControl);
+			const auto& ratios = UpdateVoiceRatios(channel, spreadCents);
+			// Tracking follows the pitch CV, so it would change the cached
+			// ratios on every sample; each voice applies it directly instead.
+			// It stays within a few semitones, where Exp2NearZero() is still
+			// accurate to a thousandth of a cent.
+			const double trackingCents = MaximumTrackingErrorCentsPerOctave *
+				trackingErrorDepth * basePitch;
 			const double width = std::clamp(params[WIDTH].getValue() +
 				widthCvAmount * finiteInput(WIDTH_INPUT) / 5.0, 0.0, 1.0);
 			std::array<double, tfdsp::MaximumStackedOscillatorVoices>
@@ -408,18 +459,14 @@ struct TfUnisonOscillator : Module
 			double rightStackSub = 0.0;
 			for (int voice = 0; voice < voicesToProcess; ++voice)
 			{
-				const double drift = individualDriftProcesses[channel][voice].Step(
-					randomGenerator);
-				const double trackingCents = MaximumTrackingErrorCentsPerOctave *
-					trackingErrorDepth * trackingPositions[voice] * basePitch;
-				double voicePitch = centerPitch + (spreadCents *
-					pitchPositions[voice] + trackingCents) / 1200.0;
+				const double drift = driftProcesses.Value(
+					IndividualDriftProcess(channel, voice));
+				double frequency = centerFrequency * ratios[voice] *
+					tfdsp::Exp2NearZero(trackingCents * trackingPositions[voice] / 1200.0);
 				if (centsDrift)
-					voicePitch += MaximumIndividualDriftCents * individualDepth *
-						drift / 1200.0;
-				double frequency = dsp::FREQ_C4 * tfdsp::Exp2Taylor5(
-					static_cast<float>(std::clamp(voicePitch, -16.0, 16.0)));
-				if (!centsDrift)
+					frequency *= tfdsp::Exp2NearZero(MaximumIndividualDriftCents *
+						individualDepth * drift / 1200.0);
+				else
 					frequency += MaximumIndividualDriftHz * individualDepth * drift;
 				frequency = std::clamp(frequency, 0.0, 0.45 * sampleRate);
 				const double increment = frequency / sampleRate;
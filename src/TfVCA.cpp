@@ -3,13 +3,15 @@
 
 #include <memory>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include "plugin.hpp"
 #include "components.hpp"
 #include "tfdsp/filters.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 
-// Analog modelled VCA with 2x oversampling
+// Polyphonic analog modelled VCA with 2x oversampling
 struct TfVCA : Module
 {
 	enum ParamIds
@@ -47,14 +49,22 @@ struct TfVCA : Module
 	float _normalisedHighPassCv;
 	float _normalisedHighPassAudio;
 
-	std::unique_ptr<::VCA_TransistorCore<tfdsp::X2Resampler_Order7>> _vcaTransi;
+	// All channels share one bank so the 16 audio and 16 cv integrators are
+	// solved together instead of one solve per channel.
+	using VcaBank = ::VCA_TransistorCoreBank<tfdsp::X2Resampler_Order7>;
+	std::unique_ptr<VcaBank> _vcaTransi;
 
-	tfdsp::FirstOrderHighPassZdf<float> _cvHighPass{};
-	tfdsp::FirstOrderHighPassZdf<float> _audioHighPass{};
+	std::array<tfdsp::FirstOrderHighPassZdf<float>, PORT_MAX_CHANNELS> _cvHighPass{};
+	std::array<tfdsp::FirstOrderHighPassZdf<float>, PORT_MAX_CHANNELS> _audioHighPass{};
+	int _activeChannels{};
+
+	// Index of a tfdsp::QualityTier; the integrators run its Newton settings.
+	int quality = 1;
+	int configuredQuality = 1;
 
 	//----------------------------------------------------------------
 
-	TfVCA() : _vcaTransi(std::make_unique<::VCA_TransistorCore<tfdsp::X2Resampler_Order7>>(tfdsp::CreateX2Resampler_Chebychev7))
+	TfVCA() : _vcaTransi(std::make_unique<VcaBank>(tfdsp::CreateX2Resampler_Chebychev7))
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(TfVCA::LIN_INPUT_LEVEL, 0.0f, 1.0f, 1.0f, "Linear CV amount", "%", 0.0f, 100.0f);
@@ -75,10 +85,16 @@ struct TfVCA : Module
 		init(gSampleRate);
 	}
 
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
+
 	void process(const ProcessArgs &args) override;
 	void init(float sampleRate);
 	void onSampleRateChange(const SampleRateChangeEvent& event) override;
 	void onReset(const ResetEvent& event) override;
+	json_t* dataToJson() override;
+	void dataFromJson(json_t* root) override;
 
 	// For more advanced Module features, read Rack's engine.hpp header file
 	// - dataToJson, dataFromJson: serialization of internal data
@@ -97,57 +113,112 @@ void TfVCA::init(float sampleRate)
 
 void TfVCA::process(const ProcessArgs &args)
 {
+	TF_PROFILE_MODULE(profile);
 	//float deltaTime = args.sampleTime;
 
+	const int channels = std::clamp(std::max({inputs[AUDIO_INPUT].getChannels(),
+		inputs[LIN_CV_INPUT].getChannels(), inputs[EXP_CV_INPUT].getChannels(), 1}),
+		1, PORT_MAX_CHANNELS);
+	for (int channel = channels; channel < _activeChannels; ++channel)
+	{
+		_cvHighPass[channel].Reset();
+		_audioHighPass[channel].Reset();
+	}
+	_activeChannels = channels;
+	outputs[MAIN_OUTPUT].setChannels(channels);
+	// The integrators keep their state across a tier change; only the Newton
+	// stopping rule differs.
+	if (quality != configuredQuality)
+	{
+		configuredQuality = quality;
+		_vcaTransi->SetSolverSettings(tfdsp::QualitySettingsFor(
+			tfdsp::QualityTierAt(quality)).vcaIntegrator);
+	}
+
 	float driveGain = params[DRIVE].getValue();
 	constexpr float audioRenorm = 5.0f;
 	driveGain /= audioRenorm;
-
-	const float audioInput = inputs[AUDIO_INPUT].getVoltage();
-	float audio = (std::isfinite(audioInput) ? audioInput : 0.0f) * driveGain;
-	//VCA cv should be unipolar between 0 and 10, normalise to 0 to 1.
-	//If no input plugged in then pass zero.
-	const float linearInput = inputs[LIN_CV_INPUT].getNormalVoltage(0.f);
-	const float exponentialInput = inputs[EXP_CV_INPUT].getNormalVoltage(0.f);
-	const float linearCv = std::isfinite(linearInput) ? linearInput / 10.f *
-		params[LIN_INPUT_LEVEL].getValue() : 0.0f;
-	const float exponentialCv = std::isfinite(exponentialInput) ?
-		exponentialInput / 10.f * params[EXP_INPUT_LEVEL].getValue() : 0.0f;
-
+	const float linearLevel = params[LIN_INPUT_LEVEL].getValue();
+	const float exponentialLevel = params[EXP_INPUT_LEVEL].getValue();
 	const float expBase = params[EXP_CV_BASE].getValue();
+	const float cvBleedLevel = params[CV_BLEED].getValue() * _maxCvBleed;
 
 	// Compensate most of the drive-induced level change. This makes DRIVE
 	// primarily a saturation control; OUTPUT_LEVEL remains the volume control.
 	auto finalGain = std::min(100.0f, (1.0f + driveGain) / (0.00001f + driveGain));
 	finalGain *= params[OUTPUT_LEVEL].getValue();
 
+	std::array<float, PORT_MAX_CHANNELS> audio{};
+	std::array<float, PORT_MAX_CHANNELS> linearCv{};
+	std::array<float, PORT_MAX_CHANNELS> exponentialCv{};
+	std::array<float, PORT_MAX_CHANNELS> vcaOutput{};
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const float audioInput = inputs[AUDIO_INPUT].getPolyVoltage(channel);
+		audio[channel] = (std::isfinite(audioInput) ? audioInput : 0.0f) * driveGain;
+		//VCA cv should be unipolar between 0 and 10, normalise to 0 to 1.
+		//If no input plugged in then pass zero.
+		const float linearInput = inputs[LIN_CV_INPUT].isConnected() ?
+			inputs[LIN_CV_INPUT].getPolyVoltage(channel) : 0.0f;
+		const float exponentialInput = inputs[EXP_CV_INPUT].isConnected() ?
+			inputs[EXP_CV_INPUT].getPolyVoltage(channel) : 0.0f;
+		linearCv[channel] = std::isfinite(linearInput) ?
+			linearInput / 10.f * linearLevel : 0.0f;
+		exponentialCv[channel] = std::isfinite(exponentialInput) ?
+			exponentialInput / 10.f * exponentialLevel : 0.0f;
+	}
+
 	//VCA core
-	audio = _vcaTransi->StepControls(audio, linearCv, exponentialCv, expBase,
-		finalGain);
-	const float reconstructedCv = _vcaTransi->LastControl();
+	_vcaTransi->StepControls(audio.data(), linearCv.data(), exponentialCv.data(),
+		expBase, finalGain, vcaOutput.data(), channels);
 
-	// CV bleed follows the reconstructed control path so exponential audio-rate
-	// modulation cannot introduce host-rate images directly at the output.
-	const float cvBleed = _cvHighPass(reconstructedCv, _normalisedHighPassCv) *
-		params[CV_BLEED].getValue() * _maxCvBleed;
+	float lightLevel = 0.0f;
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const float reconstructedCv = _vcaTransi->LastControl(channel);
+
+		// CV bleed follows the reconstructed control path so exponential audio-rate
+		// modulation cannot introduce host-rate images directly at the output.
+		const float cvBleed = _cvHighPass[channel](reconstructedCv,
+			_normalisedHighPassCv) * cvBleedLevel;
 
-	//DC rejection in case there is some DC offset due to aliasing
-	audio = _audioHighPass(audio, _normalisedHighPassAudio);
+		//DC rejection in case there is some DC offset due to aliasing
+		const float filtered = _audioHighPass[channel](vcaOutput[channel],
+			_normalisedHighPassAudio);
 
-	const float output = static_cast<float>(
-		tfdsp::RackOutputAdapter::ProcessPostDecimation(audio + cvBleed));
-	outputs[MAIN_OUTPUT].setVoltage(std::isfinite(output) ? output : 0.0f);
+		const float output = static_cast<float>(
+			tfdsp::RackOutputAdapter::ProcessPostDecimation(filtered + cvBleed));
+		outputs[MAIN_OUTPUT].setVoltage(std::isfinite(output) ? output : 0.0f,
+			channel);
+		lightLevel = std::max(lightLevel, reconstructedCv);
+	}
 
 	//Deal with input monitoring lights
-	lights[CV_LIGHT].setSmoothBrightness(std::max(0.f, reconstructedCv),
-		args.sampleTime);
+	lights[CV_LIGHT].setSmoothBrightness(lightLevel, args.sampleTime);
 }
 void TfVCA::onReset(const ResetEvent& event)
 {
 	Module::onReset(event);
 	_vcaTransi->Reset();
-	_cvHighPass.Reset();
-	_audioHighPass.Reset();
+	for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
+	{
+		_cvHighPass[channel].Reset();
+		_audioHighPass[channel].Reset();
+	}
+	_activeChannels = 0;
+	quality = 1;
+}
+json_t* TfVCA::dataToJson()
+{
+	json_t* root = json_object();
+	json_object_set_new(root, "quality", json_integer(quality));
+	return root;
+}
+void TfVCA::dataFromJson(json_t* root)
+{
+	if (json_t* value = json_object_get(root, "quality"))
+		quality = static_cast<int>(tfdsp::QualityTierAt(
+			static_cast<int>(json_integer_value(value))));
 }
 void TfVCA::onSampleRateChange(const SampleRateChangeEvent& event)
 {
@@ -187,6 +258,18 @@ struct TfVCAWidget : ModuleWidget
 		addInput(createInput<PJ301MPort>(Vec(offset + 2 * spacing, 313), module, TfVCA::AUDIO_INPUT));
 		addOutput(createOutput<PJ301MPort>(Vec(offset + 3 * spacing, 313), module, TfVCA::MAIN_OUTPUT));
 	}
+
+	void appendContextMenu(Menu* menu) override
+	{
+		TfVCA* module = dynamic_cast<TfVCA*>(this->module);
+		if (!module)
+			return;
+		menu->addChild(new MenuSeparator);
+		appendQualityMenu(menu, &module->quality);
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "TfVCA");
+#endif
+	}
 };
 
 // Specify the Module and ModuleWidget subclass, human-readable
@@ -1,10 +1,12 @@
 #include "models/VdpSplitOscillator.hpp"
 #include <memory>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include "plugin.hpp"
 #include "components.hpp"
 #include "tfdsp/noise.hpp"
+#include "tfdsp/quality.hpp"
 
 // Analog style modulation of pitch for VCOs and filter cutoffs
 struct TfVDPO : Module
@@ -39,12 +41,18 @@ struct TfVDPO : Module
 	// Four-times oversampling suppresses aliases from the nonlinear limit cycle.
 	// The structure-aware split integrator uses cheap adaptive substeps only in
 	// the stiff high-damping/high-frequency corner.
-	VdpSplitOscillator<tfdsp::X4Resampler_Order7> _vdpHq{tfdsp::CreateX4Resampler_Cheby7};
+	// One voice per polyphony channel, all advanced together in SIMD lanes.
+	using VdpBank = VdpSplitOscillatorBank<tfdsp::X4Resampler_Order7, PORT_MAX_CHANNELS>;
+	std::unique_ptr<VdpBank> _vdpHq;
+
+	// Index of a tfdsp::QualityTier; the bank runs its substep settings.
+	int quality = 1;
+	int configuredQuality = 1;
 
 	//----------------------------------------------------------------
 
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-	TfVDPO()
+	TfVDPO() : _vdpHq(std::make_unique<VdpBank>(tfdsp::CreateX4Resampler_Cheby7))
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(TfVDPO::FREQ, -5.0f, 5.0f, 0.0f, "Frequency offset", " oct");
@@ -53,20 +61,26 @@ struct TfVDPO : Module
 		configParam(TfVDPO::LEVEL, 0.0, 1.0f, 1.0f, "Output level", "%", 0.0f, 100.0f);
 		configParam(TfVDPO::VOCT_SCALING, 0.0f, 1.0f, 1.0f, "1V/octave amount", "%", 0.0f, 100.0f);
 		configParam(TfVDPO::DAMPING_ATTENUVERT, -1.0f, 1.0f, 1.0f, "Damping modulation", "%", 0.0f, 100.0f);
-		configInput(VOCT_INPUT, "1V/octave pitch");
-		configInput(AUDIO_INPUT, "Audio");
-		configInput(DAMPING_INPUT, "Damping modulation");
-		configOutput(OUTPUT, "Audio");
+		configInput(VOCT_INPUT, "1V/octave pitch (polyphonic)");
+		configInput(AUDIO_INPUT, "Audio (polyphonic)");
+		configInput(DAMPING_INPUT, "Damping modulation (polyphonic)");
+		configOutput(OUTPUT, "Audio (polyphonic)");
 		//configParam(TfVDPO::HQ_MODE, -1.0f, 1.0f, -1.0f, "");
 		//_resampler = tfdsp::CreateX2Resampler_Butterworth5();
 		float gSampleRate = APP->engine->getSampleRate();
 		init(gSampleRate);
 	}
 
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
+
 	void process(const ProcessArgs &args) override;
 	void init(float sampleRate);
 	void onSampleRateChange(const SampleRateChangeEvent& event) override;
 	void onReset(const ResetEvent& event) override;
+	json_t* dataToJson() override;
+	void dataFromJson(json_t* root) override;
 
 	// For more advanced Module features, read Rack's engine.hpp header file
 	// - dataToJson, dataFromJson: serialization of internal data
@@ -76,38 +90,70 @@ struct TfVDPO : Module
 void TfVDPO::init(float sampleRate)
 {
 	//_vdp.SetSampleRate(sampleRate);
-	_vdpHq.SetSampleRate(sampleRate);
+	_vdpHq->SetSampleRate(sampleRate);
 }
 
 void TfVDPO::process(const ProcessArgs &args)
 {
-	const float audioInput = inputs[AUDIO_INPUT].getVoltage();
-	const float pitchInput = inputs[VOCT_INPUT].getVoltage();
-	const float dampingInput = inputs[DAMPING_INPUT].getVoltage();
-	const float x = (std::isfinite(audioInput) ? audioInput : 0.0f) * params[INPUT_GAIN].getValue();
-	const double vOct = (std::isfinite(pitchInput) ? pitchInput : 0.0f) *
-		params[VOCT_SCALING].getValue() + params[FREQ].getValue();
-	const double mu = params[DAMPING].getValue() +
-		params[DAMPING_ATTENUVERT].getValue() *
-		(std::isfinite(dampingInput) ? dampingInput : 0.0f);
-	const double log2AngularFrequency =
-		std::log2(2.0 * tfdsp::PI * dsp::FREQ_C4) + vOct;
-
-	//TODO: menu item for low quality, leave high quality by default for now.
-
-	//auto y = params[HQ_MODE].getValue() > 0 ?
-	//_vdpHq.Step(double(x), double(mu), double(2 * tfdsp::PI * freq))
-	//: _vdp.Step(double(x), double(mu), double(2 * tfdsp::PI * freq));
-	auto y = _vdpHq.StepLogAngularFrequency(double(x), mu,
-		log2AngularFrequency);
-
-	const float output = y * params[LEVEL].getValue();
-	outputs[OUTPUT].setVoltage(std::isfinite(output) ? output : 0.0f);
+	TF_PROFILE_MODULE(profile);
+	const int channels = std::clamp(std::max({inputs[VOCT_INPUT].getChannels(),
+		inputs[AUDIO_INPUT].getChannels(), inputs[DAMPING_INPUT].getChannels(), 1}),
+		1, PORT_MAX_CHANNELS);
+	outputs[OUTPUT].setChannels(channels);
+	// The voices keep their state across a tier change; only the substep
+	// count differs.
+	if (quality != configuredQuality)
+	{
+		configuredQuality = quality;
+		_vdpHq->SetSubstepSettings(tfdsp::QualitySettingsFor(
+			tfdsp::QualityTierAt(quality)).vanDerPol);
+	}
+
+	const double log2C4 = std::log2(2.0 * tfdsp::PI * dsp::FREQ_C4);
+	std::array<double, PORT_MAX_CHANNELS> x{};
+	std::array<double, PORT_MAX_CHANNELS> mu{};
+	std::array<double, PORT_MAX_CHANNELS> log2AngularFrequency{};
+	std::array<float, PORT_MAX_CHANNELS> y{};
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const float audioInput = inputs[AUDIO_INPUT].getPolyVoltage(channel);
+		const float pitchInput = inputs[VOCT_INPUT].getPolyVoltage(channel);
+		const float dampingInput = inputs[DAMPING_INPUT].getPolyVoltage(channel);
+		x[channel] = (std::isfinite(audioInput) ? audioInput : 0.0f) * params[INPUT_GAIN].getValue();
+		const double vOct = (std::isfinite(pitchInput) ? pitchInput : 0.0f) *
+			params[VOCT_SCALING].getValue() + params[FREQ].getValue();
+		mu[channel] = params[DAMPING].getValue() +
+			params[DAMPING_ATTENUVERT].getValue() *
+			(std::isfinite(dampingInput) ? dampingInput : 0.0f);
+		log2AngularFrequency[channel] = log2C4 + vOct;
+	}
+
+	_vdpHq->StepLogAngularFrequency(x.data(), mu.data(),
+		log2AngularFrequency.data(), y.data(), channels);
+
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const float output = y[channel] * params[LEVEL].getValue();
+		outputs[OUTPUT].setVoltage(std::isfinite(output) ? output : 0.0f, channel);
+	}
 }
 void TfVDPO::onReset(const ResetEvent& event)
 {
 	Module::onReset(event);
-	_vdpHq.Reset();
+	_vdpHq->Reset();
+	quality = 1;
+}
+json_t* TfVDPO::dataToJson()
+{
+	json_t* root = json_object();
+	json_object_set_new(root, "quality", json_integer(quality));
+	return root;
+}
+void TfVDPO::dataFromJson(json_t* root)
+{
+	if (json_t* value = json_object_get(root, "quality"))
+		quality = static_cast<int>(tfdsp::QualityTierAt(
+			static_cast<int>(json_integer_value(value))));
 }
 void TfVDPO::onSampleRateChange(const SampleRateChangeEvent& event)
 {
@@ -145,6 +191,18 @@ struct TfVDPOWidget : ModuleWidget
 		addInput(createInput<PJ301MPort>(Vec(20, 324), module, TfVDPO::AUDIO_INPUT));
 		addOutput(createOutput<PJ301MPort>(Vec(78, 324), module, TfVDPO::OUTPUT));
 	}
+
+	void appendContextMenu(Menu* menu) override
+	{
+		TfVDPO* module = dynamic_cast<TfVDPO*>(this->module);
+		if (!module)
+			return;
+		menu->addChild(new MenuSeparator);
+		appendQualityMenu(menu, &module->quality);
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "TfVDPO");
+#endif
+	}
 };
 
 // Specify the Module and ModuleWidget subclass, human-readable
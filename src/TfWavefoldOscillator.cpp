@@ -1,13 +1,14 @@
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <memory>
-#include <random>
 
 #include "plugin.hpp"
 #include "components.hpp"
 #include "tfdsp/approx.hpp"
 #include "tfdsp/control.hpp"
+#include "tfdsp/handoff.hpp"
 #include "tfdsp/rail.hpp"
 #include "tfdsp/sampleRate.hpp"
 #include "tfdsp/unison.hpp"
@@ -105,23 +106,26 @@ struct TfWavefoldOscillator : Module
 		tfdsp::X2Resampler_Order7>;
 	using OscillatorX4 = tfdsp::WavefoldOscillator<
 		tfdsp::X4Resampler_Order7>;
-	std::array<std::array<std::unique_ptr<OscillatorX2>,
-		tfdsp::MaximumUnisonVoices>, PORT_MAX_CHANNELS> oscillatorsX2;
-	std::array<std::array<std::unique_ptr<OscillatorX4>,
-		tfdsp::MaximumUnisonVoices>, PORT_MAX_CHANNELS> oscillatorsX4;
+	// One slot per channel and unison voice, voice-major, created by the
+	// widget for the channels and voices in use and the selected path only.
+	// Only a channel's first voice owns control interpolators.
+	static constexpr int OscillatorSlots =
+		tfdsp::MaximumUnisonVoices * PORT_MAX_CHANNELS;
+	tfdsp::OversamplingPaths<OscillatorX2, OscillatorX4, OscillatorSlots>
+		oscillators{ 1 };
+	std::atomic<int> usedChannels{ 1 };
+	std::atomic<int> usedUnisonVoices{ 1 };
+	// Morph, fold and symmetry drift for every channel and unison voice, all
+	// advanced together at the control rate.
 	static constexpr int AliveProcessCount = 3;
-	std::array<std::array<std::array<tfdsp::SmoothOrnsteinUhlenbeck,
-		AliveProcessCount>, tfdsp::MaximumUnisonVoices>,
-		PORT_MAX_CHANNELS> aliveProcesses{};
-	std::random_device aliveSeed{};
-	std::minstd_rand aliveRng;
+	tfdsp::OrnsteinUhlenbeckBank<AliveProcessCount *
+		tfdsp::MaximumUnisonVoices * PORT_MAX_CHANNELS> aliveProcesses;
 	double configuredAliveTimeSeconds{};
 	// 4x is the default quality mode; 2x is available as a lower-CPU fallback.
 	int oversampling = 1;
-	int activeOversampling = 1;
 	double sampleRate = 48000.0;
 
-	TfWavefoldOscillator() : aliveRng(aliveSeed())
+	TfWavefoldOscillator()
 	{
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(OCTAVE, -3.0f, 3.0f, 0.0f, "Octave", " oct");
@@ -173,72 +177,88 @@ struct TfWavefoldOscillator : Module
 		configOutput(FOLDED_OUTPUT,
 			"Folder output (internal oscillator or external audio input)");
 
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			for (int voice = 0; voice < tfdsp::MaximumUnisonVoices; ++voice)
-			{
-				oscillatorsX2[channel][voice] = std::make_unique<OscillatorX2>(
-					tfdsp::CreateX2Resampler_Chebychev7);
-				oscillatorsX4[channel][voice] = std::make_unique<OscillatorX4>(
-					tfdsp::CreateX4Resampler_Cheby7);
-			}
-		}
+		// Without a widget to prepare models later, allocate every slot now.
+		if (settings::headless)
+			PrepareModels(PORT_MAX_CHANNELS, tfdsp::MaximumUnisonVoices);
+		else
+			PrepareModels(1, 1);
 		SetSampleRate(APP->engine->getSampleRate());
 	}
 
+	static int OscillatorSlot(int channel, int voice)
+	{
+		return voice * PORT_MAX_CHANNELS + channel;
+	}
+
+	static int AliveProcess(int channel, int voice, int parameter)
+	{
+		return (channel * tfdsp::MaximumUnisonVoices + voice) *
+			AliveProcessCount + parameter;
+	}
+
+	static tfdsp::WavefoldControls ControlsForSlot(int slot)
+	{
+		return slot < PORT_MAX_CHANNELS ? tfdsp::WavefoldControls::Own :
+			tfdsp::WavefoldControls::Shared;
+	}
+
+	static auto SlotsInUse(int channels, int unisonVoices)
+	{
+		return [channels, unisonVoices](int slot)
+		{
+			return slot % PORT_MAX_CHANNELS < channels &&
+				slot / PORT_MAX_CHANNELS < unisonVoices;
+		};
+	}
+
+	/** Creates the models process() needs and frees those it stopped using.
+	 * Called from the widget's step(), never from process(). */
+	void PrepareModels(int channels, int unisonVoices)
+	{
+		oscillators.Prepare(oversampling, SlotsInUse(channels, unisonVoices),
+			[](int slot) { return std::make_unique<OscillatorX2>(
+				tfdsp::CreateX2Resampler_Chebychev7, ControlsForSlot(slot)); },
+			[](int slot) { return std::make_unique<OscillatorX4>(
+				tfdsp::CreateX4Resampler_Cheby7, ControlsForSlot(slot)); });
+	}
+
+	void PrepareModelsInUse()
+	{
+		PrepareModels(usedChannels.load(std::memory_order_relaxed),
+			usedUnisonVoices.load(std::memory_order_relaxed));
+	}
+
 	void ConfigureAlive(double timeSeconds)
 	{
 		configuredAliveTimeSeconds = timeSeconds;
-		for (auto& channelProcesses : aliveProcesses)
-			for (auto& voiceProcesses : channelProcesses)
-				for (auto& process : voiceProcesses)
-					process.ConfigureStationary(
-						sampleRate, timeSeconds, 1.0, 100.0);
+		aliveProcesses.ConfigureStationary(sampleRate, timeSeconds, 1.0, 100.0);
 	}
 
 	void ResetAlive()
 	{
-		for (auto& channelProcesses : aliveProcesses)
-			for (auto& voiceProcesses : channelProcesses)
-				for (auto& process : voiceProcesses)
-					process.Reset();
+		aliveProcesses.Reset();
 	}
 
 	void SetSampleRate(double nextSampleRate)
 	{
 		sampleRate = std::max(nextSampleRate, 1.0);
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			for (int voice = 0; voice < tfdsp::MaximumUnisonVoices; ++voice)
-			{
-				oscillatorsX2[channel][voice]->SetSampleRate(sampleRate);
-				oscillatorsX4[channel][voice]->SetSampleRate(sampleRate);
-			}
-		}
+		oscillators.Invalidate();
 		ConfigureAlive(AliveTimeSeconds(params[ALIVE_SPEED].getValue()));
 	}
 
 	void ResetDsp()
 	{
-		for (int channel = 0; channel < PORT_MAX_CHANNELS; ++channel)
-		{
-			for (int voice = 0; voice < tfdsp::MaximumUnisonVoices; ++voice)
-			{
-				oscillatorsX2[channel][voice]->Reset();
-				oscillatorsX4[channel][voice]->Reset();
-			}
-		}
+		oscillators.Invalidate();
 	}
 
+#ifdef TRIGGERFISH_PROFILE
+	tfdsp::ProfileCounters profile;
+#endif
+
 	void process(const ProcessArgs& args) override
 	{
+		TF_PROFILE_MODULE(profile);
 		oversampling = std::clamp(oversampling, 0, 1);
-		if (activeOversampling != oversampling)
-		{
-			activeOversampling = oversampling;
-			ResetDsp();
-		}
-
 		const int channels = std::clamp(std::max({
 			inputs[VOCT_INPUT].getChannels(), inputs[FM_INPUT].getChannels(),
 			inputs[MORPH_INPUT].getChannels(), inputs[FOLD_INPUT].getChannels(),
@@ -261,6 +281,18 @@ struct TfWavefoldOscillator : Module
 		const double symmetryAlive = params[SYMMETRY_ALIVE].getValue();
 		const int requestedUnisonVoices = std::clamp(static_cast<int>(std::round(
 			params[UNISON_VOICES].getValue())), 1, tfdsp::MaximumUnisonVoices);
+		usedChannels.store(channels, std::memory_order_relaxed);
+		usedUnisonVoices.store(requestedUnisonVoices, std::memory_order_relaxed);
+		// The switch waits until the widget has created the new path, which
+		// then starts from reset.
+		oscillators.BeginProcess(oversampling,
+			SlotsInUse(channels, requestedUnisonVoices));
+		const int activeOversampling = oscillators.Active();
+		const auto configure = [this](auto& oscillator)
+		{
+			oscillator.SetSampleRate(sampleRate);
+			oscillator.Reset();
+		};
 		const double spreadCents = tfdsp::UnisonSpreadCents(
 			params[UNISON_SPREAD].getValue());
 		const double aliveTimeSeconds = AliveTimeSeconds(
@@ -278,6 +310,7 @@ struct TfWavefoldOscillator : Module
 			params[CHARACTER].getValue())), 0, 2);
 		const auto character = charactersByPosition[characterPosition];
 		const bool externalInputConnected = inputs[AUDIO_INPUT].isConnected();
+		aliveProcesses.Advance();
 
 		for (int channel = 0; channel < channels; ++channel)
 		{
@@ -313,40 +346,51 @@ struct TfWavefoldOscillator : Module
 			const double externalInput = finiteInput(AUDIO_INPUT) / 5.0;
 			const auto pitchPositions =
 				tfdsp::UnisonPitchPositions(requestedUnisonVoices);
+			// Voices differ only by a constant pitch ratio and slow drift, so
+			// the first voice reconstructs the shared controls and every voice
+			// applies its ratio and drift offsets at the internal rate. A
+			// voice whose oscillator is still being created stays silent.
 			tfdsp::WavefoldOscillatorOutput rendered{};
-			for (int voice = 0; voice < requestedUnisonVoices; ++voice)
+			const auto renderVoices = [&](auto& models)
 			{
-				const double morph = tfdsp::ApplyBoundedDrift(morphBase,
-					aliveProcesses[channel][voice][0].Step(aliveRng), morphAlive);
-				const double fold = tfdsp::ApplyBoundedDrift(foldBase,
-					aliveProcesses[channel][voice][1].Step(aliveRng), foldAlive);
-				const double symmetry = tfdsp::ApplyBoundedDrift(symmetryBase,
-					aliveProcesses[channel][voice][2].Step(aliveRng), symmetryAlive,
-					-1.0, 1.0);
-				const double voiceFrequency = frequency * std::exp2(
-					spreadCents * pitchPositions[voice] / 1200.0);
-				const bool foldExternalInput = externalInputConnected && voice == 0;
-				tfdsp::WavefoldOscillatorOutput voiceOutput;
-				if (activeOversampling == 0)
-				{
-					oscillatorsX2[channel][voice]->SetCharacter(character);
-					oscillatorsX2[channel][voice]->SetFolderAntialiasing(false);
-					voiceOutput = oscillatorsX2[channel][voice]->StepWithInput(
-						voiceFrequency, morph, fold, symmetry, externalInput,
-						foldExternalInput);
-				}
-				else
+				auto* first = models.Acquire(OscillatorSlot(channel, 0), configure);
+				const auto* controls = first ? &first->UpsampleControls(frequency,
+					morphBase, foldBase, symmetryBase, externalInput) : nullptr;
+				for (int voice = 0; voice < requestedUnisonVoices; ++voice)
 				{
-					oscillatorsX4[channel][voice]->SetCharacter(character);
-					oscillatorsX4[channel][voice]->SetFolderAntialiasing(false);
-					voiceOutput = oscillatorsX4[channel][voice]->StepWithInput(
-						voiceFrequency, morph, fold, symmetry, externalInput,
+					const auto drift = [&](int parameter)
+					{
+						return aliveProcesses.Value(
+							AliveProcess(channel, voice, parameter));
+					};
+					const double morphOffset = tfdsp::ApplyBoundedDrift(morphBase,
+						drift(0), morphAlive) - morphBase;
+					const double foldOffset = tfdsp::ApplyBoundedDrift(foldBase,
+						drift(1), foldAlive) - foldBase;
+					const double symmetryOffset = tfdsp::ApplyBoundedDrift(
+						symmetryBase, drift(2), symmetryAlive, -1.0, 1.0) -
+						symmetryBase;
+					auto* oscillator = voice == 0 ? first :
+						models.Acquire(OscillatorSlot(channel, voice), configure);
+					if (!controls || !oscillator)
+						continue;
+					const double frequencyRatio = std::exp2(
+						spreadCents * pitchPositions[voice] / 1200.0);
+					const bool foldExternalInput = externalInputConnected && voice == 0;
+					oscillator->SetCharacter(character);
+					oscillator->SetFolderAntialiasing(false);
+					const auto voiceOutput = oscillator->StepOversampled(*controls,
+						frequencyRatio, morphOffset, foldOffset, symmetryOffset,
 						foldExternalInput);
+					rendered.oscillator += voiceOutput.oscillator;
+					if (!externalInputConnected || voice == 0)
+						rendered.folded += voiceOutput.folded;
 				}
-				rendered.oscillator += voiceOutput.oscillator;
-				if (!externalInputConnected || voice == 0)
-					rendered.folded += voiceOutput.folded;
-			}
+			};
+			if (activeOversampling == 0)
+				renderVoices(oscillators.x2);
+			else
+				renderVoices(oscillators.x4);
 			const double unisonGain =
 				tfdsp::UnisonOutputGain(requestedUnisonVoices);
 			rendered.oscillator *= unisonGain;
@@ -373,13 +417,16 @@ struct TfWavefoldOscillator : Module
 		if (json_t* value = json_object_get(root, "oversampling"))
 			oversampling = std::clamp(
 				static_cast<int>(json_integer_value(value)), 0, 1);
+		if (settings::headless)
+			PrepareModels(PORT_MAX_CHANNELS, tfdsp::MaximumUnisonVoices);
+		else
+			PrepareModelsInUse();
 	}
 
 	void onReset(const ResetEvent& event) override
 	{
 		Module::onReset(event);
 		oversampling = 1;
-		activeOversampling = 1;
 		ResetDsp();
 		ResetAlive();
 		ConfigureAlive(AliveTimeSeconds(params[ALIVE_SPEED].getValue()));
@@ -465,6 +512,14 @@ struct TfWavefoldOscillatorWidget : ModuleWidget
 			TfWavefoldOscillator::FOLDED_OUTPUT));
 	}
 
+	void step() override
+	{
+		if (TfWavefoldOscillator* oscillator =
+			dynamic_cast<TfWavefoldOscillator*>(module))
+			oscillator->PrepareModelsInUse();
+		ModuleWidget::step();
+	}
+
 	void appendContextMenu(Menu* menu) override
 	{
 		TfWavefoldOscillator* module =
@@ -474,6 +529,9 @@ struct TfWavefoldOscillatorWidget : ModuleWidget
 		menu->addChild(new MenuSeparator);
 		menu->addChild(createIndexPtrSubmenuItem("Oversampling",
 			{"2x (lower CPU)", "4x (default)"}, &module->oversampling));
+#ifdef TRIGGERFISH_PROFILE
+		appendProfileMenu(menu, &module->profile, "TfWavefoldOscillator");
+#endif
 	}
 };
 
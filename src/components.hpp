@@ -4,6 +4,13 @@
 #include <jansson.h>
 #include "rack.hpp"
 #include <iostream>
+#include <cstdio>
+#ifdef TRIGGERFISH_PROFILE
+#include "tfdsp/profile.hpp"
+#else
+#include "tfdsp/profile_scope.hpp"
+#endif
+#include "tfdsp/quality.hpp"
 
 using namespace std;
 
@@ -109,4 +116,61 @@ struct TfSvgWatermark : SvgWidget
 	}
 };
 
+// Quality tier of a solver-based module, indexing tfdsp::QualityTier. Choosing
+// a tier also selects its oversampling factor, which the Oversampling menu
+// can still change afterwards. Modules with a fixed factor pass no
+// oversampling index.
+inline void appendQualityMenu(Menu* menu, int* quality, int* oversampling = nullptr)
+{
+	menu->addChild(createIndexSubmenuItem("Quality",
+		std::vector<std::string>(tfdsp::QualityTierLabels.begin(),
+			tfdsp::QualityTierLabels.end()),
+		[=]() { return static_cast<size_t>(*quality); },
+		[=](size_t tier)
+		{
+			*quality = static_cast<int>(tier);
+			if (oversampling)
+				*oversampling = tfdsp::QualitySettingsFor(
+					tfdsp::QualityTierAt(*quality)).oversampling;
+		}));
+}
+
+#ifdef TRIGGERFISH_PROFILE
+// Context-menu readout of a module's tfdsp::ProfileCounters. The submenu is
+// built when opened, so it always shows the counters at that moment.
+inline void appendProfileMenu(Menu* menu, tfdsp::ProfileCounters* counters,
+	const std::string& slug)
+{
+	menu->addChild(createSubmenuItem("Profile", "", [=](Menu* submenu)
+	{
+		const auto snapshot = counters->Read();
+		const double samples = std::max<double>(snapshot.samples, 1.0);
+		const double total = std::max<double>(snapshot.TotalTicks(), 1.0);
+		submenu->addChild(createMenuLabel(string::f("%llu samples, %.1f %s/sample",
+			static_cast<unsigned long long>(snapshot.samples),
+			snapshot.TotalTicks() / samples, tfdsp::ProfileTickUnit)));
+		for (int i = 0; i < tfdsp::ProfileCounters::SectionCount; ++i)
+			submenu->addChild(createMenuLabel(string::f("%s: %.1f%% (%.1f/sample)",
+				tfdsp::ProfileSectionName(static_cast<tfdsp::ProfileSection>(i)),
+				100.0 * snapshot.ticks[i] / total, snapshot.ticks[i] / samples)));
+		submenu->addChild(new MenuSeparator);
+		submenu->addChild(createMenuItem("Reset profile counters", "",
+			[=]() { counters->RequestReset(); }));
+		submenu->addChild(createMenuItem("Save profile JSON", "", [=]()
+		{
+			const std::string path = asset::user("TriggerFish-profile-" + slug + ".json");
+			if (std::FILE* file = std::fopen(path.c_str(), "w"))
+			{
+				const std::string json = counters->ToJson(slug);
+				std::fwrite(json.data(), 1, json.size(), file);
+				std::fclose(file);
+				INFO("Wrote %s", path.c_str());
+			}
+			else
+				WARN("Could not write %s", path.c_str());
+		}));
+	}));
+}
+#endif
+
 } // namespace rack
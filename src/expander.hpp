@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+#include "plugin.hpp"
+
+/**
+ * Expander message from a 303 Oscillator to a 303 Voice Core placed directly
+ * to its right.
+ *
+ * It carries each channel's mixed oscillator output at the internal rate, so
+ * a voice core running the same oversampling factor filters it without the
+ * oscillator decimating and the filter interpolating it again. A voice core
+ * at the other factor converts the frames with one half-band stage. The
+ * voice core owns both buffers as its left expander messages; Rack swaps them
+ * after each engine frame, so the voice core hears the frame the oscillator
+ * rendered one sample earlier, just as it would through a cable.
+ */
+struct OversampledAudioBus
+{
+	// Oversampling factor of the valid frames: 2 or 4.
+	int factor{};
+	int channels{};
+	// Advanced by the producer on every frame. A consumer that sees the same
+	// value twice is reading a message left behind by a bypassed producer.
+	std::uint64_t sequence{};
+	std::array<Eigen::Array<double, 2, 1>, PORT_MAX_CHANNELS> framesX2{};
+	std::array<Eigen::Array<double, 4, 1>, PORT_MAX_CHANNELS> framesX4{};
+};
@@ -2,9 +2,9 @@
 
 #include <algorithm>
 #include <cmath>
-#include <functional>
-#include <memory>
 
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/profile_scope.hpp"
 #include "tfdsp/rail.hpp"
 #include "tfdsp/sampleRate.hpp"
 
@@ -53,12 +53,13 @@ class Arp4019Vca
 {
 public:
 	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
+	using Resampler = ResamplerType;
 
-	explicit Arp4019Vca(
-		std::function<std::unique_ptr<ResamplerType>()> resamplerCreator)
-		: _audioResampler(resamplerCreator()),
-		  _linearCvResampler(resamplerCreator()),
-		  _exponentialCvResampler(resamplerCreator())
+	// Each resampling stage starts as a copy of `resampler`.
+	explicit Arp4019Vca(const ResamplerType& resampler)
+		: _audioResampler(resampler),
+		  _linearCvResampler(resampler),
+		  _exponentialCvResampler(resampler)
 	{
 	}
 
@@ -75,9 +76,9 @@ public:
 
 	void Reset()
 	{
-		_audioResampler->Reset();
-		_linearCvResampler->Reset();
-		_exponentialCvResampler->Reset();
+		_audioResampler.Reset();
+		_linearCvResampler.Reset();
+		_exponentialCvResampler.Reset();
 		_outputLowPass = 0.0;
 		_lastControlGain = 0.0;
 		_lastControlCurrent = 0.0;
@@ -97,18 +98,31 @@ public:
 			return 0.0f;
 		}
 
-		const auto audio = _audioResampler->Upsample(
-			noninvertingInputVolts - invertingInputVolts);
-		const auto linearCv = _linearCvResampler->Upsample(linearControlVolts);
-		const auto exponentialCv = _exponentialCvResampler->Upsample(
-			exponentialControlVolts);
+		Eigen::Array<double, OversamplingFactor, 1> audio;
+		Eigen::Array<double, OversamplingFactor, 1> linearCv;
+		Eigen::Array<double, OversamplingFactor, 1> exponentialCv;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			audio = _audioResampler.Upsample(
+				noninvertingInputVolts - invertingInputVolts);
+			linearCv = _linearCvResampler.Upsample(linearControlVolts);
+			exponentialCv = _exponentialCvResampler.Upsample(
+				exponentialControlVolts);
+		}
 		Eigen::Array<double, OversamplingFactor, 1> output;
-		for (int i = 0; i < OversamplingFactor; ++i)
-			output(i) = RackOutputAdapter::ProcessOversampled(
-				ProcessOversampled(audio(i), linearCv(i), exponentialCv(i),
-					initialGain));
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < OversamplingFactor; ++i)
+				output(i) = RackOutputAdapter::ProcessOversampled(
+					ProcessOversampled(audio(i), linearCv(i), exponentialCv(i),
+						initialGain));
+		}
 
-		const double result = _audioResampler->Downsample(output);
+		double result;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			result = _audioResampler.Downsample(output);
+		}
 		if (!std::isfinite(result))
 		{
 			Reset();
@@ -148,7 +162,8 @@ public:
 		const double outputCurrent = _lastControlCurrent * std::tanh(
 			differentialBaseVolts / (2.0 * ThermalVoltage));
 		const double target = OutputFeedbackResistanceOhms * outputCurrent;
-		_outputLowPass += _outputCoefficient * (target - _outputLowPass);
+		_outputLowPass = SnapToZero(_outputLowPass +
+			_outputCoefficient * (target - _outputLowPass));
 		return SoftOutputCompliance(_outputLowPass);
 	}
 
@@ -195,9 +210,9 @@ private:
 	static constexpr double OutputKneeVolts = 10.0;
 	static constexpr double OutputRailVolts = 13.5;
 
-	std::unique_ptr<ResamplerType> _audioResampler;
-	std::unique_ptr<ResamplerType> _linearCvResampler;
-	std::unique_ptr<ResamplerType> _exponentialCvResampler;
+	ResamplerType _audioResampler;
+	ResamplerType _linearCvResampler;
+	ResamplerType _exponentialCvResampler;
 	double _hostSampleRate{};
 	double _sampleRate{};
 	double _outputCoefficient{};
@@ -4,13 +4,15 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
-#include <functional>
 #include <limits>
-#include <memory>
 #include <utility>
 
 #include "tfdsp/sampleRate.hpp"
 #include "tfdsp/approx.hpp"
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/implicit.hpp"
+#include "tfdsp/profile_scope.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/rail.hpp"
 
 namespace tfdsp
@@ -27,23 +29,28 @@ namespace tfdsp
 // States are the AC components of the four LM3900 output voltages. Their large
 // negative quiescent voltage is removed analytically; the even number of
 // inverting stages and the final level-shifter cancel it in the hardware too.
-template<typename ResamplerType, int MaximumNewtonIterations = 8>
+//
+// MaximumNewtonIterations bounds the runtime solver settings, which default to
+// the Standard quality tier.
+template<typename ResamplerType,
+	int MaximumNewtonIterations = MaximumSolverIterations>
 class Arp4072Filter
 {
 public:
 	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
+	using Resampler = ResamplerType;
 	static_assert(MaximumNewtonIterations >= 0,
 		"Newton iteration limit must be non-negative");
 
-	explicit Arp4072Filter(
-		std::function<std::unique_ptr<ResamplerType>()> resamplerCreator)
-		: _resampler(resamplerCreator()),
-		  _cutoffPitchResampler(resamplerCreator()),
-		  _linearFmResampler(resamplerCreator()),
-		  _resonanceResampler(resamplerCreator()),
-		  _postOutputResampler(resamplerCreator()),
-		  _postLinearCvResampler(resamplerCreator()),
-		  _postExponentialCvResampler(resamplerCreator())
+	// Each resampling stage starts as a copy of `resampler`.
+	explicit Arp4072Filter(const ResamplerType& resampler)
+		: _resampler(resampler),
+		  _cutoffPitchResampler(resampler),
+		  _linearFmResampler(resampler),
+		  _resonanceResampler(resampler),
+		  _postOutputResampler(resampler),
+		  _postLinearCvResampler(resampler),
+		  _postExponentialCvResampler(resampler)
 	{
 	}
 
@@ -65,13 +72,13 @@ public:
 	void Reset()
 	{
 		_state = {};
-		_resampler->Reset();
-		_cutoffPitchResampler->Reset();
-		_linearFmResampler->Reset();
-		_resonanceResampler->Reset();
-		_postOutputResampler->Reset();
-		_postLinearCvResampler->Reset();
-		_postExponentialCvResampler->Reset();
+		_resampler.Reset();
+		_cutoffPitchResampler.Reset();
+		_linearFmResampler.Reset();
+		_resonanceResampler.Reset();
+		_postOutputResampler.Reset();
+		_postLinearCvResampler.Reset();
+		_postExponentialCvResampler.Reset();
 		_lastIterations = 0;
 		_solverFailures = 0;
 	}
@@ -112,18 +119,29 @@ public:
 		const auto controls = UpsampleControls(log2CutoffHz, linearFmHz, resonance,
 			std::min(CutoffCeilingHz, numericalCeiling));
 
-		const auto upsampled = _resampler->Upsample(inputRackVolts * driveGain);
+		Eigen::Array<double, OversamplingFactor, 1> upsampled;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			upsampled = _resampler.Upsample(inputRackVolts * driveGain);
+		}
 		Eigen::Array<double, OversamplingFactor, 1> output;
-		for (int i = 0; i < OversamplingFactor; ++i)
 		{
-			const double physicalOutput = OutputLevelShiftGain *
-				ProcessOversampled(upsampled(i), controls.cutoffHz(i),
-					controls.resonance(i));
-			output(i) = RackOutputAdapter::ProcessOversampled(
-				SoftOutputCompliance(physicalOutput));
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < OversamplingFactor; ++i)
+			{
+				const double physicalOutput = OutputLevelShiftGain *
+					ProcessOversampled(upsampled(i), controls.cutoffHz(i),
+						controls.resonance(i));
+				output(i) = RackOutputAdapter::ProcessOversampled(
+					SoftOutputCompliance(physicalOutput));
+			}
 		}
 
-		const double result = _resampler->Downsample(output);
+		double result;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			result = _resampler.Downsample(output);
+		}
 		if (!std::isfinite(result))
 		{
 			Reset();
@@ -187,29 +205,42 @@ public:
 		const auto controls = UpsampleControls(log2CutoffHz, linearFmHz, resonance,
 			std::min(CutoffCeilingHz, numericalCeiling));
 
-		const auto audio = _resampler->Upsample(inputRackVolts * driveGain);
-		const auto linearCv = _postLinearCvResampler->Upsample(
-			linearControlVolts);
-		const auto exponentialCv = _postExponentialCvResampler->Upsample(
-			exponentialControlVolts);
+		Eigen::Array<double, OversamplingFactor, 1> audio;
+		Eigen::Array<double, OversamplingFactor, 1> linearCv;
+		Eigen::Array<double, OversamplingFactor, 1> exponentialCv;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			audio = _resampler.Upsample(inputRackVolts * driveGain);
+			linearCv = _postLinearCvResampler.Upsample(linearControlVolts);
+			exponentialCv = _postExponentialCvResampler.Upsample(
+				exponentialControlVolts);
+		}
 		Eigen::Array<double, OversamplingFactor, 1> lowPass;
 		Eigen::Array<double, OversamplingFactor, 1> postProcessed;
-		for (int i = 0; i < OversamplingFactor; ++i)
 		{
-			const double physicalOutput = OutputLevelShiftGain *
-				ProcessOversampled(audio(i), controls.cutoffHz(i),
-					controls.resonance(i));
-			// The final ARP level shifter and its supply compliance precede the
-			// normalled connection to the VCA. Both output paths therefore see
-			// exactly the same filter-node level and overload behavior.
-			const double limitedOutput = SoftOutputCompliance(physicalOutput);
-			lowPass(i) = RackOutputAdapter::ProcessOversampled(limitedOutput);
-			postProcessed(i) = RackOutputAdapter::ProcessOversampled(
-				postProcessor(limitedOutput, linearCv(i), exponentialCv(i)));
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < OversamplingFactor; ++i)
+			{
+				const double physicalOutput = OutputLevelShiftGain *
+					ProcessOversampled(audio(i), controls.cutoffHz(i),
+						controls.resonance(i));
+				// The final ARP level shifter and its supply compliance precede the
+				// normalled connection to the VCA. Both output paths therefore see
+				// exactly the same filter-node level and overload behavior.
+				const double limitedOutput = SoftOutputCompliance(physicalOutput);
+				lowPass(i) = RackOutputAdapter::ProcessOversampled(limitedOutput);
+				postProcessed(i) = RackOutputAdapter::ProcessOversampled(
+					postProcessor(limitedOutput, linearCv(i), exponentialCv(i)));
+			}
 		}
 
-		const double lowPassResult = _resampler->Downsample(lowPass);
-		const double postResult = _postOutputResampler->Downsample(postProcessed);
+		double lowPassResult;
+		double postResult;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			lowPassResult = _resampler.Downsample(lowPass);
+			postResult = _postOutputResampler.Downsample(postProcessed);
+		}
 		if (!std::isfinite(lowPassResult) || !std::isfinite(postResult))
 		{
 			Reset();
@@ -223,6 +254,15 @@ public:
 		};
 	}
 
+	/** Iteration limit and residual tolerance, in volts, of the ladder solve. */
+	void SetSolverSettings(const NewtonSolverSettings& settings)
+	{
+		_solver.maximumIterations = std::clamp(settings.maximumIterations, 0,
+			MaximumNewtonIterations);
+		_solver.tolerance = settings.tolerance;
+	}
+
+	const NewtonSolverSettings& SolverSettings() const { return _solver; }
 	int LastIterations() const { return _lastIterations; }
 	std::size_t SolverFailures() const { return _solverFailures; }
 	const std::array<double, 4>& State() const { return _state; }
@@ -333,16 +373,18 @@ private:
 	static constexpr double OutputKneeVolts = 10.0;
 	static constexpr double OutputRailVolts = 13.5;
 
-	std::unique_ptr<ResamplerType> _resampler;
-	std::unique_ptr<ResamplerType> _cutoffPitchResampler;
-	std::unique_ptr<ResamplerType> _linearFmResampler;
-	std::unique_ptr<ResamplerType> _resonanceResampler;
-	std::unique_ptr<ResamplerType> _postOutputResampler;
-	std::unique_ptr<ResamplerType> _postLinearCvResampler;
-	std::unique_ptr<ResamplerType> _postExponentialCvResampler;
+	ResamplerType _resampler;
+	ResamplerType _cutoffPitchResampler;
+	ResamplerType _linearFmResampler;
+	ResamplerType _resonanceResampler;
+	ResamplerType _postOutputResampler;
+	ResamplerType _postLinearCvResampler;
+	ResamplerType _postExponentialCvResampler;
 	std::array<double, 4> _state{};
 	double _hostSampleRate{};
 	double _sampleRate{};
+	NewtonSolverSettings _solver{ QualitySettingsFor(
+		QualityTier::Standard).ladderFilter };
 	int _lastIterations{};
 	std::size_t _solverFailures{};
 
@@ -375,9 +417,10 @@ private:
 		// Reconstruct cutoff in its exponential control domain. Mapping to hertz
 		// after interpolation keeps audio-rate 1 V/octave modulation band-limited
 		// before it changes the nonlinear solver coefficients.
-		const auto cutoffPitch = _cutoffPitchResampler->Upsample(log2CutoffHz);
-		const auto linearFm = _linearFmResampler->Upsample(linearFmHz);
-		auto resonanceValues = _resonanceResampler->Upsample(resonance);
+		TF_PROFILE_SCOPE(Resampling);
+		const auto cutoffPitch = _cutoffPitchResampler.Upsample(log2CutoffHz);
+		const auto linearFm = _linearFmResampler.Upsample(linearFmHz);
+		auto resonanceValues = _resonanceResampler.Upsample(resonance);
 		OversampledControls controls;
 		for (int i = 0; i < OversamplingFactor; ++i)
 		{
@@ -413,45 +456,35 @@ private:
 			OutputLevelShiftGain;
 
 		const auto previous = _state;
-		auto next = previous;
-		bool converged = false;
-		_lastIterations = 0;
+		ImplicitVector<4> next(previous[0], previous[1], previous[2],
+			previous[3]);
+		double limiterTanh{};
+		std::array<double, 4> stageTanh{};
 
-		for (int iteration = 0; iteration < MaximumNewtonIterations; ++iteration)
+		const auto residual = [&](const ImplicitVector<4>& state,
+			ImplicitVector<4>& value)
 		{
-			++_lastIterations;
 			std::array<double, 4> midpoint{};
 			for (int i = 0; i < 4; ++i)
-				midpoint[i] = 0.5 * (previous[i] + next[i]);
+				midpoint[i] = 0.5 * (previous[i] + state(i));
 
 			const double limiterVoltage = input * AudioBaseScale() -
 				feedbackScale * midpoint[3];
-			const double limiterTanh = std::tanh(
-				limiterVoltage / (2.0 * ThermalVoltage));
+			limiterTanh = std::tanh(limiterVoltage / (2.0 * ThermalVoltage));
 			const double firstInput = limiterPeak * limiterTanh;
 
-			std::array<double, 4> stageTanh{};
 			stageTanh[0] = std::tanh(stageSaturationCoefficient *
 				(firstInput + midpoint[0]));
 			for (int i = 1; i < 4; ++i)
 				stageTanh[i] = std::tanh(stageSaturationCoefficient *
 					(midpoint[i - 1] + midpoint[i]));
 
-			std::array<double, 4> residual{};
-			double maximumResidual = 0.0;
 			for (int i = 0; i < 4; ++i)
-			{
-				residual[i] = next[i] - previous[i] +
-					stageStep * stageTanh[i];
-				maximumResidual = std::max(maximumResidual,
-					std::abs(residual[i]));
-			}
-			if (maximumResidual < 1.0e-11)
-			{
-				converged = true;
-				break;
-			}
-
+				value(i) = state(i) - previous[i] + stageStep * stageTanh[i];
+		};
+		const auto jacobian = [&](const ImplicitVector<4>&,
+			ImplicitMatrix<4>& matrix)
+		{
 			const double limiterSlope = 1.0 - limiterTanh * limiterTanh;
 			const double firstInputDerivative = -0.5 * limiterPeak *
 				limiterSlope * feedbackScale /
@@ -460,31 +493,24 @@ private:
 			for (int i = 0; i < 4; ++i)
 				stageSlope[i] = 1.0 - stageTanh[i] * stageTanh[i];
 
-			double jacobian[4][4]{
-				{1.0 + 0.5 * gamma * stageSlope[0], 0.0, 0.0,
-					gamma * stageSlope[0] * firstInputDerivative},
-				{0.5 * gamma * stageSlope[1],
-					1.0 + 0.5 * gamma * stageSlope[1], 0.0, 0.0},
-				{0.0, 0.5 * gamma * stageSlope[2],
-					1.0 + 0.5 * gamma * stageSlope[2], 0.0},
-				{0.0, 0.0, 0.5 * gamma * stageSlope[3],
-					1.0 + 0.5 * gamma * stageSlope[3]},
-			};
-			for (double& value : residual)
-				value = -value;
-			if (!Solve4x4(jacobian, residual))
-				break;
-
-			double maximumDelta = 0.0;
-			for (double value : residual)
-				maximumDelta = std::max(maximumDelta, std::abs(value));
-			const double damping = maximumDelta > 2.0 ?
-				2.0 / maximumDelta : 1.0;
-			for (int i = 0; i < 4; ++i)
-				next[i] += damping * residual[i];
-		}
+			matrix <<
+				1.0 + 0.5 * gamma * stageSlope[0], 0.0, 0.0,
+					gamma * stageSlope[0] * firstInputDerivative,
+				0.5 * gamma * stageSlope[1],
+					1.0 + 0.5 * gamma * stageSlope[1], 0.0, 0.0,
+				0.0, 0.5 * gamma * stageSlope[2],
+					1.0 + 0.5 * gamma * stageSlope[2], 0.0,
+				0.0, 0.0, 0.5 * gamma * stageSlope[3],
+					1.0 + 0.5 * gamma * stageSlope[3];
+		};
 
-		if (!converged)
+		const NewtonSolverSettings settings{ std::min(
+			_solver.maximumIterations, MaximumNewtonIterations),
+			_solver.tolerance };
+		const auto telemetry = SolveNewton<4>(next, residual, jacobian,
+			settings, MaximumNewtonStep{ 2.0 });
+		_lastIterations = telemetry.iterations;
+		if (!telemetry.converged)
 		{
 			// Never commit an iterate whose residual has not met the solver
 			// tolerance. Holding the previous state for one internal sample keeps
@@ -493,56 +519,17 @@ private:
 			++_solverFailures;
 			return previous[3];
 		}
-		for (double value : next)
+		for (int i = 0; i < 4; ++i)
 		{
-			if (!std::isfinite(value) || std::abs(value) > 100.0)
+			if (!std::isfinite(next(i)) || std::abs(next(i)) > 100.0)
 			{
 				Reset();
 				return 0.0;
 			}
 		}
-		_state = next;
-		return next[3];
-	}
-
-	static bool Solve4x4(double matrix[4][4], std::array<double, 4>& rhs)
-	{
-		for (int column = 0; column < 4; ++column)
-		{
-			int pivot = column;
-			for (int row = column + 1; row < 4; ++row)
-			{
-				if (std::abs(matrix[row][column]) >
-					std::abs(matrix[pivot][column]))
-					pivot = row;
-			}
-			if (std::abs(matrix[pivot][column]) < 1.0e-14)
-				return false;
-			if (pivot != column)
-			{
-				for (int i = column; i < 4; ++i)
-					std::swap(matrix[column][i], matrix[pivot][i]);
-				std::swap(rhs[column], rhs[pivot]);
-			}
-
-			for (int row = column + 1; row < 4; ++row)
-			{
-				const double factor = matrix[row][column] /
-					matrix[column][column];
-				for (int i = column + 1; i < 4; ++i)
-					matrix[row][i] -= factor * matrix[column][i];
-				rhs[row] -= factor * rhs[column];
-			}
-		}
-
-		for (int row = 3; row >= 0; --row)
-		{
-			double value = rhs[row];
-			for (int column = row + 1; column < 4; ++column)
-				value -= matrix[row][column] * rhs[column];
-			rhs[row] = value / matrix[row][row];
-		}
-		return true;
+		for (int i = 0; i < 4; ++i)
+			_state[i] = SnapToZero(next(i));
+		return _state[3];
 	}
 };
 
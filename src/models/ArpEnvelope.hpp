@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <cmath>
 
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/profile_scope.hpp"
+
 namespace tfdsp
 {
 
@@ -77,6 +80,7 @@ public:
 		double decaySeconds, double sustain, double releaseSeconds,
 		double curve = 0.0, bool autoGateTrigger = true)
 	{
+		TF_PROFILE_SCOPE(Envelope);
 		gateVolts = std::isfinite(gateVolts) ? gateVolts : 0.0;
 		triggerVolts = std::isfinite(triggerVolts) ? triggerVolts : 0.0;
 		attackSeconds = SanitizeTime(attackSeconds);
@@ -281,7 +285,7 @@ private:
 		const double remaining = 1.0 - oldCurve;
 		const double fraction = remaining > 1.0e-12 ?
 			std::clamp((nextCurve - oldCurve) / remaining, 0.0, 1.0) : 1.0;
-		_value += fraction * (target - _value);
+		_value = SnapToZero(_value + fraction * (target - _value));
 		_phase = nextPhase;
 	}
 };
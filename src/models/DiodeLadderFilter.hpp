@@ -4,16 +4,20 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
-#include <functional>
 #include <limits>
-#include <memory>
 #include <utility>
 
+#include <Eigen/Dense>
+
 #include "AnalogOutputStage.hpp"
 #include "tfdsp/rail.hpp"
 #include "tfdsp/filters.hpp"
 #include "tfdsp/sampleRate.hpp"
 #include "tfdsp/approx.hpp"
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/implicit.hpp"
+#include "tfdsp/profile_scope.hpp"
+#include "tfdsp/quality.hpp"
 
 namespace tfdsp
 {
@@ -36,6 +40,16 @@ public:
 		double offset{};
 	};
 
+	// output = feedthrough * input + stateToOutput * state, and the next
+	// state = inputToState * input + stateToState * state.
+	struct StateSpace
+	{
+		double feedthrough{};
+		double stateToOutput{};
+		double inputToState{};
+		double stateToState{};
+	};
+
 	void Configure(double poleRadians, double zeroRadians, double sampleRate)
 	{
 		const double safePole = std::max(poleRadians, 1.0e-12);
@@ -51,11 +65,17 @@ public:
 			_mix * _stateGain * _state};
 	}
 
+	StateSpace Realization() const
+	{
+		return {1.0 + _mix * _integratorGain, _mix * _stateGain,
+			2.0 * _integratorGain, 2.0 * _stateGain - 1.0};
+	}
+
 	double Process(double input)
 	{
 		const double lowPass = _integratorGain * input + _stateGain * _state;
 		const double output = input + _mix * lowPass;
-		_state = 2.0 * lowPass - _state;
+		_state = SnapToZero(2.0 * lowPass - _state);
 		return output;
 	}
 
@@ -71,50 +91,78 @@ private:
 	double _state{};
 };
 
+// A chain of AnalogRatioSections compiled into one state-space system
+//
+//     y = c s + d u,    s' = A s + b u.
+//
+// Each section's input is the previous section's output, so A is lower
+// triangular. A sample costs one small matrix-vector product rather than a
+// chain of dependent section updates, and the affine preview used by the
+// zero-delay ladder solve is a single dot product. The states are those of
+// the individual sections, so results match the sequential chain to
+// rounding.
 template<std::size_t Size>
 class AnalogRatioCascade
 {
 public:
 	using PoleZero = std::pair<double, double>;
+	static constexpr int Order = static_cast<int>(Size);
 
 	void Configure(const std::array<PoleZero, Size>& poleZeros,
 		double sampleRate, double gain)
 	{
-		_gain = gain;
-		for (std::size_t i = 0; i < Size; ++i)
-			_sections[i].Configure(poleZeros[i].first,
-				poleZeros[i].second, sampleRate);
+		// The input of section k as an affine function of the cascade input
+		// and the states of the sections before it.
+		Eigen::Matrix<double, 1, Order> stateToSectionInput =
+			Eigen::Matrix<double, 1, Order>::Zero();
+		double inputToSectionInput = 1.0;
+		_transition.setZero();
+		for (int k = 0; k < Order; ++k)
+		{
+			AnalogRatioSection section;
+			section.Configure(poleZeros[k].first, poleZeros[k].second,
+				sampleRate);
+			const auto realization = section.Realization();
+			_transition.row(k) = realization.inputToState * stateToSectionInput;
+			_transition(k, k) += realization.stateToState;
+			_inputToState(k) = realization.inputToState * inputToSectionInput;
+			stateToSectionInput *= realization.feedthrough;
+			stateToSectionInput(k) += realization.stateToOutput;
+			inputToSectionInput *= realization.feedthrough;
+		}
+		_stateToOutput = gain * stateToSectionInput;
+		_feedthrough = gain * inputToSectionInput;
 	}
 
 	typename AnalogRatioSection::Affine Preview() const
 	{
-		double gain = 1.0;
-		double offset = 0.0;
-		for (const auto& section : _sections)
-		{
-			const auto affine = section.Preview();
-			gain = affine.gain * gain;
-			offset = affine.gain * offset + affine.offset;
-		}
-		return {_gain * gain, _gain * offset};
+		return {_feedthrough, _stateToOutput.dot(_state.matrix())};
 	}
 
 	double Process(double input)
 	{
-		for (auto& section : _sections)
-			input = section.Process(input);
-		return _gain * input;
+		const double output = _stateToOutput.dot(_state.matrix()) +
+			_feedthrough * input;
+		_state = (_transition * _state.matrix() + _inputToState * input).array();
+		SnapToZero(_state);
+		return output;
 	}
 
 	void Reset()
 	{
-		for (auto& section : _sections)
-			section.Reset();
+		_state.setZero();
 	}
 
 private:
-	std::array<AnalogRatioSection, Size> _sections{};
-	double _gain{1.0};
+	Eigen::Matrix<double, Order, Order> _transition{
+		Eigen::Matrix<double, Order, Order>::Identity() };
+	Eigen::Matrix<double, Order, 1> _inputToState{
+		Eigen::Matrix<double, Order, 1>::Zero() };
+	Eigen::Matrix<double, 1, Order> _stateToOutput{
+		Eigen::Matrix<double, 1, Order>::Zero() };
+	double _feedthrough{1.0};
+	Eigen::Array<double, Order, 1> _state{
+		Eigen::Array<double, Order, 1>::Zero() };
 };
 
 // Circuit-structured nonlinear model of the four-capacitor TB-303 diode
@@ -134,14 +182,16 @@ class DiodeLadderFilter
 {
 public:
 	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
-
-	explicit DiodeLadderFilter(
-		std::function<std::unique_ptr<ResamplerType>()> resamplerCreator)
-		: _resampler(resamplerCreator()),
-		  _cutoffPitchResampler(resamplerCreator()),
-		  _linearFmResampler(resamplerCreator()),
-		  _resonanceResampler(resamplerCreator()),
-		  _postResampler(resamplerCreator())
+	using Resampler = ResamplerType;
+	using Frame = Eigen::Array<double, OversamplingFactor, 1>;
+
+	// Each resampling stage starts as a copy of `resampler`.
+	explicit DiodeLadderFilter(const ResamplerType& resampler)
+		: _resampler(resampler),
+		  _cutoffPitchResampler(resampler),
+		  _linearFmResampler(resampler),
+		  _resonanceResampler(resampler),
+		  _postResampler(resampler)
 	{
 	}
 
@@ -196,11 +246,11 @@ public:
 		_outputCoupling.Reset();
 		for (auto& section : _bassCorrection)
 			section.Reset();
-		_resampler->Reset();
-		_cutoffPitchResampler->Reset();
-		_linearFmResampler->Reset();
-		_resonanceResampler->Reset();
-		_postResampler->Reset();
+		_resampler.Reset();
+		_cutoffPitchResampler.Reset();
+		_linearFmResampler.Reset();
+		_resonanceResampler.Reset();
+		_postResampler.Reset();
 		_smoothedBass = 0.0;
 		_smoothedDrive = 0.0;
 		_configuredBass = -1.0;
@@ -256,23 +306,34 @@ public:
 		// pair's tanh(v / 2VT) coordinates this is about 1.05 normalized Vpp.
 		// Map a nominal 10 Vpp Rack oscillator to that circuit drive. The
 		// Devil Fish range then extends to 66.6 times the stock level.
-		const auto upsampled = _resampler->Upsample(inputVolts * StockInputScale);
+		Frame upsampled;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			upsampled = _resampler.Upsample(inputVolts * StockInputScale);
+		}
 		Eigen::Array<double, OversamplingFactor, 1> output;
-		for (int i = 0; i < OversamplingFactor; ++i)
 		{
-			const double resonanceMakeup = 1.0 + controls.resonance(i) *
-				(highResonance ? HighResonanceMakeup : StockResonanceMakeup);
-			output(i) = AnalogOutputStage::Process(
-				RackOutputScale * resonanceMakeup * ProcessOversampled(
-					upsampled(i), controls.cutoffHz(i), controls.resonance(i),
-					highResonance, driveGain, bass));
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < OversamplingFactor; ++i)
+			{
+				const double resonanceMakeup = 1.0 + controls.resonance(i) *
+					(highResonance ? HighResonanceMakeup : StockResonanceMakeup);
+				output(i) = AnalogOutputStage::Process(
+					RackOutputScale * resonanceMakeup * ProcessOversampled(
+						upsampled(i), controls.cutoffHz(i), controls.resonance(i),
+						highResonance, driveGain, bass));
+			}
 		}
 
 		// Open303 and tbvcf both use resonance-dependent output makeup. The
 		// calibration is based on AC signal level after the output coupling
 		// section, retaining some authentic thinning without counting nonlinear
 		// DC offset as useful output level.
-		const double result = _resampler->Downsample(output);
+		double result;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			result = _resampler.Downsample(output);
+		}
 		if (!std::isfinite(result))
 		{
 			Reset();
@@ -322,58 +383,48 @@ public:
 		bool highResonance, double driveGain, double bass, double postControl,
 		PostProcessor&& postProcessor)
 	{
-		if (!std::isfinite(inputVolts) ||
-			!std::isfinite(log2CutoffHz) || !std::isfinite(linearFmHz) ||
-			!std::isfinite(resonance) || !std::isfinite(driveGain) ||
-			!std::isfinite(bass) || !std::isfinite(postControl) ||
-			!(_sampleRate > 0.0))
+		if (!std::isfinite(inputVolts))
 		{
 			Reset();
 			return {};
 		}
-
-		const double maximumCutoff = std::min(20000.0, 0.45 * _hostSampleRate);
-		const auto controls = UpsampleControls(log2CutoffHz, linearFmHz,
-			resonance, maximumCutoff);
-		driveGain = std::clamp(driveGain, 0.0, 66.6);
-		bass = std::clamp(bass, 0.0, 1.0);
-
-		const auto upsampled = _resampler->Upsample(inputVolts * StockInputScale);
-		const auto upsampledControl = _postResampler->Upsample(postControl);
-		Eigen::Array<double, OversamplingFactor, 1> lowPass;
-		Eigen::Array<double, OversamplingFactor, 1> postProcessed;
-		const double vcaInputScale = RackOutputScale;
-		for (int i = 0; i < OversamplingFactor; ++i)
+		Frame upsampled;
 		{
-			const double resonanceMakeup = 1.0 + controls.resonance(i) *
-				(highResonance ? HighResonanceMakeup : StockResonanceMakeup);
-			const double filtered = ProcessOversampled(upsampled(i),
-				controls.cutoffHz(i), controls.resonance(i), highResonance,
-				driveGain, bass);
-			lowPass(i) = AnalogOutputStage::Process(
-				RackOutputScale * resonanceMakeup * filtered);
-			// Resonance makeup is a Rack output calibration rather than part of
-			// the circuit. Apply it after the nonlinear VCA so it cannot change
-			// the BA662 drive and then pass it through the modeled output rail.
-			postProcessed(i) = AnalogOutputStage::Process(resonanceMakeup *
-				postProcessor(vcaInputScale * filtered, upsampledControl(i)));
+			TF_PROFILE_SCOPE(Resampling);
+			upsampled = _resampler.Upsample(inputVolts * StockInputScale);
 		}
+		return ProcessWithPostProcessor(upsampled, log2CutoffHz, linearFmHz, resonance, highResonance, driveGain, bass, postControl,
+			std::forward<PostProcessor>(postProcessor));
+	}
 
-		const double lowPassResult = _resampler->Downsample(lowPass);
-		const double postResult = _postResampler->Downsample(postProcessed);
-		if (!std::isfinite(lowPassResult) || !std::isfinite(postResult))
+	// As above, for an input that is already at the internal rate, such as the
+	// undecimated output of an oscillator running at the same factor. The input
+	// interpolator is skipped; the result is still decimated to the host rate.
+	template<typename PostProcessor>
+	ProcessedOutputs StepWithPostProcessorOversampledInput(const Frame& inputVolts,
+		double log2CutoffHz, double linearFmHz, double resonance,
+		bool highResonance, double driveGain, double bass, double postControl,
+		PostProcessor&& postProcessor)
+	{
+		if (!inputVolts.allFinite())
 		{
 			Reset();
 			return {};
 		}
-		return {
-			static_cast<float>(
-				RackOutputAdapter::ProcessPostDecimation(lowPassResult)),
-			static_cast<float>(
-				RackOutputAdapter::ProcessPostDecimation(postResult)),
-		};
+		return ProcessWithPostProcessor(inputVolts * StockInputScale,
+			log2CutoffHz, linearFmHz, resonance, highResonance, driveGain, bass,
+			postControl, std::forward<PostProcessor>(postProcessor));
+	}
+
+	/** Iteration limit and residual tolerance, in volts, of the ladder solve. */
+	void SetSolverSettings(const NewtonSolverSettings& settings)
+	{
+		_solver.maximumIterations = std::clamp(settings.maximumIterations, 0,
+			MaximumSolverIterations);
+		_solver.tolerance = settings.tolerance;
 	}
 
+	const NewtonSolverSettings& SolverSettings() const { return _solver; }
 	int LastIterations() const { return _lastIterations; }
 	std::size_t SolverFailures() const { return _solverFailures; }
 
@@ -407,11 +458,11 @@ private:
 	static constexpr double CutoffPinchKneeHz = 1.0;
 	static constexpr double CutoffCeilingKneeHz = 10.0;
 
-	std::unique_ptr<ResamplerType> _resampler;
-	std::unique_ptr<ResamplerType> _cutoffPitchResampler;
-	std::unique_ptr<ResamplerType> _linearFmResampler;
-	std::unique_ptr<ResamplerType> _resonanceResampler;
-	std::unique_ptr<ResamplerType> _postResampler;
+	ResamplerType _resampler;
+	ResamplerType _cutoffPitchResampler;
+	ResamplerType _linearFmResampler;
+	ResamplerType _resonanceResampler;
+	ResamplerType _postResampler;
 	AnalogRatioCascade<4> _forward;
 	AnalogRatioCascade<6> _feedback;
 	AnalogRatioSection _outputCoupling;
@@ -424,6 +475,8 @@ private:
 	double _configuredBass{-1.0};
 	double _bassSmoothing{};
 	double _driveSmoothing{};
+	NewtonSolverSettings _solver{ QualitySettingsFor(
+		QualityTier::Standard).ladderFilter };
 	int _lastIterations{};
 	std::size_t _solverFailures{};
 
@@ -440,9 +493,10 @@ private:
 		// linear FM remains in hertz. Combining them at the internal rate keeps
 		// both control laws intact and removes host-rate images before the
 		// nonlinear ladder.
-		const auto cutoffPitch = _cutoffPitchResampler->Upsample(log2CutoffHz);
-		const auto linearFm = _linearFmResampler->Upsample(linearFmHz);
-		auto resonanceValues = _resonanceResampler->Upsample(resonance);
+		TF_PROFILE_SCOPE(Resampling);
+		const auto cutoffPitch = _cutoffPitchResampler.Upsample(log2CutoffHz);
+		const auto linearFm = _linearFmResampler.Upsample(linearFmHz);
+		auto resonanceValues = _resonanceResampler.Upsample(resonance);
 		OversampledControls controls;
 		for (int i = 0; i < OversamplingFactor; ++i)
 		{
@@ -455,6 +509,74 @@ private:
 		return controls;
 	}
 
+	template<typename PostProcessor>
+	ProcessedOutputs ProcessWithPostProcessor(const Frame& upsampled,
+		double log2CutoffHz, double linearFmHz, double resonance,
+		bool highResonance, double driveGain, double bass, double postControl,
+		PostProcessor&& postProcessor)
+	{
+		if (!std::isfinite(log2CutoffHz) || !std::isfinite(linearFmHz) ||
+			!std::isfinite(resonance) || !std::isfinite(driveGain) ||
+			!std::isfinite(bass) || !std::isfinite(postControl) ||
+			!(_sampleRate > 0.0))
+		{
+			Reset();
+			return {};
+		}
+
+		const double maximumCutoff = std::min(20000.0, 0.45 * _hostSampleRate);
+		const auto controls = UpsampleControls(log2CutoffHz, linearFmHz,
+			resonance, maximumCutoff);
+		driveGain = std::clamp(driveGain, 0.0, 66.6);
+		bass = std::clamp(bass, 0.0, 1.0);
+
+		Frame upsampledControl;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			upsampledControl = _postResampler.Upsample(postControl);
+		}
+		Eigen::Array<double, OversamplingFactor, 1> lowPass;
+		Eigen::Array<double, OversamplingFactor, 1> postProcessed;
+		const double vcaInputScale = RackOutputScale;
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < OversamplingFactor; ++i)
+			{
+				const double resonanceMakeup = 1.0 + controls.resonance(i) *
+					(highResonance ? HighResonanceMakeup : StockResonanceMakeup);
+				const double filtered = ProcessOversampled(upsampled(i),
+					controls.cutoffHz(i), controls.resonance(i), highResonance,
+					driveGain, bass);
+				lowPass(i) = AnalogOutputStage::Process(
+					RackOutputScale * resonanceMakeup * filtered);
+				// Resonance makeup is a Rack output calibration rather than part of
+				// the circuit. Apply it after the nonlinear VCA so it cannot change
+				// the BA662 drive and then pass it through the modeled output rail.
+				postProcessed(i) = AnalogOutputStage::Process(resonanceMakeup *
+					postProcessor(vcaInputScale * filtered, upsampledControl(i)));
+			}
+		}
+
+		double lowPassResult;
+		double postResult;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			lowPassResult = _resampler.Downsample(lowPass);
+			postResult = _postResampler.Downsample(postProcessed);
+		}
+		if (!std::isfinite(lowPassResult) || !std::isfinite(postResult))
+		{
+			Reset();
+			return {};
+		}
+		return {
+			static_cast<float>(
+				RackOutputAdapter::ProcessPostDecimation(lowPassResult)),
+			static_cast<float>(
+				RackOutputAdapter::ProcessPostDecimation(postResult)),
+		};
+	}
+
 	static double Softplus(double value, double knee)
 	{
 		const double normalized = value / knee;
@@ -499,133 +621,81 @@ private:
 			std::tan(PI * cutoffHz / _sampleRate);
 
 		const auto previous = _state;
-		auto next = previous;
-		bool converged = false;
-		_lastIterations = 0;
+		ImplicitVector<4> next(previous[0], previous[1], previous[2],
+			previous[3]);
+		std::array<double, 5> junction{};
 
-		for (int iteration = 0; iteration < 8; ++iteration)
+		const auto residual = [&](const ImplicitVector<4>& state,
+			ImplicitVector<4>& value)
 		{
-			++_lastIterations;
 			std::array<double, 4> midpoint{};
 			for (int i = 0; i < 4; ++i)
-				midpoint[i] = 0.5 * (previous[i] + next[i]);
+				midpoint[i] = 0.5 * (previous[i] + state(i));
 
-			const double feedback = feedbackAffine.gain * next[3] +
+			const double feedback = feedbackAffine.gain * state(3) +
 				feedbackAffine.offset;
 			const double inputJunction = forward - feedbackAmount * feedback;
-			const double junction0 = std::tanh(inputJunction);
-			const double junction1 = std::tanh(midpoint[0] - midpoint[1]);
-			const double junction2 = std::tanh(midpoint[1] - midpoint[2]);
-			const double junction3 = std::tanh(midpoint[2] - midpoint[3]);
-			const double junction4 = std::tanh(midpoint[3]);
+			junction[0] = std::tanh(inputJunction);
+			junction[1] = std::tanh(midpoint[0] - midpoint[1]);
+			junction[2] = std::tanh(midpoint[1] - midpoint[2]);
+			junction[3] = std::tanh(midpoint[2] - midpoint[3]);
+			junction[4] = std::tanh(midpoint[3]);
 
 			const std::array<double, 4> derivative{{
-				FirstStageScale * (junction0 - junction1),
-				junction1 - junction2,
-				junction2 - junction3,
-				junction3 - junction4,
+				FirstStageScale * (junction[0] - junction[1]),
+				junction[1] - junction[2],
+				junction[2] - junction[3],
+				junction[3] - junction[4],
 			}};
-			std::array<double, 4> residual{};
-			double maximumResidual = 0.0;
 			for (int i = 0; i < 4; ++i)
-			{
-				residual[i] = next[i] - previous[i] - step * derivative[i];
-				maximumResidual = std::max(maximumResidual, std::abs(residual[i]));
-			}
-			if (maximumResidual < 1.0e-11)
-			{
-				converged = true;
-				break;
-			}
-
-			const double slope0 = 1.0 - junction0 * junction0;
-			const double slope1 = 1.0 - junction1 * junction1;
-			const double slope2 = 1.0 - junction2 * junction2;
-			const double slope3 = 1.0 - junction3 * junction3;
-			const double slope4 = 1.0 - junction4 * junction4;
-
-			double jacobian[4][4]{
-				{1.0 + 0.5 * step * FirstStageScale * slope1,
+				value(i) = state(i) - previous[i] - step * derivative[i];
+		};
+		const auto jacobian = [&](const ImplicitVector<4>&,
+			ImplicitMatrix<4>& matrix)
+		{
+			const double slope0 = 1.0 - junction[0] * junction[0];
+			const double slope1 = 1.0 - junction[1] * junction[1];
+			const double slope2 = 1.0 - junction[2] * junction[2];
+			const double slope3 = 1.0 - junction[3] * junction[3];
+			const double slope4 = 1.0 - junction[4] * junction[4];
+
+			matrix <<
+				1.0 + 0.5 * step * FirstStageScale * slope1,
 					-0.5 * step * FirstStageScale * slope1, 0.0,
-					step * FirstStageScale * slope0 * feedbackAmount * feedbackAffine.gain},
-				{-0.5 * step * slope1,
+					step * FirstStageScale * slope0 * feedbackAmount * feedbackAffine.gain,
+				-0.5 * step * slope1,
 					1.0 + 0.5 * step * (slope1 + slope2),
-					-0.5 * step * slope2, 0.0},
-				{0.0, -0.5 * step * slope2,
+					-0.5 * step * slope2, 0.0,
+				0.0, -0.5 * step * slope2,
 					1.0 + 0.5 * step * (slope2 + slope3),
-					-0.5 * step * slope3},
-				{0.0, 0.0, -0.5 * step * slope3,
-					1.0 + 0.5 * step * (slope3 + slope4)},
-			};
-			for (double& value : residual)
-				value = -value;
-			if (!Solve4x4(jacobian, residual))
-				break;
-
-			double maximumDelta = 0.0;
-			for (double value : residual)
-				maximumDelta = std::max(maximumDelta, std::abs(value));
-			const double damping = maximumDelta > 1.0 ? 1.0 / maximumDelta : 1.0;
-			for (int i = 0; i < 4; ++i)
-				next[i] += damping * residual[i];
-		}
+					-0.5 * step * slope3,
+				0.0, 0.0, -0.5 * step * slope3,
+					1.0 + 0.5 * step * (slope3 + slope4);
+		};
 
-		if (!converged)
+		const auto telemetry = SolveNewton<4>(next, residual, jacobian,
+			_solver, MaximumNewtonStep{ 1.0 });
+		_lastIterations = telemetry.iterations;
+
+		if (!telemetry.converged)
 			++_solverFailures;
-		for (double value : next)
+		for (int i = 0; i < 4; ++i)
 		{
-			if (!std::isfinite(value) || std::abs(value) > 100.0)
+			if (!std::isfinite(next(i)) || std::abs(next(i)) > 100.0)
 			{
 				Reset();
 				return 0.0;
 			}
 		}
 
-		_state = next;
-		_feedback.Process(next[3]);
-		double output = _outputCoupling.Process(next[3]);
+		for (int i = 0; i < 4; ++i)
+			_state[i] = SnapToZero(next(i));
+		_feedback.Process(_state[3]);
+		double output = _outputCoupling.Process(_state[3]);
 		for (auto& section : _bassCorrection)
 			output = section.Process(output);
 		return output;
 	}
-
-	static bool Solve4x4(double matrix[4][4], std::array<double, 4>& rhs)
-	{
-		for (int column = 0; column < 4; ++column)
-		{
-			int pivot = column;
-			for (int row = column + 1; row < 4; ++row)
-			{
-				if (std::abs(matrix[row][column]) > std::abs(matrix[pivot][column]))
-					pivot = row;
-			}
-			if (std::abs(matrix[pivot][column]) < 1.0e-14)
-				return false;
-			if (pivot != column)
-			{
-				for (int i = column; i < 4; ++i)
-					std::swap(matrix[column][i], matrix[pivot][i]);
-				std::swap(rhs[column], rhs[pivot]);
-			}
-
-			for (int row = column + 1; row < 4; ++row)
-			{
-				const double factor = matrix[row][column] / matrix[column][column];
-				for (int i = column + 1; i < 4; ++i)
-					matrix[row][i] -= factor * matrix[column][i];
-				rhs[row] -= factor * rhs[column];
-			}
-		}
-
-		for (int row = 3; row >= 0; --row)
-		{
-			double value = rhs[row];
-			for (int column = row + 1; column < 4; ++column)
-				value -= matrix[row][column] * rhs[column];
-			rhs[row] = value / matrix[row][row];
-		}
-		return true;
-	}
 };
 
 } // namespace tfdsp
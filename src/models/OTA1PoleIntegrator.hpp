@@ -1,8 +1,11 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include "../tfdsp/nonlinear.hpp"
+#include "../tfdsp/quality.hpp"
 #include <array>
 
 /**
@@ -24,12 +27,6 @@ private:
 	//Previous value of input
 	double _x1{};
 
-	//solve for u[n] numerically : f(u) = g* Grad2[tanh](u, u1) + u - u1 - x + x1 = 0
-	static double func(const double u, const double u1, const double x, const double x1, const double g)
-	{
-		return g * Tanh<double, 1>::Value(u, u1) + u - u1 - x + x1;
-	}
-
 public:
 	OTA1PoleIntegrator() = default;
 	~OTA1PoleIntegrator() = default;
@@ -40,109 +37,53 @@ public:
 
 private:
 	/**
-	 * \brief Compute the initial 2 guesses of the secant method for each of the models
-	 * \tparam N number of independent models
-	 * \param x input for each model, expected between -10 and 10
-	 * \param g normalised cutoff gain for each model, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
-	 * \param u1 previous state for each model
-	 * \param x1 previous input for each model
-	 * \param u interleaved state guesses ( 2 guesses ) for each model
-	 * \param f interleaved function values for the 2 guesses of each model
-	 */
-	template<int N>
-	static void InitGuesses(
-		const Eigen::Array<double, N, 1>& x,
-		const Eigen::Array<double, N, 1>& g,
-		const Eigen::Array<double, N, 1>& u1,
-		const Eigen::Array<double, N, 1>& x1,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> u,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> f)
-	{
-		for (int i = 0; i < N; ++i)
-		{
-			//initial guess linearised around u ~ 0
-			auto guess = (x(i) - x1(i) + u1(i) * (1.0 - 0.5*g(i))) / (1 + 0.5*g(i));
-			u(2 * i) = guess;
-			//u(2 * i + 1) = guess + 1.0e-6;
-			u(2 * i + 1) = u1(i);
-		}
-		for(int i=0; i < N; ++i)
-		{
-			if (std::abs(u(2 * i + 1) - u(2 * i)) < 1.0e-8)
-				u(2 * i + 1) += 1.0e-8;
-		}
-		for(int i=0; i < 2*N; ++i)
-		{
-			f(i) = func(u(i), u1(i / 2), x(i / 2), x1(i / 2), g(i/2));
-		}
-	}
-
-	/**
-	 * \brief Compute 1 step of the secant method for each of the models
-	 * \tparam N number of independent models
+	 * \brief Solve u[n] of N independent models, one per lane
 	 * \param x input for each model, expected between -10 and 10
 	 * \param g normalised cutoff gain for each model, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
 	 * \param u1 previous state for each model
 	 * \param x1 previous input for each model
-	 * \param u interleaved state guesses ( 2 guesses ) for each model
-	 * \param f interleaved function values ( 2 ) for the guesses of each model
+	 * \return the last Newton iterate for each model, not finite where the solve failed
 	 */
 	template<int N>
-	static void SecantIteration(
-		const Eigen::Array<double, N, 1>& x,
-		const Eigen::Array<double, N, 1>& g,
-		const Eigen::Array<double, N, 1>& u1,
-		const Eigen::Array<double, N, 1>& x1,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> u,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> f)
+	static tfdsp::LaneVector<N> Solve(
+		const tfdsp::LaneVector<N>& x,
+		const tfdsp::LaneVector<N>& g,
+		const tfdsp::LaneVector<N>& u1,
+		const tfdsp::LaneVector<N>& x1,
+		const tfdsp::NewtonSolverSettings& settings)
 	{
-		for (int i = 0; i < N; ++i)
-		{
-			const auto u_cur = u(2 * i);
-			const auto denominator = f(2 * i) - f(2 * i + 1);
-			if (!std::isfinite(u_cur) || !std::isfinite(f(2 * i)) ||
-				!std::isfinite(denominator) || std::abs(denominator) < 1.0e-14)
-				continue;
-			const auto next = u_cur - f(2 * i) * (u_cur - u(2 * i + 1)) / denominator;
-			if (!std::isfinite(next))
-				continue;
-			u(2 * i) = next;
-			f(2 * i + 1) = f(2 * i);
-			f(2 * i) = func(u(2 * i), u1(i), x(i), x1(i), g(i));
-			u(2 * i + 1) = u_cur;
-		}
+		//solve for u[n] numerically : f(u) = g* Grad2[tanh](u, u1) + u - u1 - x + x1 = 0
+		//Start from the solution of the system linearised around the previous state:
+		//Grad2[tanh](u, u1) ~= tanh(u1) + sech^2(u1) / 2 * (u - u1)
+		const tfdsp::LaneVector<N> t = u1.tanh();
+		tfdsp::LaneVector<N> u = u1 + (x - x1 - g * t) / (1.0 + 0.5 * g * (1.0 - t * t));
+		tfdsp::LaneVector<N> gradient;
+		tfdsp::SolveNewtonLanes<N>(u,
+			[&](const tfdsp::LaneVector<N>& v, tfdsp::LaneVector<N>& f)
+			{
+				gradient = Tanh<double, N>::Value(v, u1);
+				f = g * gradient + v - u1 - x + x1;
+			},
+			[&](const tfdsp::LaneVector<N>& v, tfdsp::LaneVector<N>& slope)
+			{
+				slope = g * Tanh<double, N>::Derivative(v, u1, gradient) + 1.0;
+			},
+			settings);
+		return u;
 	}
 
-	double SolveSecantAndUpdateState(const double x, const double g,
-		Eigen::Ref<Eigen::Array<double, 2, 1>> u,
-		Eigen::Ref<Eigen::Array<double, 2, 1>> f)
+	double UpdateState(const double x, const double solution)
 	{
-		if (!std::isfinite(x) || !std::isfinite(g))
+		if (!std::isfinite(x))
 		{
 			Reset();
 			return 0.0;
 		}
-		//Secant method
-		Eigen::Array<double, 1, 1> v_x; v_x << x;
-		Eigen::Array<double, 1, 1> v_g   ; v_g	   << g;
-		Eigen::Array<double, 1, 1> v_u1  ; v_u1   << _u1;
-		Eigen::Array<double, 1, 1> v_x1  ; v_x1   << _x1;
-		constexpr int maxIterations = 8;
-		for (int iteration = 0; iteration < maxIterations; ++iteration)
-		{
-			//Note:we know input x should be in a fairly narrow range so a fixed constant stopping criterion seems
-			//reasonable here, this should correspond to about 120dB accuracy
-			if (!std::isfinite(f[0]) || !std::isfinite(f[1]) ||
-				std::fabs(f[0]) < 1.0e-6 || std::fabs(f[0] - f[1]) < 1.0e-12)
-				break;
-			SecantIteration<1>(v_x, v_g, v_u1, v_x1, u, f);
-		}
-
-		const double solution = std::isfinite(u[0]) ? u[0] : (std::isfinite(u[1]) ? u[1] : _u1);
-		_u1 = solution;
+		if (std::isfinite(solution))
+			_u1 = solution;
 		_x1 = x;
 
-		return x - solution;
+		return x - _u1;
 	}
 
 public:
@@ -157,32 +98,56 @@ public:
 	 * dy/dt = w_c * tanh(x-y)
 	 * \param x input, expected between -10 and 10
 	 * \param g normalised cutoff gain, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 ) 
+	 * \param settings Newton iteration limit and residual tolerance, in volts
 	 * \return filtered value
 	 */
-	double Step(const double x, const double g)
+	double Step(const double x, const double g, const tfdsp::NewtonSolverSettings& settings)
 	{
 		//Solve the ODE discretized with a second order gradient method:
 		//u[n] - u[n-1] = x[n]-x[n-1] - g * Grad2[tanh](u[n], u[n-1])
 		//u[n] = x[n] - y[n]
 		// u[n-1] = _u1
 		// x[n-1] = _x1
-		//solve for u[n] numerically : f(u) = g* Grad2[tanh](u, u1) + u - u1 - x + x1 = 0
-
-		//[0] : current guess
-		//[1] : previous guess
-		Eigen::Array<double, 2, 1> u;
-		Eigen::Array<double, 2, 1> f;
-
-		Eigen::Array<double, 1, 1> v_x; v_x << x;
-		Eigen::Array<double, 1, 1> v_g   ; v_g	   << g;
-		Eigen::Array<double, 1, 1> v_u1  ; v_u1   << _u1;
-		Eigen::Array<double, 1, 1> v_x1  ; v_x1   << _x1;
-
-		//Note: Newton method is much slower than secant method here
-		InitGuesses< 1 > (v_x, v_g, v_u1, v_x1, u, f);
-		SecantIteration<1>(v_x, v_g, v_u1, v_x1, u, f);
-
-		return SolveSecantAndUpdateState(x, g, u, f);
+		if (!std::isfinite(x) || !std::isfinite(g))
+		{
+			Reset();
+			return 0.0;
+		}
+		const tfdsp::LaneVector<1> u = Solve<1>(tfdsp::LaneVector<1>::Constant(x),
+			tfdsp::LaneVector<1>::Constant(g), tfdsp::LaneVector<1>::Constant(_u1),
+			tfdsp::LaneVector<1>::Constant(_x1), settings);
+		return UpdateState(x, u(0));
+	}
+	/**
+	 * \brief Process one sample of the discretized version of the system for a bank of models :
+	 * dy/dt = w_c * tanh(x-y)
+	 * The models are solved together by one lane-wise Newton iteration, so each of its
+	 * steps runs over all lanes, e.g. 16 audio and 16 cv paths of a polyphonic VCA.
+	 * \tparam N number of models
+	 * \param models the first of N consecutive models, one per lane
+	 * \param x inputs / outputs, expected between -10 and 10
+	 * \param g normalised cutoff gains, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
+	 * \param settings Newton iteration limit and residual tolerance, in volts
+	 * \return filtered values in place of input
+	 */
+	template<int N>
+	static void StepBank(OTA1PoleIntegrator* models, Eigen::Ref<Eigen::Array<double, N, 1>> x,
+		Eigen::Ref<const Eigen::Array<double, N, 1>> g, const tfdsp::NewtonSolverSettings& settings)
+	{
+		tfdsp::LaneVector<N> u1;
+		tfdsp::LaneVector<N> x1;
+		for (int j = 0; j < N; ++j)
+		{
+			u1(j) = models[j]._u1;
+			x1(j) = models[j]._x1;
+		}
+		const tfdsp::LaneVector<N> xIn = x;
+		// A non-finite gain resets its model as a non-finite input does
+		const tfdsp::LaneVector<N> finiteX = g.isFinite().select(xIn,
+			std::numeric_limits<double>::quiet_NaN());
+		const tfdsp::LaneVector<N> u = Solve<N>(finiteX, g, u1, x1, settings);
+		for (int j = 0; j < N; ++j)
+			x(j) = models[j].UpdateState(finiteX(j), u(j));
 	}
 	/**
 	 * \brief Process one sample of the discretized version of the system, but for 2 models and inputs :
@@ -190,36 +155,12 @@ public:
 	 * \param models the two models
 	 * \param x inputs / outputs, expected between -10 and 10
 	 * \param g normalised cutoff gains, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 ) 
+	 * \param settings Newton iteration limit and residual tolerance, in volts
 	 * \return filtered values in place of input
 	 */
-	static void StepDual(std::array<OTA1PoleIntegrator, 2>& models, Eigen::Ref<Eigen::Array<double, 2, 1>> x, const Eigen::Array<double, 2, 1>& g)
+	static void StepDual(std::array<OTA1PoleIntegrator, 2>& models, Eigen::Ref<Eigen::Array<double, 2, 1>> x,
+		const Eigen::Array<double, 2, 1>& g, const tfdsp::NewtonSolverSettings& settings)
 	{
-		Eigen::Array<double, 4, 1> uAudioCv;
-		Eigen::Array<double, 4, 1> fAudioCv;
-		Eigen::Array<double, 2, 1> u1;
-		u1 << models[0]._u1, models[1]._u1;
-		Eigen::Array<double, 2, 1> x1;
-		x1 << models[0]._x1, models[1]._x1;
-		Eigen::Array<double, 2, 1> phiX;
-
-		//Interleave the 2 guesses for the secant method for the audio and cv to
-		//make the compiler vectorize:
-		InitGuesses<2>(x, g, u1, x1, uAudioCv, fAudioCv);
-
-		//Similarly, Do one step of secant method in parallel
-		SecantIteration<2>(x, g, u1, x1, uAudioCv, fAudioCv);
-
-		//Do rest of the secant method, compiler probably can't unroll this
-		//due to the branches in each inner loop 
-		for (int j = 0; j < 2; ++j)
-		{
-			Eigen::Array<double, 2, 1> u;
-			Eigen::Array<double, 2, 1> f;
-			u(0) = uAudioCv(2 * j);
-			u(1) = uAudioCv(2 * j + 1);
-			f(0) = fAudioCv(2 * j);
-			f(1) = fAudioCv(2 * j + 1);
-			x(j) = models[j].SolveSecantAndUpdateState(x(j), g(j), u, f);
-		}
+		StepBank<2>(models.data(), x, g, settings);
 	}
 };
@@ -8,7 +8,10 @@
 
 #include "tfdsp/rail.hpp"
 #include "tfdsp/approx.hpp"
+#include "tfdsp/implicit.hpp"
 #include "tfdsp/oscillator.hpp"
+#include "tfdsp/profile_scope.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 
 namespace tfdsp
@@ -30,6 +33,8 @@ class Tb303SquareShaper
 	double _c11Current{};
 	double _forwardJunctionExponent{10.12667110305036};
 	double _reverseJunctionExponent{-10.0};
+	NewtonSolverSettings _solver{ QualitySettingsFor(
+		QualityTier::Standard).squareShaper };
 
 	static constexpr double SupplyVoltage = 12.0;
 	static constexpr double BiasVoltage = 5.333;
@@ -51,9 +56,11 @@ class Tb303SquareShaper
 	static constexpr double ReverseSaturationCurrent =
 		ForwardAlpha / ReverseAlpha * SaturationCurrent;
 	static constexpr double ThermalVoltage = 8.617333262e-5 * (273.15 + 27.0);
+	// Square root of the smallest Jacobian determinant the junction solve
+	// accepts.
+	static constexpr double MinimumJacobianPivot = 1.0e-10;
 	static constexpr double StockMaximumFrequency = 1000.0;
 	static constexpr double ExtendedSquareFullFrequency = 2000.0;
-	static constexpr int MaximumNewtonIterations = 8;
 	static constexpr double Log2E = 1.4426950408889634;
 
 	struct JunctionState
@@ -106,6 +113,15 @@ public:
 		_sampleRate = std::max(sampleRate, 1.0);
 	}
 
+	/** Iteration limit and the junction exponent step, in thermal voltages,
+	 * below which the solve stops. */
+	void SetSolverSettings(const NewtonSolverSettings& settings)
+	{
+		_solver.maximumIterations = std::clamp(settings.maximumIterations, 0,
+			MaximumSolverIterations);
+		_solver.tolerance = settings.tolerance;
+	}
+
 	void Reset()
 	{
 		_c10Voltage = 0.0;
@@ -149,21 +165,25 @@ public:
 		const double emitterOpenVoltage = emitterResistance *
 			(SupplyVoltage / R45 - c11History);
 
-		double forwardExponent = _forwardJunctionExponent;
-		double reverseExponent = _reverseJunctionExponent;
+		ImplicitVector<2> exponents(_forwardJunctionExponent,
+			_reverseJunctionExponent);
 		JunctionState junction;
-		for (int iteration = 0; iteration < MaximumNewtonIterations; ++iteration)
+		const auto residual = [&](const ImplicitVector<2>& state,
+			ImplicitVector<2>& value)
 		{
-			junction = EvaluateJunctions(forwardExponent, reverseExponent,
+			junction = EvaluateJunctions(state(0), state(1),
 				baseOpenVoltage, baseResistance, emitterOpenVoltage,
 				emitterResistance);
-			const double residualForward = forwardExponent -
+			value(0) = state(0) -
 				(junction.emitterVoltage - junction.baseVoltage) /
 					ThermalVoltage;
-			const double residualReverse = reverseExponent -
+			value(1) = state(1) -
 				(junction.collectorVoltage - junction.baseVoltage) /
 					ThermalVoltage;
-
+		};
+		const auto jacobian = [&](const ImplicitVector<2>&,
+			ImplicitMatrix<2>& matrix)
+		{
 			const double emitterForward = junction.forwardDerivative;
 			const double emitterReverse = -ReverseAlpha *
 				junction.reverseDerivative;
@@ -175,34 +195,23 @@ public:
 			const double baseReverse = (1.0 - ReverseAlpha) *
 				junction.reverseDerivative;
 
-			const double j00 = 1.0 +
-				(emitterResistance * emitterForward +
-					baseResistance * baseForward) / ThermalVoltage;
-			const double j01 =
+			matrix <<
+				1.0 + (emitterResistance * emitterForward +
+					baseResistance * baseForward) / ThermalVoltage,
 				(emitterResistance * emitterReverse +
-					baseResistance * baseReverse) / ThermalVoltage;
-			const double j10 = -
-				(R36 * collectorForward - baseResistance * baseForward) /
-					ThermalVoltage;
-			const double j11 = 1.0 -
-				(R36 * collectorReverse - baseResistance * baseReverse) /
+					baseResistance * baseReverse) / ThermalVoltage,
+				-(R36 * collectorForward - baseResistance * baseForward) /
+					ThermalVoltage,
+				1.0 - (R36 * collectorReverse - baseResistance * baseReverse) /
 					ThermalVoltage;
-			const double determinant = j00 * j11 - j01 * j10;
-			if (!std::isfinite(determinant) || std::abs(determinant) < 1.0e-20)
-				break;
-			double deltaForward =
-				(residualForward * j11 - residualReverse * j01) / determinant;
-			double deltaReverse =
-				(j00 * residualReverse - j10 * residualForward) / determinant;
-			const double damping = std::max({1.0,
-				std::abs(deltaForward) / 2.0, std::abs(deltaReverse) / 2.0});
-			deltaForward /= damping;
-			deltaReverse /= damping;
-			forwardExponent -= deltaForward;
-			reverseExponent -= deltaReverse;
-			if (std::max(std::abs(deltaForward), std::abs(deltaReverse)) < 1.0e-4)
-				break;
-		}
+		};
+		// Steps are limited to two thermal voltages, and the iteration stops
+		// once a step falls below the tolerance.
+		SolveNewton<2>(exponents, residual, jacobian, _solver,
+			MaximumNewtonStep{ 2.0 }, NewtonConvergence::Step,
+			MinimumJacobianPivot);
+		const double forwardExponent = exponents(0);
+		const double reverseExponent = exponents(1);
 
 		junction = EvaluateJunctions(forwardExponent, reverseExponent,
 			baseOpenVoltage, baseResistance, emitterOpenVoltage,
@@ -262,6 +271,8 @@ public:
 	using Resampler = ResamplerType;
 	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
 
+	using Frame = Eigen::Array<double, OversamplingFactor, 1>;
+
 	struct Output
 	{
 		float saw{};
@@ -270,6 +281,14 @@ public:
 		float pitch{};
 	};
 
+	// The mixed output before decimation, for a consumer that runs at the same
+	// internal rate and would otherwise upsample the decimated signal again.
+	struct OversampledOutput
+	{
+		Frame mixed = Frame::Zero();
+		float pitch{};
+	};
+
 private:
 	std::unique_ptr<ResamplerType> _pitchInterpolator;
 	std::unique_ptr<ResamplerType> _slideTimeInterpolator;
@@ -300,74 +319,43 @@ private:
 		return std::copysign(curved, frequency);
 	}
 
-public:
-	explicit Tb303Oscillator(
-		std::function<std::unique_ptr<ResamplerType>()> createResampler) :
-		_pitchInterpolator(createResampler()),
-		_slideTimeInterpolator(createResampler()),
-		_fmInterpolator(createResampler()),
-		_shapeInterpolator(createResampler()),
-		_waveInterpolator(createResampler()),
-		_sawDecimator(createResampler()),
-		_squareDecimator(createResampler()),
-		_mixedDecimator(createResampler())
-	{
-		SetSampleRate(_sampleRate);
-	}
-
-	void SetSampleRate(double sampleRate)
-	{
-		_sampleRate = std::max(sampleRate, 1.0);
-		_squareShaper.SetSampleRate(_sampleRate * OversamplingFactor);
-	}
-
-	void Reset()
-	{
-		_pitchInterpolator->Reset();
-		_slideTimeInterpolator->Reset();
-		_fmInterpolator->Reset();
-		_shapeInterpolator->Reset();
-		_waveInterpolator->Reset();
-		_sawDecimator->Reset();
-		_squareDecimator->Reset();
-		_mixedDecimator->Reset();
-		_squareShaper.Reset();
-		_sawOscillator.Reset();
-		_pitch = 0.0;
-		_pitchInitialized = false;
-	}
-
-	Output Step(double targetPitch, bool slide, double slideTime,
+	bool RenderFrame(double targetPitch, bool slide, double slideTime,
 		double tuningOffset, double fmVoltage, bool linearFm, double shape,
-		double wave, double syncCrossing = -1.0)
+		double wave, double syncCrossing, Frame* sawValues,
+		Frame* squareValues, Frame& mixedValues)
 	{
 		if (!std::isfinite(targetPitch) || !std::isfinite(slideTime) ||
 			!std::isfinite(tuningOffset) || !std::isfinite(fmVoltage) ||
 			!std::isfinite(shape) || !std::isfinite(wave))
-			return {};
+			return false;
 
 		const double slideTimeLog = std::log(std::max(slideTime,
 			std::numeric_limits<double>::min()));
-		if (!_pitchInitialized)
+		Frame targetPitchValues;
+		Frame slideTimeLogValues;
+		Frame fm;
+		Frame shapeValues;
+		Frame waveValues;
 		{
-			_pitchInterpolator->PrimeUpsample(targetPitch);
-			_slideTimeInterpolator->PrimeUpsample(slideTimeLog);
-			_fmInterpolator->PrimeUpsample(fmVoltage);
-			_shapeInterpolator->PrimeUpsample(shape);
-			_waveInterpolator->PrimeUpsample(wave);
-			_pitch = targetPitch;
-			_pitchInitialized = true;
+			TF_PROFILE_SCOPE(Resampling);
+			if (!_pitchInitialized)
+			{
+				_pitchInterpolator->PrimeUpsample(targetPitch);
+				_slideTimeInterpolator->PrimeUpsample(slideTimeLog);
+				_fmInterpolator->PrimeUpsample(fmVoltage);
+				_shapeInterpolator->PrimeUpsample(shape);
+				_waveInterpolator->PrimeUpsample(wave);
+				_pitch = targetPitch;
+				_pitchInitialized = true;
+			}
+			targetPitchValues = _pitchInterpolator->Upsample(targetPitch);
+			slideTimeLogValues = _slideTimeInterpolator->Upsample(slideTimeLog);
+			fm = _fmInterpolator->Upsample(fmVoltage);
+			shapeValues = _shapeInterpolator->Upsample(shape);
+			waveValues = _waveInterpolator->Upsample(wave);
 		}
-		const auto targetPitchValues = _pitchInterpolator->Upsample(targetPitch);
-		const auto slideTimeLogValues = _slideTimeInterpolator->Upsample(
-			slideTimeLog);
-		const auto fm = _fmInterpolator->Upsample(fmVoltage);
-		const auto shapeValues = _shapeInterpolator->Upsample(shape);
-		const auto waveValues = _waveInterpolator->Upsample(wave);
-		Eigen::Array<double, OversamplingFactor, 1> sawValues;
-		Eigen::Array<double, OversamplingFactor, 1> squareValues;
-		Eigen::Array<double, OversamplingFactor, 1> mixedValues;
 
+		TF_PROFILE_SCOPE(Solver);
 		const double internalRate = _sampleRate * OversamplingFactor;
 		const auto syncEvent = tfdsp::MapEventToOversampledFrame<
 			OversamplingFactor>(syncCrossing);
@@ -410,27 +398,128 @@ public:
 			// The physical saw is mapped with descending polarity before Q8, so its
 			// collector output is already phase-aligned with the Rack-facing saw.
 			const double squareRack = (20.0 / 5.5) * square;
-			sawValues(index) = RackOutputAdapter::ProcessOversampled(sawRack);
-			squareValues(index) = RackOutputAdapter::ProcessOversampled(squareRack);
+			if (sawValues)
+				(*sawValues)(index) = RackOutputAdapter::ProcessOversampled(sawRack);
+			if (squareValues)
+				(*squareValues)(index) = RackOutputAdapter::ProcessOversampled(squareRack);
 			mixedValues(index) = RackOutputAdapter::ProcessOversampled(
 				(1.0 - blend) * sawRack + blend * squareRack);
 		}
 
+		return true;
+	}
+
+public:
+	explicit Tb303Oscillator(
+		std::function<std::unique_ptr<ResamplerType>()> createResampler) :
+		_pitchInterpolator(createResampler()),
+		_slideTimeInterpolator(createResampler()),
+		_fmInterpolator(createResampler()),
+		_shapeInterpolator(createResampler()),
+		_waveInterpolator(createResampler()),
+		_sawDecimator(createResampler()),
+		_squareDecimator(createResampler()),
+		_mixedDecimator(createResampler())
+	{
+		SetSampleRate(_sampleRate);
+	}
+
+	void SetSampleRate(double sampleRate)
+	{
+		_sampleRate = std::max(sampleRate, 1.0);
+		_squareShaper.SetSampleRate(_sampleRate * OversamplingFactor);
+	}
+
+	void SetSolverSettings(const NewtonSolverSettings& squareShaper)
+	{
+		_squareShaper.SetSolverSettings(squareShaper);
+	}
+
+	void Reset()
+	{
+		_pitchInterpolator->Reset();
+		_slideTimeInterpolator->Reset();
+		_fmInterpolator->Reset();
+		_shapeInterpolator->Reset();
+		_waveInterpolator->Reset();
+		ResetDecimators();
+		_squareShaper.Reset();
+		_sawOscillator.Reset();
+		_pitch = 0.0;
+		_pitchInitialized = false;
+	}
+
+	Output Step(double targetPitch, bool slide, double slideTime,
+		double tuningOffset, double fmVoltage, bool linearFm, double shape,
+		double wave, double syncCrossing = -1.0)
+	{
+		Frame sawValues;
+		Frame squareValues;
+		Frame mixedValues;
+		if (!RenderFrame(targetPitch, slide, slideTime, tuningOffset, fmVoltage,
+			linearFm, shape, wave, syncCrossing, &sawValues, &squareValues,
+			mixedValues))
+			return {};
+
+		double saw;
+		double square;
+		double mixed;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			saw = _sawDecimator->Downsample(sawValues);
+			square = _squareDecimator->Downsample(squareValues);
+			mixed = _mixedDecimator->Downsample(mixedValues);
+		}
 		Output output;
-		output.saw = static_cast<float>(RackOutputAdapter::ProcessPostDecimation(
-			_sawDecimator->Downsample(sawValues)));
+		output.saw = static_cast<float>(
+			RackOutputAdapter::ProcessPostDecimation(saw));
 		output.square = static_cast<float>(
-			RackOutputAdapter::ProcessPostDecimation(
-				_squareDecimator->Downsample(squareValues)));
+			RackOutputAdapter::ProcessPostDecimation(square));
 		output.mixed = static_cast<float>(
-			RackOutputAdapter::ProcessPostDecimation(
-				_mixedDecimator->Downsample(mixedValues)));
+			RackOutputAdapter::ProcessPostDecimation(mixed));
 		output.pitch = static_cast<float>(_pitch);
 		if (!std::isfinite(output.saw) || !std::isfinite(output.square) ||
 			!std::isfinite(output.mixed) || !std::isfinite(output.pitch))
 			return {};
 		return output;
 	}
+
+	// Renders one host sample without decimating anything and returns the
+	// oversampled mixed output. The saw and square are not computed. Pass the
+	// frame to DecimateMixed() if the host-rate mix is needed too.
+	OversampledOutput StepOversampled(double targetPitch, bool slide,
+		double slideTime, double tuningOffset, double fmVoltage, bool linearFm,
+		double shape, double wave, double syncCrossing = -1.0)
+	{
+		OversampledOutput output;
+		if (!RenderFrame(targetPitch, slide, slideTime, tuningOffset, fmVoltage,
+			linearFm, shape, wave, syncCrossing, nullptr, nullptr, output.mixed) ||
+			!output.mixed.allFinite() || !std::isfinite(_pitch))
+			return {};
+		output.pitch = static_cast<float>(_pitch);
+		return output;
+	}
+
+	// Clears the saw, square and mixed decimators, whose history is stale
+	// after StepOversampled() frames that did not pass through them.
+	void ResetDecimators()
+	{
+		_sawDecimator->Reset();
+		_squareDecimator->Reset();
+		_mixedDecimator->Reset();
+	}
+
+	float DecimateMixed(const Frame& mixed)
+	{
+		double decimated;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			decimated = _mixedDecimator->Downsample(mixed);
+		}
+		const float result = static_cast<float>(
+			RackOutputAdapter::ProcessPostDecimation(decimated));
+		return std::isfinite(result) ? result : 0.0f;
+	}
 };
 
 } // namespace tfdsp
@@ -5,6 +5,8 @@
 
 #include "AnalogOutputStage.hpp"
 #include "OtaVca.hpp"
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/profile_scope.hpp"
 
 namespace tfdsp
 {
@@ -171,6 +173,7 @@ public:
 		double normalDecaySeconds, double accentDecaySeconds,
 		double vcaDecayControl)
 	{
+		TF_PROFILE_SCOPE(Envelope);
 		if (!std::isfinite(gateVolts))
 			gateVolts = 0.0;
 		if (!std::isfinite(accentVolts))
@@ -395,8 +398,8 @@ public:
 		// C38 is the BA662 buffer's 1 uF output coupling capacitor. The
 		// following 50k volume control gives a 3.18 Hz corner, below the 303's
 		// already modeled filter coupling losses.
-		_outputLowPass += _outputCouplingCoefficient *
-			(rackVolts - _outputLowPass);
+		_outputLowPass = SnapToZero(_outputLowPass +
+			_outputCouplingCoefficient * (rackVolts - _outputLowPass));
 		return rackVolts - _outputLowPass;
 	}
 
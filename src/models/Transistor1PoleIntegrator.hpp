@@ -1,9 +1,12 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <array>
 #include "../tfdsp/nonlinear.hpp"
+#include "../tfdsp/quality.hpp"
 
 /**
  * References:
@@ -33,13 +36,6 @@ private:
 	//Previous value of input
 	double _x1{};
 
-	//solve for y[n] numerically : f(y) = g* Grad2[tanh](y, y1) - g* phiX + y - y1 = 0
-	//phiX = Grad2[tanh](x, x1)
-	static double func(const double y, const double y1, const double phiX, const double g)
-	{
-		return g * Tanh<double, 1>::Value(y, y1) - g*phiX + y - y1;
-	}
-
 public:
 	Transistor1PoleIntegrator() = default;
 	~Transistor1PoleIntegrator() = default;
@@ -50,108 +46,54 @@ public:
 
 private:
 	/**
-	 * \brief Compute the initial 2 guesses of the secant method for each of the models
-	 * \tparam N number of independent models
+	 * \brief Solve y[n] of N independent models, one per lane
 	 * \param phiX processed input for each model
 	 * \param g normalised cutoff gain for each model, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
 	 * \param y1 previous state for each model
-	 * \param y interleaved state guesses ( 2 guesses ) for each model
-	 * \param f interleaved function values for the 2 guesses of each model
+	 * \return the last Newton iterate for each model, not finite where the solve failed
 	 */
 	template<int N>
-	static void InitGuesses(
-		const Eigen::Array<double, N, 1 >& phiX,
-		const Eigen::Array<double, N, 1>& g,
-		const Eigen::Array<double, N, 1>& y1,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> y,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> f)
+	static tfdsp::LaneVector<N> Solve(
+		const tfdsp::LaneVector<N>& phiX,
+		const tfdsp::LaneVector<N>& g,
+		const tfdsp::LaneVector<N>& y1,
+		const tfdsp::NewtonSolverSettings& settings)
 	{
-		for (int i = 0; i < N; ++i)
-		{
-			//initial guess linearised around u ~ 0
-			double guess = (g(i) * phiX(i) + (1.0 - 0.5*g(i)) * y1(i)) / (1 + 0.5*g(i));
-			y(2 * i) = guess;
-			//y(2 * i + 1) = guess + 1.0e-6;
-			//Other guess is simply the lagged value from the previous output:
-			y(2 * i + 1) = y1(i);
-		}
-		for(int i=0; i < N; ++i)
-		{
-			if (std::abs(y(2 * i + 1) - y(2 * i)) < 1.0e-8)
-				y(2 * i + 1) += 1.0e-8;
-		}
-		for(int i=0; i < 2*N; ++i)
-		{
-			f(i) = func(y(i), y1(i / 2), phiX(i / 2), g(i / 2));
-		}
+		//solve for y[n] numerically : f(y) = g* Grad2[tanh](y, y1) - g* phiX + y - y1 = 0
+		//phiX = Grad2[tanh](x, x1)
+		//Start from the solution of the system linearised around the previous state:
+		//Grad2[tanh](y, y1) ~= tanh(y1) + sech^2(y1) / 2 * (y - y1)
+		const tfdsp::LaneVector<N> t = y1.tanh();
+		tfdsp::LaneVector<N> y = y1 + g * (phiX - t) / (1.0 + 0.5 * g * (1.0 - t * t));
+		tfdsp::LaneVector<N> gradient;
+		tfdsp::SolveNewtonLanes<N>(y,
+			[&](const tfdsp::LaneVector<N>& v, tfdsp::LaneVector<N>& f)
+			{
+				gradient = Tanh<double, N>::Value(v, y1);
+				f = g * gradient - g * phiX + v - y1;
+			},
+			[&](const tfdsp::LaneVector<N>& v, tfdsp::LaneVector<N>& slope)
+			{
+				slope = g * Tanh<double, N>::Derivative(v, y1, gradient) + 1.0;
+			},
+			settings);
+		return y;
 	}
 
-	/**
-	 * \brief Compute 1 step of the secant method for each of the models
-	 * \tparam N number of independent models
-	 * \param phiX processed input for each model
-	 * \param g normalised cutoff gain for each model, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
-	 * \param y1 previous state for each model
-	 * \param y interleaved state guesses ( 2 guesses ) for each model
-	 * \param f interleaved function values for the 2 guesses of each model
-	 */
-	template<int N>
-	static void SecantIteration(
-		const Eigen::Array<double, N, 1 >& phiX,
-		const Eigen::Array<double, N, 1>& g,
-		const Eigen::Array<double, N, 1>& y1,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> y,
-		Eigen::Ref<Eigen::Array<double, 2*N, 1>> f)
-	{
-		for (int i = 0; i < N; ++i)
-		{
-			const auto y_cur = y(2 * i);
-			const auto denominator = f(2 * i) - f(2 * i + 1);
-			if (!std::isfinite(y_cur) || !std::isfinite(f(2 * i)) ||
-				!std::isfinite(denominator) || std::abs(denominator) < 1.0e-14)
-				continue;
-			const auto next = y_cur - f(2 * i) * (y_cur - y(2 * i + 1)) / denominator;
-			if (!std::isfinite(next))
-				continue;
-			y(2 * i) = next;
-			f(2 * i + 1) = f(2 * i);
-			f(2 * i) = func(y(2 * i), y1(i), phiX(i), g(i));
-			y(2 * i + 1) = y_cur;
-		}
-	}
-
-	double SolveSecantAndUpdateState( const double x, const double phiX, const double g,
-		Eigen::Ref<Eigen::Array<double, 2, 1>> y,
-		Eigen::Ref<Eigen::Array<double, 2, 1>> f)
+	double UpdateState(const double x, const double phiX, const double solution)
 	{
-		if (!std::isfinite(x) || !std::isfinite(phiX) || !std::isfinite(g))
+		if (!std::isfinite(x) || !std::isfinite(phiX))
 		{
 			Reset();
 			return 0.0;
 		}
-		Eigen::Array<double, 1, 1> v_phiX; v_phiX << phiX;
-		Eigen::Array<double, 1, 1> v_g   ; v_g	   << g;
-		Eigen::Array<double, 1, 1> v_y1  ; v_y1   << _y1;
-		//Secant method
-		constexpr int maxIterations = 8;
-		for (int iteration = 0; iteration < maxIterations; ++iteration)
-		{
-			//Note:we know input x should be in a fairly narrow range so a fixed constant stopping criterion seems
-			//reasonable here, this should correspond to about 120dB accuracy
-			if (!std::isfinite(f(0)) || !std::isfinite(f(1)) ||
-				std::fabs(f(0)) < 1.0e-6 || std::fabs(f(0) - f(1)) < 1.0e-12)
-				break;
-			SecantIteration<1>(v_phiX, v_g, v_y1, y, f);
-		}
-
-		const double solution = std::isfinite(y(0)) ? y(0) : (std::isfinite(y(1)) ? y(1) : _y1);
-		_y1 = solution;
+		if (std::isfinite(solution))
+			_y1 = solution;
 		_x1 = x;
 
-		return solution;
+		return _y1;
 	}
 
-
 public:
 	void Reset()
 	{
@@ -164,32 +106,55 @@ public:
 	 * dy/dt = w_c * (tanh(x) - tanh(y))
 	 * \param x input, expected between -10 and 10
 	 * \param g normalised cutoff gain, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 ) 
+	 * \param settings Newton iteration limit and residual tolerance, in volts
 	 * \return filtered value
 	 */
-	double Step(const double x, const double g)
+	double Step(const double x, const double g, const tfdsp::NewtonSolverSettings& settings)
 	{
 		//Solve the ODE discretized with a second order gradient method:
 		//y[n] - y[n-1] = g * [ Grad2[tanh](x[n], x[n-1]) - Grad2[tanh](y[n], y[n-1]) ]
 		// y[n-1] = _y1
 		// x[n-1] = _x1
-		//solve for y[n] numerically : f(y) = g* Grad2[tanh](y, y1) - g* Grad2[tanh](x, x1) + y - y1 = 0
-
-		//[0] : current guess
-		//[1] : previous guess
-		Eigen::Array<double, 2, 1> u;
-		Eigen::Array<double, 2, 1> f;
-
+		if (!std::isfinite(x) || !std::isfinite(g))
+		{
+			Reset();
+			return 0.0;
+		}
 		const auto phiX = Tanh<double,1>::Value(x, _x1);
-
-		//Note: Newton method is much slower than the secant method here
-		Eigen::Array<double, 1, 1> v_phiX; v_phiX << phiX;
-		Eigen::Array<double, 1, 1> v_g   ; v_g	   << g;
-		Eigen::Array<double, 1, 1> v_y1  ; v_y1   << _y1;
-
-		InitGuesses<1>(v_phiX, v_g, v_y1, u, f);
-		SecantIteration<1>(v_phiX, v_g, v_y1, u, f);
-
-		return SolveSecantAndUpdateState(x, phiX, g, u, f);
+		const tfdsp::LaneVector<1> y = Solve<1>(tfdsp::LaneVector<1>::Constant(phiX),
+			tfdsp::LaneVector<1>::Constant(g), tfdsp::LaneVector<1>::Constant(_y1), settings);
+		return UpdateState(x, phiX, y(0));
+	}
+	/**
+	 * \brief Process one sample of the discretized version of the system for a bank of models :
+	 * dy/dt = w_c * (tanh(x) - tanh(y))
+	 * The models are solved together by one lane-wise Newton iteration, so each of its
+	 * steps runs over all lanes, e.g. 16 audio and 16 cv paths of a polyphonic VCA.
+	 * \tparam N number of models
+	 * \param models the first of N consecutive models, one per lane
+	 * \param x inputs / outputs, expected between -10 and 10
+	 * \param g normalised cutoff gains, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 )
+	 * \param settings Newton iteration limit and residual tolerance, in volts
+	 * \return filtered values in place of input
+	 */
+	template<int N>
+	static void StepBank(Transistor1PoleIntegrator* models, Eigen::Ref<Eigen::Array<double, N, 1>> x,
+		Eigen::Ref<const Eigen::Array<double, N, 1>> g, const tfdsp::NewtonSolverSettings& settings)
+	{
+		tfdsp::LaneVector<N> y1;
+		tfdsp::LaneVector<N> x1;
+		for (int j = 0; j < N; ++j)
+		{
+			y1(j) = models[j]._y1;
+			x1(j) = models[j]._x1;
+		}
+		const tfdsp::LaneVector<N> xIn = x;
+		// A non-finite gain resets its model as a non-finite input does
+		const tfdsp::LaneVector<N> phiX = g.isFinite().select(
+			Tanh<double, N>::Value(xIn, x1), std::numeric_limits<double>::quiet_NaN());
+		const tfdsp::LaneVector<N> y = Solve<N>(phiX, g, y1, settings);
+		for (int j = 0; j < N; ++j)
+			x(j) = models[j].UpdateState(x(j), phiX(j), y(j));
 	}
 	/**
 	 * \brief Process one sample of the discretized version of the system, but for 2 models and inputs :
@@ -197,39 +162,12 @@ public:
 	 * \param models the two models
 	 * \param x inputs / outputs, expected between -10 and 10
 	 * \param g normalised cutoff gains, must be prewarped: g = w^~_c * T  = 2* tan( wc *T / 2 ) 
+	 * \param settings Newton iteration limit and residual tolerance, in volts
 	 * \return filtered values in place of input
 	 */
-	static void StepDual (std::array<Transistor1PoleIntegrator, 2>& models,  Eigen::Ref<Eigen::Array<double,2, 1>> x, const Eigen::Array<double,2, 1>& g)
+	static void StepDual (std::array<Transistor1PoleIntegrator, 2>& models,  Eigen::Ref<Eigen::Array<double,2, 1>> x,
+		const Eigen::Array<double,2, 1>& g, const tfdsp::NewtonSolverSettings& settings)
 	{
-		Eigen::Array<double, 4, 1> uAudioCv;
-		Eigen::Array<double, 4, 1> fAudioCv;
-		Eigen::Array<double, 2, 1> y1;
-		y1 << models[0]._y1, models[1]._y1;
-		Eigen::Array<double, 2, 1> x1;
-		x1 << models[0]._x1, models[1]._x1;
-		Eigen::Array<double, 2, 1> phiX;
-
-		for (int j = 0; j < 2; ++j)
-			phiX(j) = Tanh<double, 1>::Value(x(j), x1(j));
-
-		//Interleave the 2 guesses for the secant method for the audio and cv to
-		//make the compiler vectorize:
-		InitGuesses<2>(phiX, g, y1, uAudioCv, fAudioCv);
-
-		//Similarly, Do one step of secant method in parallel
-		SecantIteration<2>(phiX, g, y1, uAudioCv, fAudioCv);
-
-		//Do rest of the secant method, compiler probably can't unroll this
-		//due to the branches in each inner loop 
-		for (int j = 0; j < 2; ++j)
-		{
-			Eigen::Array<double, 2, 1> u;
-			Eigen::Array<double, 2, 1> f;
-			u(0) = uAudioCv(2 * j);
-			u(1) = uAudioCv(2 * j + 1);
-			f(0) = fAudioCv(2 * j);
-			f(1) = fAudioCv(2 * j + 1);
-			x(j) = models[j].SolveSecantAndUpdateState(x(j), phiX(j), g(j), u, f);
-		}
+		StepBank<2>(models.data(), x, g, settings);
 	}
 };
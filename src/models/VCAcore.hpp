@@ -1,13 +1,17 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <memory>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <random>
+#include <stdexcept>
 #include "../tfdsp/filters.hpp"
 #include "../tfdsp/noise.hpp"
+#include "../tfdsp/profile_scope.hpp"
 #include "OTA1PoleIntegrator.hpp"
 #include "tfdsp/rail.hpp"
 #include "Transistor1PoleIntegrator.hpp"
@@ -23,6 +27,7 @@ private:
 	//Oversampling of audio and cv:--------------------------------------------------
 	float _sampleRate{};
 	static constexpr unsigned int ResamplingFactor{ Oversampler::ResamplingFactor };
+	using Block = Eigen::Array<double, ResamplingFactor, 1>;
 	std::unique_ptr<Oversampler> _audioResampler;
 	std::unique_ptr<Oversampler> _cvResampler;
 	std::unique_ptr<Oversampler> _exponentialCvResampler;
@@ -34,6 +39,8 @@ private:
 	std::array<Model, 2> _models{};
 	Eigen::Array<double, 2, 1> _rolloffs;
 	Eigen::Array<double, 2, 1> _g;//Normalised and prewarped rolloffs
+	tfdsp::NewtonSolverSettings _solver{ tfdsp::QualitySettingsFor(
+		tfdsp::QualityTier::Standard).vcaIntegrator };
 
 	tfdsp::PinkNoiseSource _noise{};
 	double _noiseLevel{ 1.0e-10 };
@@ -63,6 +70,30 @@ public:
 		//Conserve the power spectral density independently of the sample rate
 		_noiseStdDev = std::sqrt( _noiseLevel * _sampleRate / 2);
 	}
+	/**
+	 * \brief Set the Newton iteration limit and residual tolerance, in volts, of both integrators
+	 */
+	void SetSolverSettings(const tfdsp::NewtonSolverSettings& settings)
+	{
+		_solver.maximumIterations = std::clamp(settings.maximumIterations, 0,
+			tfdsp::MaximumSolverIterations);
+		_solver.tolerance = settings.tolerance;
+	}
+	/**
+	 * \brief Set the power spectral density of the pink noise added to the audio input, 0 disables it
+	 */
+	void SetNoiseLevel(const double noiseLevel)
+	{
+		_noiseLevel = std::max(noiseLevel, 0.0);
+		_noiseStdDev = std::sqrt( _noiseLevel * _sampleRate / 2);
+	}
+	/**
+	 * \brief Make the input noise reproducible, e.g. for offline renders and benchmarks
+	 */
+	void SeedNoise(const std::uint64_t seed)
+	{
+		_noise.Seed(seed);
+	}
 	void Reset()
 	{
 		for (auto& model : _models)
@@ -88,24 +119,16 @@ public:
 		const double noise = _noiseStdDev * _noise.Step();
 		double input = noise + audio;
 
-		auto audioA = _audioResampler->Upsample(input);
-		auto cvA = _cvResampler->Upsample(double(_cvScaling*cv));
-
-		Step(audioA, cvA, finalGain);
-		const Eigen::Array<double, ResamplingFactor, 1> normalizedCv =
-			cvA / _cvScaling;
-		_lastControl = static_cast<float>(
-			_cvResampler->Downsample(normalizedCv));
-
-		const float output = static_cast<float>(
-			tfdsp::RackOutputAdapter::ProcessPostDecimation(
-				_audioResampler->Downsample(audioA)));
-		if (!std::isfinite(output))
+		Block audioA;
+		Block cvA;
 		{
-			Reset();
-			return 0.0f;
+			TF_PROFILE_SCOPE(Resampling);
+			audioA = _audioResampler->Upsample(input);
+			cvA = _cvResampler->Upsample(double(_cvScaling*cv));
 		}
-		return output;
+
+		Step(audioA, cvA, finalGain);
+		return Decimate(audioA, cvA);
 	}
 	float LastControl() const { return _lastControl; }
 
@@ -124,10 +147,15 @@ public:
 		}
 
 		const double noise = _noiseStdDev * _noise.Step();
-		auto audioValues = _audioResampler->Upsample(noise + audio);
-		auto linearValues = _cvResampler->Upsample(linearCv);
-		const auto exponentialValues =
-			_exponentialCvResampler->Upsample(exponentialCv);
+		Block audioValues;
+		Block linearValues;
+		Block exponentialValues;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			audioValues = _audioResampler->Upsample(noise + audio);
+			linearValues = _cvResampler->Upsample(linearCv);
+			exponentialValues = _exponentialCvResampler->Upsample(exponentialCv);
+		}
 		const double base = std::max<double>(exponentialBase, 1.0e-6);
 		for (unsigned int i = 0; i < ResamplingFactor; ++i)
 		{
@@ -139,14 +167,43 @@ public:
 				std::clamp(linear + shaped, 0.0, 1.0);
 		}
 		Step(audioValues, linearValues, finalGain);
-		const Eigen::Array<double, ResamplingFactor, 1> normalizedCv =
-			linearValues / _cvScaling;
-		_lastControl = static_cast<float>(
-			_cvResampler->Downsample(normalizedCv));
+		return Decimate(audioValues, linearValues);
+	}
+private:
+	inline void Step(Eigen::Ref<Eigen::Array<double, ResamplingFactor, 1>> audio, const Eigen::Array<double, ResamplingFactor, 1>& cv, const double finalGain)
+	{
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (unsigned int i = 0; i < ResamplingFactor; ++i)
+			{
+				Eigen::Array<double, 2 ,1> audioAndCv;
+				audioAndCv(0) = audio(i);
+				audioAndCv(1) = cv(i);
+
+				Model::StepDual(_models, audioAndCv, _g, _solver);
 
+				audio(i) = audioAndCv(0) * audioAndCv(1) / _cvScaling;
+			}
+		}
+		TF_PROFILE_SCOPE(OutputStage);
+		//Apply final gain and saturate to power supply voltage
+		audio = _powerSupplyVoltage *  _outputStage.Process(finalGain / _powerSupplyVoltage * audio);
+		for (unsigned int i = 0; i < ResamplingFactor; ++i)
+			audio(i) = tfdsp::RackOutputAdapter::ProcessOversampled(audio(i));
+	}
+	// Decimates the processed audio and cv blocks, the cv at its unscaled level
+	float Decimate(const Block& audio, const Block& cv)
+	{
+		double decimated;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			const Block normalizedCv = cv / _cvScaling;
+			_lastControl = static_cast<float>(
+				_cvResampler->Downsample(normalizedCv));
+			decimated = _audioResampler->Downsample(audio);
+		}
 		const float output = static_cast<float>(
-			tfdsp::RackOutputAdapter::ProcessPostDecimation(
-				_audioResampler->Downsample(audioValues)));
+			tfdsp::RackOutputAdapter::ProcessPostDecimation(decimated));
 		if (!std::isfinite(output))
 		{
 			Reset();
@@ -154,26 +211,244 @@ public:
 		}
 		return output;
 	}
+};
+/**
+ * \brief Polyphonic version of VCACore.
+ * The audio and cv integrators of every channel are packed into a single bank of
+ * 2 * Channels models: lane 2 * c holds the audio path of channel c and lane
+ * 2 * c + 1 its cv path, so each oversampled frame is one Model::StepBank
+ * Newton solve instead of one StepDual per channel. The solve only covers the
+ * lanes of the active channels, rounded up to a power of two lanes so that
+ * the bank is a whole number of SIMD packets; the few inactive lanes it
+ * includes are fed silence.
+ * Resampling, noise and the output stage stay per channel and are skipped for
+ * inactive channels.
+ */
+template<typename Oversampler, typename Model, int Channels = 16>
+class VCACoreBank
+{
 private:
-	inline void Step(Eigen::Ref<Eigen::Array<double, ResamplingFactor, 1>> audio, const Eigen::Array<double, ResamplingFactor, 1>& cv, const double finalGain)
+	VCACoreBank(const VCACoreBank&) = delete;
+	VCACoreBank& operator=(const VCACoreBank&) = delete;
+
+	static constexpr unsigned int ResamplingFactor{ Oversampler::ResamplingFactor };
+	static constexpr int Lanes{ 2 * Channels };
+	using Block = Eigen::Array<double, ResamplingFactor, 1>;
+	using LaneArray = Eigen::Array<double, Lanes, 1>;
+
+	float _sampleRate{};
+	std::array<std::unique_ptr<Oversampler>, Channels> _audioResamplers;
+	std::array<std::unique_ptr<Oversampler>, Channels> _cvResamplers;
+	std::array<std::unique_ptr<Oversampler>, Channels> _exponentialCvResamplers;
+
+	std::array<Model, Lanes> _models{};
+	LaneArray _g;//Normalised and prewarped rolloffs
+	tfdsp::NewtonSolverSettings _solver{ tfdsp::QualitySettingsFor(
+		tfdsp::QualityTier::Standard).vcaIntegrator };
+
+	std::array<tfdsp::PinkNoiseSource, Channels> _noise{};
+	double _noiseLevel{ 1.0e-10 };
+	double _noiseStdDev{};
+
+	double _cvScaling{3.0};
+	double _powerSupplyVoltage{ 12.0 };
+	std::array<TanhBlock<double, ResamplingFactor>, Channels> _outputStages{};
+	std::array<float, Channels> _lastControls{};
+	int _activeChannels{};
+
+	// Steps the smallest bank, from Width lanes up, that holds `lanes` lanes.
+	template<int Width>
+	void StepLanes(LaneArray& audioAndCv, const int lanes)
 	{
-		for (unsigned int i = 0; i < ResamplingFactor; ++i)
+		if constexpr (Width < Lanes)
+		{
+			if (lanes > Width)
+			{
+				StepLanes<std::min(2 * Width, Lanes)>(audioAndCv, lanes);
+				return;
+			}
+		}
+		Model::template StepBank<Width>(_models.data(),
+			audioAndCv.template head<Width>(), _g.template head<Width>(), _solver);
+	}
+
+	void ResetChannel(const int channel)
+	{
+		_models[2 * channel].Reset();
+		_models[2 * channel + 1].Reset();
+		_audioResamplers[channel]->Reset();
+		_cvResamplers[channel]->Reset();
+		_exponentialCvResamplers[channel]->Reset();
+		_noise[channel].Reset();
+		_outputStages[channel].Reset();
+		_lastControls[channel] = 0.0f;
+	}
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	explicit VCACoreBank(std::function<std::unique_ptr<Oversampler>()> resamplerCreator)
+	{
+		for (int channel = 0; channel < Channels; ++channel)
+		{
+			_audioResamplers[channel] = resamplerCreator();
+			_cvResamplers[channel] = resamplerCreator();
+			_exponentialCvResamplers[channel] = resamplerCreator();
+		}
+		_g.setZero();
+	}
+	void SetSampleRate(const float f0)
+	{
+		_sampleRate = f0 * ResamplingFactor;
+		const double g = 2.0 * std::tan(tfdsp::PI / 2.0 * Model::DefaultRolloff / (0.5 * _sampleRate));
+		_g.setConstant(g);
+		_noiseStdDev = std::sqrt( _noiseLevel * _sampleRate / 2);
+	}
+	void SetSolverSettings(const tfdsp::NewtonSolverSettings& settings)
+	{
+		_solver.maximumIterations = std::clamp(settings.maximumIterations, 0,
+			tfdsp::MaximumSolverIterations);
+		_solver.tolerance = settings.tolerance;
+	}
+	void SetNoiseLevel(const double noiseLevel)
+	{
+		_noiseLevel = std::max(noiseLevel, 0.0);
+		_noiseStdDev = std::sqrt( _noiseLevel * _sampleRate / 2);
+	}
+	void SeedNoise(const std::uint64_t seed)
+	{
+		for (int channel = 0; channel < Channels; ++channel)
+			_noise[channel].Seed(seed + static_cast<std::uint64_t>(channel));
+	}
+	void Reset()
+	{
+		for (int channel = 0; channel < Channels; ++channel)
+			ResetChannel(channel);
+		_activeChannels = 0;
+	}
+	float LastControl(const int channel) const { return _lastControls[channel]; }
+
+	/**
+	 * \brief Process one host sample for the first `channels` channels, see VCACore::StepControls
+	 * \param audio, linearCv, exponentialCv per channel inputs, at least `channels` values each
+	 * \param output per channel outputs, at least `channels` values
+	 */
+	void StepControls(const float* audio, const float* linearCv,
+		const float* exponentialCv, const float exponentialBase,
+		const float finalGain, float* output, int channels)
+	{
+		if (_sampleRate <= 0.f)
+			throw std::runtime_error("Sample rate invalid or not initialized");
+		channels = std::clamp(channels, 0, Channels);
+		// Channels which were dropped restart from rest if they come back
+		for (int channel = channels; channel < _activeChannels; ++channel)
+			ResetChannel(channel);
+		_activeChannels = channels;
+
+		const double base = std::max<double>(exponentialBase, 1.0e-6);
+		const bool finiteGain = std::isfinite(finalGain) && std::isfinite(exponentialBase);
+		std::array<Block, Channels> audioValues;
+		std::array<Block, Channels> cvValues;
+		std::array<Block, Channels> exponentialValues;
+		std::array<double, Channels> noise;
+		for (int channel = 0; channel < channels; ++channel)
+			noise[channel] = _noiseStdDev * _noise[channel].Step();
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				if (!finiteGain || !std::isfinite(audio[channel]) ||
+					!std::isfinite(linearCv[channel]) || !std::isfinite(exponentialCv[channel]))
+				{
+					ResetChannel(channel);
+					audioValues[channel].setZero();
+					cvValues[channel].setZero();
+					exponentialValues[channel].setZero();
+					continue;
+				}
+				audioValues[channel] = _audioResamplers[channel]->Upsample(noise[channel] + audio[channel]);
+				cvValues[channel] = _cvResamplers[channel]->Upsample(linearCv[channel]);
+				exponentialValues[channel] =
+					_exponentialCvResamplers[channel]->Upsample(exponentialCv[channel]);
+			}
+		}
+		for (int channel = 0; channel < channels; ++channel)
 		{
-			Eigen::Array<double, 2 ,1> audioAndCv;
-			audioAndCv(0) = audio(i);
-			audioAndCv(1) = cv(i);
+			for (unsigned int i = 0; i < ResamplingFactor; ++i)
+			{
+				const double linear = std::clamp(cvValues[channel](i), 0.0, 1.0);
+				const double exponent = std::clamp(exponentialValues[channel](i), 0.0, 1.0);
+				const double shaped = std::abs(base - 1.0) < 1.0e-8 ? exponent :
+					(std::pow(base, exponent) - 1.0) / (base - 1.0);
+				cvValues[channel](i) = _cvScaling *
+					std::clamp(linear + shaped, 0.0, 1.0);
+			}
+		}
+
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (unsigned int i = 0; i < ResamplingFactor; ++i)
+			{
+				LaneArray audioAndCv = LaneArray::Zero();
+				for (int channel = 0; channel < channels; ++channel)
+				{
+					audioAndCv(2 * channel) = audioValues[channel](i);
+					audioAndCv(2 * channel + 1) = cvValues[channel](i);
+				}
 
-			Model::StepDual(_models, audioAndCv, _g);
+				StepLanes<std::min(4, Lanes)>(audioAndCv, 2 * channels);
 
-			audio(i) = audioAndCv(0) * audioAndCv(1) / _cvScaling;
+				for (int channel = 0; channel < channels; ++channel)
+					audioValues[channel](i) = audioAndCv(2 * channel) *
+						audioAndCv(2 * channel + 1) / _cvScaling;
+			}
+		}
+
+		{
+			TF_PROFILE_SCOPE(OutputStage);
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				Block& values = audioValues[channel];
+				//Apply final gain and saturate to power supply voltage
+				values = _powerSupplyVoltage * _outputStages[channel].Process(
+					(finiteGain ? finalGain : 0.0f) / _powerSupplyVoltage * values);
+				for (unsigned int i = 0; i < ResamplingFactor; ++i)
+					values(i) = tfdsp::RackOutputAdapter::ProcessOversampled(values(i));
+			}
+		}
+
+		std::array<double, Channels> decimated;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				const Block normalizedCv = cvValues[channel] / _cvScaling;
+				_lastControls[channel] = static_cast<float>(
+					_cvResamplers[channel]->Downsample(normalizedCv));
+				decimated[channel] = _audioResamplers[channel]->Downsample(
+					audioValues[channel]);
+			}
+		}
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			const float result = static_cast<float>(
+				tfdsp::RackOutputAdapter::ProcessPostDecimation(decimated[channel]));
+			if (!std::isfinite(result))
+			{
+				ResetChannel(channel);
+				output[channel] = 0.0f;
+			}
+			else
+				output[channel] = result;
 		}
-		//Apply final gain and saturate to power supply voltage
-		audio = _powerSupplyVoltage *  _outputStage.Process(finalGain / _powerSupplyVoltage * audio);
-		for (unsigned int i = 0; i < ResamplingFactor; ++i)
-			audio(i) = tfdsp::RackOutputAdapter::ProcessOversampled(audio(i));
 	}
 };
+
 template<typename T>
 using VCA_OTACore = ::VCACore<T, OTA1PoleIntegrator>;
 template<typename T>
 using VCA_TransistorCore = ::VCACore<T, Transistor1PoleIntegrator>;
+template<typename T>
+using VCA_OTACoreBank = ::VCACoreBank<T, OTA1PoleIntegrator>;
+template<typename T>
+using VCA_TransistorCoreBank = ::VCACoreBank<T, Transistor1PoleIntegrator>;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <functional>
 #include <memory>
@@ -9,6 +10,8 @@
 #include "tfdsp/rail.hpp"
 #include "../tfdsp/filters.hpp"
 #include "../tfdsp/approx.hpp"
+#include "../tfdsp/profile_scope.hpp"
+#include "../tfdsp/quality.hpp"
 #include "../tfdsp/sampleRate.hpp"
 
 /**
@@ -25,8 +28,8 @@ class VdpSplitOscillator
 private:
 	static constexpr int ResamplingFactor{Oversampler::ResamplingFactor};
 	static constexpr double maxOutput{12.0};
-	static constexpr double maxDampingPhasePerStep{0.4};
-	static constexpr int maxSubsteps{24};
+	static constexpr int maxSubsteps{48};
+	using Block = Eigen::Array<double, ResamplingFactor, 1>;
 
 	double _position{};
 	double _velocity{1.0};
@@ -35,6 +38,8 @@ private:
 	std::unique_ptr<Oversampler> _resamplerX;
 	std::unique_ptr<Oversampler> _resamplerMu;
 	std::unique_ptr<Oversampler> _resamplerW;
+	tfdsp::VdpSubstepSettings _substeps{ tfdsp::QualitySettingsFor(
+		tfdsp::QualityTier::Standard).vanDerPol };
 
 	bool VelocityStep(double input, double damping, double interval, double& normalizedVelocity)
 	{
@@ -54,8 +59,8 @@ private:
 		const double mu = std::clamp(damping, 1.0e-8, 9.0);
 		const double requestedPhase = requestedW / _sampleRate;
 		const int substeps = std::clamp(
-			static_cast<int>(std::ceil(mu * requestedPhase / maxDampingPhasePerStep)),
-			1, maxSubsteps);
+			static_cast<int>(std::ceil(mu * requestedPhase / _substeps.maximumDampingPhase)),
+			1, _substeps.maximumSubsteps);
 		const double targetPhaseStep = requestedPhase / substeps;
 		const double phaseStep = 2.0 * std::sin(0.5 * targetPhaseStep);
 		const double effectiveW = phaseStep * _sampleRate * substeps;
@@ -95,6 +100,15 @@ public:
 	{
 	}
 
+	/** Substep limit and largest damping phase per substep, see
+	 * tfdsp::VdpSubstepSettings. */
+	void SetSubstepSettings(const tfdsp::VdpSubstepSettings& settings)
+	{
+		_substeps.maximumSubsteps = std::clamp(settings.maximumSubsteps, 1,
+			maxSubsteps);
+		_substeps.maximumDampingPhase = std::max(settings.maximumDampingPhase, 0.05);
+	}
+
 	void SetSampleRate(double sampleRate)
 	{
 		_sampleRate = sampleRate * ResamplingFactor;
@@ -118,21 +132,23 @@ public:
 			Reset();
 			return 0.0f;
 		}
-		const auto inputValues = _resamplerX->Upsample(input);
-		const auto dampingValues = _resamplerMu->Upsample(damping);
-		const auto frequencyValues = _resamplerW->Upsample(angularFrequency);
-		Eigen::Array<double, ResamplingFactor, 1> output;
-		for (int i = 0; i < ResamplingFactor; ++i)
-			output(i) = tfdsp::RackOutputAdapter::ProcessOversampled(
-				ModelStep(inputValues(i), dampingValues(i), frequencyValues(i)));
-		const float result = _resamplerX->Downsample(output);
-		if (!std::isfinite(result))
+		Block inputValues;
+		Block dampingValues;
+		Block frequencyValues;
 		{
-			Reset();
-			return 0.0f;
+			TF_PROFILE_SCOPE(Resampling);
+			inputValues = _resamplerX->Upsample(input);
+			dampingValues = _resamplerMu->Upsample(damping);
+			frequencyValues = _resamplerW->Upsample(angularFrequency);
 		}
-		return static_cast<float>(
-			tfdsp::RackOutputAdapter::ProcessPostDecimation(result));
+		Block output;
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < ResamplingFactor; ++i)
+				output(i) = tfdsp::RackOutputAdapter::ProcessOversampled(
+					ModelStep(inputValues(i), dampingValues(i), frequencyValues(i)));
+		}
+		return Decimate(output);
 	}
 
 	float StepLogAngularFrequency(double input, double damping,
@@ -146,20 +162,38 @@ public:
 			Reset();
 			return 0.0f;
 		}
-		const auto inputValues = _resamplerX->Upsample(input);
-		const auto dampingValues = _resamplerMu->Upsample(damping);
-		const auto frequencyLogValues =
-			_resamplerW->Upsample(log2AngularFrequency);
-		Eigen::Array<double, ResamplingFactor, 1> output;
-		for (int i = 0; i < ResamplingFactor; ++i)
+		Block inputValues;
+		Block dampingValues;
+		Block frequencyLogValues;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			inputValues = _resamplerX->Upsample(input);
+			dampingValues = _resamplerMu->Upsample(damping);
+			frequencyLogValues = _resamplerW->Upsample(log2AngularFrequency);
+		}
+		Block output;
 		{
-			const double angularFrequency = tfdsp::Exp2Taylor5(
-				static_cast<float>(std::clamp(frequencyLogValues(i), -100.0,
-					100.0)));
-			output(i) = tfdsp::RackOutputAdapter::ProcessOversampled(
-				ModelStep(inputValues(i), dampingValues(i), angularFrequency));
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < ResamplingFactor; ++i)
+			{
+				const double angularFrequency = tfdsp::Exp2Taylor5(
+					static_cast<float>(std::clamp(frequencyLogValues(i), -100.0,
+						100.0)));
+				output(i) = tfdsp::RackOutputAdapter::ProcessOversampled(
+					ModelStep(inputValues(i), dampingValues(i), angularFrequency));
+			}
+		}
+		return Decimate(output);
+	}
+
+private:
+	float Decimate(const Block& output)
+	{
+		float result;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			result = _resamplerX->Downsample(output);
 		}
-		const float result = _resamplerX->Downsample(output);
 		if (!std::isfinite(result))
 		{
 			Reset();
@@ -169,3 +203,277 @@ public:
 			tfdsp::RackOutputAdapter::ProcessPostDecimation(result));
 	}
 };
+
+/**
+ * Bank of up to Channels independent VdpSplitOscillator voices advanced in SIMD lanes.
+ *
+ * Each voice keeps its own resamplers and its own substep count. The split
+ * update runs up to the largest substep count of the active voices, on the
+ * lanes of the active voices rounded up to a power of two; lanes which
+ * already finished, or which failed, are masked out so every voice follows
+ * exactly the same arithmetic as VdpSplitOscillator.
+ */
+template<typename Oversampler, int Channels = 16>
+class VdpSplitOscillatorBank
+{
+private:
+	VdpSplitOscillatorBank(const VdpSplitOscillatorBank&) = delete;
+	VdpSplitOscillatorBank& operator=(const VdpSplitOscillatorBank&) = delete;
+
+	static constexpr int ResamplingFactor{Oversampler::ResamplingFactor};
+	static constexpr double maxOutput{12.0};
+	static constexpr int maxSubsteps{48};
+	using Block = Eigen::Array<double, ResamplingFactor, 1>;
+	template<int Width>
+	using Lanes = Eigen::Array<double, Width, 1>;
+	template<int Width>
+	using Mask = Eigen::Array<bool, Width, 1>;
+	using LaneArray = Lanes<Channels>;
+
+	LaneArray _position;
+	LaneArray _velocity;
+	double _sampleRate{};
+	double _maxAngularFrequency{};
+	std::array<std::unique_ptr<Oversampler>, Channels> _resamplersX;
+	std::array<std::unique_ptr<Oversampler>, Channels> _resamplersMu;
+	std::array<std::unique_ptr<Oversampler>, Channels> _resamplersW;
+	int _activeChannels{};
+	// Substep settings shared by all voices
+	tfdsp::VdpSubstepSettings _substeps{ tfdsp::QualitySettingsFor(
+		tfdsp::QualityTier::Standard).vanDerPol };
+
+	void ResetChannel(const int channel)
+	{
+		_position(channel) = 0.0;
+		_velocity(channel) = 1.0;
+		_resamplersX[channel]->Reset();
+		_resamplersMu[channel]->Reset();
+		_resamplersW[channel]->Reset();
+	}
+
+	// Masked VdpSplitOscillator::VelocityStep on Width lanes, lanes whose update
+	// fails are added to `failed` and keep their previous velocity.
+	template<int Width>
+	static void VelocityStep(const Lanes<Width>& input, const Lanes<Width>& damping,
+		const Lanes<Width>& interval, const Lanes<Width>& position, const Mask<Width>& active,
+		Mask<Width>& failed, Lanes<Width>& normalizedVelocity)
+	{
+		const Lanes<Width> rate = damping * (1.0 - position * position);
+		const Lanes<Width> halfRateInterval = 0.5 * rate * interval;
+		const Lanes<Width> denominator = 1.0 - halfRateInterval;
+		const Lanes<Width> next = ((1.0 + halfRateInterval) * normalizedVelocity
+			+ interval * (input - position)) / denominator;
+		const Mask<Width> valid = denominator.isFinite() && denominator.abs() >= 1.0e-12 &&
+			next.isFinite();
+		failed = failed || (active && !valid);
+		normalizedVelocity = (active && valid).select(next, normalizedVelocity);
+	}
+
+	// Advances the first `channels` voices on the smallest bank, from Width
+	// lanes up, that holds them.
+	template<int Width>
+	void ModelStep(const LaneArray& input, const LaneArray& damping,
+		const LaneArray& angularFrequency, const int channels, LaneArray& output)
+	{
+		if constexpr (Width < Channels)
+		{
+			if (channels > Width)
+			{
+				ModelStep<std::min(2 * Width, Channels)>(input, damping,
+					angularFrequency, channels, output);
+				return;
+			}
+		}
+		Lanes<Width> mu = Lanes<Width>::Constant(1.0e-8);
+		Lanes<Width> phaseStep = Lanes<Width>::Zero();
+		Lanes<Width> effectiveW = Lanes<Width>::Ones();
+		Lanes<Width> normalizedVelocity = Lanes<Width>::Zero();
+		std::array<int, Width> substeps{};
+		int laneSubsteps = 0;
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			const double requestedW = std::clamp(angularFrequency(channel), 1.0e-4, _maxAngularFrequency);
+			mu(channel) = std::clamp(damping(channel), 1.0e-8, 9.0);
+			const double requestedPhase = requestedW / _sampleRate;
+			substeps[channel] = std::clamp(
+				static_cast<int>(std::ceil(mu(channel) * requestedPhase / _substeps.maximumDampingPhase)),
+				1, _substeps.maximumSubsteps);
+			const double targetPhaseStep = requestedPhase / substeps[channel];
+			phaseStep(channel) = 2.0 * std::sin(0.5 * targetPhaseStep);
+			effectiveW(channel) = phaseStep(channel) * _sampleRate * substeps[channel];
+			normalizedVelocity(channel) = _velocity(channel) / effectiveW(channel);
+			laneSubsteps = std::max(laneSubsteps, substeps[channel]);
+		}
+
+		const Lanes<Width> laneInput = input.template head<Width>();
+		const Lanes<Width> interval = 0.5 * phaseStep;
+		Lanes<Width> position = _position.template head<Width>();
+		Mask<Width> failed = Mask<Width>::Constant(false);
+		for (int i = 0; i < laneSubsteps; ++i)
+		{
+			Mask<Width> active;
+			for (int channel = 0; channel < Width; ++channel)
+				active(channel) = i < substeps[channel];
+			active = active && !failed;
+
+			VelocityStep<Width>(laneInput, mu, interval, position, active, failed,
+				normalizedVelocity);
+			active = active && !failed;
+			const Lanes<Width> moved = position + phaseStep * normalizedVelocity;
+			failed = failed || (active && !moved.isFinite());
+			active = active && !failed;
+			position = active.select(moved.max(-maxOutput).min(maxOutput), position);
+			VelocityStep<Width>(laneInput, mu, interval, position, active, failed,
+				normalizedVelocity);
+		}
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			if (failed(channel))
+			{
+				_position(channel) = 0.0;
+				_velocity(channel) = 1.0;
+				output(channel) = 0.0;
+				continue;
+			}
+			_position(channel) = position(channel);
+			_velocity(channel) = std::clamp(
+				effectiveW(channel) * normalizedVelocity(channel),
+				-2.0 * maxOutput * _sampleRate,
+				2.0 * maxOutput * _sampleRate);
+			output(channel) = position(channel);
+		}
+	}
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	explicit VdpSplitOscillatorBank(std::function<std::unique_ptr<Oversampler>()> resamplerCreator)
+	{
+		for (int channel = 0; channel < Channels; ++channel)
+		{
+			_resamplersX[channel] = resamplerCreator();
+			_resamplersMu[channel] = resamplerCreator();
+			_resamplersW[channel] = resamplerCreator();
+		}
+		_position.setZero();
+		_velocity.setOnes();
+	}
+
+	/** Substep limit and largest damping phase per substep, see
+	 * tfdsp::VdpSubstepSettings. */
+	void SetSubstepSettings(const tfdsp::VdpSubstepSettings& settings)
+	{
+		_substeps.maximumSubsteps = std::clamp(settings.maximumSubsteps, 1,
+			maxSubsteps);
+		_substeps.maximumDampingPhase = std::max(settings.maximumDampingPhase, 0.05);
+	}
+
+	void SetSampleRate(double sampleRate)
+	{
+		_sampleRate = sampleRate * ResamplingFactor;
+		_maxAngularFrequency = tfdsp::PI * 0.9 * sampleRate;
+	}
+
+	void Reset()
+	{
+		for (int channel = 0; channel < Channels; ++channel)
+			ResetChannel(channel);
+		_activeChannels = 0;
+	}
+
+	/**
+	 * \brief Process one host sample for the first `channels` voices, see VdpSplitOscillator::StepLogAngularFrequency
+	 * \param input, damping, log2AngularFrequency per channel inputs, at least `channels` values each
+	 * \param output per channel outputs, at least `channels` values
+	 */
+	void StepLogAngularFrequency(const double* input, const double* damping,
+		const double* log2AngularFrequency, float* output, int channels)
+	{
+		if (!(_sampleRate > 0.0))
+			throw std::runtime_error("Sample rate invalid or not initialized");
+		channels = std::clamp(channels, 0, Channels);
+		// Channels which were dropped restart from rest if they come back
+		for (int channel = channels; channel < _activeChannels; ++channel)
+			ResetChannel(channel);
+		_activeChannels = channels;
+
+		std::array<Block, Channels> inputValues;
+		std::array<Block, Channels> dampingValues;
+		// log2 angular frequencies, exponentiated in the oversampled loop
+		std::array<Block, Channels> frequencyValues;
+		std::array<bool, Channels> finite{};
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				finite[channel] = std::isfinite(input[channel]) && std::isfinite(damping[channel]) &&
+					std::isfinite(log2AngularFrequency[channel]);
+				if (!finite[channel])
+				{
+					ResetChannel(channel);
+					inputValues[channel].setZero();
+					dampingValues[channel].setZero();
+					frequencyValues[channel].setZero();
+					continue;
+				}
+				inputValues[channel] = _resamplersX[channel]->Upsample(input[channel]);
+				dampingValues[channel] = _resamplersMu[channel]->Upsample(damping[channel]);
+				frequencyValues[channel] =
+					_resamplersW[channel]->Upsample(log2AngularFrequency[channel]);
+			}
+		}
+
+		std::array<Block, Channels> outputValues;
+		{
+			TF_PROFILE_SCOPE(Solver);
+			for (int i = 0; i < ResamplingFactor; ++i)
+			{
+				LaneArray laneInput = LaneArray::Zero();
+				LaneArray laneDamping = LaneArray::Zero();
+				LaneArray laneFrequency = LaneArray::Zero();
+				for (int channel = 0; channel < channels; ++channel)
+				{
+					laneInput(channel) = inputValues[channel](i);
+					laneDamping(channel) = dampingValues[channel](i);
+					if (finite[channel])
+						laneFrequency(channel) = tfdsp::Exp2Taylor5(static_cast<float>(
+							std::clamp(frequencyValues[channel](i), -100.0, 100.0)));
+				}
+				LaneArray laneOutput = LaneArray::Zero();
+				ModelStep<std::min(4, Channels)>(laneInput, laneDamping, laneFrequency,
+					channels, laneOutput);
+				for (int channel = 0; channel < channels; ++channel)
+					outputValues[channel](i) =
+						tfdsp::RackOutputAdapter::ProcessOversampled(laneOutput(channel));
+			}
+		}
+
+		std::array<float, Channels> decimated{};
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			for (int channel = 0; channel < channels; ++channel)
+				if (finite[channel])
+					decimated[channel] = _resamplersX[channel]->Downsample(outputValues[channel]);
+		}
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			if (!finite[channel])
+			{
+				// The lane ran from rest on zero inputs, discard that step as the mono voice does.
+				ResetChannel(channel);
+				output[channel] = 0.0f;
+				continue;
+			}
+			const float result = decimated[channel];
+			if (!std::isfinite(result))
+			{
+				ResetChannel(channel);
+				output[channel] = 0.0f;
+				continue;
+			}
+			output[channel] = static_cast<float>(
+				tfdsp::RackOutputAdapter::ProcessPostDecimation(result));
+		}
+	}
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
@@ -23,4 +26,42 @@ namespace tfdsp
 			(0.008991698010f + fraction * 0.001879100722f))));
 		return integerPart * polynomial;
 	}
+
+	/** Exp2Taylor5() of every element. The loop has no branches, so compilers
+	 * vectorize it; use it to refresh a per-voice table in one pass. */
+	template<std::size_t Size>
+	inline void Exp2Taylor5(const std::array<float, Size>& values,
+		std::array<float, Size>& results)
+	{
+		for (std::size_t i = 0; i < Size; ++i)
+			results[i] = Exp2Taylor5(values[i]);
+	}
+
+	/** 2^x for exponents of at most a semitone, such as a few cents of drift,
+	 * with at most 6e-9 relative error. A plain polynomial in double precision,
+	 * cheaper than Exp2Taylor5() and without its float rounding.
+	 */
+	inline double Exp2NearZero(double value)
+	{
+		const double x = 0.69314718055994530942 * value;
+		return 1.0 + x * (1.0 + x * (1.0 / 2.0 + x * (1.0 / 6.0 +
+			x * (1.0 / 24.0))));
+	}
+
+	/** cos(2*pi*phase) for a phase in cycles, with at most 4e-9 absolute error.
+	 * The phase is folded onto a quarter cycle where an odd degree-9 minimax
+	 * polynomial gives sin(2*pi*t); the error is periodic in the phase, so for
+	 * a steady phase ramp it only adds harmonics below -165 dB. There are no
+	 * branches or library calls, so loops over voices can vectorize.
+	 * The caller must provide a finite phase of moderate magnitude.
+	 */
+	inline double CosineCycle(double phase)
+	{
+		const double centered = phase - std::floor(phase + 0.5);
+		const double t = 0.25 - std::abs(centered);
+		const double t2 = t * t;
+		return t * (6.2831851600888875 + t2 * (-41.341655031265219 + t2 *
+			(81.601004063113052 + t2 * (-76.549782046260347 + t2 *
+			39.536704087685671))));
+	}
 }
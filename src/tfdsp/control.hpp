@@ -1,10 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <random>
 
 #include "filters.hpp"
+#include "random.hpp"
 
 namespace tfdsp
 {
@@ -200,7 +203,8 @@ namespace tfdsp
 			{
 				_phase -= 1.0;
 				_start = _target;
-				_target = _decay * _target + _innovationStdDev * _normal(generator);
+				_target = _decay * _target + _innovationStdDev *
+					DrawStandardNormal(_normal, generator);
 			}
 			return _start + _phase * (_target - _start);
 		}
@@ -247,4 +251,159 @@ namespace tfdsp
 			return std::sqrt(2.0) * _smoothed;
 		}
 	};
+
+	/** Many SmoothOrnsteinUhlenbeck processes sharing one control clock.
+	 *
+	 * Every process has the same time constant and stationary deviation, as the
+	 * drift and "alive" modulations of one module do. All the work happens at
+	 * the control rate: each update draws one Gaussian per process in SIMD
+	 * lanes, advances the raw OU processes and advances their smoothers in
+	 * closed form across the whole interval, treating the raw path as the
+	 * linear ramp InterpolatedOrnsteinUhlenbeck plays back. Between updates
+	 * Value() linearly interpolates the smoothed knots, so a process nobody
+	 * reads costs nothing per sample. With time constants far longer than the
+	 * control interval the knots lie on a smooth curve and the interpolation
+	 * error is negligible.
+	 *
+	 * With Smoothed false the bank plays back the raw processes instead, each
+	 * matching an InterpolatedOrnsteinUhlenbeck.
+	 */
+	template<int Processes, bool Smoothed = true>
+	class OrnsteinUhlenbeckBank
+	{
+	public:
+		static constexpr int Size = Processes;
+
+		/** Seeded from std::random_device, use Seed() for reproducible streams. */
+		OrnsteinUhlenbeckBank()
+		{
+			ZigguratGaussian::Prepare();
+		}
+
+		explicit OrnsteinUhlenbeckBank(std::uint64_t seed) : _generator(seed)
+		{
+			ZigguratGaussian::Prepare();
+		}
+
+		void Seed(std::uint64_t seed)
+		{
+			_generator.Seed(seed);
+		}
+
+		/** Configure by diffusion, as InterpolatedOrnsteinUhlenbeck::Configure(). */
+		void Configure(double sampleRate, double timeConstant, double diffusion,
+			double controlRate = 100.0)
+		{
+			const double boundedTimeConstant = std::isfinite(timeConstant) ?
+				std::max(timeConstant, 1.0e-6) : 1.0;
+			ConfigureStationary(sampleRate, boundedTimeConstant,
+				diffusion * std::sqrt(0.5 * boundedTimeConstant), controlRate);
+		}
+
+		void ConfigureStationary(double sampleRate, double timeConstant,
+			double stationaryStdDev = 1.0, double controlRate = 100.0)
+		{
+			const double boundedSampleRate = std::isfinite(sampleRate) ?
+				std::max(sampleRate, 1.0) : 1.0;
+			const double boundedTimeConstant = std::isfinite(timeConstant) ?
+				std::max(timeConstant, 1.0e-6) : 1.0;
+			const double boundedStdDev = std::isfinite(stationaryStdDev) ?
+				std::max(stationaryStdDev, 0.0) : 0.0;
+			const double boundedControlRate = std::isfinite(controlRate) ?
+				std::clamp(controlRate, 1.0, boundedSampleRate) : 100.0;
+			const double interval = 1.0 / boundedControlRate;
+			_phaseIncrement = boundedControlRate / boundedSampleRate;
+			_decay = std::exp(-interval / boundedTimeConstant);
+			_innovationStdDev = boundedStdDev *
+				std::sqrt(1.0 - _decay * _decay);
+			// A one-pole smoother y' = (x - y) / tau driven by x ramping from a to
+			// b over the interval ends at decay * y + (1 - k) * b + (k - decay) * a.
+			const double k = boundedTimeConstant * -std::expm1(
+				-interval / boundedTimeConstant) / interval;
+			_smoothedWeight = _decay;
+			_endWeight = 1.0 - k;
+			_startWeight = k - _decay;
+		}
+
+		void Reset()
+		{
+			_phase = 0.0;
+			_raw.fill(0.0);
+			_smoothed.fill(0.0);
+			_knot.fill(0.0);
+			_slope.fill(0.0);
+		}
+
+		/** Moves the shared clock forward, updating every process on each
+		 * control tick passed. */
+		void Advance(int samples = 1)
+		{
+			for (int sample = 0; sample < samples; ++sample)
+			{
+				_phase += _phaseIncrement;
+				if (_phase >= 1.0)
+				{
+					_phase -= 1.0;
+					Update();
+				}
+			}
+		}
+
+		/** The output of `process` at the current sample, or `samplesAhead`
+		 * samples later. Looking ahead past the next control tick holds the
+		 * current interval's end value, which the next interval starts from. */
+		double Value(int process, int samplesAhead = 0) const
+		{
+			const double phase = std::min(
+				_phase + samplesAhead * _phaseIncrement, 1.0);
+			return _knot[process] + phase * _slope[process];
+		}
+
+	private:
+		static constexpr int GaussianLanes = 8;
+
+		void Update()
+		{
+			std::array<float, GaussianLanes> draws;
+			for (int first = 0; first < Processes; first += GaussianLanes)
+			{
+				ZigguratGaussian::DrawLanes<GaussianLanes>(_generator, draws.data());
+				const int count = std::min(GaussianLanes, Processes - first);
+				for (int lane = 0; lane < count; ++lane)
+				{
+					const int process = first + lane;
+					const double start = _raw[process];
+					const double end = _decay * start +
+						_innovationStdDev * static_cast<double>(draws[lane]);
+					_raw[process] = end;
+					if constexpr (!Smoothed)
+					{
+						_knot[process] = start;
+						_slope[process] = end - start;
+						continue;
+					}
+					const double smoothed = _smoothedWeight * _smoothed[process] +
+						_endWeight * end + _startWeight * start;
+					// The sqrt(2) gain restores the variance lost by cascading two
+					// equal-time-constant poles, as in SmoothOrnsteinUhlenbeck.
+					_knot[process] = std::sqrt(2.0) * _smoothed[process];
+					_slope[process] = std::sqrt(2.0) * (smoothed - _smoothed[process]);
+					_smoothed[process] = smoothed;
+				}
+			}
+		}
+
+		Xoshiro128PlusPlusLanes<GaussianLanes> _generator;
+		double _phase{};
+		double _phaseIncrement{};
+		double _decay{};
+		double _innovationStdDev{};
+		double _smoothedWeight{1.0};
+		double _endWeight{};
+		double _startWeight{};
+		std::array<double, Processes> _raw{};
+		std::array<double, Processes> _smoothed{};
+		std::array<double, Processes> _knot{};
+		std::array<double, Processes> _slope{};
+	};
 }
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
+
+namespace tfdsp
+{
+	// Recursive states that decay toward zero are snapped to exactly zero once
+	// they fall below this level, roughly -600 dB relative to a 1 V signal and
+	// far above the subnormal range, so release tails never reach subnormals
+	// even where nothing has enabled flush-to-zero.
+	constexpr double DenormalSnapThreshold = 1.0e-30;
+
+	inline double SnapToZero(double x)
+	{
+		return std::abs(x) < DenormalSnapThreshold ? 0.0 : x;
+	}
+
+	template<typename Derived>
+	inline void SnapToZero(Eigen::ArrayBase<Derived>& x)
+	{
+		x = (x.abs() < DenormalSnapThreshold).select(0.0, x);
+	}
+
+	/**
+	 * Enables flush-to-zero and denormals-are-zero on the calling thread for the
+	 * guard's lifetime and restores the previous mode afterwards.
+	 *
+	 * Rack sets these flags on its engine threads; every other entry point (the
+	 * Python bindings, the offline renderer, the benchmarks) opens one of these
+	 * around its processing. Without SSE or AArch64 it does nothing.
+	 */
+	class ScopedFlushDenormals
+	{
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+		// MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6).
+		static constexpr unsigned int FlushMask = 0x8040u;
+		unsigned int _previous;
+
+	public:
+		ScopedFlushDenormals() : _previous(_mm_getcsr())
+		{
+			_mm_setcsr(_previous | FlushMask);
+		}
+
+		~ScopedFlushDenormals()
+		{
+			_mm_setcsr(_previous);
+		}
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+		// FPCR flush-to-zero (bit 24) covers both inputs and results.
+		static constexpr std::uint64_t FlushMask = std::uint64_t{1} << 24;
+		std::uint64_t _previous;
+
+	public:
+		ScopedFlushDenormals()
+		{
+			__asm__ __volatile__("mrs %0, fpcr" : "=r"(_previous));
+			const std::uint64_t flushed = _previous | FlushMask;
+			__asm__ __volatile__("msr fpcr, %0" : : "r"(flushed));
+		}
+
+		~ScopedFlushDenormals()
+		{
+			__asm__ __volatile__("msr fpcr, %0" : : "r"(_previous));
+		}
+#else
+	public:
+		ScopedFlushDenormals() {}
+#endif
+
+		ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+		ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+	};
+}
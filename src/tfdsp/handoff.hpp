@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace tfdsp
+{
+	// Per-channel voice state is aligned and padded to this, so the channels a
+	// module renders one after another never share a cache line.
+	constexpr std::size_t CacheLineSize = 64;
+
+	/**
+	 * Per-slot models created on demand off the audio thread.
+	 *
+	 * A slot is typically one polyphony channel of one oversampling path. The
+	 * preparer thread (the module widget's step() in Rack, or the constructor
+	 * before the module reaches the engine) calls Prepare() with the slots it
+	 * wants; missing models are created and published, and models no longer
+	 * wanted are unpublished and deleted once the audio thread has provably
+	 * moved past them. The audio thread never allocates, frees or blocks: it
+	 * calls BeginProcess() once per process() and Acquire() per slot, which
+	 * returns nullptr while a model is still being prepared.
+	 *
+	 * Only one thread may prepare at a time, and process() calls must not
+	 * overlap, which Rack guarantees for a single module.
+	 */
+	template<typename Model, int Slots>
+	class LazyModelSlots
+	{
+	public:
+		// --- Audio thread -------------------------------------------------------
+
+		/** Marks the previous process() call as finished. */
+		void BeginProcess()
+		{
+			_epoch.store(_epoch.load(std::memory_order_relaxed) + 1);
+		}
+
+		/**
+		 * The model published for `slot`, or nullptr. A model seen for the first
+		 * time, or after Invalidate(), is passed to `configure` (set the sample
+		 * rate and reset it) before it is returned.
+		 */
+		template<typename Configure>
+		Model* Acquire(int slot, Configure&& configure)
+		{
+			// Publish() bumps the version before it stores the pointer, so reading
+			// the pointer first sees a new model with its new version or a later one.
+			Model* model = _published[slot].load(std::memory_order_acquire);
+			if (!model)
+				return nullptr;
+			const std::uint32_t version = _version[slot].load(std::memory_order_acquire);
+			if (version != _configuredVersion[slot])
+			{
+				_configuredVersion[slot] = version;
+				configure(*model);
+			}
+			return model;
+		}
+
+		/** Calls `apply` on every published model, for settings that change
+		 * without a reset. Models configured later must get them in `configure`. */
+		template<typename Apply>
+		void ForEachPublished(Apply&& apply)
+		{
+			for (auto& published : _published)
+			{
+				if (Model* model = published.load(std::memory_order_acquire))
+					apply(*model);
+			}
+		}
+
+		bool Published(int slot) const
+		{
+			return _published[slot].load(std::memory_order_acquire) != nullptr;
+		}
+
+		/** Reconfigures every model at its next Acquire(). Call from the audio
+		 * thread or while the engine holds the module (sample rate changes). */
+		void Invalidate()
+		{
+			_configuredVersion.fill(InvalidVersion);
+		}
+
+		void Invalidate(int slot)
+		{
+			_configuredVersion[slot] = InvalidVersion;
+		}
+
+		// --- Preparer thread ----------------------------------------------------
+
+		/**
+		 * Publishes a model for every slot where `needed(slot)` holds, creating it
+		 * with `create()` if there is none, or with `create(slot)` for models that
+		 * depend on their slot. Retires slots that have not been needed for more
+		 * than `idleCallsBeforeRetire` consecutive calls. The delay keeps a
+		 * channel count that flickers from thrashing the allocator.
+		 */
+		template<typename Needed, typename Create>
+		void Prepare(Needed&& needed, Create&& create, int idleCallsBeforeRetire = 0)
+		{
+			const std::uint64_t epoch = _epoch.load();
+			for (int slot = 0; slot < Slots; ++slot)
+			{
+				if (_owned[slot] && _retiredAt[slot] != NotRetired && epoch > _retiredAt[slot])
+				{
+					_owned[slot].reset();
+					_retiredAt[slot] = NotRetired;
+				}
+
+				if (needed(slot))
+				{
+					_idleCalls[slot] = 0;
+					if (!_owned[slot])
+					{
+						if constexpr (std::is_invocable_v<Create&, int>)
+							_owned[slot] = create(slot);
+						else
+							_owned[slot] = create();
+					}
+					if (_retiredAt[slot] != NotRetired || !_published[slot].load(std::memory_order_relaxed))
+						Publish(slot, _owned[slot].get());
+					_retiredAt[slot] = NotRetired;
+				}
+				else if (_owned[slot] && _retiredAt[slot] == NotRetired &&
+					++_idleCalls[slot] > idleCallsBeforeRetire)
+				{
+					// Any process() call that still sees the model started no later than
+					// the epoch read after unpublishing it, so a larger epoch means that
+					// call has returned.
+					_published[slot].store(nullptr);
+					_retiredAt[slot] = _epoch.load();
+				}
+			}
+		}
+
+		/** Number of models currently allocated, including retired ones not yet freed. */
+		int OwnedCount() const
+		{
+			int count = 0;
+			for (const auto& model : _owned)
+				count += model ? 1 : 0;
+			return count;
+		}
+
+	private:
+		static constexpr std::uint32_t InvalidVersion = ~std::uint32_t{0};
+		static constexpr std::uint64_t NotRetired = ~std::uint64_t{0};
+
+		void Publish(int slot, Model* model)
+		{
+			// A new version makes the audio thread reconfigure the slot, even when
+			// an earlier model at the same address was freed in between. It is
+			// stored first: an Acquire() that sees the pointer then sees it too.
+			std::uint32_t version = _version[slot].load(std::memory_order_relaxed) + 1;
+			if (version == InvalidVersion)
+				version = 0;
+			_version[slot].store(version, std::memory_order_release);
+			_published[slot].store(model, std::memory_order_release);
+		}
+
+		std::atomic<std::uint64_t> _epoch{};
+		std::array<std::atomic<Model*>, Slots> _published{};
+		std::array<std::atomic<std::uint32_t>, Slots> _version{};
+
+		// Audio thread only.
+		std::array<std::uint32_t, Slots> _configuredVersion{};
+
+		// Preparer thread only.
+		std::array<std::unique_ptr<Model>, Slots> _owned{};
+		std::array<std::uint64_t, Slots> _retiredAt{ FilledRetiredAt() };
+		std::array<int, Slots> _idleCalls{};
+
+		static std::array<std::uint64_t, Slots> FilledRetiredAt()
+		{
+			std::array<std::uint64_t, Slots> values;
+			values.fill(NotRetired);
+			return values;
+		}
+	};
+
+	/**
+	 * The 2x and 4x model sets of a module with an oversampling menu.
+	 *
+	 * The preparer keeps models for the requested path and for the path still
+	 * playing; process() switches to the requested path only once every slot it
+	 * needs has been published, so a menu change never drops out, and the old
+	 * path is freed a little later. Path 0 is 2x, path 1 is 4x, matching the
+	 * modules' "oversampling" index.
+	 */
+	template<typename ModelX2, typename ModelX4, int Slots>
+	class OversamplingPaths
+	{
+	public:
+		// About two seconds of UI frames before an unused model is freed.
+		static constexpr int IdleCallsBeforeRetire = 120;
+
+		LazyModelSlots<ModelX2, Slots> x2;
+		LazyModelSlots<ModelX4, Slots> x4;
+
+		explicit OversamplingPaths(int active) : _active(active) {}
+
+		int Active() const { return _active.load(std::memory_order_relaxed); }
+
+		// --- Audio thread -------------------------------------------------------
+
+		/**
+		 * Starts a process() call and switches to `requested` if every slot for
+		 * which `needed(slot)` holds is ready on that path. Returns true on a
+		 * switch; the new path's models are reset at their next Acquire().
+		 */
+		template<typename Needed>
+		bool BeginProcess(int requested, Needed&& needed)
+		{
+			x2.BeginProcess();
+			x4.BeginProcess();
+			if (requested == Active())
+				return false;
+			for (int slot = 0; slot < Slots; ++slot)
+			{
+				if (needed(slot) && !(requested == 0 ? x2.Published(slot) : x4.Published(slot)))
+					return false;
+			}
+			if (requested == 0)
+				x2.Invalidate();
+			else
+				x4.Invalidate();
+			_active.store(requested, std::memory_order_relaxed);
+			return true;
+		}
+
+		void Invalidate()
+		{
+			x2.Invalidate();
+			x4.Invalidate();
+		}
+
+		/** Calls `apply` on every published model of both paths. */
+		template<typename Apply>
+		void ForEachPublished(Apply&& apply)
+		{
+			x2.ForEachPublished(apply);
+			x4.ForEachPublished(apply);
+		}
+
+		void Invalidate(int slot)
+		{
+			x2.Invalidate(slot);
+			x4.Invalidate(slot);
+		}
+
+		// --- Preparer thread ----------------------------------------------------
+
+		template<typename Needed, typename CreateX2, typename CreateX4>
+		void Prepare(int requested, Needed&& needed, CreateX2&& createX2, CreateX4&& createX4,
+			int idleCallsBeforeRetire = IdleCallsBeforeRetire)
+		{
+			const int active = Active();
+			const auto neededOn = [&](int path)
+			{
+				const bool used = path == requested || path == active;
+				return [&needed, used](int slot) { return used && needed(slot); };
+			};
+			x2.Prepare(neededOn(0), createX2, idleCallsBeforeRetire);
+			x4.Prepare(neededOn(1), createX4, idleCallsBeforeRetire);
+		}
+
+	private:
+		std::atomic<int> _active;
+	};
+}
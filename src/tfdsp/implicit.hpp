@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Dense>
+
+namespace tfdsp
+{
+	/** Iteration limit and convergence tolerance of a model's Newton solve.
+	 * Each model documents the units of its tolerance. */
+	struct NewtonSolverSettings
+	{
+		int maximumIterations{ 8 };
+		double tolerance{ 1.0e-11 };
+	};
+
+	// Most Newton iterations any quality tier asks for. Models with a
+	// compile-time iteration bound default to it.
+	constexpr int MaximumSolverIterations = 16;
+
+	template<int Dimension>
+	using ImplicitVector = Eigen::Matrix<double, Dimension, 1>;
+	template<int Dimension>
+	using ImplicitMatrix = Eigen::Matrix<double, Dimension, Dimension>;
+
+	/** Largest component magnitude. NaN components are skipped, so callers
+	 * must check finiteness of what they commit. */
+	template<int Dimension>
+	double MaximumMagnitude(const ImplicitVector<Dimension>& vector)
+	{
+		double maximum = 0.0;
+		for (int i = 0; i < Dimension; ++i)
+			maximum = std::max(maximum, std::abs(vector(i)));
+		return maximum;
+	}
+
+	/**
+	 * Solves matrix * x = rhs by Gaussian elimination with partial pivoting,
+	 * leaving x in `rhs` and destroying `matrix`. Returns false, with both
+	 * partly reduced, when a pivot is smaller than `minimumPivot` or not
+	 * finite. Two-dimensional systems, such as a transistor's pair of junction
+	 * exponents, take the shorter closed form, which rejects a determinant
+	 * smaller than `minimumPivot` squared.
+	 */
+	template<int Dimension>
+	bool SolveLinearInPlace(ImplicitMatrix<Dimension>& matrix,
+		ImplicitVector<Dimension>& rhs, double minimumPivot = 1.0e-14)
+	{
+		if constexpr (Dimension == 2)
+		{
+			// Cramer's rule, with the determinant standing in for the product
+			// of the two pivots.
+			const double determinant = matrix(0, 0) * matrix(1, 1) -
+				matrix(0, 1) * matrix(1, 0);
+			if (!(std::abs(determinant) >= minimumPivot * minimumPivot))
+				return false;
+			const double first = (rhs(0) * matrix(1, 1) - rhs(1) * matrix(0, 1)) /
+				determinant;
+			rhs(1) = (matrix(0, 0) * rhs(1) - matrix(1, 0) * rhs(0)) / determinant;
+			rhs(0) = first;
+			return true;
+		}
+
+		for (int column = 0; column < Dimension; ++column)
+		{
+			int pivot = column;
+			for (int row = column + 1; row < Dimension; ++row)
+			{
+				if (std::abs(matrix(row, column)) > std::abs(matrix(pivot, column)))
+					pivot = row;
+			}
+			if (!(std::abs(matrix(pivot, column)) >= minimumPivot))
+				return false;
+			if (pivot != column)
+			{
+				for (int i = column; i < Dimension; ++i)
+					std::swap(matrix(column, i), matrix(pivot, i));
+				std::swap(rhs(column), rhs(pivot));
+			}
+
+			for (int row = column + 1; row < Dimension; ++row)
+			{
+				const double factor = matrix(row, column) / matrix(column, column);
+				for (int i = column + 1; i < Dimension; ++i)
+					matrix(row, i) -= factor * matrix(column, i);
+				rhs(row) -= factor * rhs(column);
+			}
+		}
+
+		for (int row = Dimension - 1; row >= 0; --row)
+		{
+			double value = rhs(row);
+			for (int column = row + 1; column < Dimension; ++column)
+				value -= matrix(row, column) * rhs(column);
+			rhs(row) = value / matrix(row, row);
+		}
+		return true;
+	}
+
+	/** Takes full Newton steps. */
+	struct UndampedNewtonStep
+	{
+		template<int Dimension>
+		void operator()(ImplicitVector<Dimension>&) const {}
+	};
+
+	/** Shortens a Newton step so that no component exceeds `maximum`, which
+	 * keeps the iteration inside the region where the circuit's exponentials
+	 * and tanh() stages are well approximated by their tangents. */
+	struct MaximumNewtonStep
+	{
+		double maximum;
+
+		template<int Dimension>
+		void operator()(ImplicitVector<Dimension>& step) const
+		{
+			const double largest = MaximumMagnitude<Dimension>(step);
+			if (largest > maximum)
+				step *= maximum / largest;
+		}
+	};
+
+	enum class NewtonConvergence
+	{
+		// The largest residual component falls below the tolerance.
+		Residual,
+		// The largest component of a damped step falls below the tolerance.
+		Step,
+	};
+
+	struct NewtonTelemetry
+	{
+		// Residual evaluations, including the one that met the tolerance.
+		int iterations{};
+		bool converged{};
+	};
+
+	/**
+	 * Damped Newton iteration for a fixed-size implicit equation F(x) = 0.
+	 *
+	 * `residual(x, f)` writes F(x). `jacobian(x, J)` writes dF/dx and is only
+	 * called right after `residual` at the same x, so it may reuse values the
+	 * residual cached, such as the tanh() or exponential of each junction. `x`
+	 * starts at the caller's guess, typically the previous sample's solution,
+	 * and holds the last iterate on return whether or not it converged. A
+	 * Jacobian that SolveLinearInPlace() rejects at `minimumPivot` ends the
+	 * iteration unconverged.
+	 */
+	template<int Dimension, typename Residual, typename Jacobian,
+		typename Damping = UndampedNewtonStep>
+	NewtonTelemetry SolveNewton(ImplicitVector<Dimension>& x,
+		Residual&& residual, Jacobian&& jacobian,
+		const NewtonSolverSettings& settings, Damping damping = {},
+		NewtonConvergence convergence = NewtonConvergence::Residual,
+		double minimumPivot = 1.0e-14)
+	{
+		NewtonTelemetry telemetry;
+		ImplicitVector<Dimension> value;
+		ImplicitMatrix<Dimension> derivative;
+		while (telemetry.iterations < settings.maximumIterations)
+		{
+			++telemetry.iterations;
+			residual(static_cast<const ImplicitVector<Dimension>&>(x), value);
+			if (convergence == NewtonConvergence::Residual &&
+				MaximumMagnitude<Dimension>(value) < settings.tolerance)
+			{
+				telemetry.converged = true;
+				break;
+			}
+			jacobian(static_cast<const ImplicitVector<Dimension>&>(x), derivative);
+			value = -value;
+			if (!SolveLinearInPlace<Dimension>(derivative, value, minimumPivot))
+				break;
+			damping(value);
+			x += value;
+			if (convergence == NewtonConvergence::Step &&
+				MaximumMagnitude<Dimension>(value) < settings.tolerance)
+			{
+				telemetry.converged = true;
+				break;
+			}
+		}
+		return telemetry;
+	}
+
+	template<int Lanes>
+	using LaneVector = Eigen::Array<double, Lanes, 1>;
+	template<int Lanes>
+	using LaneMask = Eigen::Array<bool, Lanes, 1>;
+
+	template<int Lanes>
+	struct NewtonLanesTelemetry
+	{
+		// Residual evaluations of the slowest lane.
+		int iterations{};
+		LaneMask<Lanes> converged{ LaneMask<Lanes>::Constant(false) };
+	};
+
+	/**
+	 * Newton iteration for `Lanes` independent scalar equations F_j(x_j) = 0,
+	 * such as a bank of one-pole integrators.
+	 *
+	 * `residual(x, f)` writes every lane's F_j(x_j). `derivative(x, d)` writes
+	 * dF_j/dx_j and is only called right after `residual` at the same x, so it
+	 * may reuse what the residual cached. Both see the whole bank, so their
+	 * loops run over every lane and vectorize. A lane stops once its residual
+	 * magnitude falls below the tolerance, or unconverged once its step is not
+	 * finite; its x is then left alone while the others iterate.
+	 */
+	template<int Lanes, typename Residual, typename Derivative>
+	NewtonLanesTelemetry<Lanes> SolveNewtonLanes(LaneVector<Lanes>& x,
+		Residual&& residual, Derivative&& derivative,
+		const NewtonSolverSettings& settings)
+	{
+		NewtonLanesTelemetry<Lanes> telemetry;
+		LaneMask<Lanes> active = LaneMask<Lanes>::Constant(true);
+		LaneVector<Lanes> value;
+		LaneVector<Lanes> slope;
+		while (telemetry.iterations < settings.maximumIterations)
+		{
+			++telemetry.iterations;
+			residual(static_cast<const LaneVector<Lanes>&>(x), value);
+			const LaneMask<Lanes> met = value.abs() < settings.tolerance;
+			telemetry.converged = telemetry.converged || (active && met);
+			active = active && !met;
+			if (!active.any())
+				break;
+			derivative(static_cast<const LaneVector<Lanes>&>(x), slope);
+			const LaneVector<Lanes> step = -value / slope;
+			active = active && step.isFinite();
+			x = active.select(x + step, x);
+		}
+		return telemetry;
+	}
+}
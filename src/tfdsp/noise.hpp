@@ -2,50 +2,72 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <random>
 #include "approx.hpp"
 #include "filters.hpp"
+#include "random.hpp"
 
 
 /**
  * References:
  *  -Pinking filter for pink noise : https://ccrma.stanford.edu/~jos/sasp/Example_Synthesis_1_F_Noise.html
+ *  -Generator and Gaussian : see random.hpp
  */
 
 namespace tfdsp 
 {
+	/** Gaussian white noise from a 4 lane xoshiro128++ and a ziggurat. */
 	class WhiteNoiseSource
 	{
 	private:
-		std::random_device _seed{};
-		std::minstd_rand _rng;
-		std::normal_distribution<float> _gaussian{ 0.0, 1.0 };
+		static constexpr int Lanes = 4;
+		Xoshiro128PlusPlusLanes<Lanes> _rng{};
 	public:
-		WhiteNoiseSource() : _rng(_seed())
+		WhiteNoiseSource()
 		{
+			ZigguratGaussian::Prepare();
+		}
+		/** Make the sequence reproducible, e.g. for offline renders and benchmarks. */
+		void Seed(std::uint64_t seed)
+		{
+			_rng.Seed(seed);
 		}
 		float Step()
 		{
-			return _gaussian(_rng);
+			return ZigguratGaussian::Draw(_rng);
+		}
+		/** Fill a block with independent standard normal samples. */
+		void Process(float* out, int count)
+		{
+			ZigguratGaussian::Fill(_rng, out, count);
 		}
 		void Reset()
 		{
-			_gaussian.reset();
 		}
 	};
 
 	class PinkNoiseSource
 	{
 	private:
+		static constexpr int BlockSize = 32;
 		WhiteNoiseSource _white{};
 		FirstOrderLowPassZdf<float> _filter;
 		std::array<float, 4> _x{};
 		std::array<float, 4> _y{};
 		std::array<float, 4> _a{{ 1.0f, -2.494956002f, 2.017265875f, -0.522189400f }};
 		std::array<float, 4> _b{{ 0.049922035, -0.095993537, 0.050612699, -0.004408786 }};
+		std::array<float, BlockSize> _block{};
+		int _blockPosition{ BlockSize };
 	public:
 		PinkNoiseSource() {}
 
+		void Seed(std::uint64_t seed)
+		{
+			_white.Seed(seed);
+			_blockPosition = BlockSize;
+		}
+
 		float Filter3dbPerOctave(float x)
 		{
 			_x[0] = x;
@@ -62,10 +84,37 @@ namespace tfdsp
 			return y;
 		}
 
+		/** Generate a block of pink noise: the white samples are drawn in lanes,
+		 * then the pinking filter runs with its state held in locals.
+		 */
+		void Process(float* out, int count)
+		{
+			_white.Process(out, count);
+			float x1 = _x[1], x2 = _x[2], x3 = _x[3];
+			float y1 = _y[1], y2 = _y[2], y3 = _y[3];
+			for (int i = 0; i < count; ++i)
+			{
+				const float x = out[i];
+				float y = _b[0] * x;
+				y += _b[1] * x1 - _a[1] * y1;
+				y += _b[2] * x2 - _a[2] * y2;
+				y += _b[3] * x3 - _a[3] * y3;
+				x3 = x2; x2 = x1; x1 = x;
+				y3 = y2; y2 = y1; y1 = y;
+				out[i] = y;
+			}
+			_x[1] = x1; _x[2] = x2; _x[3] = x3;
+			_y[1] = y1; _y[2] = y2; _y[3] = y3;
+		}
+
 		float Step()
 		{
-			auto x = _white.Step();
-			return Filter3dbPerOctave(x);
+			if (_blockPosition >= BlockSize)
+			{
+				Process(_block.data(), BlockSize);
+				_blockPosition = 0;
+			}
+			return _block[_blockPosition++];
 		}
 		void Reset()
 		{
@@ -73,6 +122,7 @@ namespace tfdsp
 			_filter.Reset();
 			_x.fill(0.0f);
 			_y.fill(0.0f);
+			_blockPosition = BlockSize;
 		}
 	};
 	class detune
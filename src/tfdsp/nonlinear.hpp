@@ -10,61 +10,113 @@
  */
 namespace DiscreteGradient2
 {
+	// Below this input difference the difference quotient is replaced by its
+	// midpoint expansion, whose truncation error is O(d^4) and far below the
+	// cancellation error the quotient would have there.
 	template<typename Float>
-	struct _TanhEpsilon
+	struct _TanhMidpointThreshold
 	{
-		static constexpr Float Value = 1.0e-12;
+		static constexpr Float Value = 1.0e-3;
 	};
 	template<>
-	struct _TanhEpsilon<float>
+	struct _TanhMidpointThreshold<float>
 	{
-		static constexpr float Value = 1.0e-6f;
-	};
-	template<>
-	struct _TanhEpsilon<double>
-	{
-		static constexpr double Value = 1.0e-12;
+		static constexpr float Value = 1.0e-2f;
 	};
 
 	template<typename Float, int blockSize>
 	class Tanh
 	{
 	private:
-		static constexpr Float eps = _TanhEpsilon<Float>::Value;
-		static Float LogCosh(const Float x)
+		static constexpr Float midpointThreshold = _TanhMidpointThreshold<Float>::Value;
+		using Block = Eigen::Array<Float, blockSize, 1>;
+
+		// (logcosh(x) - logcosh(y)) / (x - y) with logcosh(x) = |x| + log1p(exp(-2|x|)) - log(2).
+		// The log(2) terms cancel and both log1p terms fuse into a single one:
+		//   log1p(ex) - log1p(ey) = log1p((ex - ey) / (1 + ey))
+		// which keeps full precision when both exponentials are tiny and never forms cosh(x).
+		static Float ValueLarge(const Float x, const Float xPrev)
 		{
-			// log(cosh(x)) without forming cosh(x), which overflows for large |x|.
 			const Float ax = std::abs(x);
-			return ax + std::log1p(std::exp(-Float(2) * ax)) - std::log(Float(2));
+			const Float ay = std::abs(xPrev);
+			const Float ex = std::exp(-Float(2) * ax);
+			const Float ey = std::exp(-Float(2) * ay);
+			return (ax - ay + std::log1p((ex - ey) / (Float(1) + ey))) / (x - xPrev);
 		}
-		static Float ValueLarge(const Float x, const Float xPrev)
+		// Midpoint expansion of the discrete gradient:
+		//   tanh(m) + d^2 / 24 * tanh''(m) = t - d^2 / 12 * t * sech^2(m)
+		// tanh and sech^2 share the exponential exp(-2|m|).
+		static Float ValueMidpoint(const Float x, const Float xPrev)
 		{
-			return (LogCosh(x) - LogCosh(xPrev)) / (x - xPrev);
+			const Float m = Float(0.5) * (x + xPrev);
+			const Float d = x - xPrev;
+			const Float e = std::exp(-Float(2) * std::abs(m));
+			const Float inverse = Float(1) / (Float(1) + e);
+			const Float t = std::copysign((Float(1) - e) * inverse, m);
+			const Float sech2 = Float(4) * e * inverse * inverse;
+			return t - d * d / Float(12) * t * sech2;
+		}
+		// Derivative of the midpoint expansion with respect to x. Its error is
+		// O(d^2), where the difference quotient would lose digits to
+		// cancellation.
+		static Float DerivativeMidpoint(const Float x, const Float xPrev)
+		{
+			const Float d = x - xPrev;
+			const Float t = std::tanh(Float(0.5) * (x + xPrev));
+			const Float sech2 = Float(1) - t * t;
+			return Float(0.5) * sech2 - d / Float(6) * t * sech2;
 		}
 
 	public:
 		static Float Value(const Float x, const Float xPrev)
 		{
-			return std::abs(x - xPrev) <= eps ?
-				std::tanh(0.5*(x + xPrev)) :
+			return std::abs(x - xPrev) <= midpointThreshold ?
+				ValueMidpoint(x, xPrev) :
 				ValueLarge(x, xPrev);
 		}
-		static Eigen::Array<Float, blockSize, 1> Value(const Eigen::Array<Float, blockSize, 1>&x, const Eigen::Array<Float, blockSize,1>& xPrev)
+		// Lane-wise Value(): both forms are evaluated for every lane and the
+		// threshold selects between them, so the loops vectorize.
+		static Block Value(const Block& x, const Block& xPrev)
 		{
-			Eigen::Array<Float, blockSize, 1> result;
-			for (int i = 0; i < blockSize; ++i)
-				result(i) = Value(x(i), xPrev(i));
-			return result;
+			const Block d = x - xPrev;
+			const Block m = Float(0.5) * (x + xPrev);
+			const Block em = (Float(-2) * m.abs()).exp();
+			const Block inverse = (Float(1) + em).inverse();
+			const Block t = m.sign() * (Float(1) - em) * inverse;
+			const Block midpoint = t - d.square() / Float(12) * t *
+				(Float(4) * em * inverse.square());
+
+			const Block ax = x.abs();
+			const Block ay = xPrev.abs();
+			const Block ex = (Float(-2) * ax).exp();
+			const Block ey = (Float(-2) * ay).exp();
+			const Block large = (ax - ay + ((ex - ey) / (Float(1) + ey)).log1p()) / d;
+			return (d.abs() <= midpointThreshold).select(midpoint, large);
 		}
 		static Float Derivative(const Float x, const Float xPrev)
 		{
-			if (std::abs(x - xPrev) <= eps)
-			{
-				auto t = std::tanh(0.5*(x + xPrev));
-				return 0.5*(1.0 - t * t);
-			}
+			if (std::abs(x - xPrev) <= midpointThreshold)
+				return DerivativeMidpoint(x, xPrev);
 			return (std::tanh(x) - ValueLarge(x, xPrev)) / (x - xPrev);
 		}
+		// Derivative with respect to x, reusing value = Value(x, xPrev). Near
+		// xPrev it differentiates the midpoint expansion instead.
+		static Float Derivative(const Float x, const Float xPrev, const Float value)
+		{
+			const Float d = x - xPrev;
+			if (std::abs(d) > midpointThreshold)
+				return (std::tanh(x) - value) / d;
+			return DerivativeMidpoint(x, xPrev);
+		}
+		// Lane-wise Derivative(x, xPrev, value).
+		static Block Derivative(const Block& x, const Block& xPrev, const Block& value)
+		{
+			const Block d = x - xPrev;
+			const Block t = (Float(0.5) * (x + xPrev)).tanh();
+			const Block sech2 = Float(1) - t.square();
+			const Block midpoint = Float(0.5) * sech2 - d / Float(6) * t * sech2;
+			return (d.abs() > midpointThreshold).select((x.tanh() - value) / d, midpoint);
+		}
 	};
 	template<typename Float, int blockSize>
 	class TanhBlock
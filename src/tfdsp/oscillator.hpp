@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 #include "tfdsp/minblep.hpp"
 
@@ -47,19 +48,103 @@ OversampledEvent MapEventToOversampledFrame(double framePosition)
 	return {segment, std::clamp(scaled - segment, 0.0, 1.0)};
 }
 
+/** Oscillator phase stored as a double in [0, 1).
+ *
+ * Wraps use floor(), and increments of any size are accepted.
+ */
+struct FloatingPhase
+{
+	using State = double;
+	// Outputs are checked for non-finite values, which very large increments
+	// can produce.
+	static constexpr bool GuardOutput = true;
+
+	static State FromCycles(double phase) { return phase - std::floor(phase); }
+	static double Cycles(State phase) { return phase; }
+	/** The increment that Advance() actually applies. Advance() must be
+	 * given increments that have been through this function. */
+	static double Increment(double increment) { return increment; }
+	static State Advance(State phase, double increment)
+	{
+		return FromCycles(phase + increment);
+	}
+	/** Wrapped distance from `offset` forward to `phase`. */
+	static State Subtract(State phase, State offset)
+	{
+		return FromCycles(phase - offset);
+	}
+	/** The last phase before a forward wrap, where reverse hard sync resets. */
+	static State LastBeforeWrap() { return std::nextafter(1.0, 0.0); }
+};
+
+/** Oscillator phase in 32 bit fixed point, one cycle being 2^32 steps.
+ *
+ * Wraps come from unsigned overflow, so advancing needs no floor() and the
+ * phase sequence is bit-identical on every platform. Increments are rounded
+ * to whole steps and limited to half a cycle either way, the Nyquist limit of
+ * a band-limited oscillator. Every phase and increment is then exactly
+ * representable as a double, so event positions computed from them are exact
+ * and each call handles at most one wrap. The state is a plain uint32_t,
+ * which arrays of voices can advance in SIMD lanes.
+ */
+struct FixedPhase
+{
+	using State = std::uint32_t;
+	static constexpr bool GuardOutput = false;
+	static constexpr double StepsPerCycle = 4294967296.0;
+	static constexpr std::int64_t MaximumSteps = (std::int64_t{1} << 31) - 1;
+
+	static State FromCycles(double phase)
+	{
+		const double wrapped = phase - std::floor(phase);
+		return static_cast<State>(static_cast<std::uint64_t>(
+			wrapped * StepsPerCycle));
+	}
+
+	static double Cycles(State phase) { return phase * (1.0 / StepsPerCycle); }
+
+	/** Rounds to the nearest step by truncation, which compiles to a single
+	 * conversion instead of a libm call and survives -funsafe-math. */
+	static std::int64_t Steps(double increment)
+	{
+		const double steps = std::clamp(increment * StepsPerCycle,
+			-static_cast<double>(MaximumSteps), static_cast<double>(MaximumSteps));
+		return static_cast<std::int64_t>(steps + (steps < 0.0 ? -0.5 : 0.5));
+	}
+
+	static double Increment(double increment)
+	{
+		return static_cast<double>(Steps(increment)) * (1.0 / StepsPerCycle);
+	}
+
+	/** Takes an increment returned by Increment(), so the conversion is exact. */
+	static State Advance(State phase, double increment)
+	{
+		return phase + static_cast<State>(
+			static_cast<std::int64_t>(increment * StepsPerCycle));
+	}
+
+	/** Wrapped distance from `offset` forward to `phase`. Unlike Advance(),
+	 * it covers the whole cycle. */
+	static State Subtract(State phase, State offset) { return phase - offset; }
+
+	static State LastBeforeWrap() { return ~State{}; }
+};
+
 /** Through-zero saw oscillator with fractional hard sync.
  *
  * Ordinary phase wraps use a short polyBLEP. A hard reset can have any step
  * height, so it and any wrap in the same sample are reconstructed with a
  * minimum-phase band-limited step at their exact sub-sample positions.
  */
-template<int MinBlepZeroCrossings = 8, int MinBlepTableOversampling = 32>
+template<int MinBlepZeroCrossings = 8, int MinBlepTableOversampling = 32,
+	typename PhaseType = FloatingPhase>
 class BandlimitedSawOscillator
 {
 public:
 	void Reset(double phase = 0.0)
 	{
-		_phase = WrapPhase(std::isfinite(phase) ? phase : 0.0);
+		_phase = PhaseType::FromCycles(std::isfinite(phase) ? phase : 0.0);
 		_discontinuityBlep.Reset();
 	}
 
@@ -68,27 +153,23 @@ public:
 		if (!std::isfinite(phaseIncrement))
 			return 0.0;
 		const double antiAliasIncrement = AdvanceWithSync(
-			phaseIncrement, syncPosition);
-		const double saw = 2.0 * _phase - 1.0 -
-			SignedPolyBlep(_phase, antiAliasIncrement) +
+			PhaseType::Increment(phaseIncrement), syncPosition);
+		const double phase = PhaseType::Cycles(_phase);
+		const double saw = 2.0 * phase - 1.0 -
+			SignedPolyBlep(phase, antiAliasIncrement) +
 			_discontinuityBlep.Process();
-		if (std::isfinite(saw))
+		if (!PhaseType::GuardOutput || std::isfinite(saw))
 			return saw;
 		Reset();
 		return 0.0;
 	}
 
-	double Phase() const { return _phase; }
+	double Phase() const { return PhaseType::Cycles(_phase); }
 
 private:
 	MinBlepGenerator<MinBlepZeroCrossings,
 		MinBlepTableOversampling, double> _discontinuityBlep;
-	double _phase{};
-
-	static double WrapPhase(double phase)
-	{
-		return phase - std::floor(phase);
-	}
+	typename PhaseType::State _phase{};
 
 	static double PolyBlep(double phase, double increment)
 	{
@@ -119,7 +200,8 @@ private:
 	void AdvanceBandlimited(double increment, double startPosition,
 		double endPosition)
 	{
-		const double startPhase = _phase;
+		increment = PhaseType::Increment(increment);
+		const double startPhase = PhaseType::Cycles(_phase);
 		const double endPhase = startPhase + increment;
 		if (increment > 0.0 && endPhase >= 1.0)
 		{
@@ -135,21 +217,22 @@ private:
 				(endPosition - startPosition);
 			_discontinuityBlep.InsertDiscontinuity(eventPosition - 1.0, 2.0);
 		}
-		_phase = WrapPhase(endPhase);
+		_phase = PhaseType::Advance(_phase, increment);
 	}
 
 	double AdvanceWithSync(double increment, double syncPosition)
 	{
 		if (!(syncPosition >= 0.0 && syncPosition <= 1.0))
 		{
-			_phase = WrapPhase(_phase + increment);
+			_phase = PhaseType::Advance(_phase, increment);
 			return increment;
 		}
 
 		AdvanceBandlimited(increment * syncPosition, 0.0, syncPosition);
-		const double resetPhase = increment < 0.0 ?
-			std::nextafter(1.0, 0.0) : 0.0;
-		const double discontinuity = 2.0 * (resetPhase - _phase);
+		const auto resetPhase = increment < 0.0 ?
+			PhaseType::LastBeforeWrap() : typename PhaseType::State{};
+		const double discontinuity = 2.0 * (PhaseType::Cycles(resetPhase) -
+			PhaseType::Cycles(_phase));
 		_discontinuityBlep.InsertDiscontinuity(
 			syncPosition - 1.0, discontinuity);
 		const double remainingIncrement = increment * (1.0 - syncPosition);
@@ -167,7 +250,8 @@ private:
  * sub-sample positions. Duty cycle is interpolated linearly over each call,
  * matching a comparator threshold driven by a reconstructed control signal.
  */
-template<int MinBlepZeroCrossings = 8, int MinBlepTableOversampling = 32>
+template<int MinBlepZeroCrossings = 8, int MinBlepTableOversampling = 32,
+	typename PhaseType = FloatingPhase>
 class BandlimitedPulseOscillator
 {
 public:
@@ -176,7 +260,7 @@ public:
 
 	void Reset(double phase = 0.0)
 	{
-		_phase = WrapPhase(std::isfinite(phase) ? phase : 0.0);
+		_phase = PhaseType::FromCycles(std::isfinite(phase) ? phase : 0.0);
 		_dutyCycle = 0.5;
 		_dutyInitialized = false;
 		_discontinuityBlep.Reset();
@@ -191,6 +275,7 @@ public:
 			return 0.0;
 		}
 
+		phaseIncrement = PhaseType::Increment(phaseIncrement);
 		const double nextDuty = ClampDutyCycle(dutyCycle);
 		if (!_dutyInitialized)
 		{
@@ -204,21 +289,21 @@ public:
 			AdvanceContinuous(phaseIncrement, _dutyCycle, nextDuty, 0.0, 1.0);
 
 		_dutyCycle = nextDuty;
-		const double pulse = RawPulse(_phase, _dutyCycle) +
+		const double pulse = RawPulse(PhaseType::Cycles(_phase), _dutyCycle) +
 			_discontinuityBlep.Process();
-		if (std::isfinite(pulse))
+		if (!PhaseType::GuardOutput || std::isfinite(pulse))
 			return pulse;
 		Reset();
 		return 0.0;
 	}
 
-	double Phase() const { return _phase; }
+	double Phase() const { return PhaseType::Cycles(_phase); }
 	double DutyCycle() const { return _dutyCycle; }
 
 private:
 	MinBlepGenerator<MinBlepZeroCrossings,
 		MinBlepTableOversampling, double> _discontinuityBlep;
-	double _phase{};
+	typename PhaseType::State _phase{};
 	double _dutyCycle{0.5};
 	bool _dutyInitialized{};
 
@@ -227,11 +312,6 @@ private:
 		return std::clamp(dutyCycle, MinimumDutyCycle, MaximumDutyCycle);
 	}
 
-	static double WrapPhase(double phase)
-	{
-		return phase - std::floor(phase);
-	}
-
 	static double RawPulse(double phase, double dutyCycle)
 	{
 		return phase < dutyCycle ? 1.0 : -1.0;
@@ -280,7 +360,8 @@ private:
 		if (!(endPosition > startPosition))
 			return;
 
-		const double unwrappedStart = _phase;
+		phaseIncrement = PhaseType::Increment(phaseIncrement);
+		const double unwrappedStart = PhaseType::Cycles(_phase);
 		const double unwrappedEnd = unwrappedStart + phaseIncrement;
 		const double comparatorStart = unwrappedStart - startDuty;
 		const double comparatorEnd = unwrappedEnd - endDuty;
@@ -306,7 +387,7 @@ private:
 					(endPosition - startPosition), wrapStep);
 			});
 
-		_phase = WrapPhase(unwrappedEnd);
+		_phase = PhaseType::Advance(_phase, phaseIncrement);
 	}
 
 	void AdvanceWithSync(double phaseIncrement, double nextDuty,
@@ -317,10 +398,10 @@ private:
 		AdvanceContinuous(phaseIncrement * syncPosition, _dutyCycle,
 			syncDuty, 0.0, syncPosition);
 
-		const double pulseBefore = RawPulse(_phase, syncDuty);
-		const double resetPhase = phaseIncrement < 0.0 ?
-			std::nextafter(1.0, 0.0) : 0.0;
-		const double pulseAfter = RawPulse(resetPhase, syncDuty);
+		const double pulseBefore = RawPulse(PhaseType::Cycles(_phase), syncDuty);
+		const auto resetPhase = phaseIncrement < 0.0 ?
+			PhaseType::LastBeforeWrap() : typename PhaseType::State{};
+		const double pulseAfter = RawPulse(PhaseType::Cycles(resetPhase), syncDuty);
 		InsertStep(syncPosition, pulseAfter - pulseBefore);
 		_phase = resetPhase;
 
@@ -334,12 +415,13 @@ private:
 	 * Its wrap and comparator edges use polyBLEP correction. This is preferable
 	 * to the event-buffered PWM oscillator when duty is fixed and sync is absent.
  */
+template<typename PhaseType = FloatingPhase>
 class BandlimitedFixedPulseOscillator
 {
 public:
 	void Reset(double phase = 0.0)
 	{
-		_phase = WrapPhase(std::isfinite(phase) ? phase : 0.0);
+		_phase = PhaseType::FromCycles(std::isfinite(phase) ? phase : 0.0);
 	}
 
 	double Step(double phaseIncrement, double dutyCycle = 0.5)
@@ -349,24 +431,22 @@ public:
 			Reset();
 			return 0.0;
 		}
-		const double increment = std::clamp(phaseIncrement, 0.0, 0.45);
-		const double duty = std::clamp(dutyCycle, 0.05, 0.95);
-		_phase = WrapPhase(_phase + increment);
-		const double comparatorPhase = WrapPhase(_phase - duty);
+		const double increment = PhaseType::Increment(
+			std::clamp(phaseIncrement, 0.0, 0.45));
+		const auto duty = PhaseType::FromCycles(std::clamp(dutyCycle, 0.05, 0.95));
+		_phase = PhaseType::Advance(_phase, increment);
+		const double phase = PhaseType::Cycles(_phase);
+		const double comparatorPhase = PhaseType::Cycles(
+			PhaseType::Subtract(_phase, duty));
 		const double output = (_phase < duty ? 1.0 : -1.0) +
-			PolyBlep(_phase, increment) - PolyBlep(comparatorPhase, increment);
-		return std::isfinite(output) ? output : 0.0;
+			PolyBlep(phase, increment) - PolyBlep(comparatorPhase, increment);
+		return !PhaseType::GuardOutput || std::isfinite(output) ? output : 0.0;
 	}
 
-	double Phase() const { return _phase; }
+	double Phase() const { return PhaseType::Cycles(_phase); }
 
 private:
-	double _phase{};
-
-	static double WrapPhase(double phase)
-	{
-		return phase - std::floor(phase);
-	}
+	typename PhaseType::State _phase{};
 
 	static double PolyBlep(double phase, double increment)
 	{
@@ -393,14 +473,15 @@ private:
  * The correction is causal with one sample of latency; OutputPhase() exposes
  * the correspondingly delayed phase so another waveform can remain aligned.
  */
+template<typename PhaseType = FloatingPhase>
 class BandlimitedTriangleOscillator
 {
 public:
 	void Reset(double phase = 0.0)
 	{
-		_phase = WrapPhase(std::isfinite(phase) ? phase : 0.0);
+		_phase = PhaseType::FromCycles(std::isfinite(phase) ? phase : 0.0);
 		_outputPhase = _phase;
-		_nextSample = RawTriangle(_phase);
+		_nextSample = RawTriangle(PhaseType::Cycles(_phase));
 	}
 
 	double Step(double phaseIncrement)
@@ -411,11 +492,12 @@ public:
 			return 0.0;
 		}
 
+		phaseIncrement = PhaseType::Increment(phaseIncrement);
 		double output = _nextSample;
 		_nextSample = 0.0;
 		_outputPhase = _phase;
 
-		const double start = _phase;
+		const double start = PhaseType::Cycles(_phase);
 		const double end = start + phaseIncrement;
 		ForEachCorner(start, end, [&](double corner, bool integerCorner)
 		{
@@ -435,16 +517,16 @@ public:
 				derivativeJump;
 		});
 
-		_phase = WrapPhase(end);
-		_nextSample += RawTriangle(_phase);
-		if (std::isfinite(output))
+		_phase = PhaseType::Advance(_phase, phaseIncrement);
+		_nextSample += RawTriangle(PhaseType::Cycles(_phase));
+		if (!PhaseType::GuardOutput || std::isfinite(output))
 			return output;
 		Reset();
 		return 0.0;
 	}
 
-	double Phase() const { return _phase; }
-	double OutputPhase() const { return _outputPhase; }
+	double Phase() const { return PhaseType::Cycles(_phase); }
+	double OutputPhase() const { return PhaseType::Cycles(_outputPhase); }
 
 	static double RawTriangle(double phase)
 	{
@@ -453,8 +535,8 @@ public:
 	}
 
 private:
-	double _phase{};
-	double _outputPhase{};
+	typename PhaseType::State _phase{};
+	typename PhaseType::State _outputPhase{};
 	double _nextSample{-1.0};
 
 	static double WrapPhase(double phase)
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRIGGERFISH_PROFILE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRIGGERFISH_PROFILE_RDTSC 1
+#endif
+
+/**
+ * Opt-in hot path instrumentation.
+ *
+ * Build with TRIGGERFISH_PROFILE defined (make TRIGGERFISH_PROFILE=1, or
+ * -DTRIGGERFISH_PROFILE=ON with CMake) to time the resamplers, solvers,
+ * envelopes and output stages. A module opens TF_PROFILE_MODULE(counters) at
+ * the top of process(); every TF_PROFILE_SCOPE reached on that thread until
+ * process() returns is charged to that module. Scopes record exclusive time,
+ * a nested scope is subtracted from its parent, so the sections add up to
+ * the module total. Without TRIGGERFISH_PROFILE the macros expand to nothing.
+ *
+ * A scope reads the clock twice, so it wraps a model's work for one host
+ * sample, such as all of its upsampling or its whole oversampled loop, and
+ * never a function called once per oversampled sample. Work inside such a
+ * loop, e.g. the output rails, is charged to the loop's section. DSP headers
+ * include profile_scope.hpp, which only pulls in this header when profiling.
+ */
+namespace tfdsp
+{
+	enum class ProfileSection
+	{
+		Other,
+		Resampling,
+		Solver,
+		Envelope,
+		OutputStage,
+		Count,
+	};
+
+	inline const char* ProfileSectionName(ProfileSection section)
+	{
+		switch (section)
+		{
+		case ProfileSection::Resampling: return "resampling";
+		case ProfileSection::Solver: return "solver";
+		case ProfileSection::Envelope: return "envelope";
+		case ProfileSection::OutputStage: return "output_stage";
+		default: return "other";
+		}
+	}
+
+#if defined(TRIGGERFISH_PROFILE_RDTSC)
+	inline std::uint64_t ProfileTicks() { return __rdtsc(); }
+	constexpr const char* ProfileTickUnit = "cycles";
+#else
+	inline std::uint64_t ProfileTicks()
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+	constexpr const char* ProfileTickUnit = "ns";
+#endif
+
+	/** Per-module tick accumulators.
+	 *
+	 * Only the thread running the module's process() writes, so updates are
+	 * relaxed load/store pairs rather than read-modify-write instructions. The
+	 * UI reads a snapshot at any time and requests resets through a flag the
+	 * audio thread honors at its next sample.
+	 */
+	class ProfileCounters
+	{
+	public:
+		static constexpr int SectionCount = static_cast<int>(ProfileSection::Count);
+
+		struct Snapshot
+		{
+			std::array<std::uint64_t, SectionCount> ticks{};
+			std::uint64_t samples{};
+
+			std::uint64_t TotalTicks() const
+			{
+				std::uint64_t total = 0;
+				for (const auto value : ticks)
+					total += value;
+				return total;
+			}
+		};
+
+		void Add(ProfileSection section, std::uint64_t ticks)
+		{
+			auto& counter = _ticks[static_cast<int>(section)];
+			counter.store(counter.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+		}
+
+		void BeginSample()
+		{
+			if (_resetRequested.exchange(false, std::memory_order_acquire))
+			{
+				for (auto& counter : _ticks)
+					counter.store(0, std::memory_order_relaxed);
+				_samples.store(0, std::memory_order_relaxed);
+			}
+			_samples.store(_samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		void RequestReset() { _resetRequested.store(true, std::memory_order_release); }
+
+		Snapshot Read() const
+		{
+			Snapshot snapshot;
+			for (int i = 0; i < SectionCount; ++i)
+				snapshot.ticks[i] = _ticks[i].load(std::memory_order_relaxed);
+			snapshot.samples = _samples.load(std::memory_order_relaxed);
+			return snapshot;
+		}
+
+		/** Per-section ticks per sample and share of the module total. */
+		std::string ToJson(const std::string& module) const
+		{
+			const Snapshot snapshot = Read();
+			const double samples = static_cast<double>(std::max<std::uint64_t>(snapshot.samples, 1));
+			const double total = static_cast<double>(std::max<std::uint64_t>(snapshot.TotalTicks(), 1));
+			std::string json = "{\n  \"module\": \"" + module + "\",\n  \"unit\": \"" +
+				ProfileTickUnit + "\",\n  \"samples\": " + std::to_string(snapshot.samples) +
+				",\n  \"sections\": {\n";
+			for (int i = 0; i < SectionCount; ++i)
+			{
+				char line[160];
+				std::snprintf(line, sizeof(line),
+					"    \"%s\": {\"per_sample\": %.2f, \"percent\": %.2f}%s\n",
+					ProfileSectionName(static_cast<ProfileSection>(i)), snapshot.ticks[i] / samples,
+					100.0 * snapshot.ticks[i] / total, i + 1 < SectionCount ? "," : "");
+				json += line;
+			}
+			char totalLine[96];
+			std::snprintf(totalLine, sizeof(totalLine), "  },\n  \"total_per_sample\": %.2f\n}\n",
+				snapshot.TotalTicks() / samples);
+			return json + totalLine;
+		}
+
+	private:
+		std::array<std::atomic<std::uint64_t>, SectionCount> _ticks{};
+		std::atomic<std::uint64_t> _samples{};
+		std::atomic<bool> _resetRequested{};
+	};
+
+	namespace profile_detail
+	{
+		inline thread_local ProfileCounters* current = nullptr;
+		inline thread_local std::uint64_t childTicks = 0;
+	}
+
+	/** Charges the exclusive time of its lifetime to the current module, if any. */
+	class ProfileScope
+	{
+		ProfileCounters* _counters;
+		ProfileSection _section;
+		std::uint64_t _start{};
+		std::uint64_t _parentChildTicks{};
+
+	public:
+		explicit ProfileScope(ProfileSection section)
+			: _counters(profile_detail::current), _section(section)
+		{
+			if (!_counters)
+				return;
+			_parentChildTicks = profile_detail::childTicks;
+			profile_detail::childTicks = 0;
+			_start = ProfileTicks();
+		}
+
+		~ProfileScope()
+		{
+			if (!_counters)
+				return;
+			const std::uint64_t elapsed = ProfileTicks() - _start;
+			_counters->Add(_section, elapsed - std::min(profile_detail::childTicks, elapsed));
+			profile_detail::childTicks = _parentChildTicks + elapsed;
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+	};
+
+	/** Routes the scopes of one process() call to a module's counters. Time not
+	 * covered by a nested scope is charged to ProfileSection::Other. */
+	class ProfileModuleScope
+	{
+		ProfileCounters* _previous;
+		ProfileScope _other;
+
+		static ProfileCounters* Enter(ProfileCounters& counters)
+		{
+			ProfileCounters* previous = profile_detail::current;
+			counters.BeginSample();
+			profile_detail::current = &counters;
+			return previous;
+		}
+
+	public:
+		explicit ProfileModuleScope(ProfileCounters& counters)
+			: _previous(Enter(counters)), _other(ProfileSection::Other)
+		{
+		}
+
+		~ProfileModuleScope()
+		{
+			// _other still holds its counters and is destroyed after this body.
+			profile_detail::current = _previous;
+		}
+
+		ProfileModuleScope(const ProfileModuleScope&) = delete;
+		ProfileModuleScope& operator=(const ProfileModuleScope&) = delete;
+	};
+}
+
+#include "profile_scope.hpp"
@@ -0,0 +1,20 @@
+#pragma once
+
+/**
+ * TF_PROFILE_SCOPE and TF_PROFILE_MODULE, see profile.hpp. DSP headers include
+ * this rather than profile.hpp, so a normal build neither compiles the
+ * counters nor pulls in their clock and string headers.
+ */
+#define TF_PROFILE_JOIN_IMPL(a, b) a##b
+#define TF_PROFILE_JOIN(a, b) TF_PROFILE_JOIN_IMPL(a, b)
+#ifdef TRIGGERFISH_PROFILE
+#include "profile.hpp"
+
+#define TF_PROFILE_SCOPE(section) \
+	::tfdsp::ProfileScope TF_PROFILE_JOIN(tfProfileScope, __LINE__)(::tfdsp::ProfileSection::section)
+#define TF_PROFILE_MODULE(counters) \
+	::tfdsp::ProfileModuleScope TF_PROFILE_JOIN(tfProfileModule, __LINE__)(counters)
+#else
+#define TF_PROFILE_SCOPE(section) static_cast<void>(0)
+#define TF_PROFILE_MODULE(counters) static_cast<void>(0)
+#endif
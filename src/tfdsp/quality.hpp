@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "implicit.hpp"
+
+namespace tfdsp
+{
+	/**
+	 * Accuracy against CPU for the solver-based modules, chosen per instance
+	 * from the context menu. Standard is the modules' historical behaviour.
+	 * Eco loosens the solvers and drops to 2x oversampling for dense live
+	 * patches; Reference tightens them and runs 4x for rendering.
+	 */
+	enum class QualityTier
+	{
+		Eco,
+		Standard,
+		Reference,
+	};
+
+	constexpr std::array<const char*, 3> QualityTierLabels{{
+		"Eco (2x, relaxed solvers)",
+		"Standard (4x)",
+		"Reference (4x, tight solvers)",
+	}};
+
+	/** Substepping of the Van der Pol split integrator. */
+	struct VdpSubstepSettings
+	{
+		// Most substeps one oversampled step may take.
+		int maximumSubsteps{ 24 };
+		// Largest damping phase, mu times the phase advance, of one substep.
+		double maximumDampingPhase{ 0.4 };
+	};
+
+	struct QualitySettings
+	{
+		// Residual of the ARP 4072 and TB-303 diode ladders, in volts.
+		NewtonSolverSettings ladderFilter;
+		// Newton step of the TB-303 Q8 junction exponents, in thermal voltages.
+		NewtonSolverSettings squareShaper;
+		// Newton residual of the VCA's audio and cv integrators, in volts.
+		NewtonSolverSettings vcaIntegrator;
+		// Substeps of the Van der Pol split integrator.
+		VdpSubstepSettings vanDerPol;
+		// Oversampling menu index selected with the tier: 0 is 2x, 1 is 4x.
+		int oversampling{ 1 };
+	};
+
+	constexpr QualitySettings QualitySettingsFor(QualityTier tier)
+	{
+		switch (tier)
+		{
+		case QualityTier::Eco:
+			return { { 4, 1.0e-8 }, { 6, 1.0e-3 }, { 4, 1.0e-5 }, { 12, 0.8 }, 0 };
+		case QualityTier::Reference:
+			return { { MaximumSolverIterations, 1.0e-13 },
+				{ MaximumSolverIterations, 1.0e-7 },
+				{ MaximumSolverIterations, 1.0e-9 }, { 48, 0.2 }, 1 };
+		case QualityTier::Standard:
+			break;
+		}
+		return { { 8, 1.0e-11 }, { 8, 1.0e-4 }, { 8, 1.0e-6 }, { 24, 0.4 }, 1 };
+	}
+
+	/** The tier stored under a menu or patch index, clamped to a valid one. */
+	inline QualityTier QualityTierAt(int index)
+	{
+		return static_cast<QualityTier>(std::clamp(index, 0,
+			static_cast<int>(QualityTierLabels.size()) - 1));
+	}
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/**
+ * References:
+ *  -xoshiro128++ : D. Blackman, S. Vigna, Scrambled Linear Pseudorandom Number Generators, 2018, https://prng.di.unimi.it/
+ *  -splitmix64 seeding : https://prng.di.unimi.it/splitmix64.c
+ *  -Ziggurat : G. Marsaglia, W. W. Tsang, The Ziggurat Method for Generating Random Variables, J. Stat. Softw. 2000
+ */
+
+namespace tfdsp
+{
+	/** Expand a 64 bit seed into well mixed state words. */
+	class SplitMix64
+	{
+		std::uint64_t _state;
+	public:
+		explicit SplitMix64(std::uint64_t seed) : _state(seed) {}
+		std::uint64_t operator()()
+		{
+			std::uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			return z ^ (z >> 31);
+		}
+	};
+
+	/** xoshiro128++ running Lanes independent streams in lockstep.
+	 *
+	 * The state is stored structure-of-arrays so the per-lane update in Next()
+	 * is plain 32 bit integer arithmetic that compilers vectorize. With
+	 * Lanes == 1 the class is a UniformRandomBitGenerator and can replace
+	 * std::minstd_rand in the standard distributions and the drift processes.
+	 */
+	template<int Lanes>
+	class Xoshiro128PlusPlusLanes
+	{
+		static_assert(Lanes >= 1, "at least one lane is required");
+		std::array<std::uint32_t, Lanes> _s0{};
+		std::array<std::uint32_t, Lanes> _s1{};
+		std::array<std::uint32_t, Lanes> _s2{};
+		std::array<std::uint32_t, Lanes> _s3{};
+
+		static std::uint32_t Rotl(std::uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+	public:
+		using result_type = std::uint32_t;
+		static constexpr int LaneCount = Lanes;
+
+		/** Seeded from std::random_device, use Seed() for reproducible streams. */
+		Xoshiro128PlusPlusLanes()
+		{
+			std::random_device device;
+			Seed((static_cast<std::uint64_t>(device()) << 32) ^ device());
+		}
+		explicit Xoshiro128PlusPlusLanes(std::uint64_t seed)
+		{
+			Seed(seed);
+		}
+
+		/** Deterministically (re)seed every lane, lanes receive distinct streams. */
+		void Seed(std::uint64_t seed)
+		{
+			SplitMix64 mixer(seed);
+			for (int lane = 0; lane < Lanes; ++lane)
+			{
+				const std::uint64_t a = mixer();
+				const std::uint64_t b = mixer();
+				_s0[lane] = static_cast<std::uint32_t>(a);
+				_s1[lane] = static_cast<std::uint32_t>(a >> 32);
+				_s2[lane] = static_cast<std::uint32_t>(b);
+				_s3[lane] = static_cast<std::uint32_t>(b >> 32);
+				// The all zero state is the only invalid one.
+				if ((_s0[lane] | _s1[lane] | _s2[lane] | _s3[lane]) == 0u)
+					_s0[lane] = 1u;
+			}
+		}
+
+		/** Advance every lane once. */
+		void Next(std::array<std::uint32_t, Lanes>& out)
+		{
+			for (int lane = 0; lane < Lanes; ++lane)
+			{
+				out[lane] = Rotl(_s0[lane] + _s3[lane], 7) + _s0[lane];
+				const std::uint32_t t = _s1[lane] << 9;
+				_s2[lane] ^= _s0[lane];
+				_s3[lane] ^= _s1[lane];
+				_s1[lane] ^= _s2[lane];
+				_s0[lane] ^= _s3[lane];
+				_s2[lane] ^= t;
+				_s3[lane] = Rotl(_s3[lane], 11);
+			}
+		}
+
+		/** Advance a single lane, used to resolve rare rejection paths lane by lane. */
+		std::uint32_t NextLane(int lane)
+		{
+			const std::uint32_t result = Rotl(_s0[lane] + _s3[lane], 7) + _s0[lane];
+			const std::uint32_t t = _s1[lane] << 9;
+			_s2[lane] ^= _s0[lane];
+			_s3[lane] ^= _s1[lane];
+			_s1[lane] ^= _s2[lane];
+			_s0[lane] ^= _s3[lane];
+			_s2[lane] ^= t;
+			_s3[lane] = Rotl(_s3[lane], 11);
+			return result;
+		}
+
+		static constexpr result_type min() { return 0u; }
+		static constexpr result_type max() { return std::numeric_limits<std::uint32_t>::max(); }
+		result_type operator()() { return NextLane(0); }
+	};
+
+	using Xoshiro128PlusPlus = Xoshiro128PlusPlusLanes<1>;
+
+	/** Standard normal variates with the 128 layer Marsaglia-Tsang ziggurat.
+	 *
+	 * About 99% of draws take the fast path: one 32 bit word, one table
+	 * compare and one multiply. The wedge and tail fall back to the exact
+	 * rejection tests so the distribution is not truncated.
+	 */
+	class ZigguratGaussian
+	{
+		struct Tables
+		{
+			std::array<std::uint32_t, 128> k{};
+			std::array<float, 128> w{};
+			std::array<float, 128> f{};
+
+			Tables()
+			{
+				constexpr double m1 = 2147483648.0;
+				constexpr double vn = 9.91256303526217e-3;
+				double dn = TailStart;
+				double tn = dn;
+				const double q = vn / std::exp(-0.5 * dn * dn);
+				k[0] = static_cast<std::uint32_t>((dn / q) * m1);
+				k[1] = 0u;
+				w[0] = static_cast<float>(q / m1);
+				w[127] = static_cast<float>(dn / m1);
+				f[0] = 1.0f;
+				f[127] = static_cast<float>(std::exp(-0.5 * dn * dn));
+				for (int i = 126; i >= 1; --i)
+				{
+					dn = std::sqrt(-2.0 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+					k[i + 1] = static_cast<std::uint32_t>((dn / tn) * m1);
+					tn = dn;
+					f[i] = static_cast<float>(std::exp(-0.5 * dn * dn));
+					w[i] = static_cast<float>(dn / m1);
+				}
+			}
+		};
+
+		static const Tables& Table()
+		{
+			static const Tables tables{};
+			return tables;
+		}
+
+		static constexpr double TailStart = 3.442619855899;
+
+		// Uniform in the open interval (0, 1) so the logarithms below stay finite.
+		static float OpenUniform(std::uint32_t bits)
+		{
+			return (static_cast<float>(bits >> 8) + 0.5f) * (1.0f / 16777216.0f);
+		}
+
+		template<typename NextWord>
+		static float Slow(std::int32_t hz, std::uint32_t iz, NextWord&& next)
+		{
+			const Tables& table = Table();
+			for (;;)
+			{
+				float x = static_cast<float>(hz) * table.w[iz];
+				if (iz == 0u)
+				{
+					float y;
+					do
+					{
+						x = -std::log(OpenUniform(next())) * static_cast<float>(1.0 / TailStart);
+						y = -std::log(OpenUniform(next()));
+					} while (y + y < x * x);
+					return hz > 0 ? static_cast<float>(TailStart) + x :
+						-static_cast<float>(TailStart) - x;
+				}
+				if (table.f[iz] + OpenUniform(next()) * (table.f[iz - 1] - table.f[iz]) <
+					std::exp(-0.5f * x * x))
+					return x;
+				hz = static_cast<std::int32_t>(next());
+				iz = static_cast<std::uint32_t>(hz) & 127u;
+				if (static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(hz))) < table.k[iz])
+					return static_cast<float>(hz) * table.w[iz];
+			}
+		}
+
+	public:
+		/** Force the table construction outside of the audio thread. */
+		static void Prepare()
+		{
+			(void) Table();
+		}
+
+		/** One standard normal variate from any 32 bit generator. */
+		template<typename Generator>
+		static float Draw(Generator& generator)
+		{
+			const Tables& table = Table();
+			const std::int32_t hz = static_cast<std::int32_t>(
+				static_cast<std::uint32_t>(generator()));
+			const std::uint32_t iz = static_cast<std::uint32_t>(hz) & 127u;
+			if (static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(hz))) < table.k[iz])
+				return static_cast<float>(hz) * table.w[iz];
+			return Slow(hz, iz, [&generator]() { return static_cast<std::uint32_t>(generator()); });
+		}
+
+		/** One standard normal variate per lane. The fast path runs on all lanes
+		 * together and only the rejected lanes are resolved one by one.
+		 */
+		template<int Lanes>
+		static void DrawLanes(Xoshiro128PlusPlusLanes<Lanes>& generator, float* out)
+		{
+			const Tables& table = Table();
+			std::array<std::uint32_t, Lanes> bits;
+			generator.Next(bits);
+			std::uint32_t rejected = 0u;
+			for (int lane = 0; lane < Lanes; ++lane)
+			{
+				const std::int32_t hz = static_cast<std::int32_t>(bits[lane]);
+				const std::uint32_t iz = bits[lane] & 127u;
+				out[lane] = static_cast<float>(hz) * table.w[iz];
+				rejected |= static_cast<std::uint32_t>(
+					static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(hz))) >= table.k[iz]);
+			}
+			if (rejected == 0u)
+				return;
+			for (int lane = 0; lane < Lanes; ++lane)
+			{
+				const std::int32_t hz = static_cast<std::int32_t>(bits[lane]);
+				const std::uint32_t iz = bits[lane] & 127u;
+				if (static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(hz))) >= table.k[iz])
+					out[lane] = Slow(hz, iz, [&generator, lane]() { return generator.NextLane(lane); });
+			}
+		}
+
+		/** Fill a block of standard normal variates, Lanes at a time. */
+		template<int Lanes>
+		static void Fill(Xoshiro128PlusPlusLanes<Lanes>& generator, float* out, int count)
+		{
+			int index = 0;
+			for (; index + Lanes <= count; index += Lanes)
+				DrawLanes(generator, out + index);
+			if (index < count)
+			{
+				std::array<float, Lanes> rest;
+				DrawLanes(generator, rest.data());
+				for (int lane = 0; lane < Lanes && index < count; ++index, ++lane)
+					out[index] = rest[lane];
+			}
+		}
+	};
+
+	/** Standard normal draw used by the drift processes.
+	 * Standard generators keep going through std::normal_distribution so existing
+	 * sequences are unchanged, the xoshiro generator takes the ziggurat path.
+	 */
+	template<typename Generator>
+	double DrawStandardNormal(std::normal_distribution<double>& normal, Generator& generator)
+	{
+		return normal(generator);
+	}
+
+	inline double DrawStandardNormal(std::normal_distribution<double>&, Xoshiro128PlusPlus& generator)
+	{
+		return ZigguratGaussian::Draw(generator);
+	}
+}
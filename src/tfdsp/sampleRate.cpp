@@ -3,7 +3,7 @@
 
 namespace tfdsp {
 
-std::unique_ptr<X2Resampler_Order5> CreateX2Resampler_Butterworth5()
+X2Resampler_Order5 MakeX2Resampler_Butterworth5()
 {
 	Eigen::Array<double, 1, 1> directCoeffs;
 	Eigen::Array<double, 1, 1> delayedCoeffs;
@@ -11,23 +11,40 @@ std::unique_ptr<X2Resampler_Order5> CreateX2Resampler_Butterworth5()
 	directCoeffs << 1.0 / (5 + 2 * std::sqrt(5));
 	delayedCoeffs << 5 - 2 * std::sqrt(5);
 
-	return std::make_unique<X2Resampler_Order5>(directCoeffs, delayedCoeffs);
+	return X2Resampler_Order5(directCoeffs, delayedCoeffs);
 }
-std::unique_ptr<X2Resampler_Order7> CreateX2Resampler_Chebychev7()
+X2Resampler_Order7 MakeX2Resampler_Chebychev7()
 {
 	Eigen::Array<double, 2, 1> directCoeffs;
 	Eigen::Array<double, 1, 1> delayedCoeffs;
 	directCoeffs << 0.081430023176616115, 0.70977080010248506;
 	delayedCoeffs << 0.31565984021666094;
-	return std::make_unique<X2Resampler_Order7>(directCoeffs, delayedCoeffs);
+	return X2Resampler_Order7(directCoeffs, delayedCoeffs);
 }
-std::unique_ptr<X2Resampler_Order9> CreateX2Resampler_Chebychev9()
+X2Resampler_Order9 MakeX2Resampler_Chebychev9()
 {
 	Eigen::Array<double, 2, 1> directCoeffs;
 	Eigen::Array<double, 2, 1> delayedCoeffs;
 	directCoeffs << 0.079866426236357438, 0.54532365107113168;
 	delayedCoeffs << 0.28382934487410966, 0.83441189148073658;
-	return std::make_unique<X2Resampler_Order9>(directCoeffs, delayedCoeffs);
+	return X2Resampler_Order9(directCoeffs, delayedCoeffs);
+}
+X4Resampler_Order7 MakeX4Resampler_Cheby7()
+{
+	return X4Resampler_Order7(MakeX2Resampler_Chebychev7());
+}
+
+std::unique_ptr<X2Resampler_Order5> CreateX2Resampler_Butterworth5()
+{
+	return std::make_unique<X2Resampler_Order5>(MakeX2Resampler_Butterworth5());
+}
+std::unique_ptr<X2Resampler_Order7> CreateX2Resampler_Chebychev7()
+{
+	return std::make_unique<X2Resampler_Order7>(MakeX2Resampler_Chebychev7());
+}
+std::unique_ptr<X2Resampler_Order9> CreateX2Resampler_Chebychev9()
+{
+	return std::make_unique<X2Resampler_Order9>(MakeX2Resampler_Chebychev9());
 }
 std::unique_ptr<DummyResampler> CreateDummyResampler()
 {
@@ -35,7 +52,7 @@ std::unique_ptr<DummyResampler> CreateDummyResampler()
 }
 std::unique_ptr<X4Resampler_Order7> CreateX4Resampler_Cheby7()
 {
-	return std::make_unique<X4Resampler_Order7>(CreateX2Resampler_Chebychev7);
+	return std::make_unique<X4Resampler_Order7>(MakeX2Resampler_Chebychev7());
 }
 
 std::unique_ptr<X16Resampler_Order7> CreateX16Resampler_Cheby7()
@@ -63,6 +63,10 @@ namespace tfdsp
 	};
 
 	/// N direct stages, M delayed stages
+	///
+	/// The all-pass states are not snapped to zero as they ring down, since a
+	/// compare on the hot path costs the round trips 25-40%. Callers outside
+	/// Rack's engine threads hold a ScopedFlushDenormals while processing.
 	template<int N, int M>
 	class PolyphaseIIR_X2Resampler : public Resampler<PolyphaseIIR_X2Resampler<N, M>, 2>
 	{
@@ -158,35 +162,38 @@ namespace tfdsp
 			return x;
 		}
 	};
+	// The stages are held by value, so a model that embeds an X4Resampler keeps
+	// both of them in its own allocation.
 	template<typename X2Type>
 	class X4Resampler : public Resampler<X4Resampler<X2Type>, 4>
 	{
-		std::unique_ptr<X2Type> _stage1;
-		std::unique_ptr<X2Type> _stage2;
+		X2Type _stage1;
+		X2Type _stage2;
 
 	public:
-		explicit X4Resampler(std::function<std::unique_ptr<X2Type>()> resamplerCreator) : _stage1{ resamplerCreator() }, _stage2(resamplerCreator())
+		// Both stages start as copies of `stage`.
+		explicit X4Resampler(const X2Type& stage) : _stage1(stage), _stage2(stage)
 		{
 		}
 	private:
 		friend class Resampler<X4Resampler<X2Type>, 4>;
 		void _Reset()
 		{
-			_stage1->Reset();
-			_stage2->Reset();
+			_stage1.Reset();
+			_stage2.Reset();
 		}
 		void _PrimeUpsample(const double x)
 		{
-			_stage1->PrimeUpsample(x);
-			_stage2->PrimeUpsample(x);
+			_stage1.PrimeUpsample(x);
+			_stage2.PrimeUpsample(x);
 		}
 		Eigen::Array<double, 4, 1> _Upsample(const double x)
 		{
 			Eigen::Array<double, 4 ,1> x4;
-			auto x1 = _stage1->Upsample(x);
+			auto x1 = _stage1.Upsample(x);
 			for (int i = 0; i < 2; ++i)
 			{
-				auto x2 = _stage2->Upsample(x1(i));
+				auto x2 = _stage2.Upsample(x1(i));
 				x4(2 * i) = x2(0);
 				x4(2 * i + 1) = x2(1);
 			}
@@ -197,14 +204,57 @@ namespace tfdsp
 			Eigen::Array<double, 2, 1> x2;
 			x2(0) = x4(0);
 			x2(1) = x4(1);
-			auto s1 = _stage2->Downsample(x2);
+			auto s1 = _stage2.Downsample(x2);
 			x2(0) = x4(2);
 			x2(1) = x4(3);
-			auto s2 = _stage2->Downsample(x2);
+			auto s2 = _stage2.Downsample(x2);
 			x2(0) = s1;
 			x2(1) = s2;
 
-			return _stage1->Downsample(x2);
+			return _stage1.Downsample(x2);
+		}
+	};
+
+	/** Converts a stream of oversampled frames between 2x and 4x with the
+	 * half-band stage an X4Resampler runs at its higher rate, for a consumer
+	 * whose factor differs from its producer's. Upsample() followed by an X2
+	 * interpolator's frames equals the X4 interpolation; Downsample() equals
+	 * the first half of the X4 decimation. */
+	template<typename X2Type>
+	class X2X4FrameConverter
+	{
+		X2Type _stage;
+
+	public:
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		explicit X2X4FrameConverter(const X2Type& stage) : _stage(stage)
+		{
+		}
+		void Reset()
+		{
+			_stage.Reset();
+		}
+		Eigen::Array<double, 4, 1> Upsample(const Eigen::Array<double, 2, 1>& x2)
+		{
+			Eigen::Array<double, 4, 1> x4;
+			for (int i = 0; i < 2; ++i)
+			{
+				const auto pair = _stage.Upsample(x2(i));
+				x4(2 * i) = pair(0);
+				x4(2 * i + 1) = pair(1);
+			}
+			return x4;
+		}
+		Eigen::Array<double, 2, 1> Downsample(const Eigen::Array<double, 4, 1>& x4)
+		{
+			Eigen::Array<double, 2, 1> x2;
+			for (int i = 0; i < 2; ++i)
+			{
+				Eigen::Array<double, 2, 1> pair;
+				pair << x4(2 * i), x4(2 * i + 1);
+				x2(i) = _stage.Downsample(pair);
+			}
+			return x2;
 		}
 	};
 
@@ -303,6 +353,12 @@ namespace tfdsp
 	using X16Resampler_Order7 = CascadedX2Resampler<
 		X2Resampler_Order7, 4>;
 
+	// By value, for models that hold their resamplers as members.
+	X2Resampler_Order5 MakeX2Resampler_Butterworth5();
+	X2Resampler_Order7 MakeX2Resampler_Chebychev7();
+	X2Resampler_Order9 MakeX2Resampler_Chebychev9();
+	X4Resampler_Order7 MakeX4Resampler_Cheby7();
+
 	std::unique_ptr<X2Resampler_Order5> CreateX2Resampler_Butterworth5();
 	std::unique_ptr<X2Resampler_Order7> CreateX2Resampler_Chebychev7();
 	std::unique_ptr<X2Resampler_Order9> CreateX2Resampler_Chebychev9();
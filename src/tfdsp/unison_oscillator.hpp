@@ -100,9 +100,10 @@ namespace tfdsp
 			Pulse,
 		};
 
-		BandlimitedSawOscillator<> _saw{};
-		BandlimitedPulseOscillator<> _pulse{};
-		BandlimitedFixedPulseOscillator _sub{};
+		// Fixed-point phases keep large stacks bit-identical across platforms.
+		BandlimitedSawOscillator<8, 32, FixedPhase> _saw{};
+		BandlimitedPulseOscillator<8, 32, FixedPhase> _pulse{};
+		BandlimitedFixedPulseOscillator<FixedPhase> _sub{};
 		MainMode _mainMode{MainMode::Saw};
 	};
 }
@@ -8,7 +8,9 @@
 #include <memory>
 #include <utility>
 
+#include "tfdsp/approx.hpp"
 #include "tfdsp/oscillator.hpp"
+#include "tfdsp/profile_scope.hpp"
 #include "tfdsp/sampleRate.hpp"
 
 namespace tfdsp
@@ -433,6 +435,93 @@ struct WavefoldOscillatorOutput
 	double folded{};
 };
 
+/** The host-rate controls of a WavefoldOscillator reconstructed at its
+ * internal rate.
+ *
+ * Unison voices of one channel differ only by a constant pitch ratio and
+ * slow drift, so they can share one reconstruction and apply their own
+ * ratio and offsets at the internal rate; see
+ * WavefoldOscillator::StepOversampled().
+ */
+template<typename ResamplerType>
+class WavefoldControlInterpolator
+{
+public:
+	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
+	using Frames = Eigen::Array<double, OversamplingFactor, 1>;
+
+	struct Controls
+	{
+		Frames frequencyHz;
+		Frames morph;
+		Frames fold;
+		Frames symmetry;
+		Frames externalInput;
+	};
+
+	explicit WavefoldControlInterpolator(
+		const std::function<std::unique_ptr<ResamplerType>()>& createResampler) :
+		_frequencyInterpolator(createResampler()),
+		_morphInterpolator(createResampler()),
+		_foldInterpolator(createResampler()),
+		_symmetryInterpolator(createResampler()),
+		_externalInputInterpolator(createResampler())
+	{
+	}
+
+	void Reset()
+	{
+		_frequencyInterpolator->Reset();
+		_morphInterpolator->Reset();
+		_foldInterpolator->Reset();
+		_symmetryInterpolator->Reset();
+		_externalInputInterpolator->Reset();
+		_initialized = false;
+	}
+
+	/** Controls must be finite. The first call after Reset() primes the
+	 * interpolators so a held control does not ramp in from zero. */
+	const Controls& Upsample(double frequencyHz, double morph, double fold,
+		double symmetry, double externalInput)
+	{
+		TF_PROFILE_SCOPE(Resampling);
+		if (!_initialized)
+		{
+			_frequencyInterpolator->PrimeUpsample(frequencyHz);
+			_morphInterpolator->PrimeUpsample(morph);
+			_foldInterpolator->PrimeUpsample(fold);
+			_symmetryInterpolator->PrimeUpsample(symmetry);
+			_externalInputInterpolator->PrimeUpsample(externalInput);
+			_initialized = true;
+		}
+
+		_controls.frequencyHz = _frequencyInterpolator->Upsample(frequencyHz);
+		_controls.morph = _morphInterpolator->Upsample(morph);
+		_controls.fold = _foldInterpolator->Upsample(fold);
+		_controls.symmetry = _symmetryInterpolator->Upsample(symmetry);
+		_controls.externalInput =
+			_externalInputInterpolator->Upsample(externalInput);
+		return _controls;
+	}
+
+private:
+	std::unique_ptr<ResamplerType> _frequencyInterpolator;
+	std::unique_ptr<ResamplerType> _morphInterpolator;
+	std::unique_ptr<ResamplerType> _foldInterpolator;
+	std::unique_ptr<ResamplerType> _symmetryInterpolator;
+	std::unique_ptr<ResamplerType> _externalInputInterpolator;
+	Controls _controls{};
+	bool _initialized{};
+};
+
+/** Whether a WavefoldOscillator reconstructs its own controls, or only renders
+ * controls another voice reconstructed; see StepOversampled(). */
+enum class WavefoldControls
+{
+	Own,
+	Shared
+};
+
 /** Triangle/sine morph oscillator feeding the selectable wavefolder. */
 template<typename ResamplerType>
 class WavefoldOscillator
@@ -441,14 +530,14 @@ public:
 	static constexpr int OversamplingFactor = ResamplerType::ResamplingFactor;
 	static constexpr double FoldHarmonicBudgetHz = 6000.0;
 	using Output = WavefoldOscillatorOutput;
+	using ControlInterpolator = WavefoldControlInterpolator<ResamplerType>;
+	using Controls = typename ControlInterpolator::Controls;
 
 	explicit WavefoldOscillator(
-		std::function<std::unique_ptr<ResamplerType>()> createResampler) :
-		_frequencyInterpolator(createResampler()),
-		_morphInterpolator(createResampler()),
-		_foldInterpolator(createResampler()),
-		_symmetryInterpolator(createResampler()),
-		_externalInputInterpolator(createResampler()),
+		std::function<std::unique_ptr<ResamplerType>()> createResampler,
+		WavefoldControls controls = WavefoldControls::Own) :
+		_controls(controls == WavefoldControls::Own ?
+			std::make_unique<ControlInterpolator>(createResampler) : nullptr),
 		_oscillatorDecimator(createResampler()),
 		_foldedDecimator(createResampler())
 	{
@@ -462,18 +551,14 @@ public:
 
 	void Reset()
 	{
-		_frequencyInterpolator->Reset();
-		_morphInterpolator->Reset();
-		_foldInterpolator->Reset();
-		_symmetryInterpolator->Reset();
-		_externalInputInterpolator->Reset();
+		if (_controls)
+			_controls->Reset();
 		_oscillatorDecimator->Reset();
 		_foldedDecimator->Reset();
 		_triangle.Reset();
 		_folder.Reset();
 		_previousFolderSource = 0.0;
 		_folderSourceInitialized = false;
-		_controlsInitialized = false;
 	}
 
 	void SetFolderAntialiasing(bool enabled)
@@ -524,7 +609,8 @@ public:
 	 * When useExternalInput is false, the internal oversampled oscillator feeds
 	 * the folder directly. An external input is reconstructed through the same
 	 * interpolation filter as the CV controls before entering the nonlinear
-	 * path. Inputs and outputs use a normalized peak level of one.
+	 * path. Inputs and outputs use a normalized peak level of one. Only an
+	 * oscillator with its own controls can render this way.
 	 */
 	Output StepWithInput(double frequencyHz, double morph, double fold,
 		double symmetry, double externalInput, bool useExternalInput)
@@ -537,52 +623,65 @@ public:
 			return {};
 		}
 
-		if (!_controlsInitialized)
-		{
-			_frequencyInterpolator->PrimeUpsample(frequencyHz);
-			_morphInterpolator->PrimeUpsample(morph);
-			_foldInterpolator->PrimeUpsample(fold);
-			_symmetryInterpolator->PrimeUpsample(symmetry);
-			_externalInputInterpolator->PrimeUpsample(externalInput);
-			_controlsInitialized = true;
-		}
+		return StepOversampled(_controls->Upsample(frequencyHz, morph, fold,
+			symmetry, externalInput), 1.0, 0.0, 0.0, 0.0, useExternalInput);
+	}
 
-		const auto frequencies = _frequencyInterpolator->Upsample(frequencyHz);
-		const auto morphs = _morphInterpolator->Upsample(morph);
-		const auto folds = _foldInterpolator->Upsample(fold);
-		const auto symmetries = _symmetryInterpolator->Upsample(symmetry);
-		const auto externalInputs =
-			_externalInputInterpolator->Upsample(externalInput);
+	/** Reconstructs controls for StepOversampled() with the oscillator's own
+	 * interpolators. A unison stack upsamples through its first voice and
+	 * passes the result to the others, which are built with
+	 * WavefoldControls::Shared. */
+	const Controls& UpsampleControls(double frequencyHz, double morph,
+		double fold, double symmetry, double externalInput)
+	{
+		return _controls->Upsample(frequencyHz, morph, fold, symmetry,
+			externalInput);
+	}
+
+	/** Render from controls already at the internal rate. The frequency is
+	 * scaled by `frequencyRatio` and the offsets are added to morph, fold and
+	 * symmetry before the usual clamping, so a unison voice can reuse a shared
+	 * reconstruction. StepWithInput() is this with a unit ratio and no offsets.
+	 */
+	Output StepOversampled(const Controls& controls, double frequencyRatio,
+		double morphOffset, double foldOffset, double symmetryOffset,
+		bool useExternalInput)
+	{
+		TF_PROFILE_SCOPE(Solver);
 		Eigen::Array<double, OversamplingFactor, 1> oscillatorOutput;
 		Eigen::Array<double, OversamplingFactor, 1> foldedOutput;
 		const double internalRate = _sampleRate * OversamplingFactor;
 		for (int index = 0; index < OversamplingFactor; ++index)
 		{
-			const double increment = std::clamp(frequencies(index) / internalRate,
+			const double frequency = frequencyRatio * controls.frequencyHz(index);
+			const double increment = std::clamp(frequency / internalRate,
 				-0.45, 0.45);
 			const double triangle = _triangle.Step(increment);
-			const double sine = -std::cos(
-				6.283185307179586476925286766559 * _triangle.OutputPhase());
-			const double shape = std::clamp(morphs(index), 0.0, 1.0);
+			const double shape = std::clamp(
+				controls.morph(index) + morphOffset, 0.0, 1.0);
+			// The sine is read at the triangle's delayed output phase so the two
+			// stay aligned through the BLAMP latency.
+			const double sine = shape < 1.0 ?
+				-CosineCycle(_triangle.OutputPhase()) : triangle;
 			const double source = sine + shape * (triangle - sine);
 			const double foldTaper = useExternalInput ? 1.0 :
-				FoldScaleForFrequency(frequencies(index));
-			const double foldAmount =
-				std::clamp(folds(index), 0.0, 1.0) * foldTaper;
+				FoldScaleForFrequency(frequency);
+			const double foldAmount = std::clamp(
+				controls.fold(index) + foldOffset, 0.0, 1.0) * foldTaper;
 			// Keep the zero-fold endpoint almost linear, then traverse all four
 			// folding stages over the rest of the control. Complementary makeup
 			// keeps the unfolded and fully folded endpoints near the same peak level.
 			const double drive = 0.5 + 8.5 * foldAmount;
 			const double makeup = 2.0 / (1.0 + foldAmount);
 			const double folderSource = useExternalInput ?
-				externalInputs(index) : source;
+				controls.externalInput(index) : source;
 			const double alignedDrySource = _useAdaa &&
 				_folderSourceInitialized ?
 				0.5 * (folderSource + _previousFolderSource) : folderSource;
 			_previousFolderSource = folderSource;
 			_folderSourceInitialized = true;
 			const double foldedInput = drive * folderSource +
-				std::clamp(symmetries(index), -1.0, 1.0);
+				std::clamp(controls.symmetry(index) + symmetryOffset, -1.0, 1.0);
 			oscillatorOutput(index) = source;
 			const double wet = makeup * (_useAdaa ?
 				_folder.Process(foldedInput, _character) :
@@ -594,10 +693,12 @@ public:
 			foldedOutput(index) = foldAmount <= 0.0 ? folderSource :
 				alignedDrySource + foldAmount * (wet - alignedDrySource);
 		}
-		Output result{
-			_oscillatorDecimator->Downsample(oscillatorOutput),
-			_foldedDecimator->Downsample(foldedOutput),
-		};
+		Output result;
+		{
+			TF_PROFILE_SCOPE(Resampling);
+			result.oscillator = _oscillatorDecimator->Downsample(oscillatorOutput);
+			result.folded = _foldedDecimator->Downsample(foldedOutput);
+		}
 		if (std::isfinite(result.oscillator) && std::isfinite(result.folded))
 			return result;
 		Reset();
@@ -605,17 +706,13 @@ public:
 	}
 
 private:
-	std::unique_ptr<ResamplerType> _frequencyInterpolator;
-	std::unique_ptr<ResamplerType> _morphInterpolator;
-	std::unique_ptr<ResamplerType> _foldInterpolator;
-	std::unique_ptr<ResamplerType> _symmetryInterpolator;
-	std::unique_ptr<ResamplerType> _externalInputInterpolator;
+	// Null for a voice built with WavefoldControls::Shared.
+	std::unique_ptr<ControlInterpolator> _controls;
 	std::unique_ptr<ResamplerType> _oscillatorDecimator;
 	std::unique_ptr<ResamplerType> _foldedDecimator;
-	BandlimitedTriangleOscillator _triangle;
+	BandlimitedTriangleOscillator<FixedPhase> _triangle;
 	Wavefolder _folder;
 	double _sampleRate{48000.0};
-	bool _controlsInitialized{};
 	bool _useAdaa{};
 	double _previousFolderSource{};
 	bool _folderSourceInitialized{};
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "dsp_bench_workloads.hpp"
+#include "tfdsp/denormal.hpp"
+
+/**
+ * Native micro-benchmarks of the DSP models, free of the Python conversion overhead.
+ *
+ * Usage: triggerfish_dsp_bench [--filter text] [--samples n] [--repeats n] [--json path] [--list]
+ *     [--denormals]
+ * Reports the median ns per host sample at 48 kHz and the share of one core that
+ * 16 polyphony channels of the model would use. Denormals are flushed as on the
+ * Rack engine thread unless --denormals is given; compare the tail_ workloads
+ * both ways to check that the models' own denormal handling holds.
+ */
+namespace
+{
+	struct Options
+	{
+		std::string filter;
+		std::string jsonPath;
+		int samples{ 48000 };
+		int repeats{ 7 };
+		bool list{};
+		bool denormals{};
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (argument == "--filter" && hasValue)
+				options.filter = argv[++i];
+			else if (argument == "--json" && hasValue)
+				options.jsonPath = argv[++i];
+			else if (argument == "--samples" && hasValue)
+				options.samples = std::max(std::atoi(argv[++i]), 1);
+			else if (argument == "--repeats" && hasValue)
+				options.repeats = std::max(std::atoi(argv[++i]), 1);
+			else if (argument == "--list")
+				options.list = true;
+			else if (argument == "--denormals")
+				options.denormals = true;
+			else
+			{
+				std::cerr << "usage: triggerfish_dsp_bench [--filter text] [--samples n] "
+					"[--repeats n] [--json path] [--list] [--denormals]\n";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	struct Result
+	{
+		const tfbench::Workload* workload;
+		double nanosecondsPerSample;
+	};
+
+	void WriteJson(const std::string& path, const Options& options, const std::vector<Result>& results)
+	{
+		std::ofstream file(path);
+		file << "{\n";
+		file << "  \"host_sample_rate\": " << tfbench::HostSampleRate << ",\n";
+		file << "  \"samples\": " << options.samples << ",\n";
+		file << "  \"repeats\": " << options.repeats << ",\n";
+		file << "  \"results\": [\n";
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			char line[512];
+			std::snprintf(line, sizeof(line),
+				"    {\"name\": \"%s\", \"model\": \"%s\", \"oversampling\": %d, "
+				"\"ns_per_sample\": %.3f, \"cpu_percent_16ch_48k\": %.3f}%s\n",
+				result.workload->name.c_str(), result.workload->model.c_str(),
+				result.workload->oversampling, result.nanosecondsPerSample,
+				tfbench::CorePercent(result.nanosecondsPerSample, 16),
+				i + 1 < results.size() ? "," : "");
+			file << line;
+		}
+		file << "  ]\n}\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+		return 2;
+
+	const auto workloads = tfbench::AllWorkloads();
+	if (options.list)
+	{
+		for (const auto& workload : workloads)
+			std::cout << workload.name << '\n';
+		return 0;
+	}
+#ifndef NDEBUG
+	std::cerr << "warning: assertions are enabled, configure with -DCMAKE_BUILD_TYPE=Release "
+		"for representative timings\n";
+#endif
+
+	std::optional<tfdsp::ScopedFlushDenormals> flushDenormals;
+	if (!options.denormals)
+		flushDenormals.emplace();
+
+	std::printf("%-30s %5s %12s %16s\n", "workload", "os", "ns/sample", "16ch @48k %core");
+	std::vector<Result> results;
+	double checksum = 0.0;
+	for (const auto& workload : workloads)
+	{
+		if (!options.filter.empty() && workload.name.find(options.filter) == std::string::npos)
+			continue;
+		const auto render = workload.create();
+		const double nanoseconds = tfbench::MeasureNanosecondsPerSample(
+			render, options.samples, options.repeats, checksum);
+		results.push_back({ &workload, nanoseconds });
+		std::printf("%-30s %4dx %12.1f %15.2f%%\n", workload.name.c_str(),
+			workload.oversampling, nanoseconds, tfbench::CorePercent(nanoseconds, 16));
+	}
+	if (!std::isfinite(checksum))
+		std::cerr << "warning: a workload produced non-finite output\n";
+
+	if (!options.jsonPath.empty())
+		WriteJson(options.jsonPath, options, results);
+	return 0;
+}
@@ -0,0 +1,520 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "models/Arp4019Vca.hpp"
+#include "models/Arp4072Filter.hpp"
+#include "models/DiodeLadderFilter.hpp"
+#include "models/Tb303Oscillator.hpp"
+#include "models/Tb303Voice.hpp"
+#include "models/VdpSplitOscillator.hpp"
+#include "tfdsp/sampleRate.hpp"
+#include "tfdsp/unison_oscillator.hpp"
+#include "tfdsp/wavefolder.hpp"
+
+/**
+ * Fixed per-model workloads shared by the native benchmark and the performance gate.
+ *
+ * Every workload drives one model instance with deterministic, musically typical
+ * inputs at a 48 kHz host rate. Create() builds the model and returns a renderer
+ * that processes the requested number of host samples and returns a checksum,
+ * so the compiler cannot discard the work.
+ */
+namespace tfbench
+{
+	constexpr double HostSampleRate = 48000.0;
+
+	using Renderer = std::function<double(int hostSamples)>;
+
+	struct Workload
+	{
+		std::string name;
+		std::string model;
+		int oversampling;
+		std::function<Renderer()> create;
+	};
+
+	template<typename Resampler>
+	std::unique_ptr<Resampler> CreateResampler()
+	{
+		if constexpr (std::is_same_v<Resampler, tfdsp::DummyResampler>)
+			return tfdsp::CreateDummyResampler();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order5>)
+			return tfdsp::CreateX2Resampler_Butterworth5();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order7>)
+			return tfdsp::CreateX2Resampler_Chebychev7();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order9>)
+			return tfdsp::CreateX2Resampler_Chebychev9();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X4Resampler_Order7>)
+			return tfdsp::CreateX4Resampler_Cheby7();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X16Resampler_Order7>)
+			return tfdsp::CreateX16Resampler_Cheby7();
+		else
+			return std::make_unique<Resampler>(tfdsp::MakeX2Resampler_Chebychev9());
+	}
+
+	// By value, for the models that embed their resamplers.
+	template<typename Resampler>
+	Resampler MakeResampler()
+	{
+		if constexpr (std::is_same_v<Resampler, tfdsp::DummyResampler>)
+			return tfdsp::DummyResampler();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order5>)
+			return tfdsp::MakeX2Resampler_Butterworth5();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order7>)
+			return tfdsp::MakeX2Resampler_Chebychev7();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order9>)
+			return tfdsp::MakeX2Resampler_Chebychev9();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X4Resampler_Order7>)
+			return tfdsp::MakeX4Resampler_Cheby7();
+		else
+			return Resampler(tfdsp::MakeX2Resampler_Chebychev9());
+	}
+
+	// One period of slowly varying test signals, read cyclically so that
+	// generating the inputs costs a table lookup rather than a transcendental.
+	struct Signals
+	{
+		static constexpr int Length = 4800;
+		std::vector<double> audio;
+		std::vector<double> slow;
+
+		Signals() : audio(Length), slow(Length)
+		{
+			constexpr double TwoPi = 6.283185307179586476925286766559;
+			for (int i = 0; i < Length; ++i)
+			{
+				const double t = static_cast<double>(i) / Length;
+				audio[i] = 4.0 * std::sin(TwoPi * 110.0 * t) + std::sin(TwoPi * 330.0 * t);
+				slow[i] = std::sin(TwoPi * t);
+			}
+		}
+	};
+
+	inline const Signals& TestSignals()
+	{
+		static const Signals signals{};
+		return signals;
+	}
+
+	template<typename Resampler>
+	Workload DiodeLadder()
+	{
+		using Model = tfdsp::DiodeLadderFilter<Resampler>;
+		return { "diode_ladder_x" + std::to_string(Model::OversamplingFactor), "DiodeLadderFilter",
+			Model::OversamplingFactor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(MakeResampler<Resampler>());
+			model->SetSampleRate(HostSampleRate);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += model->StepLogCutoffModulated(signals.audio[index],
+						std::log2(800.0) + 2.0 * signals.slow[index], 0.0, 0.6, false, 1.5, 0.3);
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload Arp4072()
+	{
+		using Model = tfdsp::Arp4072Filter<Resampler>;
+		return { "arp4072_x" + std::to_string(Model::OversamplingFactor), "Arp4072Filter",
+			Model::OversamplingFactor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(MakeResampler<Resampler>());
+			model->SetSampleRate(HostSampleRate);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += model->StepLogCutoff(signals.audio[index],
+						std::log2(800.0) + 2.0 * signals.slow[index], 0.6, 1.5);
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload Arp4019()
+	{
+		using Model = tfdsp::Arp4019Vca<Resampler>;
+		return { "arp4019_x" + std::to_string(Model::OversamplingFactor), "Arp4019Vca",
+			Model::OversamplingFactor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(MakeResampler<Resampler>());
+			model->SetSampleRate(HostSampleRate);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += model->Step(signals.audio[index], 0.0,
+						5.0 + 4.0 * signals.slow[index], 0.0);
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload Tb303()
+	{
+		using Model = tfdsp::Tb303Oscillator<Resampler>;
+		return { "tb303_oscillator_x" + std::to_string(Model::OversamplingFactor), "Tb303Oscillator",
+			Model::OversamplingFactor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(&CreateResampler<Resampler>);
+			model->SetSampleRate(HostSampleRate);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					const auto output = model->Step(signals.slow[index], false, 0.060,
+						0.0, 0.0, false, 0.5, 0.5);
+					sum += output.mixed;
+				}
+				return sum;
+			};
+		} };
+	}
+
+	// One channel of the 303 Voice Core: articulation, diode ladder and the
+	// oversampled BA662 VCA, driven by a 16th-note gate pattern with accents.
+	template<typename Resampler>
+	Workload Tb303VoiceCore()
+	{
+		using Filter = tfdsp::DiodeLadderFilter<Resampler>;
+		struct Voice
+		{
+			Filter filter{ MakeResampler<Resampler>() };
+			tfdsp::Tb303Articulation articulation{};
+			tfdsp::Tb303Vca vca{};
+		};
+		return { "tb303_voice_core_x" + std::to_string(Filter::OversamplingFactor), "Tb303VoiceCore",
+			Filter::OversamplingFactor, []() -> Renderer
+		{
+			auto voice = std::make_shared<Voice>();
+			voice->filter.SetSampleRate(HostSampleRate);
+			voice->articulation.SetSampleRate(HostSampleRate);
+			voice->vca.SetSampleRate(HostSampleRate * Filter::OversamplingFactor);
+			return [voice](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				constexpr int StepLength = 6000;
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					const int step = i / StepLength;
+					const double gate = i % StepLength < StepLength / 2 ? 5.0 : 0.0;
+					const double accent = step % 3 == 0 ? 5.0 : 0.0;
+					const auto envelope = voice->articulation.Step(gate, accent, 0.7, 1.2, 0.2, 0.5);
+					const double log2CutoffHz = std::log2(261.625565) + 1.0 +
+						3.0 * (envelope.mainEnvelope - 0.3137) + envelope.filterAccent;
+					const double vcaAccent = envelope.vcaAccent;
+					const auto rendered = voice->filter.StepWithPostProcessorLogCutoffModulated(
+						signals.audio[index], log2CutoffHz, 0.0, 0.7, false, 1.0, 0.0,
+						envelope.volumeEnvelope,
+						[&](double audioValue, double control)
+						{
+							return voice->vca.Step(audioValue, control, vcaAccent);
+						});
+					sum += rendered.postProcessed;
+				}
+				return sum;
+			};
+		} };
+	}
+
+	// 303 Oscillator into 303 Voice Core filter. With `oversampledJunction` the
+	// filter takes the oscillator's internal-rate mix, as over the expander bus;
+	// otherwise the mix is decimated and interpolated again, as over a cable.
+	template<typename Resampler, bool OversampledJunction>
+	Workload Tb303Chain()
+	{
+		using Oscillator = tfdsp::Tb303Oscillator<Resampler>;
+		using Filter = tfdsp::DiodeLadderFilter<Resampler>;
+		struct Chain
+		{
+			Oscillator oscillator{ &CreateResampler<Resampler> };
+			Filter filter{ MakeResampler<Resampler>() };
+		};
+		return { std::string(OversampledJunction ? "tb303_chain_bus_x" : "tb303_chain_x") +
+			std::to_string(Filter::OversamplingFactor), "Tb303Chain",
+			Filter::OversamplingFactor, []() -> Renderer
+		{
+			auto chain = std::make_shared<Chain>();
+			chain->oscillator.SetSampleRate(HostSampleRate);
+			chain->filter.SetSampleRate(HostSampleRate);
+			return [chain](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				const auto identity = [](double audioValue, double) { return audioValue; };
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					const double log2CutoffHz = std::log2(800.0) + 2.0 * signals.slow[index];
+					if constexpr (OversampledJunction)
+					{
+						const auto output = chain->oscillator.StepOversampled(signals.slow[index],
+							false, 0.060, 0.0, 0.0, false, 0.5, 0.5);
+						sum += chain->filter.StepWithPostProcessorOversampledInput(output.mixed,
+							log2CutoffHz, 0.0, 0.7, false, 1.0, 0.0, 1.0, identity).postProcessed;
+					}
+					else
+					{
+						const auto output = chain->oscillator.Step(signals.slow[index], false,
+							0.060, 0.0, 0.0, false, 0.5, 0.5);
+						sum += chain->filter.StepWithPostProcessorLogCutoffModulated(output.mixed,
+							log2CutoffHz, 0.0, 0.7, false, 1.0, 0.0, 1.0, identity).postProcessed;
+					}
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload Wavefold()
+	{
+		using Model = tfdsp::WavefoldOscillator<Resampler>;
+		return { "wavefold_oscillator_x" + std::to_string(Model::OversamplingFactor),
+			"WavefoldOscillator", Model::OversamplingFactor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(&CreateResampler<Resampler>);
+			model->SetSampleRate(HostSampleRate);
+			model->SetFolderAntialiasing(true);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += model->Step(220.0, 0.5 + 0.5 * signals.slow[index],
+						0.6 + 0.3 * signals.slow[index], 0.1);
+				}
+				return sum;
+			};
+		} };
+	}
+
+	inline Workload StackedVoices()
+	{
+		return { "stacked_oscillator_7_voices", "StackedOscillatorVoice", 1, []() -> Renderer
+		{
+			constexpr int Voices = 7;
+			auto voices = std::make_shared<std::array<tfdsp::StackedOscillatorVoice, Voices>>();
+			for (int voice = 0; voice < Voices; ++voice)
+				(*voices)[voice].Reset(voice / static_cast<double>(Voices));
+			return [voices](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					for (int voice = 0; voice < Voices; ++voice)
+					{
+						const auto output = (*voices)[voice].Step(
+							(110.0 + voice) / HostSampleRate, 0.5 + 0.3 * signals.slow[index], 0.5);
+						sum += output.main + output.sub;
+					}
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload Vdpo()
+	{
+		using Model = VdpSplitOscillator<Resampler>;
+		constexpr int Factor = Resampler::ResamplingFactor;
+		return { "vdpo_x" + std::to_string(Factor), "VdpSplitOscillator", Factor, []() -> Renderer
+		{
+			auto model = std::make_shared<Model>(&CreateResampler<Resampler>);
+			model->SetSampleRate(HostSampleRate);
+			return [model](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				const double log2W = std::log2(6.283185307179586 * 261.625565);
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += model->StepLogAngularFrequency(0.1 * signals.audio[index],
+						2.0 + signals.slow[index], log2W);
+				}
+				return sum;
+			};
+		} };
+	}
+
+	template<typename Resampler>
+	Workload ResamplerRoundTrip(const std::string& name)
+	{
+		constexpr int Factor = Resampler::ResamplingFactor;
+		return { "resampler_" + name, "Resampler", Factor, []() -> Renderer
+		{
+			std::shared_ptr<Resampler> resampler = CreateResampler<Resampler>();
+			return [resampler](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+					sum += resampler->Downsample(resampler->Upsample(
+						signals.audio[i % Signals::Length]));
+				return sum;
+			};
+		} };
+	}
+
+	// Release tails: a 10 ms burst followed by silence, so the recursive states
+	// ring down through the range where subnormal arithmetic would stall the
+	// CPU. The cost per sample should match the active workloads of the model.
+	inline Workload SilentTail(const std::string& name, const std::string& model, int oversampling,
+		std::function<std::function<double(double)>()> createStep)
+	{
+		return { "tail_" + name, model, oversampling, [createStep]() -> Renderer
+		{
+			auto step = createStep();
+			return [step](int hostSamples)
+			{
+				constexpr int BurstLength = 480;
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+					sum += step(i < BurstLength ? signals.audio[i] : 0.0);
+				return sum;
+			};
+		} };
+	}
+
+	inline std::vector<Workload> SilentTails()
+	{
+		using Resampler = tfdsp::X4Resampler_Order7;
+		return {
+			SilentTail("diode_ladder_x4", "DiodeLadderFilter", 4, []()
+			{
+				auto model = std::make_shared<tfdsp::DiodeLadderFilter<Resampler>>(MakeResampler<Resampler>());
+				model->SetSampleRate(HostSampleRate);
+				return [model](double audio)
+				{
+					return static_cast<double>(model->StepLogCutoffModulated(audio, std::log2(800.0),
+						0.0, 0.6, false, 1.5, 0.3));
+				};
+			}),
+			SilentTail("arp4072_x4", "Arp4072Filter", 4, []()
+			{
+				auto model = std::make_shared<tfdsp::Arp4072Filter<Resampler>>(MakeResampler<Resampler>());
+				model->SetSampleRate(HostSampleRate);
+				return [model](double audio)
+				{
+					return static_cast<double>(model->StepLogCutoff(audio, std::log2(800.0), 0.6, 1.5));
+				};
+			}),
+			SilentTail("arp4019_x4", "Arp4019Vca", 4, []()
+			{
+				auto model = std::make_shared<tfdsp::Arp4019Vca<Resampler>>(MakeResampler<Resampler>());
+				model->SetSampleRate(HostSampleRate);
+				return [model](double audio) { return static_cast<double>(model->Step(audio, 0.0, 5.0, 0.0)); };
+			}),
+			SilentTail("resampler_x4_order7", "Resampler", 4, []()
+			{
+				std::shared_ptr<Resampler> resampler = CreateResampler<Resampler>();
+				return [resampler](double audio) { return resampler->Downsample(resampler->Upsample(audio)); };
+			}),
+		};
+	}
+
+	inline std::vector<Workload> AllWorkloads()
+	{
+		using X4Resampler_Order9 = tfdsp::X4Resampler<tfdsp::X2Resampler_Order9>;
+		std::vector<Workload> workloads{
+			DiodeLadder<tfdsp::DummyResampler>(),
+			DiodeLadder<tfdsp::X2Resampler_Order7>(),
+			DiodeLadder<tfdsp::X4Resampler_Order7>(),
+			Arp4072<tfdsp::DummyResampler>(),
+			Arp4072<tfdsp::X2Resampler_Order7>(),
+			Arp4072<tfdsp::X4Resampler_Order7>(),
+			Arp4019<tfdsp::DummyResampler>(),
+			Arp4019<tfdsp::X2Resampler_Order7>(),
+			Arp4019<tfdsp::X4Resampler_Order7>(),
+			Tb303<tfdsp::DummyResampler>(),
+			Tb303<tfdsp::X2Resampler_Order7>(),
+			Tb303<tfdsp::X4Resampler_Order7>(),
+			Tb303VoiceCore<tfdsp::X2Resampler_Order7>(),
+			Tb303VoiceCore<tfdsp::X4Resampler_Order7>(),
+			Tb303Chain<tfdsp::X2Resampler_Order7, false>(),
+			Tb303Chain<tfdsp::X2Resampler_Order7, true>(),
+			Tb303Chain<tfdsp::X4Resampler_Order7, false>(),
+			Tb303Chain<tfdsp::X4Resampler_Order7, true>(),
+			Wavefold<tfdsp::DummyResampler>(),
+			Wavefold<tfdsp::X2Resampler_Order7>(),
+			Wavefold<tfdsp::X4Resampler_Order7>(),
+			Wavefold<tfdsp::X16Resampler_Order7>(),
+			StackedVoices(),
+			Vdpo<tfdsp::X2Resampler_Order7>(),
+			Vdpo<tfdsp::X4Resampler_Order7>(),
+			ResamplerRoundTrip<tfdsp::X2Resampler_Order5>("x2_order5"),
+			ResamplerRoundTrip<tfdsp::X2Resampler_Order7>("x2_order7"),
+			ResamplerRoundTrip<tfdsp::X2Resampler_Order9>("x2_order9"),
+			ResamplerRoundTrip<tfdsp::X4Resampler_Order7>("x4_order7"),
+			ResamplerRoundTrip<X4Resampler_Order9>("x4_order9"),
+			ResamplerRoundTrip<tfdsp::X16Resampler_Order7>("x16_order7"),
+		};
+		const auto tails = SilentTails();
+		workloads.insert(workloads.end(), tails.begin(), tails.end());
+		return workloads;
+	}
+
+	/** Median wall time per host sample over `repeats` renders of `hostSamples`, after one warm-up render. */
+	inline double MeasureNanosecondsPerSample(const Renderer& render, int hostSamples,
+		int repeats, double& checksum)
+	{
+		checksum += render(hostSamples);
+		std::vector<double> timings;
+		for (int repeat = 0; repeat < std::max(repeats, 1); ++repeat)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			checksum += render(hostSamples);
+			const auto stop = std::chrono::steady_clock::now();
+			timings.push_back(std::chrono::duration<double, std::nano>(stop - start).count() /
+				hostSamples);
+		}
+		std::nth_element(timings.begin(), timings.begin() + timings.size() / 2, timings.end());
+		return timings[timings.size() / 2];
+	}
+
+	/** Share of one core used by `channels` instances at the host rate, in percent. */
+	inline double CorePercent(double nanosecondsPerSample, int channels)
+	{
+		return 100.0 * nanosecondsPerSample * 1.0e-9 * HostSampleRate * channels;
+	}
+}
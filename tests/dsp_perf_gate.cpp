@@ -0,0 +1,211 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dsp_bench_workloads.hpp"
+#include "tfdsp/denormal.hpp"
+
+/**
+ * Performance regression gate.
+ *
+ * Every benchmark workload is timed and divided by the time of a fixed
+ * calibration loop measured in the same process, so the stored costs are in
+ * "calibration units" and mostly independent of the machine running the test.
+ * The gate fails when a workload costs more than (1 + threshold) times its
+ * checked-in baseline. Like a Rack engine thread, it flushes denormals while
+ * timing.
+ *
+ * Usage: triggerfish_dsp_perf_gate --baseline path [--threshold 0.25] [--update]
+ * The threshold can also be set with TRIGGERFISH_PERF_THRESHOLD. --update
+ * rewrites the baseline from the current build instead of checking it.
+ */
+namespace
+{
+	struct Options
+	{
+		std::string baselinePath;
+		double threshold{ 0.25 };
+		int samples{ 24000 };
+		int repeats{ 5 };
+		bool update{};
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		if (const char* threshold = std::getenv("TRIGGERFISH_PERF_THRESHOLD"))
+			options.threshold = std::atof(threshold);
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (argument == "--baseline" && hasValue)
+				options.baselinePath = argv[++i];
+			else if (argument == "--threshold" && hasValue)
+				options.threshold = std::atof(argv[++i]);
+			else if (argument == "--samples" && hasValue)
+				options.samples = std::max(std::atoi(argv[++i]), 1);
+			else if (argument == "--repeats" && hasValue)
+				options.repeats = std::max(std::atoi(argv[++i]), 1);
+			else if (argument == "--update")
+				options.update = true;
+			else
+				return false;
+		}
+		return !options.baselinePath.empty() && options.threshold > 0.0;
+	}
+
+	// Scalar double arithmetic, a libm transcendental and a loop carried
+	// dependency: the same mix of work as the models' inner loops.
+	tfbench::Renderer CalibrationLoop()
+	{
+		auto state = std::make_shared<double>(0.0);
+		return [state](int hostSamples)
+		{
+			const tfbench::Signals& signals = tfbench::TestSignals();
+			double y = *state;
+			for (int i = 0; i < hostSamples; ++i)
+			{
+				const double x = signals.audio[i % tfbench::Signals::Length];
+				for (int stage = 0; stage < 4; ++stage)
+					y += 0.1 * (std::tanh(x - y) - 0.01 * y);
+			}
+			*state = y;
+			return y;
+		};
+	}
+
+	// Reads the flat {"costs": {"name": value, ...}} object written by WriteBaseline.
+	std::map<std::string, double> ReadBaseline(const std::string& path)
+	{
+		std::ifstream file(path);
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		const std::string text = buffer.str();
+		std::map<std::string, double> costs;
+		const auto section = text.find("\"costs\"");
+		if (section == std::string::npos)
+			return costs;
+		std::size_t position = text.find('{', section);
+		const std::size_t end = text.find('}', position);
+		while (position != std::string::npos && position < end)
+		{
+			const auto nameStart = text.find('"', position + 1);
+			if (nameStart == std::string::npos || nameStart > end)
+				break;
+			const auto nameEnd = text.find('"', nameStart + 1);
+			const auto colon = text.find(':', nameEnd);
+			costs[text.substr(nameStart + 1, nameEnd - nameStart - 1)] =
+				std::strtod(text.c_str() + colon + 1, nullptr);
+			position = text.find(',', colon);
+		}
+		return costs;
+	}
+
+	void WriteBaseline(const std::string& path, const std::map<std::string, double>& costs)
+	{
+		std::ofstream file(path);
+		file << "{\n";
+		file << "  \"description\": \"Workload cost per host sample divided by the calibration loop cost, "
+			"regenerate with triggerfish_dsp_perf_gate --update\",\n";
+		file << "  \"costs\": {\n";
+		std::size_t index = 0;
+		for (const auto& [name, cost] : costs)
+		{
+			char line[256];
+			std::snprintf(line, sizeof(line), "    \"%s\": %.4f%s\n", name.c_str(), cost,
+				++index < costs.size() ? "," : "");
+			file << line;
+		}
+		file << "  }\n}\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cerr << "usage: triggerfish_dsp_perf_gate --baseline path [--threshold 0.25] "
+			"[--samples n] [--repeats n] [--update]\n";
+		return 2;
+	}
+
+	tfdsp::ScopedFlushDenormals flushDenormals;
+	double checksum = 0.0;
+	const auto calibration = CalibrationLoop();
+	const auto measureCalibration = [&]()
+	{
+		return tfbench::MeasureNanosecondsPerSample(calibration, options.samples,
+			options.repeats, checksum);
+	};
+	const double calibrationBefore = measureCalibration();
+
+	std::map<std::string, double> costs;
+	std::map<std::string, tfbench::Renderer> renderers;
+	for (const auto& workload : tfbench::AllWorkloads())
+	{
+		renderers[workload.name] = workload.create();
+		costs[workload.name] = tfbench::MeasureNanosecondsPerSample(
+			renderers[workload.name], options.samples, options.repeats, checksum);
+	}
+	const double calibrationUnit = 0.5 * (calibrationBefore + measureCalibration());
+	for (auto& [name, cost] : costs)
+		cost /= calibrationUnit;
+
+	if (options.update)
+	{
+		WriteBaseline(options.baselinePath, costs);
+		std::printf("wrote %zu baseline costs to %s (calibration %.1f ns)\n", costs.size(),
+			options.baselinePath.c_str(), calibrationUnit);
+		return 0;
+	}
+
+	const auto baseline = ReadBaseline(options.baselinePath);
+	if (baseline.empty())
+	{
+		std::cerr << "FAIL: no baseline costs in " << options.baselinePath << '\n';
+		return 1;
+	}
+
+	std::printf("calibration %.1f ns, threshold +%.0f%%\n", calibrationUnit,
+		100.0 * options.threshold);
+	std::printf("%-30s %10s %10s %8s\n", "workload", "baseline", "current", "change");
+	int failures = 0;
+	for (auto& [name, cost] : costs)
+	{
+		const auto reference = baseline.find(name);
+		if (reference == baseline.end())
+		{
+			std::printf("%-30s %10s %10.3f %8s  (not in baseline)\n", name.c_str(), "-", cost, "-");
+			continue;
+		}
+		// Retry an apparent regression once so a scheduler hiccup does not fail the run.
+		if (cost > reference->second * (1.0 + options.threshold))
+		{
+			const double retry = tfbench::MeasureNanosecondsPerSample(renderers[name],
+				options.samples, options.repeats, checksum) / calibrationUnit;
+			cost = std::min(cost, retry);
+		}
+		const double change = cost / reference->second - 1.0;
+		const bool regressed = change > options.threshold;
+		failures += regressed ? 1 : 0;
+		std::printf("%-30s %10.3f %10.3f %+7.1f%%%s\n", name.c_str(), reference->second, cost,
+			100.0 * change, regressed ? "  REGRESSION" : "");
+	}
+	for (const auto& [name, cost] : baseline)
+		if (costs.find(name) == costs.end())
+			std::printf("%-30s %10.3f %10s %8s  (no longer measured)\n", name.c_str(), cost, "-", "-");
+
+	if (!std::isfinite(checksum))
+		std::cerr << "warning: a workload produced non-finite output\n";
+	if (failures > 0)
+		std::cerr << "FAIL: " << failures << " workload(s) regressed by more than "
+			<< 100.0 * options.threshold << "%\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <pthread.h>
+#define TRIGGERFISH_RT_INTERPOSE_LIBC 1
+#endif
+
+#include "dsp_bench_workloads.hpp"
+#include "models/ArpEnvelope.hpp"
+#include "models/VCAcore.hpp"
+#include "tfdsp/control.hpp"
+#include "tfdsp/noise.hpp"
+#include "tfdsp/random.hpp"
+
+/**
+ * Real-time safety harness.
+ *
+ * Global operator new, and on glibc also malloc and pthread_mutex_lock, are
+ * interposed. While a workload renders, every call on the rendering thread
+ * counts as a violation. Models are constructed and configured before the
+ * harness arms, as the modules do in their constructors and sample rate
+ * handlers, so only the per-sample Step and process paths are checked.
+ */
+namespace
+{
+	thread_local bool armed = false;
+	std::atomic<long> allocations{ 0 };
+	std::atomic<long> locks{ 0 };
+
+	void CountAllocation()
+	{
+		if (armed)
+			allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+#if TRIGGERFISH_RT_INTERPOSE_LIBC
+extern "C"
+{
+	void* __libc_malloc(std::size_t size);
+	void* __libc_calloc(std::size_t count, std::size_t size);
+	void* __libc_realloc(void* pointer, std::size_t size);
+	void* __libc_memalign(std::size_t alignment, std::size_t size);
+	void __libc_free(void* pointer);
+
+	void* malloc(std::size_t size)
+	{
+		CountAllocation();
+		return __libc_malloc(size);
+	}
+	void* calloc(std::size_t count, std::size_t size)
+	{
+		CountAllocation();
+		return __libc_calloc(count, size);
+	}
+	void* realloc(void* pointer, std::size_t size)
+	{
+		CountAllocation();
+		return __libc_realloc(pointer, size);
+	}
+	int posix_memalign(void** pointer, std::size_t alignment, std::size_t size)
+	{
+		CountAllocation();
+		*pointer = __libc_memalign(alignment, size);
+		return *pointer || size == 0 ? 0 : ENOMEM;
+	}
+	void* aligned_alloc(std::size_t alignment, std::size_t size)
+	{
+		CountAllocation();
+		return __libc_memalign(alignment, size);
+	}
+	void free(void* pointer)
+	{
+		__libc_free(pointer);
+	}
+
+	int pthread_mutex_lock(pthread_mutex_t* mutex)
+	{
+		using LockFunction = int (*)(pthread_mutex_t*);
+		static const LockFunction next =
+			reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+		if (armed)
+			locks.fetch_add(1, std::memory_order_relaxed);
+		return next(mutex);
+	}
+}
+
+namespace
+{
+	void* RawAllocate(std::size_t size) { return __libc_malloc(size); }
+	void* RawAllocateAligned(std::size_t size, std::size_t alignment) { return __libc_memalign(alignment, size); }
+	void RawFree(void* pointer) { __libc_free(pointer); }
+}
+#else
+namespace
+{
+	void* RawAllocate(std::size_t size) { return std::malloc(size); }
+	void* RawAllocateAligned(std::size_t size, std::size_t alignment)
+	{
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	}
+	void RawFree(void* pointer) { std::free(pointer); }
+}
+#endif
+
+void* operator new(std::size_t size)
+{
+	CountAllocation();
+	if (void* pointer = RawAllocate(size == 0 ? 1 : size))
+		return pointer;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	CountAllocation();
+	if (void* pointer = RawAllocateAligned(size == 0 ? 1 : size, static_cast<std::size_t>(alignment)))
+		return pointer;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+void operator delete(void* pointer) noexcept { RawFree(pointer); }
+void operator delete[](void* pointer) noexcept { RawFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { RawFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { RawFree(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { RawFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { RawFree(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { RawFree(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { RawFree(pointer); }
+
+namespace
+{
+	using tfbench::HostSampleRate;
+	using tfbench::Renderer;
+	using tfbench::Signals;
+	using tfbench::TestSignals;
+	using tfbench::Workload;
+
+	// Models driven by the modules which are not part of the benchmark set.
+	std::vector<Workload> ModuleWorkloads()
+	{
+		std::vector<Workload> workloads;
+		workloads.push_back({ "vca_transistor_core", "VCACore", 2, []() -> Renderer
+		{
+			auto vca = std::make_shared<VCA_TransistorCore<tfdsp::X2Resampler_Order7>>(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			vca->SetSampleRate(static_cast<float>(HostSampleRate));
+			return [vca](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const int index = i % Signals::Length;
+					sum += vca->StepControls(static_cast<float>(signals.audio[index]),
+						static_cast<float>(0.5 + 0.4 * signals.slow[index]), 0.2f, 20.0f, 1.0f);
+				}
+				return sum;
+			};
+		} });
+		workloads.push_back({ "vca_ota_core", "VCACore", 2, []() -> Renderer
+		{
+			auto vca = std::make_shared<VCA_OTACore<tfdsp::X2Resampler_Order7>>(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			vca->SetSampleRate(static_cast<float>(HostSampleRate));
+			return [vca](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+					sum += vca->Step(static_cast<float>(signals.audio[i % Signals::Length]), 0.5f, 1.0f);
+				return sum;
+			};
+		} });
+		workloads.push_back({ "vca_transistor_bank_16", "VCACoreBank", 2, []() -> Renderer
+		{
+			auto vca = std::make_shared<VCA_TransistorCoreBank<tfdsp::X2Resampler_Order7>>(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			vca->SetSampleRate(static_cast<float>(HostSampleRate));
+			return [vca](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				std::array<float, 16> audio{};
+				std::array<float, 16> linear{};
+				std::array<float, 16> exponential{};
+				std::array<float, 16> output{};
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					for (int channel = 0; channel < 16; ++channel)
+					{
+						audio[channel] = static_cast<float>(signals.audio[(i + 37 * channel) % Signals::Length]);
+						linear[channel] = 0.5f;
+						exponential[channel] = 0.2f;
+					}
+					// Drop and restore channels so the channel reset path is exercised too.
+					const int channels = (i / 1000) % 2 == 0 ? 16 : 9;
+					vca->StepControls(audio.data(), linear.data(), exponential.data(), 20.0f, 1.0f,
+						output.data(), channels);
+					sum += output[0];
+				}
+				return sum;
+			};
+		} });
+		workloads.push_back({ "vdpo_bank_16", "VdpSplitOscillatorBank", 4, []() -> Renderer
+		{
+			auto bank = std::make_shared<VdpSplitOscillatorBank<tfdsp::X4Resampler_Order7>>(
+				tfdsp::CreateX4Resampler_Cheby7);
+			bank->SetSampleRate(HostSampleRate);
+			return [bank](int hostSamples)
+			{
+				const Signals& signals = TestSignals();
+				std::array<double, 16> input{};
+				std::array<double, 16> damping{};
+				std::array<double, 16> log2W{};
+				std::array<float, 16> output{};
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					for (int channel = 0; channel < 16; ++channel)
+					{
+						input[channel] = 0.1 * signals.audio[i % Signals::Length];
+						damping[channel] = 0.5 + 0.5 * channel;
+						log2W[channel] = std::log2(6.283185307179586 * 110.0 * (1 + channel));
+					}
+					bank->StepLogAngularFrequency(input.data(), damping.data(), log2W.data(),
+						output.data(), 16);
+					sum += output[3];
+				}
+				return sum;
+			};
+		} });
+		workloads.push_back({ "noise_sources", "PinkNoiseSource", 1, []() -> Renderer
+		{
+			auto pink = std::make_shared<tfdsp::PinkNoiseSource>();
+			auto white = std::make_shared<tfdsp::WhiteNoiseSource>();
+			return [pink, white](int hostSamples)
+			{
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+					sum += pink->Step() + white->Step();
+				return sum;
+			};
+		} });
+		workloads.push_back({ "smooth_ornstein_uhlenbeck", "SmoothOrnsteinUhlenbeck", 1, []() -> Renderer
+		{
+			struct Drift
+			{
+				tfdsp::SmoothOrnsteinUhlenbeck xoshiroDrift{};
+				tfdsp::SmoothOrnsteinUhlenbeck standardDrift{};
+				tfdsp::Xoshiro128PlusPlus xoshiro{ 7u };
+				std::minstd_rand standard{ 7u };
+			};
+			auto drift = std::make_shared<Drift>();
+			drift->xoshiroDrift.ConfigureStationary(HostSampleRate, 0.5, 1.0, 1000.0);
+			drift->standardDrift.ConfigureStationary(HostSampleRate, 0.5, 1.0, 1000.0);
+			return [drift](int hostSamples)
+			{
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+					sum += drift->xoshiroDrift.Step(drift->xoshiro) +
+						drift->standardDrift.Step(drift->standard);
+				return sum;
+			};
+		} });
+		workloads.push_back({ "ornstein_uhlenbeck_bank", "OrnsteinUhlenbeckBank", 1, []() -> Renderer
+		{
+			using Bank = tfdsp::OrnsteinUhlenbeckBank<3 * 7 * 16>;
+			auto bank = std::make_shared<Bank>(7u);
+			bank->ConfigureStationary(HostSampleRate, 0.5, 1.0, 1000.0);
+			return [bank](int hostSamples)
+			{
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					bank->Advance();
+					sum += bank->Value(0) + bank->Value(Bank::Size - 1);
+				}
+				return sum;
+			};
+		} });
+		workloads.push_back({ "arp_envelope", "ArpEnvelope", 1, []() -> Renderer
+		{
+			auto envelope = std::make_shared<tfdsp::ArpEnvelope>();
+			envelope->SetSampleRate(HostSampleRate);
+			return [envelope](int hostSamples)
+			{
+				double sum = 0.0;
+				for (int i = 0; i < hostSamples; ++i)
+				{
+					const double gate = i % 4800 < 2400 ? 10.0 : 0.0;
+					sum += envelope->Step(gate, 0.0, 0.005, 0.2, 0.5, 0.3);
+				}
+				return sum;
+			};
+		} });
+		return workloads;
+	}
+}
+
+int main()
+{
+#if !TRIGGERFISH_RT_INTERPOSE_LIBC
+	std::cout << "note: malloc and mutex interposition need glibc, only operator new is checked\n";
+#endif
+	auto workloads = tfbench::AllWorkloads();
+	for (auto& workload : ModuleWorkloads())
+		workloads.push_back(std::move(workload));
+	(void) TestSignals();
+
+	int failures = 0;
+	double checksum = 0.0;
+	for (const auto& workload : workloads)
+	{
+		const auto render = workload.create();
+		allocations = 0;
+		locks = 0;
+		armed = true;
+		checksum += render(2 * Signals::Length);
+		armed = false;
+		const long allocated = allocations.load();
+		const long locked = locks.load();
+		if (allocated != 0 || locked != 0)
+		{
+			std::cerr << "FAIL: " << workload.name << " performed " << allocated
+				<< " heap allocation(s) and " << locked << " mutex lock(s) while rendering\n";
+			++failures;
+		}
+	}
+	if (!std::isfinite(checksum))
+	{
+		std::cerr << "FAIL: a workload produced non-finite output\n";
+		++failures;
+	}
+
+	// The harness must see allocations and locks, otherwise a pass proves nothing.
+	allocations = 0;
+	locks = 0;
+	armed = true;
+	{
+		auto probe = std::make_unique<double>(1.0);
+		checksum += *probe;
+#if TRIGGERFISH_RT_INTERPOSE_LIBC
+		pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+		pthread_mutex_lock(&mutex);
+		pthread_mutex_unlock(&mutex);
+		void* raw = std::malloc(16);
+		std::free(raw);
+#endif
+	}
+	armed = false;
+#if TRIGGERFISH_RT_INTERPOSE_LIBC
+	const bool probeSeen = allocations.load() == 2 && locks.load() == 1;
+#else
+	const bool probeSeen = allocations.load() == 1;
+#endif
+	if (!probeSeen)
+	{
+		std::cerr << "FAIL: interposed allocation and lock probes were not counted\n";
+		++failures;
+	}
+
+	if (failures == 0)
+		std::cout << "All " << workloads.size() << " real-time safety checks passed\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -1,9 +1,13 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "models/OTA1PoleIntegrator.hpp"
@@ -18,10 +22,16 @@
 #include "models/VCAcore.hpp"
 #include "models/VdpSplitOscillator.hpp"
 #include "tfdsp/control.hpp"
+#include "tfdsp/denormal.hpp"
+#include "tfdsp/handoff.hpp"
+#include "tfdsp/implicit.hpp"
 #include "tfdsp/minblep.hpp"
 #include "tfdsp/noise.hpp"
+#include "tfdsp/random.hpp"
 #include "tfdsp/nonlinear.hpp"
 #include "tfdsp/oscillator.hpp"
+#include "tfdsp/profile.hpp"
+#include "tfdsp/quality.hpp"
 #include "tfdsp/sampleRate.hpp"
 #include "tfdsp/unison.hpp"
 #include "tfdsp/unison_oscillator.hpp"
@@ -78,14 +88,76 @@ int main()
 		"stable log(cosh) discrete gradient stays finite");
 	Check(std::abs(Tanh<double, 1>::Value(1000.0, -1000.0)) < 1e-12,
 		"symmetric large discrete gradient is zero");
+	{
+		const auto reference = [](long double x, long double xPrev)
+		{
+			return (std::log(std::cosh(x)) - std::log(std::cosh(xPrev))) / (x - xPrev);
+		};
+		double maxError = 0.0;
+		for (const double midpoint : { -6.0, -1.3, -0.2, 0.0, 0.4, 2.5, 7.0 })
+		{
+			for (const double difference : { 3.0, 0.25, 2.0e-3, 1.001e-3, 0.999e-3, 2.0e-4, 1.0e-5 })
+			{
+				const double x = midpoint + 0.5 * difference;
+				const double xPrev = midpoint - 0.5 * difference;
+				maxError = std::max(maxError, static_cast<double>(std::abs(
+					Tanh<double, 1>::Value(x, xPrev) - reference(x, xPrev))));
+			}
+		}
+		Check(maxError < 1.0e-12, "fused tanh discrete gradient matches the long double quotient");
+
+		double jump = 0.0;
+		for (const double midpoint : { -3.0, -0.5, 0.1, 1.7 })
+		{
+			const double below = Tanh<double, 1>::Value(midpoint + 0.4999999e-3, midpoint - 0.4999999e-3);
+			const double above = Tanh<double, 1>::Value(midpoint + 0.5000001e-3, midpoint - 0.5000001e-3);
+			jump = std::max(jump, std::abs(above - below));
+		}
+		Check(jump < 1.0e-12, "tanh discrete gradient is continuous across the midpoint branch");
+		Check(std::abs(Tanh<double, 1>::Value(0.3, 0.3) - std::tanh(0.3)) < 1.0e-15,
+			"tanh discrete gradient reduces to tanh for equal arguments");
+
+		Eigen::Array<double, 4, 1> x;
+		Eigen::Array<double, 4, 1> xPrev;
+		x << 1.0, -2.0, 0.5, 9.0;
+		xPrev << 1.0 + 1.0e-7, 3.0, 0.5005, 8.0;
+		const Eigen::Array<double, 4, 1> block = Tanh<double, 4>::Value(x, xPrev);
+		bool blockMatches = true;
+		for (int i = 0; i < 4; ++i)
+			blockMatches = blockMatches && block(i) == Tanh<double, 1>::Value(x(i), xPrev(i));
+		Check(blockMatches, "block tanh discrete gradient matches the scalar kernel");
+
+		// Close to xPrev the difference quotient cancels, so both derivative
+		// forms must differentiate the midpoint expansion instead.
+		double derivativeError = 0.0;
+		bool derivativesMatch = true;
+		for (const double midpoint : { -2.0, -0.3, 0.0, 0.8, 4.0 })
+		{
+			const double d = 1.0e-9;
+			const double x = midpoint + 0.5 * d;
+			const double xPrev = midpoint - 0.5 * d;
+			const double t = std::tanh(midpoint);
+			const double sech2 = 1.0 - t * t;
+			const double derivative = Tanh<double, 1>::Derivative(x, xPrev);
+			derivativeError = std::max(derivativeError,
+				std::abs(derivative - (0.5 * sech2 - d / 6.0 * t * sech2)));
+			derivativesMatch = derivativesMatch && derivative ==
+				Tanh<double, 1>::Derivative(x, xPrev, Tanh<double, 1>::Value(x, xPrev));
+		}
+		Check(derivativeError < 1.0e-13,
+			"tanh discrete gradient derivative avoids cancellation near xPrev");
+		Check(derivativesMatch, "both tanh discrete gradient derivative forms agree");
+	}
 
+	const tfdsp::NewtonSolverSettings vcaSolver = tfdsp::QualitySettingsFor(
+		tfdsp::QualityTier::Standard).vcaIntegrator;
 	Transistor1PoleIntegrator transistor;
 	OTA1PoleIntegrator ota;
-	Check(std::isfinite(transistor.Step(1.0, 0.5)), "transistor solver produces finite output");
-	Check(std::isfinite(ota.Step(1.0, 0.5)), "OTA solver produces finite output");
-	Check(transistor.Step(std::numeric_limits<double>::infinity(), 0.5) == 0.0,
+	Check(std::isfinite(transistor.Step(1.0, 0.5, vcaSolver)), "transistor solver produces finite output");
+	Check(std::isfinite(ota.Step(1.0, 0.5, vcaSolver)), "OTA solver produces finite output");
+	Check(transistor.Step(std::numeric_limits<double>::infinity(), 0.5, vcaSolver) == 0.0,
 		"transistor solver rejects non-finite input");
-	Check(ota.Step(std::numeric_limits<double>::quiet_NaN(), 0.5) == 0.0,
+	Check(ota.Step(std::numeric_limits<double>::quiet_NaN(), 0.5, vcaSolver) == 0.0,
 		"OTA solver rejects non-finite input");
 
 	tfdsp::RecursiveSineOscillator sine;
@@ -213,6 +285,54 @@ int main()
 	Check(pulseSawPhaseLocked,
 		"generic saw and pulse stay phase-locked through FM and hard sync");
 
+	// Fixed-point phases wrap by integer overflow: ten steps of 0.1 cycle
+	// overshoot one cycle by exactly the rounding of the increment.
+	tfdsp::BandlimitedSawOscillator<8, 32, tfdsp::FixedPhase> fixedSaw;
+	tfdsp::BandlimitedPulseOscillator<8, 32, tfdsp::FixedPhase> fixedPhasePulse;
+	tfdsp::BandlimitedSawOscillator<> floatingSaw;
+	for (int i = 0; i < 10; ++i)
+		fixedSaw.Step(0.1);
+	Check(fixedSaw.Phase() == 4.0 / tfdsp::FixedPhase::StepsPerCycle,
+		"fixed-point phase wraps exactly by integer overflow");
+	fixedSaw.Reset();
+	bool fixedPhaseLocked = true;
+	bool fixedPhaseInRange = true;
+	double fixedSawDifference = 0.0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		const double increment = 0.03 * std::sin(
+			2.0 * 3.14159265358979323846 * i / 701.0);
+		const double sync = i % 137 == 0 ? 0.417 : -1.0;
+		const double fixedValue = fixedSaw.Step(increment, sync);
+		fixedSawDifference = std::max(fixedSawDifference,
+			std::abs(fixedValue - floatingSaw.Step(increment, sync)));
+		fixedPhasePulse.Step(increment, 0.2 + 0.6 * (i % 503) / 502.0, sync);
+		fixedPhaseLocked = fixedPhaseLocked &&
+			fixedPhasePulse.Phase() == fixedSaw.Phase();
+		fixedPhaseInRange = fixedPhaseInRange &&
+			fixedSaw.Phase() >= 0.0 && fixedSaw.Phase() < 1.0;
+	}
+	Check(fixedPhaseLocked && fixedPhaseInRange,
+		"fixed-point saw and pulse stay exactly phase-locked through-zero and through sync");
+	Check(fixedSawDifference < 1.0e-6,
+		"fixed-point saw matches the floating-point saw");
+
+	// The fixed-duty pulse's comparator phase spans the whole cycle, so duty
+	// above one half must match the floating-point pulse as well. A dyadic
+	// increment keeps both phases exact.
+	tfdsp::BandlimitedFixedPulseOscillator<tfdsp::FixedPhase> fixedPhaseFixedPulse;
+	tfdsp::BandlimitedFixedPulseOscillator<> floatingFixedPulse;
+	double fixedPulseDifference = 0.0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		const double duty = i < 10000 ? 0.8 : 0.6;
+		fixedPulseDifference = std::max(fixedPulseDifference, std::abs(
+			fixedPhaseFixedPulse.Step(3.0 / 256.0, duty) -
+			floatingFixedPulse.Step(3.0 / 256.0, duty)));
+	}
+	Check(fixedPulseDifference < 1.0e-6,
+		"fixed-point fixed-duty pulse matches the floating-point pulse above half duty");
+
 	genericPulse.Reset();
 	genericPulse.Step(0.25, 0.5);
 	for (int i = 0; i < 32; ++i)
@@ -267,7 +387,7 @@ int main()
 	Check(bandlimitedSpectrumError < 0.5 * naiveSpectrumError,
 		"generic pulse improves in-band spectrum over a sampled comparator");
 
-	tfdsp::BandlimitedFixedPulseOscillator fixedPulse;
+	tfdsp::BandlimitedFixedPulseOscillator<> fixedPulse;
 	fixedPulse.Reset();
 	naivePhase = 0.0;
 	for (int i = 0; i < spectralWarmup; ++i)
@@ -315,7 +435,7 @@ int main()
 		tfdsp::BandlimitedPulseOscillator<>::MinimumDutyCycle,
 		"generic pulse safely clamps duty cycle away from degenerate endpoints");
 
-	tfdsp::BandlimitedTriangleOscillator genericTriangle;
+	tfdsp::BandlimitedTriangleOscillator<> genericTriangle;
 	constexpr double triangleIncrement = 1500.0 / 48000.0;
 	for (int i = 0; i < 256; ++i)
 		genericTriangle.Step(triangleIncrement);
@@ -326,7 +446,7 @@ int main()
 	{
 		bandlimitedTriangle[i] = genericTriangle.Step(triangleIncrement);
 		naiveTriangle[i] =
-			tfdsp::BandlimitedTriangleOscillator::RawTriangle(naiveTrianglePhase);
+			tfdsp::BandlimitedTriangleOscillator<>::RawTriangle(naiveTrianglePhase);
 		naiveTrianglePhase += triangleIncrement;
 		naiveTrianglePhase -= std::floor(naiveTrianglePhase);
 	}
@@ -467,6 +587,38 @@ int main()
 	}
 	Check(externalPathFinite,
 		"reconstructed external folder input remains finite");
+	// A unison voice driven from another voice's reconstructed controls, with
+	// its own pitch ratio and drift offsets, matches a voice that upsamples
+	// its ratio-scaled, offset controls itself. The follower is built without
+	// interpolators of its own.
+	{
+		using Oscillator = tfdsp::WavefoldOscillator<tfdsp::X4Resampler_Order7>;
+		Oscillator leader(tfdsp::CreateX4Resampler_Cheby7);
+		Oscillator follower(tfdsp::CreateX4Resampler_Cheby7,
+			tfdsp::WavefoldControls::Shared);
+		Oscillator independent(tfdsp::CreateX4Resampler_Cheby7);
+		for (Oscillator* oscillator : { &leader, &follower, &independent })
+			oscillator->SetSampleRate(48000.0);
+		const double ratio = std::exp2(7.0 / 1200.0);
+		double sharedDifference = 0.0;
+		for (int i = 0; i < 4800; ++i)
+		{
+			const double frequency = 220.0 + 30.0 *
+				std::sin(2.0 * 3.14159265358979323846 * i / 997.0);
+			const double morph = 0.5 + 0.4 *
+				std::sin(2.0 * 3.14159265358979323846 * i / 733.0);
+			const auto& controls = leader.UpsampleControls(
+				frequency, morph, 0.6, 0.1, 0.0);
+			const auto shared = follower.StepOversampled(
+				controls, ratio, -0.05, 0.1, 0.2, false);
+			const auto expected = independent.StepWithInput(
+				frequency * ratio, morph - 0.05, 0.7, 0.3, 0.0, false);
+			sharedDifference = std::max(sharedDifference,
+				std::abs(shared.folded - expected.folded));
+		}
+		Check(sharedDifference < 1.0e-6,
+			"unison voices can share one control reconstruction");
+	}
 	using X4Wavefolder =
 		tfdsp::WavefoldOscillator<tfdsp::X4Resampler_Order7>;
 	Check(std::abs(X4Wavefolder::FoldScaleForFrequency(100.0) - 1.0) <
@@ -522,6 +674,99 @@ int main()
 	Check(std::abs(stationaryVariance - 4.0) < 0.35,
 		"stationary OU configuration preserves requested variance");
 
+	tfdsp::InterpolatedOrnsteinUhlenbeck fastOu;
+	fastOu.ConfigureStationary(100.0, 0.5, 2.0, 100.0);
+	tfdsp::Xoshiro128PlusPlus fastRng{2024};
+	double fastSum = 0.0;
+	double fastSumSquares = 0.0;
+	for (int i = 0; i < stationarySamples + stationaryWarmup; ++i)
+	{
+		const double value = fastOu.Step(fastRng);
+		if (i >= stationaryWarmup)
+		{
+			fastSum += value;
+			fastSumSquares += value * value;
+		}
+	}
+	const double fastMean = fastSum / stationarySamples;
+	Check(std::abs(fastMean) < 0.12 && std::abs(fastSumSquares /
+		stationarySamples - fastMean * fastMean - 4.0) < 0.35,
+		"xoshiro ziggurat drives the OU process with the requested variance");
+	tfdsp::InterpolatedOrnsteinUhlenbeck replayOuA;
+	tfdsp::InterpolatedOrnsteinUhlenbeck replayOuB;
+	replayOuA.ConfigureStationary(1000.0, 0.5, 1.0, 100.0);
+	replayOuB.ConfigureStationary(1000.0, 0.5, 1.0, 100.0);
+	tfdsp::Xoshiro128PlusPlus replayRngA{77};
+	tfdsp::Xoshiro128PlusPlus replayRngB{77};
+	bool replayMatches = true;
+	for (int i = 0; i < 5000; ++i)
+		replayMatches = replayMatches &&
+			replayOuA.Step(replayRngA) == replayOuB.Step(replayRngB);
+	Check(replayMatches, "seeded OU drift is reproducible");
+
+	{
+		tfdsp::Xoshiro128PlusPlusLanes<4> lanesA{99};
+		tfdsp::Xoshiro128PlusPlusLanes<4> lanesB{99};
+		std::array<std::uint32_t, 4> wordsA{};
+		std::array<std::uint32_t, 4> wordsB{};
+		lanesA.Next(wordsA);
+		lanesB.Next(wordsB);
+		Check(wordsA == wordsB && wordsA[0] != wordsA[1] &&
+			wordsA[1] != wordsA[2] && wordsA[2] != wordsA[3],
+			"xoshiro lanes are seeded reproducibly with distinct streams");
+
+		constexpr int gaussianSamples = 400000;
+		std::vector<float> gaussian(gaussianSamples);
+		tfdsp::Xoshiro128PlusPlusLanes<8> gaussianRng{1234};
+		tfdsp::ZigguratGaussian::Fill(gaussianRng, gaussian.data(),
+			gaussianSamples);
+		double moment1 = 0.0;
+		double moment2 = 0.0;
+		double moment4 = 0.0;
+		int tail = 0;
+		for (float value : gaussian)
+		{
+			moment1 += value;
+			moment2 += static_cast<double>(value) * value;
+			moment4 += static_cast<double>(value) * value * value * value;
+			tail += std::abs(value) > 3.0f ? 1 : 0;
+		}
+		moment1 /= gaussianSamples;
+		moment2 /= gaussianSamples;
+		moment4 /= gaussianSamples;
+		const double tailFraction = static_cast<double>(tail) / gaussianSamples;
+		Check(std::abs(moment1) < 0.01 && std::abs(moment2 - 1.0) < 0.01 &&
+			std::abs(moment4 - 3.0) < 0.08,
+			"ziggurat Gaussian matches the normal moments");
+		Check(std::abs(tailFraction - 0.0026998) < 0.0006,
+			"ziggurat Gaussian keeps the normal tail");
+
+		tfdsp::PinkNoiseSource pinkSteps;
+		tfdsp::PinkNoiseSource pinkBlock;
+		pinkSteps.Seed(5);
+		pinkBlock.Seed(5);
+		std::array<float, 100> block{};
+		pinkBlock.Process(block.data(), static_cast<int>(block.size()));
+		float pinkError = 0.0f;
+		tfdsp::PinkNoiseSource pinkReference;
+		pinkReference.Seed(5);
+		std::array<float, 100> white{};
+		tfdsp::WhiteNoiseSource whiteReference;
+		whiteReference.Seed(5);
+		whiteReference.Process(white.data(), static_cast<int>(white.size()));
+		for (std::size_t i = 0; i < block.size(); ++i)
+			pinkError = std::max(pinkError, std::abs(block[i] -
+				pinkReference.Filter3dbPerOctave(white[i])));
+		Check(pinkError < 1.0e-6,
+			"block pinking matches the per-sample pinking filter");
+		bool stepsMatch = true;
+		tfdsp::PinkNoiseSource pinkReplay;
+		pinkReplay.Seed(5);
+		for (int i = 0; i < 100; ++i)
+			stepsMatch = stepsMatch && pinkSteps.Step() == pinkReplay.Step();
+		Check(stepsMatch, "seeded pink noise is reproducible");
+	}
+
 	tfdsp::SmoothOrnsteinUhlenbeck smoothOu;
 	smoothOu.ConfigureStationary(1000.0, 0.5, 1.0, 100.0);
 	CountingGenerator smoothRng;
@@ -559,6 +804,96 @@ int main()
 		"smooth OU process preserves requested stationary variance");
 	Check(smoothDifferenceRms < 0.004,
 		"smooth OU process suppresses rapid parameter movement");
+	{
+		// The bank's processes share one clock but must keep the statistics of
+		// independent smooth OU processes.
+		constexpr int BankSize = 12;
+		tfdsp::OrnsteinUhlenbeckBank<BankSize> bank(2024);
+		bank.ConfigureStationary(1000.0, 0.5, 1.0, 100.0);
+		bank.Reset();
+		double bankSum = 0.0;
+		double bankSumSquares = 0.0;
+		double bankCrossProducts = 0.0;
+		double bankDifferenceSquares = 0.0;
+		std::array<double, BankSize> previous{};
+		constexpr int bankSamples = 100000;
+		for (int i = 0; i < bankSamples + smoothWarmup; ++i)
+		{
+			bank.Advance();
+			if (i < smoothWarmup)
+			{
+				for (int process = 0; process < BankSize; ++process)
+					previous[process] = bank.Value(process);
+				continue;
+			}
+			for (int process = 0; process < BankSize; ++process)
+			{
+				const double value = bank.Value(process);
+				bankSum += value;
+				bankSumSquares += value * value;
+				const double difference = value - previous[process];
+				bankDifferenceSquares += difference * difference;
+				previous[process] = value;
+			}
+			bankCrossProducts += bank.Value(0) * bank.Value(1);
+		}
+		const double bankCount = static_cast<double>(bankSamples) * BankSize;
+		const double bankMean = bankSum / bankCount;
+		const double bankVariance = bankSumSquares / bankCount - bankMean * bankMean;
+		Check(std::abs(bankMean) < 0.15 && std::abs(bankVariance - 1.0) < 0.12,
+			"OU bank processes keep the requested stationary statistics");
+		Check(std::abs(bankCrossProducts / bankSamples) < 0.3,
+			"OU bank processes are independent");
+		Check(std::sqrt(bankDifferenceSquares / bankCount) < 0.004,
+			"OU bank processes move as smoothly as the per-sample smoother");
+
+		// Unsmoothed banks play back the raw processes, configured by diffusion
+		// like InterpolatedOrnsteinUhlenbeck: diffusion 2 over a 0.5 s time
+		// constant is a unit stationary deviation.
+		tfdsp::OrnsteinUhlenbeckBank<BankSize, false> rawBank(2025);
+		rawBank.Configure(1000.0, 0.5, 2.0, 100.0);
+		double rawSum = 0.0;
+		double rawSumSquares = 0.0;
+		double rawCrossProducts = 0.0;
+		for (int i = 0; i < bankSamples + smoothWarmup; ++i)
+		{
+			rawBank.Advance();
+			if (i < smoothWarmup)
+				continue;
+			for (int process = 0; process < BankSize; ++process)
+			{
+				const double value = rawBank.Value(process);
+				rawSum += value;
+				rawSumSquares += value * value;
+			}
+			rawCrossProducts += rawBank.Value(0) * rawBank.Value(1);
+		}
+		const double rawMean = rawSum / bankCount;
+		const double rawVariance = rawSumSquares / bankCount - rawMean * rawMean;
+		Check(std::abs(rawMean) < 0.15 && std::abs(rawVariance - 1.0) < 0.12 &&
+			std::abs(rawCrossProducts / bankSamples) < 0.3,
+			"unsmoothed OU bank keeps independent stationary statistics");
+		rawBank.Configure(1024.0, 0.5, 2.0, 128.0);
+		rawBank.Reset();
+		rawBank.Advance(8);
+		Check(std::abs(rawBank.Value(3, 4) -
+			0.5 * (rawBank.Value(3) + rawBank.Value(3, 8))) < 1.0e-12,
+			"unsmoothed OU bank interpolates linearly within a control interval");
+
+		// Eight samples per control interval keep the phase exact.
+		bank.ConfigureStationary(1024.0, 0.5, 1.0, 128.0);
+		bank.Reset();
+		bank.Advance(16);
+		const double ahead = bank.Value(5, 3);
+		const double intervalEnd = bank.Value(5, 8);
+		Check(bank.Value(5, 30) == intervalEnd,
+			"OU bank lookahead holds the interval end past a control tick");
+		bank.Advance(3);
+		const bool lookaheadMatches = std::abs(bank.Value(5) - ahead) < 1.0e-12;
+		bank.Advance(5);
+		Check(lookaheadMatches && std::abs(bank.Value(5) - intervalEnd) < 1.0e-12,
+			"OU bank lookahead matches the values reached by advancing");
+	}
 	Check(tfdsp::UnisonSpreadCents(0.0) == 0.0 &&
 		std::abs(tfdsp::UnisonSpreadCents(0.5) - 7.1875) < 1.0e-12 &&
 		tfdsp::UnisonSpreadCents(1.0) == 50.0,
@@ -638,6 +973,35 @@ int main()
 	}
 	Check(maxExp2RelativeError < 6.0e-6,
 		"fast exp2 stays within its relative-error budget");
+	std::array<float, 16> exp2Exponents{};
+	std::array<float, 16> exp2Results{};
+	for (int i = 0; i < 16; ++i)
+		exp2Exponents[i] = -3.0f + 0.37f * i;
+	tfdsp::Exp2Taylor5(exp2Exponents, exp2Results);
+	bool exp2ArrayMatches = true;
+	for (int i = 0; i < 16; ++i)
+		exp2ArrayMatches = exp2ArrayMatches &&
+			exp2Results[i] == tfdsp::Exp2Taylor5(exp2Exponents[i]);
+	Check(exp2ArrayMatches, "array exp2 matches the scalar approximation");
+	double maxExp2NearZeroError = 0.0;
+	for (int i = 0; i <= 20000; ++i)
+	{
+		const double exponent = (-1.0 + 2.0 * i / 20000.0) / 12.0;
+		maxExp2NearZeroError = std::max(maxExp2NearZeroError,
+			std::abs(tfdsp::Exp2NearZero(exponent) / std::exp2(exponent) - 1.0));
+	}
+	Check(maxExp2NearZeroError < 6.0e-9,
+		"small-exponent exp2 stays within its relative-error budget");
+	double maxCosineCycleError = 0.0;
+	for (int i = 0; i <= 200000; ++i)
+	{
+		const double phase = -1.0 + 3.0 * i / 200000.0;
+		maxCosineCycleError = std::max(maxCosineCycleError, std::abs(
+			tfdsp::CosineCycle(phase) - std::cos(
+			6.283185307179586476925286766559 * phase)));
+	}
+	Check(maxCosineCycleError < 4.0e-9,
+		"polynomial cosine stays within its absolute-error budget");
 
 	Check(tfdsp::detune::linear(5.0, 0.0) == 5.0,
 		"linear detune preserves pitch exactly when drift is zero");
@@ -676,7 +1040,7 @@ int main()
 	Check(Arp4072::StageBaseResistanceOhms() > 212.2 &&
 		Arp4072::StageBaseResistanceOhms() < 212.4,
 		"ARP 4072 stage model includes signal-resistor loading at each base");
-	Arp4072 arp4072(tfdsp::CreateX4Resampler_Cheby7);
+	Arp4072 arp4072(tfdsp::MakeX4Resampler_Cheby7());
 	arp4072.SetSampleRate(48000.0);
 	double arpPeak = 0.0;
 	bool arpFinite = true;
@@ -711,7 +1075,7 @@ int main()
 		"ARP 4072 extreme 4x stress converges without solver failures");
 
 	using Arp4072NoNewton = tfdsp::Arp4072Filter<tfdsp::DummyResampler, 0>;
-	Arp4072NoNewton arpFallback(tfdsp::CreateDummyResampler);
+	Arp4072NoNewton arpFallback(tfdsp::DummyResampler{});
 	arpFallback.SetSampleRate(48000.0);
 	const auto fallbackState = arpFallback.State();
 	const double fallbackOutput = arpFallback.Step(5.0, 1000.0, 1.0);
@@ -720,7 +1084,7 @@ int main()
 		"ARP 4072 solver failure holds the previous valid state");
 
 	using Arp4072X2 = tfdsp::Arp4072Filter<tfdsp::X2Resampler_Order7>;
-	Arp4072X2 arpPostSafety(tfdsp::CreateX2Resampler_Chebychev7);
+	Arp4072X2 arpPostSafety(tfdsp::MakeX2Resampler_Chebychev7());
 	arpPostSafety.SetSampleRate(48000.0);
 	double arpPostSafetyPeak = 0.0;
 	for (int i = 0; i < 4096; ++i)
@@ -874,7 +1238,7 @@ int main()
 	Check(replaceWithExternal.linear == 0.0 &&
 		replaceWithExternal.exponential == 2.0,
 		"VCA EXT routing replaces the envelope and retains modulation law");
-	Arp4019 arp4019(tfdsp::CreateX4Resampler_Cheby7);
+	Arp4019 arp4019(tfdsp::MakeX4Resampler_Cheby7());
 	arp4019.SetSampleRate(48000.0);
 	double arpVcaLinearPeak = 0.0;
 	double arpVcaExponentialPeak = 0.0;
@@ -905,8 +1269,8 @@ int main()
 		10.0, 0.0) == 0.0f,
 		"ARP 4019 rejects non-finite input");
 
-	Arp4072 arpVoiceFilter(tfdsp::CreateX4Resampler_Cheby7);
-	Arp4019 arpVoiceVca(tfdsp::CreateX4Resampler_Cheby7);
+	Arp4072 arpVoiceFilter(tfdsp::MakeX4Resampler_Cheby7());
+	Arp4019 arpVoiceVca(tfdsp::MakeX4Resampler_Cheby7());
 	arpVoiceFilter.SetSampleRate(48000.0);
 	arpVoiceVca.SetSampleRate(48000.0);
 	double arpVoiceFilterPeak = 0.0;
@@ -938,9 +1302,9 @@ int main()
 	Check(std::abs(arpVoiceVcaPeak / arpVoiceFilterPeak - 1.0) < 0.04,
 		"ARP voice-core VCA preserves the filter level at unity control");
 
-	Arp4072X2 arpVoiceFilterX2(tfdsp::CreateX2Resampler_Chebychev7);
+	Arp4072X2 arpVoiceFilterX2(tfdsp::MakeX2Resampler_Chebychev7());
 	tfdsp::Arp4019Vca<tfdsp::X2Resampler_Order7> arpVoiceVcaX2(
-		tfdsp::CreateX2Resampler_Chebychev7);
+		tfdsp::MakeX2Resampler_Chebychev7());
 	arpVoiceFilterX2.SetSampleRate(48000.0);
 	arpVoiceVcaX2.SetSampleRate(48000.0);
 	double arpVoiceFilterPeakX2 = 0.0;
@@ -985,6 +1349,71 @@ int main()
 		"VCA model rejects non-finite input");
 	vca.Reset();
 
+	{
+		// The polyphonic bank solves all channels in one Newton bank and must
+		// match independent mono cores channel for channel, also once more
+		// channels widen the solve.
+		constexpr int bankChannels = 5;
+		VCA_TransistorCoreBank<tfdsp::X2Resampler_Order7> vcaBank(
+			tfdsp::CreateX2Resampler_Chebychev7);
+		vcaBank.SetSampleRate(48000.0f);
+		vcaBank.SetNoiseLevel(0.0);
+		std::array<std::unique_ptr<VCA_TransistorCore<tfdsp::X2Resampler_Order7>>,
+			bankChannels> monoVcas;
+		for (auto& mono : monoVcas)
+		{
+			mono = std::make_unique<VCA_TransistorCore<tfdsp::X2Resampler_Order7>>(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			mono->SetSampleRate(48000.0f);
+			mono->SetNoiseLevel(0.0);
+		}
+		double bankError = 0.0;
+		double bankPeak = 0.0;
+		float bankControlError = 0.0f;
+		for (int i = 0; i < 2048; ++i)
+		{
+			std::array<float, bankChannels> bankAudio{};
+			std::array<float, bankChannels> bankLinear{};
+			std::array<float, bankChannels> bankExponential{};
+			std::array<float, bankChannels> bankOutput{};
+			for (int channel = 0; channel < bankChannels; ++channel)
+			{
+				bankAudio[channel] = static_cast<float>(2.0 * std::sin(
+					2.0 * tfdsp::PI * (220.0 + 110.0 * channel) * i / 48000.0));
+				bankLinear[channel] = 0.2f + 0.3f * channel;
+				bankExponential[channel] = static_cast<float>(
+					0.25 + 0.25 * std::sin(2.0 * tfdsp::PI * 3.0 * i / 48000.0));
+			}
+			const int activeChannels = i < 1024 ? 1 : bankChannels;
+			vcaBank.StepControls(bankAudio.data(), bankLinear.data(),
+				bankExponential.data(), 20.0f, 1.5f, bankOutput.data(),
+				activeChannels);
+			for (int channel = 0; channel < activeChannels; ++channel)
+			{
+				const float mono = monoVcas[channel]->StepControls(
+					bankAudio[channel], bankLinear[channel],
+					bankExponential[channel], 20.0f, 1.5f);
+				bankError = std::max(bankError,
+					std::abs(static_cast<double>(bankOutput[channel] - mono)));
+				bankPeak = std::max(bankPeak, std::abs(static_cast<double>(mono)));
+				bankControlError = std::max(bankControlError, std::abs(
+					vcaBank.LastControl(channel) - monoVcas[channel]->LastControl()));
+			}
+		}
+		Check(bankPeak > 0.1 && bankError < 1.0e-5 && bankControlError < 1.0e-6,
+			"polyphonic VCA bank matches independent mono cores");
+
+		std::array<float, bankChannels> silentAudio{};
+		std::array<float, bankChannels> silentControl{};
+		std::array<float, bankChannels> bankOutput{};
+		silentAudio[1] = std::numeric_limits<float>::quiet_NaN();
+		vcaBank.StepControls(silentAudio.data(), silentControl.data(),
+			silentControl.data(), 20.0f, 1.0f, bankOutput.data(), bankChannels);
+		Check(bankOutput[1] == 0.0f && std::isfinite(bankOutput[0]) &&
+			std::isfinite(bankOutput[2]),
+			"polyphonic VCA bank isolates a non-finite channel");
+	}
+
 	VdpSplitOscillator<tfdsp::X4Resampler_Order7> oscillator(tfdsp::CreateX4Resampler_Cheby7);
 	oscillator.SetSampleRate(48000.0);
 	float oscillatorOutput = 0.0f;
@@ -1003,6 +1432,62 @@ int main()
 		"VDPO model rejects non-finite input");
 	oscillator.Reset();
 
+	{
+		// Voices take different substep counts (low damping at low pitch up to
+		// the stiff corner), the masked bank must still match mono voices, also
+		// once more voices widen it.
+		constexpr int bankVoices = 6;
+		VdpSplitOscillatorBank<tfdsp::X4Resampler_Order7> vdpBank(tfdsp::CreateX4Resampler_Cheby7);
+		vdpBank.SetSampleRate(48000.0);
+		std::array<std::unique_ptr<VdpSplitOscillator<tfdsp::X4Resampler_Order7>>, bankVoices> monoVoices;
+		for (auto& mono : monoVoices)
+		{
+			mono = std::make_unique<VdpSplitOscillator<tfdsp::X4Resampler_Order7>>(
+				tfdsp::CreateX4Resampler_Cheby7);
+			mono->SetSampleRate(48000.0);
+		}
+		const std::array<double, bankVoices> voiceDamping{ 0.2, 1.5, 6.0, 9.0, 3.0, 0.7 };
+		const std::array<double, bankVoices> voiceHz{ 55.0, 440.0, 3000.0, 15000.0,
+			1200.0, 110.0 };
+		double voiceError = 0.0;
+		double voicePeak = 0.0;
+		for (int i = 0; i < 4800; ++i)
+		{
+			std::array<double, bankVoices> voiceInput{};
+			std::array<double, bankVoices> voiceLog2W{};
+			std::array<float, bankVoices> voiceOutput{};
+			for (int voice = 0; voice < bankVoices; ++voice)
+			{
+				voiceInput[voice] = 0.5 * std::sin(2.0 * tfdsp::PI * 100.0 * (voice + 1) * i / 48000.0);
+				voiceLog2W[voice] = std::log2(2.0 * tfdsp::PI * voiceHz[voice]);
+			}
+			const int activeVoices = i < 2400 ? 4 : bankVoices;
+			vdpBank.StepLogAngularFrequency(voiceInput.data(), voiceDamping.data(),
+				voiceLog2W.data(), voiceOutput.data(), activeVoices);
+			for (int voice = 0; voice < activeVoices; ++voice)
+			{
+				const float mono = monoVoices[voice]->StepLogAngularFrequency(
+					voiceInput[voice], voiceDamping[voice], voiceLog2W[voice]);
+				voiceError = std::max(voiceError,
+					std::abs(static_cast<double>(voiceOutput[voice] - mono)));
+				voicePeak = std::max(voicePeak, std::abs(static_cast<double>(mono)));
+			}
+		}
+		Check(voicePeak > 0.5 && voiceError < 1.0e-6,
+			"polyphonic VDPO bank with masked substeps matches mono voices");
+
+		std::array<double, bankVoices> voiceInput{};
+		std::array<double, bankVoices> voiceLog2W{};
+		std::array<float, bankVoices> voiceOutput{};
+		voiceLog2W.fill(std::log2(2.0 * tfdsp::PI * 261.625565));
+		voiceInput[2] = std::numeric_limits<double>::quiet_NaN();
+		vdpBank.StepLogAngularFrequency(voiceInput.data(), voiceDamping.data(),
+			voiceLog2W.data(), voiceOutput.data(), bankVoices);
+		Check(voiceOutput[2] == 0.0f && std::isfinite(voiceOutput[0]) &&
+			std::isfinite(voiceOutput[3]),
+			"polyphonic VDPO bank isolates a non-finite voice");
+	}
+
 	tfdsp::Tb303SquareShaper squareShaper;
 	squareShaper.SetSampleRate(192000.0);
 	double squarePeak = 0.0;
@@ -1053,8 +1538,54 @@ int main()
 	Check(invalidTb303Output.mixed == 0.0f,
 		"TB-303 oscillator rejects non-finite controls");
 
+	{
+		// The fused cascade must reproduce a chain of separate sections, both
+		// its output and the affine preview the ladder solve relies on.
+		const auto compareCascade = [](const std::array<
+			tfdsp::AnalogRatioCascade<6>::PoleZero, 6>& poleZeros,
+			double sampleRate, double gain)
+		{
+			tfdsp::AnalogRatioCascade<6> cascade;
+			cascade.Configure(poleZeros, sampleRate, gain);
+			std::array<tfdsp::AnalogRatioSection, 6> sections{};
+			for (std::size_t i = 0; i < sections.size(); ++i)
+				sections[i].Configure(poleZeros[i].first, poleZeros[i].second,
+					sampleRate);
+			std::mt19937 generator(47);
+			std::uniform_real_distribution<double> distribution(-5.0, 5.0);
+			double maximumError = 0.0;
+			for (int i = 0; i < 20000; ++i)
+			{
+				double previewGain = 1.0;
+				double previewOffset = 0.0;
+				for (const auto& section : sections)
+				{
+					const auto affine = section.Preview();
+					previewGain *= affine.gain;
+					previewOffset = affine.gain * previewOffset + affine.offset;
+				}
+				const auto preview = cascade.Preview();
+				const double input = distribution(generator);
+				double expected = input;
+				for (auto& section : sections)
+					expected = section.Process(expected);
+				const double output = cascade.Process(input);
+				maximumError = std::max({maximumError,
+					std::abs(output - gain * expected) / gain,
+					std::abs(preview.gain - gain * previewGain) / gain,
+					std::abs(preview.offset - gain * previewOffset) / gain});
+			}
+			return maximumError;
+		};
+		Check(compareCascade({{{578.1, 0.0}, {97.5, 0.0}, {38.5, 0.0},
+			{20.0, 0.0}, {7.41, 46.5}, {4.45, 4.40}}}, 192000.0, 18.7) < 1.0e-12 &&
+			compareCascade({{{60000.0, 0.0}, {12000.0, 30000.0}, {3000.0, 900.0},
+			{800.0, 0.0}, {150.0, 2000.0}, {20.0, 10.0}}}, 96000.0, 2.5) < 1.0e-12,
+			"fused analog ratio cascade matches its separate sections to rounding");
+	}
+
 	tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> diodeFilter(
-		tfdsp::CreateX2Resampler_Chebychev7);
+		tfdsp::MakeX2Resampler_Chebychev7());
 	diodeFilter.SetSampleRate(48000.0);
 	float diodeOutput = 0.0f;
 	for (int i = 0; i < 48000; ++i)
@@ -1078,10 +1609,262 @@ int main()
 		0.5, false, 1.0, 0.0) == 0.0f,
 		"diode ladder rejects non-finite input");
 
+	{
+		const auto standard = tfdsp::QualitySettingsFor(tfdsp::QualityTier::Standard);
+		const auto eco = tfdsp::QualitySettingsFor(tfdsp::QualityTier::Eco);
+		const auto reference = tfdsp::QualitySettingsFor(tfdsp::QualityTier::Reference);
+		Check(standard.ladderFilter.maximumIterations == 8 &&
+			standard.ladderFilter.tolerance == 1.0e-11 &&
+			standard.squareShaper.maximumIterations == 8 &&
+			standard.squareShaper.tolerance == 1.0e-4 &&
+			standard.vcaIntegrator.maximumIterations == 8 &&
+			standard.vcaIntegrator.tolerance == 1.0e-6 &&
+			standard.vanDerPol.maximumSubsteps == 24 &&
+			standard.vanDerPol.maximumDampingPhase == 0.4 &&
+			standard.oversampling == 1,
+			"standard quality keeps the historical solver settings and 4x");
+		Check(eco.oversampling == 0 && reference.oversampling == 1 &&
+			tfdsp::QualityTierAt(7) == tfdsp::QualityTier::Reference &&
+			tfdsp::QualityTierAt(-1) == tfdsp::QualityTier::Eco,
+			"quality tiers select their oversampling and clamp stored indices");
+
+		// Each tier renders the same resonant phrase at 2x; Eco and Reference
+		// must stay close to Standard and within their iteration limits.
+		const auto renderLadders = [](const tfdsp::NewtonSolverSettings& solver,
+			std::vector<double>& arpOutput, std::vector<double>& diodeOutput,
+			int& maximumIterations, std::size_t& failures)
+		{
+			tfdsp::Arp4072Filter<tfdsp::X2Resampler_Order7> arp(
+				tfdsp::MakeX2Resampler_Chebychev7());
+			tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> diode(
+				tfdsp::MakeX2Resampler_Chebychev7());
+			arp.SetSampleRate(48000.0);
+			diode.SetSampleRate(48000.0);
+			arp.SetSolverSettings(solver);
+			diode.SetSolverSettings(solver);
+			maximumIterations = 0;
+			for (int i = 0; i < 9600; ++i)
+			{
+				const double input = 2.0 * std::sin(2.0 * tfdsp::PI * 110.0 * i / 48000.0);
+				const double cutoff = 300.0 + 2700.0 * (i % 2400) / 2400.0;
+				arpOutput.push_back(arp.Step(input, cutoff, 0.8));
+				maximumIterations = std::max(maximumIterations, arp.LastIterations());
+				diodeOutput.push_back(diode.Step(input, cutoff, 0.8, false, 1.0, 0.0));
+				maximumIterations = std::max(maximumIterations, diode.LastIterations());
+			}
+			failures = arp.SolverFailures() + diode.SolverFailures();
+		};
+		std::vector<double> standardArp, standardDiode, ecoArp, ecoDiode,
+			referenceArp, referenceDiode;
+		int standardIterations = 0, ecoIterations = 0, referenceIterations = 0;
+		std::size_t standardFailures = 0, ecoFailures = 0, referenceFailures = 0;
+		renderLadders(standard.ladderFilter, standardArp, standardDiode,
+			standardIterations, standardFailures);
+		renderLadders(eco.ladderFilter, ecoArp, ecoDiode, ecoIterations, ecoFailures);
+		renderLadders(reference.ladderFilter, referenceArp, referenceDiode,
+			referenceIterations, referenceFailures);
+		double ecoDifference = 0.0;
+		double referenceDifference = 0.0;
+		for (std::size_t i = 0; i < standardArp.size(); ++i)
+		{
+			ecoDifference = std::max({ecoDifference,
+				std::abs(ecoArp[i] - standardArp[i]),
+				std::abs(ecoDiode[i] - standardDiode[i])});
+			referenceDifference = std::max({referenceDifference,
+				std::abs(referenceArp[i] - standardArp[i]),
+				std::abs(referenceDiode[i] - standardDiode[i])});
+		}
+		Check(standardFailures == 0 && ecoFailures == 0 && referenceFailures == 0,
+			"ladder filters converge at every quality tier");
+		Check(ecoIterations <= eco.ladderFilter.maximumIterations &&
+			referenceIterations <= reference.ladderFilter.maximumIterations,
+			"ladder solves respect the quality tier's iteration limit");
+		Check(ecoDifference < 1.0e-3 && referenceDifference < 1.0e-5,
+			"eco and reference ladders stay close to standard quality");
+
+		const auto renderSquare = [](const tfdsp::NewtonSolverSettings& solver)
+		{
+			tfdsp::Tb303Oscillator<tfdsp::X2Resampler_Order7> oscillator(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			oscillator.SetSampleRate(48000.0);
+			oscillator.SetSolverSettings(solver);
+			std::vector<double> output;
+			for (int i = 0; i < 4800; ++i)
+				output.push_back(oscillator.Step(-1.0 + i / 2400.0, false, 0.060,
+					0.0, 0.0, false, 0.0, 1.0).square);
+			return output;
+		};
+		// Square edges need many damped Newton steps, so the iteration limit
+		// sets the accuracy. Compare RMS errors against a tightly converged
+		// solve, since edges that move by a fraction of a sample dominate any
+		// pointwise comparison.
+		const auto converged = renderSquare({tfdsp::MaximumSolverIterations, 1.0e-9});
+		const auto squareError = [&](const tfdsp::NewtonSolverSettings& solver)
+		{
+			const auto output = renderSquare(solver);
+			double sum = 0.0;
+			for (std::size_t i = 0; i < output.size(); ++i)
+				sum += (output[i] - converged[i]) * (output[i] - converged[i]);
+			return std::sqrt(sum / output.size());
+		};
+		const double ecoSquareError = squareError(eco.squareShaper);
+		const double standardSquareError = squareError(standard.squareShaper);
+		const double referenceSquareError = squareError(reference.squareShaper);
+		Check(ecoSquareError > standardSquareError &&
+			standardSquareError > referenceSquareError &&
+			referenceSquareError < 1.0e-3,
+			"square shaper accuracy rises with the quality tier");
+
+		// The VCA integrators converge within a few Newton steps at any tier,
+		// so the tiers only move the output by about their residual.
+		const auto renderVca = [](const tfdsp::NewtonSolverSettings& solver)
+		{
+			VCA_TransistorCore<tfdsp::X2Resampler_Order7> vca(
+				tfdsp::CreateX2Resampler_Chebychev7);
+			vca.SetSampleRate(48000.0f);
+			vca.SetNoiseLevel(0.0);
+			vca.SetSolverSettings(solver);
+			std::vector<double> output;
+			for (int i = 0; i < 4800; ++i)
+				output.push_back(vca.StepControls(static_cast<float>(8.0 * std::sin(
+					2.0 * tfdsp::PI * 220.0 * i / 48000.0)), 0.2f + i / 6000.0f,
+					0.3f, 20.0f, 1.0f));
+			return output;
+		};
+		const auto standardVca = renderVca(standard.vcaIntegrator);
+		const auto ecoVca = renderVca(eco.vcaIntegrator);
+		const auto referenceVca = renderVca(reference.vcaIntegrator);
+		double ecoVcaDifference = 0.0;
+		double referenceVcaDifference = 0.0;
+		for (std::size_t i = 0; i < standardVca.size(); ++i)
+		{
+			ecoVcaDifference = std::max(ecoVcaDifference,
+				std::abs(ecoVca[i] - standardVca[i]));
+			referenceVcaDifference = std::max(referenceVcaDifference,
+				std::abs(referenceVca[i] - standardVca[i]));
+		}
+		Check(ecoVcaDifference < 1.0e-3 && referenceVcaDifference < 1.0e-4,
+			"eco and reference VCA integrators stay close to standard quality");
+
+		// At high damping and pitch the Van der Pol voice substeps, and finer
+		// substeps follow a finely substepped reference more closely.
+		const auto renderVdp = [](const tfdsp::VdpSubstepSettings& substeps)
+		{
+			VdpSplitOscillator<tfdsp::X4Resampler_Order7> vdp(
+				tfdsp::CreateX4Resampler_Cheby7);
+			vdp.SetSampleRate(48000.0);
+			vdp.SetSubstepSettings(substeps);
+			std::vector<double> output;
+			for (int i = 0; i < 2400; ++i)
+				output.push_back(vdp.Step(0.0, 8.0, 2.0 * tfdsp::PI * 2000.0));
+			return output;
+		};
+		const auto finelySubstepped = renderVdp({48, 0.05});
+		const auto vdpError = [&](const tfdsp::VdpSubstepSettings& substeps)
+		{
+			const auto output = renderVdp(substeps);
+			double sum = 0.0;
+			for (std::size_t i = 0; i < output.size(); ++i)
+				sum += (output[i] - finelySubstepped[i]) *
+					(output[i] - finelySubstepped[i]);
+			return std::sqrt(sum / output.size());
+		};
+		const double ecoVdpError = vdpError(eco.vanDerPol);
+		const double standardVdpError = vdpError(standard.vanDerPol);
+		const double referenceVdpError = vdpError(reference.vanDerPol);
+		Check(ecoVdpError > standardVdpError &&
+			standardVdpError > referenceVdpError,
+			"Van der Pol accuracy rises with the quality tier");
+	}
+
+	{
+		// A zero leading entry forces a row exchange.
+		tfdsp::ImplicitMatrix<3> matrix;
+		matrix << 0.0, 2.0, 1.0,
+			1.0, 1.0, 0.0,
+			4.0, 0.0, 3.0;
+		tfdsp::ImplicitVector<3> rhs(7.0, 3.0, 13.0);
+		Check(tfdsp::SolveLinearInPlace<3>(matrix, rhs) &&
+			std::abs(rhs(0) - 1.0) < 1.0e-14 && std::abs(rhs(1) - 2.0) < 1.0e-14 &&
+			std::abs(rhs(2) - 3.0) < 1.0e-14,
+			"implicit linear solve pivots to the exact solution");
+		tfdsp::ImplicitMatrix<2> singular;
+		singular << 1.0, 2.0, 2.0, 4.0;
+		tfdsp::ImplicitVector<2> singularRhs(1.0, 2.0);
+		Check(!tfdsp::SolveLinearInPlace<2>(singular, singularRhs),
+			"implicit linear solve rejects a singular matrix");
+		// The 2x2 closed form compares the determinant with the square of the
+		// minimum pivot.
+		tfdsp::ImplicitMatrix<2> small;
+		small << 1.0e-12, 0.0, 0.0, 1.0e-12;
+		tfdsp::ImplicitMatrix<2> smallCopy = small;
+		tfdsp::ImplicitVector<2> smallRhs(1.0e-12, 2.0e-12);
+		tfdsp::ImplicitVector<2> smallRhsCopy = smallRhs;
+		Check(tfdsp::SolveLinearInPlace<2>(small, smallRhs) &&
+			std::abs(smallRhs(0) - 1.0) < 1.0e-12 &&
+			std::abs(smallRhs(1) - 2.0) < 1.0e-12 &&
+			!tfdsp::SolveLinearInPlace<2>(smallCopy, smallRhsCopy, 1.0e-10),
+			"2x2 implicit solve bounds the determinant by the squared pivot");
+
+		// x^2 + y^2 = 4 and x = y, from a guess far enough away that the step
+		// limit engages.
+		const auto circle = [](const tfdsp::ImplicitVector<2>& x,
+			tfdsp::ImplicitVector<2>& value)
+		{
+			value << x(0) * x(0) + x(1) * x(1) - 4.0, x(0) - x(1);
+		};
+		const auto circleJacobian = [](const tfdsp::ImplicitVector<2>& x,
+			tfdsp::ImplicitMatrix<2>& matrix)
+		{
+			matrix << 2.0 * x(0), 2.0 * x(1), 1.0, -1.0;
+		};
+		tfdsp::ImplicitVector<2> point(20.0, 1.0);
+		const auto solved = tfdsp::SolveNewton<2>(point, circle, circleJacobian,
+			{tfdsp::MaximumSolverIterations, 1.0e-12}, tfdsp::MaximumNewtonStep{2.0});
+		Check(solved.converged && solved.iterations > 2 &&
+			std::abs(point(0) - std::sqrt(2.0)) < 1.0e-12 &&
+			std::abs(point(1) - std::sqrt(2.0)) < 1.0e-12,
+			"damped Newton kernel converges on a nonlinear system");
+
+		tfdsp::ImplicitVector<2> limited(20.0, 1.0);
+		const auto exhausted = tfdsp::SolveNewton<2>(limited, circle,
+			circleJacobian, {2, 1.0e-12}, tfdsp::MaximumNewtonStep{2.0});
+		Check(!exhausted.converged && exhausted.iterations == 2 &&
+			std::abs(limited(0) - 16.0) < 1.0e-12,
+			"Newton kernel reports an exhausted iteration limit");
+
+		tfdsp::ImplicitVector<2> origin(0.0, 0.0);
+		const auto stalled = tfdsp::SolveNewton<2>(origin, circle,
+			circleJacobian, {8, 1.0e-12});
+		Check(!stalled.converged && stalled.iterations == 1 && origin.isZero(),
+			"Newton kernel stops on a singular Jacobian");
+
+		// x^2 = a per lane: one lane iterates, one starts at its root, one has
+		// a zero derivative and one a NaN target. Each stops on its own.
+		tfdsp::LaneVector<4> target(4.0, 2.25, 1.0,
+			std::numeric_limits<double>::quiet_NaN());
+		tfdsp::LaneVector<4> lanes(3.0, 1.5, 0.0, 1.0);
+		const auto laneTelemetry = tfdsp::SolveNewtonLanes<4>(lanes,
+			[&](const tfdsp::LaneVector<4>& x, tfdsp::LaneVector<4>& value)
+			{
+				value = x * x - target;
+			},
+			[](const tfdsp::LaneVector<4>& x, tfdsp::LaneVector<4>& slope)
+			{
+				slope = 2.0 * x;
+			},
+			{8, 1.0e-12});
+		Check(laneTelemetry.converged(0) && laneTelemetry.converged(1) &&
+			!laneTelemetry.converged(2) && !laneTelemetry.converged(3) &&
+			laneTelemetry.iterations > 2 && std::abs(lanes(0) - 2.0) < 1.0e-12 &&
+			lanes(1) == 1.5 && lanes(2) == 0.0 && lanes(3) == 1.0,
+			"lane Newton kernel converges and stops each lane independently");
+	}
+
 	// The two exposed audio paths use independent decimator state. An identity
 	// post-processor must nevertheless produce the same signal as the LP path.
 	tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> dualOutputFilter(
-		tfdsp::CreateX2Resampler_Chebychev7);
+		tfdsp::MakeX2Resampler_Chebychev7());
 	dualOutputFilter.SetSampleRate(48000.0);
 	double maximumDualOutputDifference = 0.0;
 	for (int i = 0; i < 48000; ++i)
@@ -1096,6 +1879,133 @@ int main()
 	Check(maximumDualOutputDifference < 1.0e-7,
 		"diode ladder LP and post-processor decimators remain phase aligned");
 
+	// The expander bus hands the oscillator's undecimated mix to the filter.
+	// Either half of that path must match the host-rate path it replaces.
+	{
+		using Oscillator = tfdsp::Tb303Oscillator<tfdsp::X2Resampler_Order7>;
+		Oscillator hostOscillator(tfdsp::CreateX2Resampler_Chebychev7);
+		Oscillator busOscillator(tfdsp::CreateX2Resampler_Chebychev7);
+		hostOscillator.SetSampleRate(48000.0);
+		busOscillator.SetSampleRate(48000.0);
+		tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> hostFilter(
+			tfdsp::MakeX2Resampler_Chebychev7());
+		tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> busFilter(
+			tfdsp::MakeX2Resampler_Chebychev7());
+		hostFilter.SetSampleRate(48000.0);
+		busFilter.SetSampleRate(48000.0);
+		const auto interpolator = tfdsp::CreateX2Resampler_Chebychev7();
+		const auto identity = [](double audio, double) { return audio; };
+		double maximumMixDifference = 0.0;
+		double maximumFilterDifference = 0.0;
+		for (int i = 0; i < 4800; ++i)
+		{
+			const double pitch = -1.0 + 0.5 * std::sin(2.0 * tfdsp::PI * i / 4800.0);
+			const auto host = hostOscillator.Step(pitch, false, 0.060, 0.0, 0.0,
+				false, 0.3, 0.4);
+			const auto bus = busOscillator.StepOversampled(pitch, false, 0.060,
+				0.0, 0.0, false, 0.3, 0.4);
+			maximumMixDifference = std::max(maximumMixDifference, std::abs(
+				static_cast<double>(host.mixed) - busOscillator.DecimateMixed(bus.mixed)));
+
+			const auto hostFiltered = hostFilter.StepWithPostProcessorLogCutoffModulated(
+				host.mixed, 10.0, 0.0, 0.6, false, 1.0, 0.0, 1.0, identity);
+			const auto busFiltered = busFilter.StepWithPostProcessorOversampledInput(
+				interpolator->Upsample(host.mixed), 10.0, 0.0, 0.6, false, 1.0, 0.0,
+				1.0, identity);
+			maximumFilterDifference = std::max(maximumFilterDifference, std::abs(
+				static_cast<double>(hostFiltered.postProcessed) - busFiltered.postProcessed));
+		}
+		Check(maximumMixDifference == 0.0,
+			"TB-303 oversampled step decimates to the same mix as Step");
+		Check(maximumFilterDifference < 1.0e-5,
+			"diode ladder oversampled input matches its own input interpolation");
+
+		// Frames sent only over the bus skip the decimators; once reset, they
+		// decimate as if they had just been created.
+		Oscillator skipping(tfdsp::CreateX2Resampler_Chebychev7);
+		skipping.SetSampleRate(48000.0);
+		for (int i = 0; i < 480; ++i)
+			static_cast<void>(skipping.StepOversampled(-1.0, false, 0.060, 0.0,
+				0.0, false, 0.3, 0.4));
+		skipping.ResetDecimators();
+		const auto freshDecimator = tfdsp::CreateX2Resampler_Chebychev7();
+		bool decimatesFromReset = true;
+		for (int i = 0; i < 64; ++i)
+		{
+			const auto frame = skipping.StepOversampled(-1.0, false, 0.060, 0.0,
+				0.0, false, 0.3, 0.4);
+			const float expected = static_cast<float>(
+				tfdsp::RackOutputAdapter::ProcessPostDecimation(
+					freshDecimator->Downsample(frame.mixed)));
+			decimatesFromReset = decimatesFromReset &&
+				skipping.DecimateMixed(frame.mixed) == expected;
+		}
+		Check(decimatesFromReset,
+			"TB-303 decimators restart from reset after bus-only frames");
+	}
+
+	// A voice core at the other oversampling factor converts the expander
+	// frames with the stage an X4 resampler runs at its higher rate, so the
+	// conversion must split X4 resampling exactly, and a 4x oscillator must
+	// still reach a 2x filter.
+	{
+		auto reference = tfdsp::CreateX4Resampler_Cheby7();
+		auto outer = tfdsp::CreateX2Resampler_Chebychev7();
+		tfdsp::X2X4FrameConverter<tfdsp::X2Resampler_Order7> converter(
+			tfdsp::MakeX2Resampler_Chebychev7());
+		bool splitsExactly = true;
+		for (int i = 0; i < 480; ++i)
+		{
+			const double x = std::sin(2.0 * tfdsp::PI * 440.0 * i / 48000.0);
+			const Eigen::Array<double, 4, 1> expected = reference->Upsample(x);
+			const Eigen::Array<double, 4, 1> converted =
+				converter.Upsample(outer->Upsample(x));
+			splitsExactly = splitsExactly && (expected == converted).all() &&
+				reference->Downsample(expected) ==
+					outer->Downsample(converter.Downsample(converted));
+		}
+		Check(splitsExactly, "2x/4x frame converter splits X4 resampling exactly");
+
+		tfdsp::Tb303Oscillator<tfdsp::X4Resampler_Order7> oscillator(
+			tfdsp::CreateX4Resampler_Cheby7);
+		tfdsp::Tb303Oscillator<tfdsp::X4Resampler_Order7> hostOscillator(
+			tfdsp::CreateX4Resampler_Cheby7);
+		tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> busFilter(
+			tfdsp::MakeX2Resampler_Chebychev7());
+		tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7> hostFilter(
+			tfdsp::MakeX2Resampler_Chebychev7());
+		oscillator.SetSampleRate(48000.0);
+		hostOscillator.SetSampleRate(48000.0);
+		busFilter.SetSampleRate(48000.0);
+		hostFilter.SetSampleRate(48000.0);
+		converter.Reset();
+		const auto identity = [](double audio, double) { return audio; };
+		// The two paths differ in group delay, so compare levels after the
+		// start-up transient.
+		double busEnergy = 0.0;
+		double hostEnergy = 0.0;
+		for (int i = 0; i < 4800; ++i)
+		{
+			const auto bus = oscillator.StepOversampled(-1.0, false, 0.060, 0.0,
+				0.0, false, 0.3, 0.4);
+			const auto host = hostOscillator.Step(-1.0, false, 0.060, 0.0, 0.0,
+				false, 0.3, 0.4);
+			const double busFiltered = busFilter.StepWithPostProcessorOversampledInput(
+				converter.Downsample(bus.mixed), 10.0, 0.0, 0.6, false, 1.0, 0.0,
+				1.0, identity).postProcessed;
+			const double hostFiltered = hostFilter.StepWithPostProcessorLogCutoffModulated(
+				host.mixed, 10.0, 0.0, 0.6, false, 1.0, 0.0, 1.0,
+				identity).postProcessed;
+			if (i >= 480)
+			{
+				busEnergy += busFiltered * busFiltered;
+				hostEnergy += hostFiltered * hostFiltered;
+			}
+		}
+		Check(hostEnergy > 480.0 && std::abs(busEnergy / hostEnergy - 1.0) < 0.02,
+			"a 4x oscillator bus reaches a 2x filter through the frame converter");
+	}
+
 	tfdsp::OtaVcaCore otaVca;
 	constexpr double controlCurrent = 200.0e-6;
 	const double expectedGm = 0.85 * controlCurrent / (2.0 * 0.02585);
@@ -1186,6 +2096,224 @@ int main()
 		1.0, 0.0) == 0.0,
 		"TB-303 VCA wrapper rejects non-finite input");
 
+	// Release tails of the models must ring down to zero without passing
+	// through subnormals. The models run at the host rate here and without
+	// flush-to-zero, so only their own snapping is tested. The polyphase
+	// resamplers leave subnormal states to the ScopedFlushDenormals that Rack,
+	// the bindings and the tools hold around processing.
+	{
+		tfdsp::DiodeLadderFilter<tfdsp::DummyResampler> tailLadder(
+			tfdsp::DummyResampler{});
+		tfdsp::Arp4019Vca<tfdsp::DummyResampler> tailVca(
+			tfdsp::DummyResampler{});
+		tfdsp::ArpEnvelope tailEnvelope;
+		tailLadder.SetSampleRate(48000.0);
+		tailVca.SetSampleRate(48000.0);
+		tailEnvelope.SetSampleRate(48000.0);
+		int subnormals = 0;
+		const auto countSubnormal = [&](double value)
+		{
+			subnormals += std::fpclassify(value) == FP_SUBNORMAL ? 1 : 0;
+		};
+		for (int i = 0; i < 96000; ++i)
+		{
+			const double audio = i < 480 ?
+				5.0 * std::sin(2.0 * tfdsp::PI * 220.0 * i / 48000.0) : 0.0;
+			countSubnormal(tailLadder.StepLogCutoffModulated(audio, std::log2(800.0),
+				0.0, 0.6, false, 1.0, 0.0));
+			countSubnormal(tailVca.Step(audio, 0.0, 5.0, 0.0));
+			countSubnormal(tailEnvelope.Step(i < 480 ? 10.0 : 0.0, 0.0, 0.002, 0.1,
+				0.5, 0.5));
+		}
+		Check(subnormals == 0, "release tails never produce subnormal outputs");
+
+		tfdsp::ScopedFlushDenormals flushDenormals;
+		auto tailResampler = tfdsp::CreateX4Resampler_Cheby7();
+		double resamplerTail = 1.0;
+		for (int i = 0; i < 96000; ++i)
+		{
+			const double audio = i < 480 ?
+				5.0 * std::sin(2.0 * tfdsp::PI * 220.0 * i / 48000.0) : 0.0;
+			resamplerTail = tailResampler->Downsample(tailResampler->Upsample(audio));
+		}
+		Check(resamplerTail == 0.0,
+			"polyphase resampler tails reach zero with denormals flushed");
+		Check(tfdsp::SnapToZero(1.0e-31) == 0.0 && tfdsp::SnapToZero(-1.0e-20) == -1.0e-20,
+			"denormal snapping only clears values far below audio precision");
+	}
+
+	// The profiling scopes are always compiled, only the TF_PROFILE_* macros
+	// depend on TRIGGERFISH_PROFILE, so exercise the classes directly.
+	{
+		tfdsp::ProfileCounters profile;
+		const auto busy = [](int iterations)
+		{
+			volatile double sink = 0.0;
+			for (int i = 0; i < iterations; ++i)
+				sink = sink + 1.0;
+		};
+		{
+			tfdsp::ProfileScope unowned(tfdsp::ProfileSection::Envelope);
+			busy(1000);
+		}
+		{
+			tfdsp::ProfileModuleScope module(profile);
+			tfdsp::ProfileScope solver(tfdsp::ProfileSection::Solver);
+			tfdsp::ProfileScope resampling(tfdsp::ProfileSection::Resampling);
+			busy(2000000);
+		}
+		auto snapshot = profile.Read();
+		Check(snapshot.samples == 1,
+			"profile module scope counts one sample per process call");
+		Check(snapshot.ticks[static_cast<int>(tfdsp::ProfileSection::Resampling)] >
+			snapshot.ticks[static_cast<int>(tfdsp::ProfileSection::Solver)],
+			"profile scopes charge nested time to the innermost section only");
+		Check(snapshot.ticks[static_cast<int>(tfdsp::ProfileSection::Envelope)] == 0,
+			"profile scopes outside a module scope are not recorded");
+		Check(profile.ToJson("test").find("\"resampling\"") != std::string::npos,
+			"profile JSON dump lists every section");
+		profile.RequestReset();
+		{
+			tfdsp::ProfileModuleScope module(profile);
+		}
+		snapshot = profile.Read();
+		Check(snapshot.samples == 1 &&
+			snapshot.ticks[static_cast<int>(tfdsp::ProfileSection::Resampling)] == 0,
+			"profile reset is applied by the processing thread at its next sample");
+	}
+
+	{
+		struct CountedModel
+		{
+			int configured{};
+		};
+		tfdsp::LazyModelSlots<CountedModel, 4> slots;
+		int configureCalls = 0;
+		const auto configure = [&](CountedModel& model)
+		{
+			++model.configured;
+			++configureCalls;
+		};
+		const auto firstSlots = [](int count)
+		{
+			return [count](int slot) { return slot < count; };
+		};
+		const auto create = []() { return std::make_unique<CountedModel>(); };
+
+		slots.BeginProcess();
+		Check(slots.Acquire(0, configure) == nullptr,
+			"lazy slots return no model before the preparer has run");
+		slots.Prepare(firstSlots(2), create);
+		slots.BeginProcess();
+		CountedModel* first = slots.Acquire(0, configure);
+		slots.Acquire(0, configure);
+		Check(first && slots.Acquire(1, configure) && !slots.Acquire(2, configure) &&
+			first->configured == 1 && slots.OwnedCount() == 2,
+			"lazy slots publish prepared models and configure each one once");
+		slots.Invalidate();
+		slots.Acquire(0, configure);
+		Check(first->configured == 2, "lazy slot invalidation reconfigures at the next acquire");
+
+		slots.Prepare(firstSlots(1), create, 1);
+		Check(slots.Published(1), "lazy slots keep an unused model for the idle delay");
+		slots.Prepare(firstSlots(1), create, 1);
+		Check(!slots.Published(1) && slots.OwnedCount() == 2,
+			"a retired model is unpublished but not freed while process() may hold it");
+		slots.Prepare(firstSlots(1), create, 1);
+		Check(slots.OwnedCount() == 2, "a retired model outlives the process() call that saw it");
+		slots.BeginProcess();
+		slots.Prepare(firstSlots(1), create, 1);
+		Check(slots.OwnedCount() == 1, "a retired model is freed once process() has moved on");
+
+		configureCalls = 0;
+		slots.Prepare(firstSlots(2), create);
+		slots.BeginProcess();
+		Check(slots.Acquire(1, configure) && configureCalls == 1,
+			"a recreated model is configured again");
+
+		int applied = 0;
+		slots.ForEachPublished([&](CountedModel&) { ++applied; });
+		slots.BeginProcess();
+		slots.Acquire(0, configure);
+		Check(applied == 2 && configureCalls == 1,
+			"lazy slots apply settings to every published model without reconfiguring");
+
+		tfdsp::OversamplingPaths<CountedModel, CountedModel, 4> paths(1);
+		paths.Prepare(1, firstSlots(2), create, create);
+		Check(!paths.BeginProcess(0, firstSlots(2)) && paths.Active() == 1,
+			"oversampling paths keep playing until the requested path is prepared");
+		paths.Prepare(0, firstSlots(2), create, create);
+		Check(paths.x2.OwnedCount() == 2 && paths.x4.OwnedCount() == 2,
+			"oversampling paths prepare the requested path beside the playing one");
+		Check(paths.BeginProcess(0, firstSlots(2)) && paths.Active() == 0,
+			"oversampling paths switch once every needed slot is published");
+		for (int call = 0; call <= decltype(paths)::IdleCallsBeforeRetire + 1; ++call)
+		{
+			paths.Prepare(0, firstSlots(2), create, create);
+			paths.BeginProcess(0, firstSlots(2));
+		}
+		paths.Prepare(0, firstSlots(2), create, create);
+		Check(paths.x4.OwnedCount() == 0 && paths.x2.OwnedCount() == 2,
+			"the inactive oversampling path is freed after the idle delay");
+
+		tfdsp::LazyModelSlots<CountedModel, 4> slotAware;
+		slotAware.Prepare(firstSlots(3), [](int slot)
+		{
+			auto model = std::make_unique<CountedModel>();
+			model->configured = 10 * slot;
+			return model;
+		});
+		slotAware.BeginProcess();
+		Check(slotAware.Acquire(2, [](CountedModel&) {})->configured == 20,
+			"lazy slots pass the slot to a creator that takes one");
+	}
+
+	{
+		// The preparer publishes, retires and recreates models while the audio
+		// thread acquires them; no model may reach the audio thread unconfigured.
+		struct FreshModel
+		{
+			bool configured{};
+		};
+		constexpr int Slots = 4;
+		tfdsp::LazyModelSlots<FreshModel, Slots> slots;
+		std::atomic<bool> preparing{ true };
+		std::atomic<int> acquired{};
+		int unconfigured = 0;
+		std::thread audio([&]()
+		{
+			const auto configure = [](FreshModel& model) { model.configured = true; };
+			while (preparing.load(std::memory_order_relaxed))
+			{
+				slots.BeginProcess();
+				for (int slot = 0; slot < Slots; ++slot)
+				{
+					if (FreshModel* model = slots.Acquire(slot, configure))
+					{
+						acquired.fetch_add(1, std::memory_order_relaxed);
+						unconfigured += model->configured ? 0 : 1;
+					}
+				}
+				std::this_thread::yield();
+			}
+		});
+		// Slot s is needed on every other run of 2^s calls, so models are
+		// published, retired and recreated at several rates at once. Both threads
+		// yield so that they also interleave on a single core.
+		for (int call = 0; call < 20000 ||
+			acquired.load(std::memory_order_relaxed) < 1000; ++call)
+		{
+			slots.Prepare([call](int slot) { return ((call >> slot) & 1) != 0; },
+				[]() { return std::make_unique<FreshModel>(); });
+			if (call % 61 == 0)
+				std::this_thread::yield();
+		}
+		preparing.store(false, std::memory_order_relaxed);
+		audio.join();
+		Check(unconfigured == 0,
+			"lazy slots never hand the audio thread a model it has not configured");
+	}
+
 	if (failures == 0)
 		std::cout << "All TriggerFish DSP tests passed\n";
 	return failures == 0 ? 0 : 1;
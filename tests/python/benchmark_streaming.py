@@ -0,0 +1,74 @@
+import statistics
+import threading
+import time
+
+import numpy as np
+
+import _triggerfish_dsp as dsp
+
+SAMPLE_RATE = 48_000.0
+SIZE = 480_000
+CHUNK = 512
+VOICES = 4
+ROUNDS = 5
+
+
+def median_seconds(render):
+    render()
+    timings = []
+    for _ in range(ROUNDS):
+        start = time.perf_counter()
+        render()
+        timings.append(time.perf_counter() - start)
+    return statistics.median(timings)
+
+
+def main():
+    time_axis = np.arange(SIZE) / SAMPLE_RATE
+    audio = (4.0 * np.sin(2.0 * np.pi * 110.0 * time_axis)).astype(np.float32)
+    output = np.empty_like(audio)
+
+    def one_shot_chunks():
+        # The one-shot bindings copy float32 input to float64 and rebuild the
+        # model for every call, so chunked use also loses the filter state.
+        for start in range(0, SIZE, CHUNK):
+            output[start : start + CHUNK] = dsp.arp4072_x2(audio[start : start + CHUNK], 1_000.0, 0.5)
+
+    stream = dsp.Arp4072X2(SAMPLE_RATE)
+
+    def streamed_chunks():
+        for start in range(0, SIZE, CHUNK):
+            stream.process(audio[start : start + CHUNK], output[start : start + CHUNK], cutoff=1_000.0, resonance=0.5)
+
+    print(f"Arp4072 x2, {SIZE} float32 samples in {CHUNK}-sample chunks")
+    baseline = median_seconds(one_shot_chunks)
+    for name, render in (("one-shot", one_shot_chunks), ("stream", streamed_chunks)):
+        seconds = baseline if name == "one-shot" else median_seconds(render)
+        print(f"  {name:10s} {1.0e9 * seconds / SIZE:8.1f} ns/sample {baseline / seconds:6.2f}x")
+
+    streams = [dsp.Arp4072X2(SAMPLE_RATE) for _ in range(VOICES)]
+    outputs = [np.empty_like(audio) for _ in range(VOICES)]
+
+    def render_voice(voice):
+        streams[voice].process(audio, outputs[voice], cutoff=1_000.0, resonance=0.5)
+
+    def sequential_voices():
+        for voice in range(VOICES):
+            render_voice(voice)
+
+    def threaded_voices():
+        threads = [threading.Thread(target=render_voice, args=(voice,)) for voice in range(VOICES)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+    print(f"{VOICES} voices, GIL released during process()")
+    sequential = median_seconds(sequential_voices)
+    threaded = median_seconds(threaded_voices)
+    print(f"  sequential {sequential:8.3f} s")
+    print(f"  threaded   {threaded:8.3f} s {sequential / threaded:6.2f}x")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+import statistics
+import time
+
+import numpy as np
+
+import _triggerfish_dsp as dsp
+
+SIZE = 2_000_000
+ROUNDS = 9
+SAMPLE_RATE = 48_000.0
+
+
+def benchmark_group(processors):
+    timings = {name: [] for name in processors}
+    names = list(processors)
+    for processor in processors.values():
+        processor()
+
+    for round_index in range(ROUNDS):
+        offset = round_index % len(names)
+        for name in names[offset:] + names[:offset]:
+            start = time.perf_counter()
+            processors[name]()
+            timings[name].append(time.perf_counter() - start)
+
+    return {name: statistics.median(samples) for name, samples in timings.items()}
+
+
+def reference_tanh_adaa(x, x_prev):
+    # Closed form in long double where the difference quotient is well
+    # conditioned, midpoint tanh where it is not.
+    x = x.astype(np.longdouble)
+    x_prev = x_prev.astype(np.longdouble)
+    difference = x - x_prev
+    close = np.abs(difference) < 1.0e-6
+    safe = np.where(close, 1.0, difference)
+    quotient = (np.log(np.cosh(x)) - np.log(np.cosh(x_prev))) / safe
+    return np.where(close, np.tanh(0.5 * (x + x_prev)), quotient)
+
+
+def main():
+    rng = np.random.default_rng(5)
+    x_prev = rng.uniform(-8.0, 8.0, SIZE)
+    # Mix of wide steps and the small steps an integrator state takes between samples.
+    step = np.where(rng.random(SIZE) < 0.5, rng.uniform(-4.0, 4.0, SIZE),
+                    rng.uniform(-1.0e-4, 1.0e-4, SIZE))
+    x = x_prev + step
+
+    kernels = {
+        "legacy": lambda: dsp.tanh_adaa_legacy(x, x_prev),
+        "fused": lambda: dsp.tanh_adaa(x, x_prev),
+    }
+    timings = benchmark_group(kernels)
+    reference = reference_tanh_adaa(x, x_prev)
+    baseline = timings["legacy"]
+
+    print("Discrete gradient tanh kernel")
+    for name, seconds in timings.items():
+        values = {"legacy": dsp.tanh_adaa_legacy, "fused": dsp.tanh_adaa}[name](x, x_prev)
+        error = float(np.max(np.abs(values - reference)))
+        print(
+            f"  {name:8s} {1.0e9 * seconds / SIZE:6.2f} ns/evaluation "
+            f"{100.0 * (baseline / seconds - 1.0):+6.2f}% throughput  "
+            f"max error {error:.2e}"
+        )
+
+    time_axis = np.arange(SIZE // 4) / SAMPLE_RATE
+    audio = (3.0 * np.sin(2.0 * np.pi * 220.0 * time_axis)).astype(np.float32)
+    control = (0.5 + 0.4 * np.sin(2.0 * np.pi * 0.5 * time_axis)).astype(np.float32)
+    vcas = {
+        "transistor VCA": lambda: dsp.vca_transistor(audio, control, SAMPLE_RATE),
+        "OTA VCA": lambda: dsp.vca_ota_legacy(audio, control, SAMPLE_RATE, 1.0),
+    }
+    print("VCA cores using the kernel (2x oversampled, 48 kHz)")
+    for name, seconds in benchmark_group(vcas).items():
+        print(f"  {name:16s} {1.0e9 * seconds / audio.size:8.1f} ns/sample")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cmath>
 #include <limits>
@@ -21,6 +22,7 @@
 #include "models/VdpOscillator.hpp"
 #include "models/VdpSplitOscillator.hpp"
 #include "tfdsp/control.hpp"
+#include "tfdsp/denormal.hpp"
 #include "tfdsp/noise.hpp"
 #include "tfdsp/sampleRate.hpp"
 #include "tfdsp/unison.hpp"
@@ -31,6 +33,12 @@ namespace py = pybind11;
 
 namespace
 {
+	// Python threads run with the default floating-point mode, so every entry
+	// point, including the streaming process() calls, flushes denormals for its
+	// duration as the Rack engine does. The polyphase resamplers rely on this to
+	// keep their release tails out of the subnormal range.
+	using FlushDenormals = py::call_guard<tfdsp::ScopedFlushDenormals>;
+
 	void RequireSameSize(const py::buffer_info& left, const py::buffer_info& right,
 		const char* leftName, const char* rightName)
 	{
@@ -40,6 +48,22 @@ namespace
 			throw std::invalid_argument(std::string(leftName) + " and " + rightName + " must have the same length");
 	}
 
+	// By value, for the models that embed their resamplers.
+	template<typename Resampler>
+	Resampler MakeResampler()
+	{
+		if constexpr (std::is_same_v<Resampler, tfdsp::DummyResampler>)
+			return tfdsp::DummyResampler{};
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order7>)
+			return tfdsp::MakeX2Resampler_Chebychev7();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order9>)
+			return tfdsp::MakeX2Resampler_Chebychev9();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X4Resampler_Order7>)
+			return tfdsp::MakeX4Resampler_Cheby7();
+		else
+			return Resampler(tfdsp::MakeX2Resampler_Chebychev9());
+	}
+
 	template<typename Filter>
 	py::array_t<float> RenderDiodeLadderControls(
 		py::array_t<double, py::array::c_style | py::array::forcecast> audio,
@@ -64,15 +88,7 @@ namespace
 		auto cutoffValues = cutoff.unchecked<1>();
 		auto linearFmValues = linearFm.unchecked<1>();
 		auto resonanceValues = resonance.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 		{
@@ -108,15 +124,7 @@ namespace
 		auto cutoffValues = cutoff.unchecked<1>();
 		auto linearFmValues = linearFm.unchecked<1>();
 		auto resonanceValues = resonance.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 		{
@@ -182,6 +190,48 @@ namespace
 		return result;
 	}
 
+	enum class TanhAdaaMethod
+	{
+		Legacy,
+		Fused
+	};
+
+	// Discrete gradient of tanh as it was before the fused kernel, kept for benchmarking.
+	double LegacyTanhAdaa(double x, double xPrev)
+	{
+		const auto logCosh = [](double value)
+		{
+			const double magnitude = std::abs(value);
+			return magnitude + std::log1p(std::exp(-2.0 * magnitude)) - std::log(2.0);
+		};
+		return std::abs(x - xPrev) <= 1.0e-12 ?
+			std::tanh(0.5 * (x + xPrev)) :
+			(logCosh(x) - logCosh(xPrev)) / (x - xPrev);
+	}
+
+	template<TanhAdaaMethod Method>
+	py::array_t<double> RenderTanhAdaa(
+		py::array_t<double, py::array::c_style | py::array::forcecast> x,
+		py::array_t<double, py::array::c_style | py::array::forcecast> xPrev)
+	{
+		const auto xInfo = x.request();
+		const auto xPrevInfo = xPrev.request();
+		RequireSameSize(xInfo, xPrevInfo, "x", "x_prev");
+
+		py::array_t<double> result(xInfo.shape[0]);
+		auto output = result.mutable_unchecked<1>();
+		auto xValues = x.unchecked<1>();
+		auto xPrevValues = xPrev.unchecked<1>();
+		for (py::ssize_t i = 0; i < xInfo.shape[0]; ++i)
+		{
+			if constexpr (Method == TanhAdaaMethod::Legacy)
+				output(i) = LegacyTanhAdaa(xValues(i), xPrevValues(i));
+			else
+				output(i) = DiscreteGradient2::Tanh<double, 1>::Value(xValues(i), xPrevValues(i));
+		}
+		return result;
+	}
+
 	template<typename Oscillator>
 	py::array_t<float> RenderVdpo(
 		py::array_t<double, py::array::c_style | py::array::forcecast> audio,
@@ -256,31 +306,7 @@ namespace
 		py::array_t<float> result(audioInfo.shape[0]);
 		auto output = result.mutable_unchecked<1>();
 		auto audioValues = audio.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-			{
-				return tfdsp::CreateDummyResampler();
-			}
-			else if constexpr (Filter::OversamplingFactor == 2)
-			{
-				if constexpr (Order9)
-					return tfdsp::CreateX2Resampler_Chebychev9();
-				else
-					return tfdsp::CreateX2Resampler_Chebychev7();
-			}
-			else
-			{
-				if constexpr (Order9)
-				{
-					using X4Order9 = tfdsp::X4Resampler<tfdsp::X2Resampler_Order9>;
-					return std::make_unique<X4Order9>(
-						tfdsp::CreateX2Resampler_Chebychev9);
-				}
-				else
-					return tfdsp::CreateX4Resampler_Cheby7();
-			}
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), cutoff, resonance,
@@ -302,15 +328,7 @@ namespace
 		py::array_t<float> result(audioInfo.shape[0]);
 		auto output = result.mutable_unchecked<1>();
 		auto audioValues = audio.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), cutoff, resonance,
@@ -338,15 +356,7 @@ namespace
 		auto audioValues = audio.unchecked<1>();
 		auto cutoffValues = cutoff.unchecked<1>();
 		auto resonanceValues = resonance.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 		{
@@ -381,15 +391,7 @@ namespace
 		auto cutoffValues = cutoff.unchecked<1>();
 		auto linearFmValues = linearFm.unchecked<1>();
 		auto resonanceValues = resonance.unchecked<1>();
-		Filter model([]
-		{
-			if constexpr (Filter::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter model(MakeResampler<typename Filter::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 		{
@@ -421,15 +423,7 @@ namespace
 		auto audioValues = audio.unchecked<1>();
 		auto linearValues = linearCv.unchecked<1>();
 		auto exponentialValues = exponentialCv.unchecked<1>();
-		Vca model([]
-		{
-			if constexpr (Vca::OversamplingFactor == 1)
-				return tfdsp::CreateDummyResampler();
-			else if constexpr (Vca::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Vca model(MakeResampler<typename Vca::Resampler>());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), 0.0, linearValues(i),
@@ -562,7 +556,7 @@ namespace
 		auto audioValues = audio.unchecked<1>();
 		auto driveValues = driveGain.unchecked<1>();
 		auto bassValues = bass.unchecked<1>();
-		Filter model(tfdsp::CreateX4Resampler_Cheby7);
+		Filter model(tfdsp::MakeX4Resampler_Cheby7());
 		model.SetSampleRate(sampleRate);
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 		{
@@ -589,13 +583,7 @@ namespace
 		auto output = result.mutable_unchecked<1>();
 		auto audioValues = audio.unchecked<1>();
 		auto controlValues = control.unchecked<1>();
-		Filter filter([]
-		{
-			if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter filter(MakeResampler<typename Filter::Resampler>());
 		filter.SetSampleRate(sampleRate);
 		tfdsp::Tb303Vca vca;
 		vca.SetSampleRate(sampleRate * (oversampledVca ?
@@ -648,13 +636,7 @@ namespace
 		auto cutoffValues = cutoff.unchecked<1>();
 		auto baseValues = baseControl.unchecked<1>();
 		auto accentValues = accentControl.unchecked<1>();
-		Filter filter([]
-		{
-			if constexpr (Filter::OversamplingFactor == 2)
-				return tfdsp::CreateX2Resampler_Chebychev7();
-			else
-				return tfdsp::CreateX4Resampler_Cheby7();
-		});
+		Filter filter(MakeResampler<typename Filter::Resampler>());
 		filter.SetSampleRate(sampleRate);
 		tfdsp::Tb303Vca vca;
 		vca.SetSampleRate(sampleRate * Filter::OversamplingFactor);
@@ -727,7 +709,7 @@ namespace
 			else if constexpr (std::is_same_v<Resampler,
 				tfdsp::X4Resampler<tfdsp::X2Resampler_Order5>>)
 				return std::make_unique<Resampler>(
-					tfdsp::CreateX2Resampler_Butterworth5);
+					tfdsp::MakeX2Resampler_Butterworth5());
 			else
 				return tfdsp::CreateX4Resampler_Cheby7();
 		});
@@ -964,6 +946,372 @@ namespace
 			output(i) = folder.Process(values(i), selected);
 		return result;
 	}
+
+	// Streaming wrappers. Each object owns one model whose state carries over
+	// between process() calls, so long signals can be rendered in chunks. The
+	// input and output are caller-owned one-dimensional C-contiguous arrays of
+	// the same float32 or float64 dtype and are used in place. Controls are a
+	// scalar held for the chunk or an array of the same dtype. The GIL is
+	// released while rendering so separate objects render concurrently.
+	template<typename Sample>
+	using StreamBuffer = py::array_t<Sample, py::array::c_style>;
+
+	template<int OversamplingFactor>
+	auto CreateStreamResampler()
+	{
+		if constexpr (OversamplingFactor == 1)
+			return tfdsp::CreateDummyResampler();
+		else if constexpr (OversamplingFactor == 2)
+			return tfdsp::CreateX2Resampler_Chebychev7();
+		else
+			return tfdsp::CreateX4Resampler_Cheby7();
+	}
+
+	template<typename Sample>
+	class StreamControl
+	{
+		const Sample* _values{};
+		double _constant{};
+
+	public:
+		StreamControl(const py::object& control, py::ssize_t length, const char* name)
+		{
+			if (py::isinstance<py::array>(control))
+			{
+				if (!py::isinstance<StreamBuffer<Sample>>(control))
+					throw py::type_error(std::string(name) +
+						" must be a C-contiguous array with the dtype of the input");
+				const auto values = py::reinterpret_borrow<StreamBuffer<Sample>>(control);
+				if (values.ndim() != 1 || values.shape(0) != length)
+					throw std::invalid_argument(std::string(name) + " must have the input length");
+				_values = values.data();
+			}
+			else
+				_constant = py::cast<double>(control);
+		}
+
+		double operator[](py::ssize_t i) const
+		{
+			return _values ? static_cast<double>(_values[i]) : _constant;
+		}
+	};
+
+	/** Validates the buffers of one process() call and renders them with the
+	 * GIL released. Models are not thread safe, so a second concurrent call on
+	 * the same object is rejected rather than corrupting its state. */
+	class StreamProcessor
+	{
+		std::atomic<bool> _busy{};
+
+		struct BusyScope
+		{
+			std::atomic<bool>& busy;
+			~BusyScope() { busy = false; }
+		};
+
+	public:
+		template<typename Sample>
+		static py::ssize_t Length(const StreamBuffer<Sample>& input, const StreamBuffer<Sample>& output)
+		{
+			if (input.ndim() != 1 || output.ndim() != 1)
+				throw std::invalid_argument("input and output must be one-dimensional arrays");
+			if (input.shape(0) != output.shape(0))
+				throw std::invalid_argument("input and output must have the same length");
+			if (!output.writeable())
+				throw std::invalid_argument("output must be writeable");
+			return input.shape(0);
+		}
+
+		template<typename Sample, typename Render>
+		void Run(const StreamBuffer<Sample>& input, StreamBuffer<Sample>& output, Render&& render)
+		{
+			const Sample* in = input.data();
+			Sample* out = output.mutable_data();
+			const py::ssize_t length = input.shape(0);
+			if (_busy.exchange(true))
+				throw std::runtime_error("process() is already running on this object in another thread");
+			BusyScope scope{ _busy };
+			py::gil_scoped_release release;
+			tfdsp::ScopedFlushDenormals flushDenormals;
+			render(in, out, length);
+		}
+	};
+
+	template<typename Filter>
+	class DiodeLadderStream
+	{
+		Filter _model{ MakeResampler<typename Filter::Resampler>() };
+		StreamProcessor _processor;
+
+	public:
+		explicit DiodeLadderStream(double sampleRate)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> input, StreamBuffer<Sample> output,
+			const py::object& cutoff, const py::object& resonance, bool highResonance,
+			const py::object& driveGain, const py::object& bass)
+		{
+			const auto length = StreamProcessor::Length(input, output);
+			const StreamControl<Sample> cutoffs(cutoff, length, "cutoff");
+			const StreamControl<Sample> resonances(resonance, length, "resonance");
+			const StreamControl<Sample> driveGains(driveGain, length, "drive_gain");
+			const StreamControl<Sample> basses(bass, length, "bass");
+			_processor.Run(input, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], cutoffs[i], resonances[i],
+						highResonance, driveGains[i], basses[i]));
+			});
+		}
+	};
+
+	template<typename Filter>
+	class Arp4072Stream
+	{
+		Filter _model{ MakeResampler<typename Filter::Resampler>() };
+		StreamProcessor _processor;
+
+	public:
+		explicit Arp4072Stream(double sampleRate)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> input, StreamBuffer<Sample> output,
+			const py::object& cutoff, const py::object& resonance, const py::object& driveGain)
+		{
+			const auto length = StreamProcessor::Length(input, output);
+			const StreamControl<Sample> cutoffs(cutoff, length, "cutoff");
+			const StreamControl<Sample> resonances(resonance, length, "resonance");
+			const StreamControl<Sample> driveGains(driveGain, length, "drive_gain");
+			_processor.Run(input, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], cutoffs[i], resonances[i],
+						driveGains[i]));
+			});
+		}
+	};
+
+	template<typename Vca>
+	class Arp4019Stream
+	{
+		Vca _model{ MakeResampler<typename Vca::Resampler>() };
+		StreamProcessor _processor;
+
+	public:
+		explicit Arp4019Stream(double sampleRate)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> input, StreamBuffer<Sample> output,
+			const py::object& linearCv, const py::object& exponentialCv,
+			const py::object& initialGain)
+		{
+			const auto length = StreamProcessor::Length(input, output);
+			const StreamControl<Sample> linear(linearCv, length, "linear_cv");
+			const StreamControl<Sample> exponential(exponentialCv, length, "exponential_cv");
+			const StreamControl<Sample> gains(initialGain, length, "initial_gain");
+			_processor.Run(input, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], 0.0, linear[i],
+						exponential[i], gains[i]));
+			});
+		}
+	};
+
+	template<typename Oscillator>
+	class Tb303OscillatorStream
+	{
+		Oscillator _model{ &CreateStreamResampler<Oscillator::OversamplingFactor> };
+		StreamProcessor _processor;
+
+	public:
+		explicit Tb303OscillatorStream(double sampleRate)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> pitch, StreamBuffer<Sample> output,
+			const py::object& slide, const py::object& fm, const py::object& shape,
+			const py::object& wave, double slideTime, bool linearFm)
+		{
+			const auto length = StreamProcessor::Length(pitch, output);
+			const StreamControl<Sample> slides(slide, length, "slide");
+			const StreamControl<Sample> fms(fm, length, "fm");
+			const StreamControl<Sample> shapes(shape, length, "shape");
+			const StreamControl<Sample> waves(wave, length, "wave");
+			if (!(slideTime > 0.0))
+				throw std::invalid_argument("slide_time must be positive");
+			_processor.Run(pitch, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], slides[i] >= 1.0, slideTime,
+						0.0, fms[i], linearFm, shapes[i], waves[i]).mixed);
+			});
+		}
+	};
+
+	template<typename Oscillator>
+	class WavefoldOscillatorStream
+	{
+		Oscillator _model{ &CreateStreamResampler<Oscillator::OversamplingFactor> };
+		StreamProcessor _processor;
+
+	public:
+		WavefoldOscillatorStream(double sampleRate, bool adaa, int character)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			if (character < 0 || character >=
+				static_cast<int>(tfdsp::WavefolderCharacter::Count))
+				throw std::invalid_argument("invalid wavefolder character");
+			_model.SetSampleRate(sampleRate);
+			_model.SetFolderAntialiasing(adaa);
+			_model.SetCharacter(static_cast<tfdsp::WavefolderCharacter>(character));
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> frequency, StreamBuffer<Sample> output,
+			const py::object& morph, const py::object& fold, const py::object& symmetry)
+		{
+			const auto length = StreamProcessor::Length(frequency, output);
+			const StreamControl<Sample> morphs(morph, length, "morph");
+			const StreamControl<Sample> folds(fold, length, "fold");
+			const StreamControl<Sample> symmetries(symmetry, length, "symmetry");
+			_processor.Run(frequency, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], morphs[i], folds[i],
+						symmetries[i]));
+			});
+		}
+	};
+
+	class ArpEnvelopeStream
+	{
+		tfdsp::ArpEnvelope _model;
+		StreamProcessor _processor;
+
+	public:
+		ArpEnvelopeStream(double sampleRate, int mode)
+		{
+			if (!(sampleRate > 0.0))
+				throw std::invalid_argument("sample_rate must be positive");
+			_model.SetSampleRate(sampleRate);
+			_model.SetMode(static_cast<tfdsp::ArpEnvelope::Mode>(std::clamp(mode, 0, 2)));
+		}
+
+		void Reset() { _model.Reset(); }
+
+		template<typename Sample>
+		void Process(StreamBuffer<Sample> gate, StreamBuffer<Sample> output,
+			const py::object& attack, const py::object& decay, const py::object& sustain,
+			const py::object& release, const py::object& trigger, const py::object& curve,
+			bool autoGateTrigger)
+		{
+			const auto length = StreamProcessor::Length(gate, output);
+			const StreamControl<Sample> triggers(trigger, length, "trigger");
+			const StreamControl<Sample> attacks(attack, length, "attack");
+			const StreamControl<Sample> decays(decay, length, "decay");
+			const StreamControl<Sample> sustains(sustain, length, "sustain");
+			const StreamControl<Sample> releases(release, length, "release");
+			const StreamControl<Sample> curves(curve, length, "curve");
+			_processor.Run(gate, output, [&](const Sample* in, Sample* out, py::ssize_t count)
+			{
+				for (py::ssize_t i = 0; i < count; ++i)
+					out[i] = static_cast<Sample>(_model.Step(in[i], triggers[i], attacks[i],
+						decays[i], sustains[i], releases[i], curves[i], autoGateTrigger));
+			});
+		}
+	};
+
+	/** Register the float32 and float64 process() overloads. noconvert keeps
+	 * pybind11 from silently copying a buffer into the other dtype. */
+	template<typename Stream, typename... Arguments>
+	void DefineStreamProcess(py::class_<Stream>& binding, const char* inputName,
+		Arguments... arguments)
+	{
+		binding.def("process", &Stream::template Process<float>,
+			py::arg(inputName).noconvert(), py::arg("output").noconvert(), arguments...);
+		binding.def("process", &Stream::template Process<double>,
+			py::arg(inputName).noconvert(), py::arg("output").noconvert(), arguments...);
+		binding.def("reset", &Stream::Reset);
+	}
+
+	template<typename Filter>
+	void BindDiodeLadderStream(py::module_& module, const char* name)
+	{
+		py::class_<DiodeLadderStream<Filter>> binding(module, name);
+		binding.def(py::init<double>(), py::arg("sample_rate") = 48000.0);
+		DefineStreamProcess(binding, "input", py::arg("cutoff"), py::arg("resonance") = 0.0,
+			py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
+			py::arg("bass") = 0.0);
+	}
+
+	template<typename Filter>
+	void BindArp4072Stream(py::module_& module, const char* name)
+	{
+		py::class_<Arp4072Stream<Filter>> binding(module, name);
+		binding.def(py::init<double>(), py::arg("sample_rate") = 48000.0);
+		DefineStreamProcess(binding, "input", py::arg("cutoff"), py::arg("resonance") = 0.0,
+			py::arg("drive_gain") = 1.0);
+	}
+
+	template<typename Vca>
+	void BindArp4019Stream(py::module_& module, const char* name)
+	{
+		py::class_<Arp4019Stream<Vca>> binding(module, name);
+		binding.def(py::init<double>(), py::arg("sample_rate") = 48000.0);
+		DefineStreamProcess(binding, "input", py::arg("linear_cv"),
+			py::arg("exponential_cv") = 0.0, py::arg("initial_gain") = 0.0);
+	}
+
+	template<typename Oscillator>
+	void BindTb303OscillatorStream(py::module_& module, const char* name)
+	{
+		py::class_<Tb303OscillatorStream<Oscillator>> binding(module, name);
+		binding.def(py::init<double>(), py::arg("sample_rate") = 48000.0);
+		DefineStreamProcess(binding, "pitch", py::arg("slide") = 0.0, py::arg("fm") = 0.0,
+			py::arg("shape") = 0.0, py::arg("wave") = 0.0, py::arg("slide_time") = 0.060,
+			py::arg("linear_fm") = false);
+	}
+
+	template<typename Oscillator>
+	void BindWavefoldOscillatorStream(py::module_& module, const char* name)
+	{
+		py::class_<WavefoldOscillatorStream<Oscillator>> binding(module, name);
+		binding.def(py::init<double, bool, int>(), py::arg("sample_rate") = 48000.0,
+			py::arg("adaa") = false, py::arg("character") = 0);
+		DefineStreamProcess(binding, "frequency", py::arg("morph"), py::arg("fold"),
+			py::arg("symmetry") = 0.0);
+	}
 }
 
 PYBIND11_MODULE(_triggerfish_dsp, module)
@@ -976,7 +1324,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		return tfdsp::DiodeLadderFilter<
 			tfdsp::X4Resampler_Order7>::MapCutoffControl(
 			requestedHz, maximumHz);
-	}, py::arg("requested_hz"), py::arg("maximum_hz") = 20000.0);
+	}, FlushDenormals(), py::arg("requested_hz"), py::arg("maximum_hz") = 20000.0);
 
 	module.def("vca_transistor", [](py::array_t<float, py::array::c_style | py::array::forcecast> audio,
 		py::array_t<float, py::array::c_style | py::array::forcecast> cv,
@@ -997,7 +1345,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), cvValues(i), finalGain);
 		return result;
-	}, py::arg("audio"), py::arg("cv"), py::arg("sample_rate"), py::arg("final_gain") = 1.0f);
+	}, FlushDenormals(), py::arg("audio"), py::arg("cv"), py::arg("sample_rate"), py::arg("final_gain") = 1.0f);
 
 	module.def("vca_ota_legacy", [](py::array_t<float, py::array::c_style | py::array::forcecast> audio,
 		py::array_t<float, py::array::c_style | py::array::forcecast> cv,
@@ -1018,7 +1366,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), cvValues(i), finalGain);
 		return result;
-	}, py::arg("audio"), py::arg("cv"), py::arg("sample_rate"),
+	}, FlushDenormals(), py::arg("audio"), py::arg("cv"), py::arg("sample_rate"),
 		py::arg("final_gain") = 1.0f);
 
 	module.def("ota_vca_current", [](py::array_t<double, py::array::c_style | py::array::forcecast> differential,
@@ -1040,7 +1388,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (py::ssize_t i = 0; i < differentialInfo.shape[0]; ++i)
 			output(i) = model.ProcessCurrent(differentialValues(i), controlValues(i));
 		return result;
-	}, py::arg("differential"), py::arg("control"),
+	}, FlushDenormals(), py::arg("differential"), py::arg("control"),
 		py::arg("efficiency") = 0.85, py::arg("input_offset") = 0.0,
 		py::arg("mirror_imbalance") = 0.0);
 
@@ -1067,7 +1415,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), baseValues(i), accentValues(i));
 		return result;
-	}, py::arg("audio"), py::arg("base_control"), py::arg("accent_control"),
+	}, FlushDenormals(), py::arg("audio"), py::arg("base_control"), py::arg("accent_control"),
 		py::arg("sample_rate") = 48000.0);
 
 	module.def("tb303_articulation", [](py::array_t<double, py::array::c_style | py::array::forcecast> gate,
@@ -1105,7 +1453,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 			output(i, 3) = value.vcaAccent;
 		}
 		return result;
-	}, py::arg("gate"), py::arg("accent"), py::arg("resonance"),
+	}, FlushDenormals(), py::arg("gate"), py::arg("accent"), py::arg("resonance"),
 		py::arg("normal_decay") = 0.5, py::arg("accent_decay") = 0.2,
 		py::arg("vca_decay") = 0.5, py::arg("sample_rate") = 48000.0,
 		py::arg("devil_fish") = false, py::arg("accent_sweep") = 2);
@@ -1133,7 +1481,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (py::ssize_t i = 0; i < audioInfo.shape[0]; ++i)
 			output(i) = model.Step(audioValues(i), dampingValues(i), frequencyValues(i));
 		return result;
-	}, py::arg("audio"), py::arg("damping"), py::arg("angular_frequency"), py::arg("sample_rate"));
+	}, FlushDenormals(), py::arg("audio"), py::arg("damping"), py::arg("angular_frequency"), py::arg("sample_rate"));
 
 	using BaselineVdpo = VdpSplitOscillator<tfdsp::X4Resampler_Order7>;
 
@@ -1143,19 +1491,23 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		double sampleRate)
 	{
 		return RenderVdpo<BaselineVdpo>(audio, damping, angularFrequency, sampleRate);
-	}, py::arg("audio"), py::arg("damping"), py::arg("angular_frequency"), py::arg("sample_rate"));
+	}, FlushDenormals(), py::arg("audio"), py::arg("damping"), py::arg("angular_frequency"), py::arg("sample_rate"));
 
-	module.def("vdpo_pitch_std", &RenderVdpoPitch<BaselineVdpo, false>,
+	module.def("vdpo_pitch_std", &RenderVdpoPitch<BaselineVdpo, false>, FlushDenormals(),
 		py::arg("audio"), py::arg("damping"), py::arg("pitch"), py::arg("sample_rate"));
-	module.def("vdpo_pitch_fast_exp2", &RenderVdpoPitch<BaselineVdpo, true>,
+	module.def("vdpo_pitch_fast_exp2", &RenderVdpoPitch<BaselineVdpo, true>, FlushDenormals(),
 		py::arg("audio"), py::arg("damping"), py::arg("pitch"), py::arg("sample_rate"));
 
-	module.def("detune_legacy_double", &RenderDetune<DetuneMethod::LegacyDouble>,
+	module.def("detune_legacy_double", &RenderDetune<DetuneMethod::LegacyDouble>, FlushDenormals(),
 		py::arg("pitch"), py::arg("detune"), py::arg("reference_frequency") = 261.63);
-	module.def("detune_optimized", &RenderDetune<DetuneMethod::Optimized>,
+	module.def("detune_optimized", &RenderDetune<DetuneMethod::Optimized>, FlushDenormals(),
 		py::arg("pitch"), py::arg("detune"), py::arg("reference_frequency") = 261.63);
-	module.def("detune_reference_double", &RenderDetune<DetuneMethod::ReferenceDouble>,
+	module.def("detune_reference_double", &RenderDetune<DetuneMethod::ReferenceDouble>, FlushDenormals(),
 		py::arg("pitch"), py::arg("detune"), py::arg("reference_frequency") = 261.63);
+	module.def("tanh_adaa_legacy", &RenderTanhAdaa<TanhAdaaMethod::Legacy>, FlushDenormals(),
+		py::arg("x"), py::arg("x_prev"));
+	module.def("tanh_adaa", &RenderTanhAdaa<TanhAdaaMethod::Fused>, FlushDenormals(),
+		py::arg("x"), py::arg("x_prev"));
 
 	using DiodeLadderX1 = tfdsp::DiodeLadderFilter<tfdsp::DummyResampler>;
 	using DiodeLadderX2 = tfdsp::DiodeLadderFilter<tfdsp::X2Resampler_Order7>;
@@ -1165,44 +1517,44 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 	using X4ResamplerOrder9 = tfdsp::X4Resampler<tfdsp::X2Resampler_Order9>;
 	using DiodeLadderX4Order9 = tfdsp::DiodeLadderFilter<X4ResamplerOrder9>;
 	module.def("diode_ladder_controls_x1",
-		&RenderDiodeLadderControls<DiodeLadderX1>, py::arg("audio"),
+		&RenderDiodeLadderControls<DiodeLadderX1>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("linear_fm"), py::arg("resonance"),
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
-	module.def("diode_ladder_x1", &RenderDiodeLadder<DiodeLadderX1>,
+	module.def("diode_ladder_x1", &RenderDiodeLadder<DiodeLadderX1>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
-	module.def("diode_ladder_x2", &RenderDiodeLadder<DiodeLadderX2>,
+	module.def("diode_ladder_x2", &RenderDiodeLadder<DiodeLadderX2>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
-	module.def("diode_ladder_x4", &RenderDiodeLadder<DiodeLadderX4>,
+	module.def("diode_ladder_x4", &RenderDiodeLadder<DiodeLadderX4>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
 	module.def("diode_ladder_modulated_x4",
-		&RenderModulatedDiodeLadder<DiodeLadderX4>, py::arg("audio"),
+		&RenderModulatedDiodeLadder<DiodeLadderX4>, FlushDenormals(), py::arg("audio"),
 		py::arg("drive_gain"), py::arg("bass"), py::arg("cutoff"),
 		py::arg("resonance") = 0.0, py::arg("high_resonance") = false,
 		py::arg("sample_rate") = 48000.0);
 	module.def("diode_ladder_controls_x4",
-		&RenderDiodeLadderControls<DiodeLadderX4>, py::arg("audio"),
+		&RenderDiodeLadderControls<DiodeLadderX4>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("linear_fm"), py::arg("resonance"),
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
 	module.def("diode_ladder_diagnostics_x4",
-		&RenderDiodeLadderDiagnostics<DiodeLadderX4>, py::arg("audio"),
+		&RenderDiodeLadderDiagnostics<DiodeLadderX4>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("linear_fm"), py::arg("resonance"),
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
 	module.def("diode_ladder_x2_order9",
-		&RenderDiodeLadder<DiodeLadderX2Order9, true>,
+		&RenderDiodeLadder<DiodeLadderX2Order9, true>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
 	module.def("diode_ladder_x4_order9",
-		&RenderDiodeLadder<DiodeLadderX4Order9, true>,
+		&RenderDiodeLadder<DiodeLadderX4Order9, true>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
 		py::arg("bass") = 0.0, py::arg("sample_rate") = 48000.0);
@@ -1210,27 +1562,27 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 	using Arp4072X1 = tfdsp::Arp4072Filter<tfdsp::DummyResampler>;
 	using Arp4072X2 = tfdsp::Arp4072Filter<tfdsp::X2Resampler_Order7>;
 	using Arp4072X4 = tfdsp::Arp4072Filter<tfdsp::X4Resampler_Order7>;
-	module.def("arp4072_controls_x1", &RenderArp4072Controls<Arp4072X1>,
+	module.def("arp4072_controls_x1", &RenderArp4072Controls<Arp4072X1>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance"),
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
-	module.def("arp4072_x1", &RenderArp4072<Arp4072X1>, py::arg("audio"),
+	module.def("arp4072_x1", &RenderArp4072<Arp4072X1>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
-	module.def("arp4072_x2", &RenderArp4072<Arp4072X2>, py::arg("audio"),
+	module.def("arp4072_x2", &RenderArp4072<Arp4072X2>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
-	module.def("arp4072_x4", &RenderArp4072<Arp4072X4>, py::arg("audio"),
+	module.def("arp4072_x4", &RenderArp4072<Arp4072X4>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("resonance") = 0.0,
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
-	module.def("arp4072_controls_x4", &RenderArp4072Controls<Arp4072X4>,
+	module.def("arp4072_controls_x4", &RenderArp4072Controls<Arp4072X4>, FlushDenormals(),
 		py::arg("audio"), py::arg("cutoff"), py::arg("resonance"),
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
 	module.def("arp4072_modulated_controls_x1",
-		&RenderArp4072ModulatedControls<Arp4072X1>, py::arg("audio"),
+		&RenderArp4072ModulatedControls<Arp4072X1>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("linear_fm"), py::arg("resonance"),
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
 	module.def("arp4072_modulated_controls_x4",
-		&RenderArp4072ModulatedControls<Arp4072X4>, py::arg("audio"),
+		&RenderArp4072ModulatedControls<Arp4072X4>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("linear_fm"), py::arg("resonance"),
 		py::arg("drive_gain") = 1.0, py::arg("sample_rate") = 48000.0);
 	module.def("arp4072_circuit_values", []
@@ -1260,14 +1612,14 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		values["small_signal_feedback_gain"] =
 			Arp4072X4::SmallSignalFeedbackGain();
 		return values;
-	});
+	}, FlushDenormals());
 
 	using Arp4019X1 = tfdsp::Arp4019Vca<tfdsp::DummyResampler>;
 	using Arp4019X4 = tfdsp::Arp4019Vca<tfdsp::X4Resampler_Order7>;
-	module.def("arp4019_x1", &RenderArp4019<Arp4019X1>, py::arg("audio"),
+	module.def("arp4019_x1", &RenderArp4019<Arp4019X1>, FlushDenormals(), py::arg("audio"),
 		py::arg("linear_cv"), py::arg("exponential_cv"),
 		py::arg("initial_gain") = 0.0, py::arg("sample_rate") = 48000.0);
-	module.def("arp4019_x4", &RenderArp4019<Arp4019X4>, py::arg("audio"),
+	module.def("arp4019_x4", &RenderArp4019<Arp4019X4>, FlushDenormals(), py::arg("audio"),
 		py::arg("linear_cv"), py::arg("exponential_cv"),
 		py::arg("initial_gain") = 0.0, py::arg("sample_rate") = 48000.0);
 	module.def("arp4019_circuit_values", []
@@ -1286,8 +1638,8 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		values["exponential_decibels_per_volt"] =
 			Arp4019X4::ExponentialDecibelsPerVolt;
 		return values;
-	});
-	module.def("arp_envelope", &RenderArpEnvelope, py::arg("gate"),
+	}, FlushDenormals());
+	module.def("arp_envelope", &RenderArpEnvelope, FlushDenormals(), py::arg("gate"),
 		py::arg("trigger"), py::arg("attack"), py::arg("decay"),
 		py::arg("sustain"), py::arg("release"), py::arg("curve") = 0.0,
 		py::arg("mode") = 0, py::arg("auto_gate_trigger") = true,
@@ -1298,53 +1650,53 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 	{
 		return RenderResamplerRoundTrip<tfdsp::X2Resampler_Order7>(audio,
 			tfdsp::CreateX2Resampler_Chebychev7);
-	}, py::arg("audio"));
+	}, FlushDenormals(), py::arg("audio"));
 	module.def("resampler_round_trip_x2_order9", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> audio)
 	{
 		return RenderResamplerRoundTrip<tfdsp::X2Resampler_Order9>(audio,
 			tfdsp::CreateX2Resampler_Chebychev9);
-	}, py::arg("audio"));
+	}, FlushDenormals(), py::arg("audio"));
 	module.def("resampler_round_trip_x4_order7", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> audio)
 	{
 		return RenderResamplerRoundTrip<tfdsp::X4Resampler_Order7>(audio,
 			tfdsp::CreateX4Resampler_Cheby7);
-	}, py::arg("audio"));
+	}, FlushDenormals(), py::arg("audio"));
 	module.def("resampler_upsample_x4_order7", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> input)
 	{
 		return RenderUpsampled<tfdsp::X4Resampler_Order7>(input,
 			tfdsp::CreateX4Resampler_Cheby7);
-	}, py::arg("input"));
+	}, FlushDenormals(), py::arg("input"));
 	module.def("resampler_downsample_x4_order7", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> input)
 	{
 		return RenderDownsampled<tfdsp::X4Resampler_Order7>(input,
 			tfdsp::CreateX4Resampler_Cheby7);
-	}, py::arg("input"));
+	}, FlushDenormals(), py::arg("input"));
 	module.def("resampler_round_trip_x4_order9", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> audio)
 	{
 		return RenderResamplerRoundTrip<X4ResamplerOrder9>(audio, []
 		{
 			return std::make_unique<X4ResamplerOrder9>(
-				tfdsp::CreateX2Resampler_Chebychev9);
+				tfdsp::MakeX2Resampler_Chebychev9());
 		});
-	}, py::arg("audio"));
+	}, FlushDenormals(), py::arg("audio"));
 
-	module.def("diode_ladder_vca_x2", &RenderDiodeLadderVca<DiodeLadderX2>,
+	module.def("diode_ladder_vca_x2", &RenderDiodeLadderVca<DiodeLadderX2>, FlushDenormals(),
 		py::arg("audio"), py::arg("control"), py::arg("cutoff"),
 		py::arg("resonance") = 0.0, py::arg("high_resonance") = false,
 		py::arg("drive_gain") = 1.0, py::arg("bass") = 0.0,
 		py::arg("sample_rate") = 48000.0, py::arg("oversampled_vca") = true);
-	module.def("diode_ladder_vca_x4", &RenderDiodeLadderVca<DiodeLadderX4>,
+	module.def("diode_ladder_vca_x4", &RenderDiodeLadderVca<DiodeLadderX4>, FlushDenormals(),
 		py::arg("audio"), py::arg("control"), py::arg("cutoff"),
 		py::arg("resonance") = 0.0, py::arg("high_resonance") = false,
 		py::arg("drive_gain") = 1.0, py::arg("bass") = 0.0,
 		py::arg("sample_rate") = 48000.0, py::arg("oversampled_vca") = true);
 	module.def("diode_ladder_voice_x4",
-		&RenderModulatedDiodeLadderVoice<DiodeLadderX4>, py::arg("audio"),
+		&RenderModulatedDiodeLadderVoice<DiodeLadderX4>, FlushDenormals(), py::arg("audio"),
 		py::arg("cutoff"), py::arg("base_control"),
 		py::arg("accent_control"), py::arg("resonance") = 0.0,
 		py::arg("high_resonance") = false, py::arg("drive_gain") = 1.0,
@@ -1359,32 +1711,32 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		tfdsp::Tb303Oscillator<tfdsp::X4Resampler_Order7>;
 	using Tb303OscillatorX4Order5 = tfdsp::Tb303Oscillator<
 		tfdsp::X4Resampler<tfdsp::X2Resampler_Order5>>;
-	module.def("tb303_q8", &RenderTb303Q8, py::arg("saw"),
+	module.def("tb303_q8", &RenderTb303Q8, FlushDenormals(), py::arg("saw"),
 		py::arg("frequency"), py::arg("shape") = 0.0,
 		py::arg("sample_rate") = 192000.0);
-	module.def("tb303_oscillator_x1", &RenderTb303Oscillator<Tb303OscillatorX1>,
+	module.def("tb303_oscillator_x1", &RenderTb303Oscillator<Tb303OscillatorX1>, FlushDenormals(),
 		py::arg("pitch"), py::arg("slide"), py::arg("fm"),
 		py::arg("shape"), py::arg("wave"), py::arg("sample_rate") = 48000.0,
 		py::arg("slide_time") = 0.060, py::arg("linear_fm") = false,
 		py::arg("sync") = py::none());
-	module.def("tb303_oscillator_x2", &RenderTb303Oscillator<Tb303OscillatorX2>,
+	module.def("tb303_oscillator_x2", &RenderTb303Oscillator<Tb303OscillatorX2>, FlushDenormals(),
 		py::arg("pitch"), py::arg("slide"), py::arg("fm"),
 		py::arg("shape"), py::arg("wave"), py::arg("sample_rate") = 48000.0,
 		py::arg("slide_time") = 0.060, py::arg("linear_fm") = false,
 		py::arg("sync") = py::none());
 	module.def("tb303_oscillator_x2_order5",
-		&RenderTb303Oscillator<Tb303OscillatorX2Order5>,
+		&RenderTb303Oscillator<Tb303OscillatorX2Order5>, FlushDenormals(),
 		py::arg("pitch"), py::arg("slide"), py::arg("fm"),
 		py::arg("shape"), py::arg("wave"), py::arg("sample_rate") = 48000.0,
 		py::arg("slide_time") = 0.060, py::arg("linear_fm") = false,
 		py::arg("sync") = py::none());
-	module.def("tb303_oscillator_x4", &RenderTb303Oscillator<Tb303OscillatorX4>,
+	module.def("tb303_oscillator_x4", &RenderTb303Oscillator<Tb303OscillatorX4>, FlushDenormals(),
 		py::arg("pitch"), py::arg("slide"), py::arg("fm"),
 		py::arg("shape"), py::arg("wave"), py::arg("sample_rate") = 48000.0,
 		py::arg("slide_time") = 0.060, py::arg("linear_fm") = false,
 		py::arg("sync") = py::none());
 	module.def("tb303_oscillator_x4_order5",
-		&RenderTb303Oscillator<Tb303OscillatorX4Order5>,
+		&RenderTb303Oscillator<Tb303OscillatorX4Order5>, FlushDenormals(),
 		py::arg("pitch"), py::arg("slide"), py::arg("fm"),
 		py::arg("shape"), py::arg("wave"), py::arg("sample_rate") = 48000.0,
 		py::arg("slide_time") = 0.060, py::arg("linear_fm") = false,
@@ -1402,15 +1754,15 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		py::array::c_style | py::array::forcecast> input, int character)
 	{
 		return EvaluateWavefolderFunction(input, character, false);
-	}, py::arg("input"), py::arg("character") = 0);
+	}, FlushDenormals(), py::arg("input"), py::arg("character") = 0);
 	module.def("wavefolder_primitive", [](py::array_t<double,
 		py::array::c_style | py::array::forcecast> input, int character)
 	{
 		return EvaluateWavefolderFunction(input, character, true);
-	}, py::arg("input"), py::arg("character") = 0);
-	module.def("wavefolder_adaa", &EvaluateWavefolderAdaa,
+	}, FlushDenormals(), py::arg("input"), py::arg("character") = 0);
+	module.def("wavefolder_adaa", &EvaluateWavefolderAdaa, FlushDenormals(),
 		py::arg("input"), py::arg("character") = 0);
-	module.def("unison_spread_cents", &tfdsp::UnisonSpreadCents,
+	module.def("unison_spread_cents", &tfdsp::UnisonSpreadCents, FlushDenormals(),
 		py::arg("control"));
 	module.def("unison_pitch_positions", [](int voices)
 	{
@@ -1421,10 +1773,10 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (int voice = 0; voice < count; ++voice)
 			output(voice) = positions[voice];
 		return result;
-	}, py::arg("voices"));
-	module.def("unison_output_gain", &tfdsp::UnisonOutputGain,
+	}, FlushDenormals(), py::arg("voices"));
+	module.def("unison_output_gain", &tfdsp::UnisonOutputGain, FlushDenormals(),
 		py::arg("voices"));
-	module.def("stacked_oscillator", &RenderStackedOscillator,
+	module.def("stacked_oscillator", &RenderStackedOscillator, FlushDenormals(),
 		py::arg("frequency"), py::arg("pulse_width"), py::arg("voices") = 7,
 		py::arg("spread_cents") = 4.0, py::arg("pulse_mix") = 0.0,
 		py::arg("width") = 0.65, py::arg("sample_rate") = 48000.0);
@@ -1438,7 +1790,7 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (int voice = 0; voice < count; ++voice)
 			output(voice) = positions[voice];
 		return result;
-	}, py::arg("voices"));
+	}, FlushDenormals(), py::arg("voices"));
 	module.def("stacked_oscillator_pan_positions", [](int voices)
 	{
 		const int count = std::clamp(voices, 1,
@@ -1449,41 +1801,64 @@ PYBIND11_MODULE(_triggerfish_dsp, module)
 		for (int voice = 0; voice < count; ++voice)
 			output(voice) = positions[voice];
 		return result;
-	}, py::arg("voices"));
+	}, FlushDenormals(), py::arg("voices"));
 	module.def("wavefold_oscillator_x1",
-		&RenderWavefoldOscillator<WavefoldOscillatorX1>,
+		&RenderWavefoldOscillator<WavefoldOscillatorX1>, FlushDenormals(),
 		py::arg("frequency"), py::arg("morph"), py::arg("fold"),
 		py::arg("symmetry"), py::arg("sample_rate") = 48000.0,
 		py::arg("adaa") = false, py::arg("character") = 0);
 	module.def("wavefold_oscillator_x2",
-		&RenderWavefoldOscillator<WavefoldOscillatorX2>,
+		&RenderWavefoldOscillator<WavefoldOscillatorX2>, FlushDenormals(),
 		py::arg("frequency"), py::arg("morph"), py::arg("fold"),
 		py::arg("symmetry"), py::arg("sample_rate") = 48000.0,
 		py::arg("adaa") = false, py::arg("character") = 0);
 	module.def("wavefold_oscillator_x4",
-		&RenderWavefoldOscillator<WavefoldOscillatorX4>,
+		&RenderWavefoldOscillator<WavefoldOscillatorX4>, FlushDenormals(),
 		py::arg("frequency"), py::arg("morph"), py::arg("fold"),
 		py::arg("symmetry"), py::arg("sample_rate") = 48000.0,
 		py::arg("adaa") = false, py::arg("character") = 0);
 	module.def("wavefold_oscillator_x16",
-		&RenderWavefoldOscillator<WavefoldOscillatorX16>,
+		&RenderWavefoldOscillator<WavefoldOscillatorX16>, FlushDenormals(),
 		py::arg("frequency"), py::arg("morph"), py::arg("fold"),
 		py::arg("symmetry"), py::arg("sample_rate") = 48000.0,
 		py::arg("adaa") = false, py::arg("character") = 0);
 	module.def("wavefolder_external_x2",
-		&RenderWavefolderExternal<WavefoldOscillatorX2>,
+		&RenderWavefolderExternal<WavefoldOscillatorX2>, FlushDenormals(),
 		py::arg("audio"), py::arg("fold"), py::arg("symmetry"),
 		py::arg("sample_rate") = 48000.0, py::arg("adaa") = false,
 		py::arg("character") = 0);
 	module.def("wavefolder_external_x4",
-		&RenderWavefolderExternal<WavefoldOscillatorX4>,
+		&RenderWavefolderExternal<WavefoldOscillatorX4>, FlushDenormals(),
 		py::arg("audio"), py::arg("fold"), py::arg("symmetry"),
 		py::arg("sample_rate") = 48000.0, py::arg("adaa") = false,
 		py::arg("character") = 0);
 	module.def("wavefolder_external_x16",
-		&RenderWavefolderExternal<WavefoldOscillatorX16>,
+		&RenderWavefolderExternal<WavefoldOscillatorX16>, FlushDenormals(),
 		py::arg("audio"), py::arg("fold"), py::arg("symmetry"),
 		py::arg("sample_rate") = 48000.0, py::arg("adaa") = false,
 		py::arg("character") = 0);
 
+
+	BindDiodeLadderStream<DiodeLadderX1>(module, "DiodeLadderX1");
+	BindDiodeLadderStream<DiodeLadderX2>(module, "DiodeLadderX2");
+	BindDiodeLadderStream<DiodeLadderX4>(module, "DiodeLadderX4");
+	BindArp4072Stream<Arp4072X1>(module, "Arp4072X1");
+	BindArp4072Stream<Arp4072X2>(module, "Arp4072X2");
+	BindArp4072Stream<Arp4072X4>(module, "Arp4072X4");
+	BindArp4019Stream<Arp4019X1>(module, "Arp4019X1");
+	BindArp4019Stream<Arp4019X4>(module, "Arp4019X4");
+	BindTb303OscillatorStream<Tb303OscillatorX1>(module, "Tb303OscillatorX1");
+	BindTb303OscillatorStream<Tb303OscillatorX2>(module, "Tb303OscillatorX2");
+	BindTb303OscillatorStream<Tb303OscillatorX4>(module, "Tb303OscillatorX4");
+	BindWavefoldOscillatorStream<WavefoldOscillatorX1>(module, "WavefoldOscillatorX1");
+	BindWavefoldOscillatorStream<WavefoldOscillatorX2>(module, "WavefoldOscillatorX2");
+	BindWavefoldOscillatorStream<WavefoldOscillatorX4>(module, "WavefoldOscillatorX4");
+	{
+		py::class_<ArpEnvelopeStream> binding(module, "ArpEnvelope");
+		binding.def(py::init<double, int>(), py::arg("sample_rate") = 48000.0,
+			py::arg("mode") = 0);
+		DefineStreamProcess(binding, "gate", py::arg("attack"), py::arg("decay"),
+			py::arg("sustain"), py::arg("release"), py::arg("trigger") = 0.0,
+			py::arg("curve") = 0.0, py::arg("auto_gate_trigger") = true);
+	}
 }
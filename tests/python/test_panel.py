@@ -294,10 +294,11 @@ def test_4072_voice_core_wrapper_preserves_normals_polyphony_and_runtime_state()
     assert "if (vcaOverride)" in source
 
     # Runtime quality changes reset the newly selected DSP path rather than
-    # resuming stale filter and resampler history.
-    assert "if (oversampling != activeOversampling)" in source
-    assert "activeOversampling = oversampling;" in source
-    assert "ResetActivePath();" in source
+    # resuming stale filter and resampler history, and only switch once the
+    # widget has created that path for every channel in use.
+    assert "voices.BeginProcess(oversampling," in source
+    assert "voice.filter.Reset();" in source
+    assert "voice.vca.Reset();" in source
 
     # Bypass follows the VCA input normalization instead of always routing the
     # filter input, and non-audio envelope outputs do not retain stale channels.
@@ -314,7 +315,7 @@ def test_4072_voice_core_wrapper_preserves_normals_polyphony_and_runtime_state()
 def test_303_oscillator_panel_matches_widget_layout():
     widget_source = (ROOT / "src" / "Tf303Oscillator.cpp").read_text(encoding="utf-8")
     assert widget_source.count("oversampling = 1;") == 2
-    assert widget_source.count("activeOversampling = 1;") == 2
+    assert "oscillators{ 1 };" in widget_source
     assert '{"2x (lower CPU)", "4x (default)"}' in widget_source
     controls = list(control_pattern("Tf303Oscillator").finditer(widget_source))
     assert len(controls) == 19
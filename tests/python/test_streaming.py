@@ -0,0 +1,114 @@
+import threading
+
+import numpy as np
+import pytest
+
+import _triggerfish_dsp as dsp
+
+SAMPLE_RATE = 48_000.0
+
+
+def _sine(size, frequency=110.0, amplitude=4.0, dtype=np.float64):
+    time = np.arange(size) / SAMPLE_RATE
+    return (amplitude * np.sin(2.0 * np.pi * frequency * time)).astype(dtype)
+
+
+def _render_chunks(model, signal, chunk, **controls):
+    output = np.empty_like(signal)
+    for start in range(0, signal.size, chunk):
+        model.process(signal[start : start + chunk], output[start : start + chunk], **controls)
+    return output
+
+
+def test_chunked_stream_matches_one_shot_render():
+    audio = _sine(9_600)
+    expected = dsp.arp4072_x2(audio, 1_200.0, 0.6)
+    streamed = _render_chunks(dsp.Arp4072X2(SAMPLE_RATE), audio, 333, cutoff=1_200.0, resonance=0.6)
+    np.testing.assert_allclose(streamed, expected, rtol=0.0, atol=1.0e-6)
+
+    expected = dsp.diode_ladder_x4(audio, 900.0, 0.5)
+    streamed = _render_chunks(dsp.DiodeLadderX4(SAMPLE_RATE), audio, 1_000, cutoff=900.0, resonance=0.5)
+    np.testing.assert_allclose(streamed, expected, rtol=0.0, atol=1.0e-6)
+
+
+def test_controls_accept_per_sample_arrays():
+    size = 4_800
+    audio = _sine(size)
+    cutoff = np.geomspace(200.0, 4_000.0, size)
+    expected = dsp.arp4072_controls_x4(audio, cutoff, np.full(size, 0.4))
+    output = np.empty(size)
+    dsp.Arp4072X4(SAMPLE_RATE).process(audio, output, cutoff=cutoff, resonance=0.4)
+    np.testing.assert_allclose(output, expected, rtol=0.0, atol=1.0e-6)
+
+
+def test_float32_buffers_are_rendered_in_place():
+    audio = _sine(2_400, dtype=np.float32)
+    output = np.zeros(2_400, dtype=np.float32)
+    address = output.__array_interface__["data"][0]
+    dsp.DiodeLadderX2(SAMPLE_RATE).process(audio, output, cutoff=800.0)
+    assert output.__array_interface__["data"][0] == address
+    assert np.any(output != 0.0)
+
+
+def test_mismatched_buffers_are_rejected_instead_of_copied():
+    model = dsp.Arp4072X1(SAMPLE_RATE)
+    with pytest.raises(TypeError):
+        model.process(np.zeros(16), np.zeros(16, dtype=np.float32), cutoff=500.0)
+    with pytest.raises(TypeError):
+        model.process(np.zeros(32)[::2], np.zeros(16), cutoff=500.0)
+    with pytest.raises(TypeError):
+        model.process(np.zeros(16), np.zeros(16), cutoff=np.zeros(16, dtype=np.float32))
+    with pytest.raises(ValueError):
+        model.process(np.zeros(16), np.zeros(8), cutoff=500.0)
+
+
+def test_reset_restores_the_initial_state():
+    audio = _sine(4_800)
+    model = dsp.Arp4072X2(SAMPLE_RATE)
+    first = np.empty_like(audio)
+    second = np.empty_like(audio)
+    model.process(audio, first, cutoff=700.0, resonance=0.9)
+    model.reset()
+    model.process(audio, second, cutoff=700.0, resonance=0.9)
+    np.testing.assert_array_equal(first, second)
+
+
+def test_voices_render_concurrently_on_python_threads():
+    audio = [_sine(24_000, frequency=55.0 * (voice + 1)) for voice in range(4)]
+    sequential = []
+    for signal in audio:
+        output = np.empty_like(signal)
+        dsp.DiodeLadderX2(SAMPLE_RATE).process(signal, output, cutoff=1_500.0, resonance=0.7)
+        sequential.append(output)
+
+    outputs = [np.empty_like(signal) for signal in audio]
+
+    def render(voice):
+        model = dsp.DiodeLadderX2(SAMPLE_RATE)
+        _render_chunks(model, audio[voice], 512, cutoff=1_500.0, resonance=0.7)
+        model.reset()
+        model.process(audio[voice], outputs[voice], cutoff=1_500.0, resonance=0.7)
+
+    threads = [threading.Thread(target=render, args=(voice,)) for voice in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    for expected, actual in zip(sequential, outputs):
+        np.testing.assert_array_equal(actual, expected)
+
+
+def test_oscillator_and_envelope_streams_match_one_shot_renders():
+    size = 4_800
+    pitch = np.zeros(size)
+    zeros = np.zeros(size)
+    expected = dsp.tb303_oscillator_x2(pitch, zeros, zeros, zeros, zeros)[:, 2]
+    streamed = _render_chunks(dsp.Tb303OscillatorX2(SAMPLE_RATE), pitch, 700)
+    np.testing.assert_allclose(streamed, expected, rtol=0.0, atol=1.0e-6)
+
+    gate = np.where(np.arange(size) < size // 2, 10.0, 0.0)
+    expected = dsp.arp_envelope(gate, zeros, 0.01, 0.05, 0.5, 0.02)
+    streamed = _render_chunks(
+        dsp.ArpEnvelope(SAMPLE_RATE), gate, 250, attack=0.01, decay=0.05, sustain=0.5, release=0.02
+    )
+    np.testing.assert_allclose(streamed, expected, rtol=0.0, atol=1.0e-12)
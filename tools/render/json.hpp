@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal JSON reader for the render descriptions.
+ *
+ * Supports the full value grammar except \u escapes outside the ASCII range,
+ * which the voice descriptions never need. Parse errors throw
+ * std::runtime_error with the byte offset of the problem.
+ */
+namespace tfrender
+{
+	class JsonValue
+	{
+	public:
+		enum class Type
+		{
+			Null,
+			Bool,
+			Number,
+			String,
+			Array,
+			Object,
+		};
+
+		Type type{ Type::Null };
+		bool boolean{};
+		double number{};
+		std::string string;
+		std::vector<JsonValue> array;
+		std::map<std::string, JsonValue> object;
+
+		bool IsNull() const { return type == Type::Null; }
+		bool IsNumber() const { return type == Type::Number; }
+		bool IsString() const { return type == Type::String; }
+		bool IsArray() const { return type == Type::Array; }
+		bool IsObject() const { return type == Type::Object; }
+
+		/** Member lookup, returns nullptr when absent or when this is not an object. */
+		const JsonValue* Find(const std::string& key) const
+		{
+			if (type != Type::Object)
+				return nullptr;
+			const auto found = object.find(key);
+			return found == object.end() ? nullptr : &found->second;
+		}
+
+		double NumberOr(const std::string& key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			if (!value)
+				return fallback;
+			if (!value->IsNumber())
+				throw std::runtime_error("\"" + key + "\" must be a number");
+			return value->number;
+		}
+
+		std::string StringOr(const std::string& key, const std::string& fallback) const
+		{
+			const JsonValue* value = Find(key);
+			if (!value)
+				return fallback;
+			if (!value->IsString())
+				throw std::runtime_error("\"" + key + "\" must be a string");
+			return value->string;
+		}
+
+		bool BoolOr(const std::string& key, bool fallback) const
+		{
+			const JsonValue* value = Find(key);
+			if (!value)
+				return fallback;
+			if (value->type != Type::Bool)
+				throw std::runtime_error("\"" + key + "\" must be true or false");
+			return value->boolean;
+		}
+	};
+
+	class JsonParser
+	{
+		const std::string& _text;
+		std::size_t _position{};
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			throw std::runtime_error("JSON " + message + " at offset " + std::to_string(_position));
+		}
+
+		void SkipWhitespace()
+		{
+			while (_position < _text.size() && std::isspace(static_cast<unsigned char>(_text[_position])))
+				++_position;
+		}
+
+		bool Consume(char expected)
+		{
+			SkipWhitespace();
+			if (_position < _text.size() && _text[_position] == expected)
+			{
+				++_position;
+				return true;
+			}
+			return false;
+		}
+
+		void Expect(char expected)
+		{
+			if (!Consume(expected))
+				Fail(std::string("expected '") + expected + "'");
+		}
+
+		bool ConsumeWord(const char* word)
+		{
+			const std::string token(word);
+			if (_text.compare(_position, token.size(), token) != 0)
+				return false;
+			_position += token.size();
+			return true;
+		}
+
+		std::string ParseString()
+		{
+			Expect('"');
+			std::string result;
+			while (_position < _text.size() && _text[_position] != '"')
+			{
+				char c = _text[_position++];
+				if (c == '\\')
+				{
+					if (_position >= _text.size())
+						break;
+					const char escaped = _text[_position++];
+					switch (escaped)
+					{
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'u':
+					{
+						if (_position + 4 > _text.size())
+							Fail("truncated \\u escape");
+						const long code = std::strtol(_text.substr(_position, 4).c_str(), nullptr, 16);
+						if (code > 0x7f)
+							Fail("non-ASCII \\u escape");
+						c = static_cast<char>(code);
+						_position += 4;
+						break;
+					}
+					default: c = escaped; break;
+					}
+				}
+				result.push_back(c);
+			}
+			if (_position >= _text.size())
+				Fail("unterminated string");
+			++_position;
+			return result;
+		}
+
+		JsonValue ParseValue()
+		{
+			SkipWhitespace();
+			if (_position >= _text.size())
+				Fail("unexpected end of input");
+			JsonValue value;
+			const char c = _text[_position];
+			if (c == '{')
+			{
+				++_position;
+				value.type = JsonValue::Type::Object;
+				if (Consume('}'))
+					return value;
+				do
+				{
+					SkipWhitespace();
+					const std::string key = ParseString();
+					Expect(':');
+					value.object[key] = ParseValue();
+				} while (Consume(','));
+				Expect('}');
+			}
+			else if (c == '[')
+			{
+				++_position;
+				value.type = JsonValue::Type::Array;
+				if (Consume(']'))
+					return value;
+				do
+					value.array.push_back(ParseValue());
+				while (Consume(','));
+				Expect(']');
+			}
+			else if (c == '"')
+			{
+				value.type = JsonValue::Type::String;
+				value.string = ParseString();
+			}
+			else if (ConsumeWord("true"))
+			{
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+			}
+			else if (ConsumeWord("false"))
+			{
+				value.type = JsonValue::Type::Bool;
+			}
+			else if (ConsumeWord("null"))
+			{
+				value.type = JsonValue::Type::Null;
+			}
+			else
+			{
+				const char* start = _text.c_str() + _position;
+				char* end = nullptr;
+				value.type = JsonValue::Type::Number;
+				value.number = std::strtod(start, &end);
+				if (end == start)
+					Fail("unexpected character");
+				_position += static_cast<std::size_t>(end - start);
+			}
+			return value;
+		}
+
+	public:
+		explicit JsonParser(const std::string& text) : _text(text) {}
+
+		JsonValue Parse()
+		{
+			JsonValue value = ParseValue();
+			SkipWhitespace();
+			if (_position != _text.size())
+				Fail("trailing characters");
+			return value;
+		}
+	};
+
+	inline JsonValue ParseJson(const std::string& text)
+	{
+		return JsonParser(text).Parse();
+	}
+}
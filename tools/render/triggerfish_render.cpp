@@ -0,0 +1,268 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "tfdsp/denormal.hpp"
+#include "voice_chain.hpp"
+
+/**
+ * Headless offline renderer for tfdsp voice chains.
+ *
+ * Usage: triggerfish_render description.json [--threads n] [--output-dir path]
+ *
+ * The description holds "sample_rate", "block_size" and a "voices" array,
+ * see voice_chain.hpp for the voice format and tools/render/examples for
+ * complete descriptions. Voices are independent and rendered in parallel,
+ * each one streamed to its own mono float WAV (or raw float32 for .raw/.f32
+ * paths). The exit status is non-zero when a voice fails or produces
+ * non-finite samples, so soak runs can be scripted.
+ */
+namespace
+{
+	struct Options
+	{
+		std::string descriptionPath;
+		std::string outputDirectory;
+		int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (argument == "--threads" && hasValue)
+				options.threads = std::max(std::atoi(argv[++i]), 1);
+			else if (argument == "--output-dir" && hasValue)
+				options.outputDirectory = argv[++i];
+			else if (!argument.empty() && argument[0] != '-' && options.descriptionPath.empty())
+				options.descriptionPath = argument;
+			else
+				return false;
+		}
+		return !options.descriptionPath.empty();
+	}
+
+	/** Streams mono float32 samples to a WAV file, or headerless for raw output. */
+	class AudioFileWriter
+	{
+		std::ofstream _file;
+		std::uint32_t _sampleRate;
+		bool _wav;
+		std::uint32_t _samples{};
+
+		void WriteU32(std::uint32_t value)
+		{
+			const char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8),
+				static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+			_file.write(bytes, 4);
+		}
+
+		void WriteU16(std::uint16_t value)
+		{
+			const char bytes[2] = { static_cast<char>(value), static_cast<char>(value >> 8) };
+			_file.write(bytes, 2);
+		}
+
+		void WriteHeader(std::uint32_t sampleRate)
+		{
+			constexpr std::uint16_t IeeeFloat = 3;
+			const std::uint32_t dataBytes = _samples * 4u;
+			_file.write("RIFF", 4);
+			WriteU32(36u + dataBytes);
+			_file.write("WAVEfmt ", 8);
+			WriteU32(16u);
+			WriteU16(IeeeFloat);
+			WriteU16(1u);
+			WriteU32(sampleRate);
+			WriteU32(sampleRate * 4u);
+			WriteU16(4u);
+			WriteU16(32u);
+			_file.write("data", 4);
+			WriteU32(dataBytes);
+		}
+
+	public:
+		AudioFileWriter(const std::string& path, std::uint32_t sampleRate)
+			: _file(path, std::ios::binary), _sampleRate(sampleRate)
+		{
+			if (!_file)
+				throw std::runtime_error("cannot write " + path);
+			const auto extension = path.substr(path.find_last_of('.') + 1);
+			_wav = extension != "raw" && extension != "f32";
+			if (_wav)
+				WriteHeader(sampleRate);
+		}
+
+		void Write(const float* samples, int count)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				std::uint32_t bits;
+				std::memcpy(&bits, &samples[i], sizeof(bits));
+				WriteU32(bits);
+			}
+			_samples += static_cast<std::uint32_t>(count);
+		}
+
+		/** Patch the WAV sizes now that the length is known. */
+		void Close()
+		{
+			if (_wav)
+			{
+				_file.seekp(0);
+				WriteHeader(_sampleRate);
+			}
+			_file.close();
+			if (_file.fail())
+				throw std::runtime_error("error while writing audio output");
+		}
+	};
+
+	struct VoiceReport
+	{
+		std::string name;
+		std::string path;
+		long samples{};
+		long nonFinite{};
+		double peak{};
+		double seconds{};
+		std::string error;
+	};
+
+	VoiceReport RenderVoice(const tfrender::JsonValue& description, double sampleRate, int blockSize,
+		const std::string& baseDirectory, const std::string& outputDirectory)
+	{
+		VoiceReport report;
+		report.name = description.StringOr("name", "voice");
+		try
+		{
+			const auto start = std::chrono::steady_clock::now();
+			tfrender::Voice voice(description, sampleRate, blockSize, baseDirectory);
+			report.path = voice.OutputPath();
+			if (!outputDirectory.empty() && report.path[0] != '/')
+				report.path = outputDirectory + "/" + report.path;
+			AudioFileWriter writer(report.path, static_cast<std::uint32_t>(sampleRate));
+			std::vector<float> block(blockSize);
+			while (report.samples < voice.TotalSamples())
+			{
+				const int count = voice.RenderBlock(block.data(), report.samples);
+				for (int i = 0; i < count; ++i)
+				{
+					if (!std::isfinite(block[i]))
+					{
+						++report.nonFinite;
+						block[i] = 0.0f;
+					}
+					report.peak = std::max(report.peak, static_cast<double>(std::abs(block[i])));
+				}
+				writer.Write(block.data(), count);
+				report.samples += count;
+			}
+			writer.Close();
+			report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		catch (const std::exception& exception)
+		{
+			report.error = exception.what();
+		}
+		return report;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cerr << "usage: triggerfish_render description.json [--threads n] [--output-dir path]\n";
+		return 2;
+	}
+
+	tfrender::JsonValue description;
+	try
+	{
+		std::ifstream file(options.descriptionPath);
+		if (!file)
+			throw std::runtime_error("cannot open " + options.descriptionPath);
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		description = tfrender::ParseJson(buffer.str());
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "error: " << exception.what() << '\n';
+		return 1;
+	}
+
+	const double sampleRate = description.NumberOr("sample_rate", 48000.0);
+	const int blockSize = std::max(static_cast<int>(description.NumberOr("block_size", 256.0)), 1);
+	const tfrender::JsonValue* voices = description.Find("voices");
+	if (!voices || !voices->IsArray() || voices->array.empty() || !(sampleRate > 0.0))
+	{
+		std::cerr << "error: the description needs a positive sample_rate and a non-empty \"voices\" array\n";
+		return 1;
+	}
+	const auto slash = options.descriptionPath.find_last_of('/');
+	const std::string baseDirectory = slash == std::string::npos ? "" :
+		options.descriptionPath.substr(0, slash);
+
+	// Voices share nothing, so workers simply claim the next unrendered voice.
+	// Each flushes denormals as a Rack engine thread would, since the polyphase
+	// resamplers leave their decaying states to flush-to-zero.
+	const int voiceCount = static_cast<int>(voices->array.size());
+	std::vector<VoiceReport> reports(voiceCount);
+	std::atomic<int> nextVoice{ 0 };
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int worker = 0; worker < std::min(options.threads, voiceCount); ++worker)
+		workers.emplace_back([&]()
+		{
+			tfdsp::ScopedFlushDenormals flushDenormals;
+			for (int index = nextVoice++; index < voiceCount; index = nextVoice++)
+				reports[index] = RenderVoice(voices->array[index], sampleRate, blockSize,
+					baseDirectory, options.outputDirectory);
+		});
+	for (auto& worker : workers)
+		worker.join();
+	const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failures = 0;
+	double audioSeconds = 0.0;
+	for (const auto& report : reports)
+	{
+		if (!report.error.empty())
+		{
+			std::cerr << "error: voice \"" << report.name << "\": " << report.error << '\n';
+			++failures;
+			continue;
+		}
+		const double seconds = report.samples / sampleRate;
+		audioSeconds += seconds;
+		std::printf("%-24s %8.2f s  peak %7.3f V  %7.1fx real time  -> %s\n", report.name.c_str(),
+			seconds, report.peak, seconds / std::max(report.seconds, 1e-9), report.path.c_str());
+		if (report.nonFinite > 0)
+		{
+			std::cerr << "error: voice \"" << report.name << "\" produced " << report.nonFinite
+				<< " non-finite samples, written as zero\n";
+			++failures;
+		}
+	}
+	std::printf("rendered %.2f s of audio in %.2f s on %d thread(s), %.1fx real time\n",
+		audioSeconds, wallSeconds, std::min(options.threads, voiceCount),
+		audioSeconds / std::max(wallSeconds, 1e-9));
+	return failures == 0 ? 0 : 1;
+}
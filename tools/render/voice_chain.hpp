@@ -0,0 +1,586 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "json.hpp"
+#include "models/Arp4019Vca.hpp"
+#include "models/Arp4072Filter.hpp"
+#include "models/ArpEnvelope.hpp"
+#include "models/DiodeLadderFilter.hpp"
+#include "models/Tb303Oscillator.hpp"
+#include "models/Tb303Voice.hpp"
+#include "tfdsp/sampleRate.hpp"
+#include "tfdsp/wavefolder.hpp"
+
+/**
+ * Voice chains for the headless renderer.
+ *
+ * A voice is a list of stages that read and write named lanes, one block of
+ * host samples at a time. CV sources fill their lanes first, then each stage
+ * runs over the whole block in description order. Audio travels on the
+ * "audio" lane unless a stage names another "input" or "output", so
+ * oscillator -> filter -> VCA chains need no explicit routing.
+ *
+ * Every numeric stage parameter is a constant, a lane name, or
+ * {"cv": lane, "scale": s, "offset": o}. Voltages follow the Rack
+ * conventions of the matching modules: pitch and cutoff in V/oct around
+ * C4, audio in volts, envelopes 0-10 V.
+ */
+namespace tfrender
+{
+	constexpr double C4Hz = 261.6255653005986;
+
+	template<typename Resampler>
+	std::unique_ptr<Resampler> CreateResampler()
+	{
+		if constexpr (std::is_same_v<Resampler, tfdsp::DummyResampler>)
+			return tfdsp::CreateDummyResampler();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order7>)
+			return tfdsp::CreateX2Resampler_Chebychev7();
+		else
+			return tfdsp::CreateX4Resampler_Cheby7();
+	}
+
+	// By value, for the models that embed their resamplers.
+	template<typename Resampler>
+	Resampler MakeResampler()
+	{
+		if constexpr (std::is_same_v<Resampler, tfdsp::DummyResampler>)
+			return tfdsp::DummyResampler();
+		else if constexpr (std::is_same_v<Resampler, tfdsp::X2Resampler_Order7>)
+			return tfdsp::MakeX2Resampler_Chebychev7();
+		else
+			return tfdsp::MakeX4Resampler_Cheby7();
+	}
+
+	/** Named per-block buffers shared by the CV sources and the stages of one voice. */
+	class Lanes
+	{
+		std::map<std::string, int> _indices;
+		std::vector<bool> _written;
+		std::vector<std::vector<double>> _buffers;
+		int _blockSize;
+
+	public:
+		explicit Lanes(int blockSize) : _blockSize(blockSize) {}
+
+		/** Lane written by a source or stage, created on first use. */
+		int Output(const std::string& name)
+		{
+			const auto found = _indices.find(name);
+			if (found != _indices.end())
+			{
+				_written[found->second] = true;
+				return found->second;
+			}
+			const int index = static_cast<int>(_buffers.size());
+			_indices[name] = index;
+			_written.push_back(true);
+			_buffers.emplace_back(_blockSize, 0.0);
+			return index;
+		}
+
+		/** Lane read by a stage, which must already have been written upstream. */
+		int Input(const std::string& name) const
+		{
+			const auto found = _indices.find(name);
+			if (found == _indices.end() || !_written[found->second])
+				throw std::runtime_error("lane \"" + name + "\" is read before any CV source or stage writes it");
+			return found->second;
+		}
+
+		double* Data(int lane) { return _buffers[lane].data(); }
+		const double* Data(int lane) const { return _buffers[lane].data(); }
+		int BlockSize() const { return _blockSize; }
+	};
+
+	/** A constant plus an optionally scaled lane. */
+	struct Parameter
+	{
+		double offset{};
+		double scale{ 1.0 };
+		int lane{ -1 };
+
+		double At(const Lanes& lanes, int i) const
+		{
+			return lane < 0 ? offset : offset + scale * lanes.Data(lane)[i];
+		}
+	};
+
+	inline Parameter ReadParameter(const JsonValue& stage, const std::string& key,
+		double fallback, const Lanes& lanes)
+	{
+		const JsonValue* value = stage.Find(key);
+		Parameter parameter;
+		parameter.offset = fallback;
+		if (!value)
+			return parameter;
+		if (value->IsNumber())
+			parameter.offset = value->number;
+		else if (value->IsString())
+		{
+			parameter.offset = 0.0;
+			parameter.lane = lanes.Input(value->string);
+		}
+		else if (value->IsObject() && value->Find("cv"))
+		{
+			parameter.lane = lanes.Input(value->StringOr("cv", ""));
+			parameter.scale = value->NumberOr("scale", 1.0);
+			parameter.offset = value->NumberOr("offset", 0.0);
+		}
+		else
+			throw std::runtime_error("\"" + key + "\" must be a number, a lane name or {\"cv\": ...}");
+		return parameter;
+	}
+
+	/** Audio input, the "audio" lane unless the stage routes another one. */
+	inline Parameter ReadInput(const JsonValue& stage, const Lanes& lanes)
+	{
+		if (!stage.Find("input"))
+			return { 0.0, 1.0, lanes.Input("audio") };
+		return ReadParameter(stage, "input", 0.0, lanes);
+	}
+
+	/** CV lane fed from a sample-and-hold stream of values. */
+	class CvSource
+	{
+		int _lane;
+		int _holdSamples;
+		int _held{};
+		double _value{};
+		bool _exhausted{};
+
+	protected:
+		/** Next value of the stream, false once it has ended. */
+		virtual bool NextValue(double& value) = 0;
+
+	public:
+		CvSource(int lane, int holdSamples) : _lane(lane), _holdSamples(std::max(holdSamples, 1)) {}
+		virtual ~CvSource() = default;
+
+		/** Fill the lane, holding the last value once the stream has ended. */
+		void Fill(Lanes& lanes, int count)
+		{
+			double* out = lanes.Data(_lane);
+			for (int i = 0; i < count; ++i)
+			{
+				if (_held == 0 && !_exhausted)
+					_exhausted = !NextValue(_value);
+				_held = _held + 1 == _holdSamples ? 0 : _held + 1;
+				out[i] = _value;
+			}
+		}
+	};
+
+	class SequenceCv : public CvSource
+	{
+		std::vector<double> _values;
+		std::size_t _index{};
+		bool _loop;
+
+	protected:
+		bool NextValue(double& value) override
+		{
+			if (_index == _values.size())
+			{
+				if (!_loop || _values.empty())
+					return false;
+				_index = 0;
+			}
+			value = _values[_index++];
+			return true;
+		}
+
+	public:
+		SequenceCv(int lane, int holdSamples, std::vector<double> values, bool loop)
+			: CvSource(lane, holdSamples), _values(std::move(values)), _loop(loop) {}
+	};
+
+	/** Streams a file block by block: raw little-endian float32 for .f32 and
+	 * .raw, otherwise whitespace separated text values. */
+	class FileCv : public CvSource
+	{
+		std::ifstream _file;
+		bool _binary;
+
+	protected:
+		bool NextValue(double& value) override
+		{
+			if (_binary)
+			{
+				float sample;
+				if (!_file.read(reinterpret_cast<char*>(&sample), sizeof(sample)))
+					return false;
+				value = sample;
+				return true;
+			}
+			return static_cast<bool>(_file >> value);
+		}
+
+	public:
+		FileCv(int lane, int holdSamples, const std::string& path)
+			: CvSource(lane, holdSamples)
+		{
+			const auto extension = path.substr(path.find_last_of('.') + 1);
+			_binary = extension == "f32" || extension == "raw";
+			_file.open(path, _binary ? std::ios::binary : std::ios::in);
+			if (!_file)
+				throw std::runtime_error("cannot open CV file " + path);
+		}
+	};
+
+	class Stage
+	{
+	public:
+		virtual ~Stage() = default;
+		virtual void Process(Lanes& lanes, int count) = 0;
+	};
+
+	template<typename Resampler>
+	class Tb303OscillatorStage : public Stage
+	{
+		tfdsp::Tb303Oscillator<Resampler> _model{ &CreateResampler<Resampler> };
+		Parameter _pitch, _slide, _slideTime, _tuning, _fm, _shape, _wave;
+		bool _linearFm;
+		int _output;
+
+	public:
+		Tb303OscillatorStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _pitch(ReadParameter(stage, "pitch", 0.0, lanes)),
+			  _slide(ReadParameter(stage, "slide", 0.0, lanes)),
+			  _slideTime(ReadParameter(stage, "slide_time", 0.060, lanes)),
+			  _tuning(ReadParameter(stage, "tuning", 0.0, lanes)),
+			  _fm(ReadParameter(stage, "fm", 0.0, lanes)),
+			  _shape(ReadParameter(stage, "shape", 0.0, lanes)),
+			  _wave(ReadParameter(stage, "wave", 0.0, lanes)),
+			  _linearFm(stage.BoolOr("linear_fm", false)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = _model.Step(_pitch.At(lanes, i), _slide.At(lanes, i) >= 1.0,
+					_slideTime.At(lanes, i), _tuning.At(lanes, i), _fm.At(lanes, i),
+					_linearFm, _shape.At(lanes, i), _wave.At(lanes, i)).mixed;
+		}
+	};
+
+	template<typename Resampler>
+	class WavefoldOscillatorStage : public Stage
+	{
+		tfdsp::WavefoldOscillator<Resampler> _model{ &CreateResampler<Resampler> };
+		Parameter _pitch, _morph, _fold, _symmetry;
+		int _output;
+
+	public:
+		WavefoldOscillatorStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _pitch(ReadParameter(stage, "pitch", 0.0, lanes)),
+			  _morph(ReadParameter(stage, "morph", 0.5, lanes)),
+			  _fold(ReadParameter(stage, "fold", 0.4, lanes)),
+			  _symmetry(ReadParameter(stage, "symmetry", 0.0, lanes)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+			_model.SetFolderAntialiasing(stage.BoolOr("folder_antialiasing", true));
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = 5.0 * _model.Step(C4Hz * std::exp2(_pitch.At(lanes, i)),
+					_morph.At(lanes, i), _fold.At(lanes, i), _symmetry.At(lanes, i));
+		}
+	};
+
+	template<typename Resampler>
+	class DiodeLadderFilterStage : public Stage
+	{
+		tfdsp::DiodeLadderFilter<Resampler> _model{ MakeResampler<Resampler>() };
+		Parameter _input, _cutoff, _resonance, _drive, _bass;
+		bool _highResonance;
+		int _output;
+
+	public:
+		DiodeLadderFilterStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _input(ReadInput(stage, lanes)),
+			  _cutoff(ReadParameter(stage, "cutoff", 0.0, lanes)),
+			  _resonance(ReadParameter(stage, "resonance", 0.0, lanes)),
+			  _drive(ReadParameter(stage, "drive", 1.0, lanes)),
+			  _bass(ReadParameter(stage, "bass", 0.0, lanes)),
+			  _highResonance(stage.BoolOr("high_resonance", false)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			const double log2C4 = std::log2(C4Hz);
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = _model.StepLogCutoffModulated(_input.At(lanes, i),
+					log2C4 + _cutoff.At(lanes, i), 0.0, _resonance.At(lanes, i),
+					_highResonance, _drive.At(lanes, i), _bass.At(lanes, i));
+		}
+	};
+
+	template<typename Resampler>
+	class Arp4072FilterStage : public Stage
+	{
+		tfdsp::Arp4072Filter<Resampler> _model{ MakeResampler<Resampler>() };
+		Parameter _input, _cutoff, _resonance, _drive;
+		int _output;
+
+	public:
+		Arp4072FilterStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _input(ReadInput(stage, lanes)),
+			  _cutoff(ReadParameter(stage, "cutoff", 0.0, lanes)),
+			  _resonance(ReadParameter(stage, "resonance", 0.0, lanes)),
+			  _drive(ReadParameter(stage, "drive", 1.0, lanes)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			const double log2C4 = std::log2(C4Hz);
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = _model.StepLogCutoff(_input.At(lanes, i), log2C4 + _cutoff.At(lanes, i),
+					_resonance.At(lanes, i), _drive.At(lanes, i));
+		}
+	};
+
+	template<typename Resampler>
+	class Arp4019VcaStage : public Stage
+	{
+		tfdsp::Arp4019Vca<Resampler> _model{ MakeResampler<Resampler>() };
+		Parameter _input, _inverting, _linear, _exponential, _initialGain;
+		int _output;
+
+	public:
+		Arp4019VcaStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _input(ReadInput(stage, lanes)),
+			  _inverting(ReadParameter(stage, "inverting_input", 0.0, lanes)),
+			  _linear(ReadParameter(stage, "linear", 0.0, lanes)),
+			  _exponential(ReadParameter(stage, "exponential", 0.0, lanes)),
+			  _initialGain(ReadParameter(stage, "initial_gain", 0.0, lanes)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = _model.Step(_input.At(lanes, i), _inverting.At(lanes, i),
+					_linear.At(lanes, i), _exponential.At(lanes, i), _initialGain.At(lanes, i));
+		}
+	};
+
+	/** The BA662 VCA runs at the host rate here, the voice core runs it inside the filter's oversampled loop. */
+	class Tb303VcaStage : public Stage
+	{
+		tfdsp::Tb303Vca _model;
+		Parameter _input, _control, _accent;
+		int _output;
+
+	public:
+		Tb303VcaStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _input(ReadInput(stage, lanes)),
+			  _control(ReadParameter(stage, "control", 1.0, lanes)),
+			  _accent(ReadParameter(stage, "accent", 0.0, lanes)),
+			  _output(lanes.Output(stage.StringOr("output", "audio")))
+		{
+			_model.SetSampleRate(sampleRate);
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = _model.Step(_input.At(lanes, i), _control.At(lanes, i), _accent.At(lanes, i));
+		}
+	};
+
+	class ArpEnvelopeStage : public Stage
+	{
+		tfdsp::ArpEnvelope _model;
+		Parameter _gate, _trigger, _attack, _decay, _sustain, _release, _curve;
+		bool _autoGateTrigger;
+		int _output;
+
+		static tfdsp::ArpEnvelope::Mode ReadMode(const JsonValue& stage)
+		{
+			const std::string mode = stage.StringOr("mode", "adsr");
+			if (mode == "adsr")
+				return tfdsp::ArpEnvelope::Mode::Adsr;
+			if (mode == "ad")
+				return tfdsp::ArpEnvelope::Mode::Ad;
+			if (mode == "ar")
+				return tfdsp::ArpEnvelope::Mode::Ar;
+			throw std::runtime_error("unknown ArpEnvelope mode \"" + mode + "\"");
+		}
+
+	public:
+		ArpEnvelopeStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+			: _gate(ReadParameter(stage, "gate", 0.0, lanes)),
+			  _trigger(ReadParameter(stage, "trigger", 0.0, lanes)),
+			  _attack(ReadParameter(stage, "attack", 0.005, lanes)),
+			  _decay(ReadParameter(stage, "decay", 0.3, lanes)),
+			  _sustain(ReadParameter(stage, "sustain", 0.5, lanes)),
+			  _release(ReadParameter(stage, "release", 0.3, lanes)),
+			  _curve(ReadParameter(stage, "curve", 0.0, lanes)),
+			  _autoGateTrigger(!stage.Find("trigger")),
+			  _output(lanes.Output(stage.StringOr("output", "envelope")))
+		{
+			_model.SetSampleRate(sampleRate);
+			_model.SetMode(ReadMode(stage));
+		}
+
+		void Process(Lanes& lanes, int count) override
+		{
+			double* out = lanes.Data(_output);
+			for (int i = 0; i < count; ++i)
+				out[i] = 10.0 * _model.Step(_gate.At(lanes, i), _trigger.At(lanes, i),
+					_attack.At(lanes, i), _decay.At(lanes, i), _sustain.At(lanes, i),
+					_release.At(lanes, i), _curve.At(lanes, i), _autoGateTrigger);
+		}
+	};
+
+	template<template<typename> class StageType>
+	std::unique_ptr<Stage> CreateOversampledStage(const JsonValue& stage, Lanes& lanes,
+		double sampleRate)
+	{
+		const int oversampling = static_cast<int>(stage.NumberOr("oversampling", 2.0));
+		switch (oversampling)
+		{
+		case 1:
+			return std::make_unique<StageType<tfdsp::DummyResampler>>(stage, lanes, sampleRate);
+		case 2:
+			return std::make_unique<StageType<tfdsp::X2Resampler_Order7>>(stage, lanes, sampleRate);
+		case 4:
+			return std::make_unique<StageType<tfdsp::X4Resampler_Order7>>(stage, lanes, sampleRate);
+		default:
+			throw std::runtime_error("oversampling must be 1, 2 or 4, got " + std::to_string(oversampling));
+		}
+	}
+
+	inline std::unique_ptr<Stage> CreateStage(const JsonValue& stage, Lanes& lanes, double sampleRate)
+	{
+		const std::string type = stage.StringOr("type", "");
+		if (type == "Tb303Oscillator")
+			return CreateOversampledStage<Tb303OscillatorStage>(stage, lanes, sampleRate);
+		if (type == "WavefoldOscillator")
+			return CreateOversampledStage<WavefoldOscillatorStage>(stage, lanes, sampleRate);
+		if (type == "DiodeLadderFilter")
+			return CreateOversampledStage<DiodeLadderFilterStage>(stage, lanes, sampleRate);
+		if (type == "Arp4072Filter")
+			return CreateOversampledStage<Arp4072FilterStage>(stage, lanes, sampleRate);
+		if (type == "Arp4019Vca")
+			return CreateOversampledStage<Arp4019VcaStage>(stage, lanes, sampleRate);
+		if (type == "Tb303Vca")
+			return std::make_unique<Tb303VcaStage>(stage, lanes, sampleRate);
+		if (type == "ArpEnvelope")
+			return std::make_unique<ArpEnvelopeStage>(stage, lanes, sampleRate);
+		throw std::runtime_error("unknown stage type \"" + type + "\"");
+	}
+
+	/** One independent voice: CV sources, a stage chain and an output lane. */
+	class Voice
+	{
+		std::string _name;
+		std::string _outputPath;
+		long _totalSamples;
+		Lanes _lanes;
+		std::vector<std::unique_ptr<CvSource>> _sources;
+		std::vector<std::unique_ptr<Stage>> _stages;
+		int _outputLane;
+
+		void AddCvSource(const std::string& lane, const JsonValue& source, double sampleRate,
+			const std::string& baseDirectory)
+		{
+			const int index = _lanes.Output(lane);
+			const double rate = source.NumberOr("sample_rate", sampleRate);
+			if (!(rate > 0.0) || rate > sampleRate)
+				throw std::runtime_error("CV \"" + lane + "\" sample_rate must be in (0, host rate]");
+			const int holdSamples = static_cast<int>(std::lround(sampleRate / rate));
+			if (source.Find("file"))
+			{
+				std::string path = source.StringOr("file", "");
+				if (!path.empty() && path[0] != '/' && !baseDirectory.empty())
+					path = baseDirectory + "/" + path;
+				_sources.push_back(std::make_unique<FileCv>(index, holdSamples, path));
+			}
+			else if (const JsonValue* values = source.Find("values"); values && values->IsArray())
+			{
+				std::vector<double> sequence;
+				for (const auto& value : values->array)
+				{
+					if (!value.IsNumber())
+						throw std::runtime_error("CV \"" + lane + "\" values must be numbers");
+					sequence.push_back(value.number);
+				}
+				_sources.push_back(std::make_unique<SequenceCv>(index, holdSamples,
+					std::move(sequence), source.BoolOr("loop", true)));
+			}
+			else
+				throw std::runtime_error("CV \"" + lane + "\" needs a \"file\" or a \"values\" array");
+		}
+
+	public:
+		Voice(const JsonValue& description, double sampleRate, int blockSize,
+			const std::string& baseDirectory)
+			: _name(description.StringOr("name", "voice")),
+			  _totalSamples(std::lround(description.NumberOr("duration_seconds", 0.0) * sampleRate)),
+			  _lanes(blockSize)
+		{
+			_outputPath = description.StringOr("file", _name + ".wav");
+			if (_totalSamples <= 0)
+				throw std::runtime_error("voice \"" + _name + "\" needs a positive duration_seconds");
+			if (const JsonValue* cv = description.Find("cv"))
+				for (const auto& [lane, source] : cv->object)
+					AddCvSource(lane, source, sampleRate, baseDirectory);
+			const JsonValue* chain = description.Find("chain");
+			if (!chain || !chain->IsArray() || chain->array.empty())
+				throw std::runtime_error("voice \"" + _name + "\" needs a non-empty \"chain\" array");
+			for (const auto& stage : chain->array)
+				_stages.push_back(CreateStage(stage, _lanes, sampleRate));
+			_outputLane = _lanes.Input(description.StringOr("output", "audio"));
+		}
+
+		const std::string& Name() const { return _name; }
+		const std::string& OutputPath() const { return _outputPath; }
+		long TotalSamples() const { return _totalSamples; }
+
+		/** Render up to one block into out, returns the number of samples written. */
+		int RenderBlock(float* out, long renderedSoFar)
+		{
+			const int count = static_cast<int>(std::min<long>(_lanes.BlockSize(),
+				_totalSamples - renderedSoFar));
+			for (auto& source : _sources)
+				source->Fill(_lanes, count);
+			for (auto& stage : _stages)
+				stage->Process(_lanes, count);
+			const double* output = _lanes.Data(_outputLane);
+			for (int i = 0; i < count; ++i)
+				out[i] = static_cast<float>(output[i]);
+			return count;
+		}
+	};
+}